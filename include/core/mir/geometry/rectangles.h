@@ -59,6 +59,14 @@ private:
 
 std::ostream& operator<<(std::ostream& out, Rectangles const& value);
 
+/**
+ * The parts of \a region not covered by \a hole
+ *
+ * Each rectangle of \a region is split into at most four, so if the rectangles of
+ * \a region don't overlap, neither do those of the result.
+ */
+Rectangles difference_of(Rectangles const& region, Rectangle const& hole);
+
 }
 }
 
@@ -74,6 +74,19 @@ public:
     **/
     virtual bool overlay(std::vector<DisplayElement> const& renderlist) = 0;
 
+    /** Whether overlay() would show \a overlays above a rendered image
+     *
+     *  This lets the caller find out whether it can put the top of the scene on
+     *  overlays before rendering the rest of it.
+     *  \param [in] overlays
+     *      The elements that would follow the rendered image, which covers the
+     *      whole of view_area(), in the list passed to overlay().
+     *  \returns
+     *      True if overlay() will accept a list of an image rendered for this
+     *      DisplaySink followed by \a overlays; False otherwise (the default).
+    **/
+    virtual bool accepts_overlays(std::vector<DisplayElement> const& /*overlays*/) { return false; }
+
     /**
      * Set the content for the next submission of this display
      *
@@ -18,6 +18,7 @@
 #define MIR_GRAPHICS_GRAPHIC_BUFFER_ALLOCATOR_H_
 
 #include "mir/graphics/buffer.h"
+#include "mir/geometry/rectangle.h"
 
 #include <vector>
 #include <memory>
@@ -86,8 +87,20 @@ public:
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release) = 0;
 
+    /**
+     * Create a Buffer for a client's shared-memory pixels
+     *
+     * \param shm_data [in]    The client's pixels
+     * \param previous [in]    The buffer previously submitted for the same surface, or nullptr.
+     *                         The new buffer may reuse resources (such as a texture) from it.
+     * \param damage [in]      The area of shm_data, in buffer coordinates, that differs from \a previous
+     * \param on_consumed [in] Called when the buffer's content is first used
+     * \param on_release [in]  Called when the buffer is no longer used
+     */
     virtual auto buffer_from_shm(
         std::shared_ptr<renderer::software::RWMappableBuffer> shm_data,
+        std::shared_ptr<Buffer> const& previous,
+        geometry::Rectangle const& damage,
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release) -> std::shared_ptr<Buffer> = 0;
 
@@ -23,6 +23,7 @@
 #include <gbm.h>
 
 #include "mir/graphics/drm_formats.h"
+#include "mir/geometry/rectangle.h"
 #include "mir/module_properties.h"
 #include "mir/module_deleter.h"
 #include "mir/renderer/sw/pixel_source.h"
@@ -309,6 +310,18 @@ public:
         virtual ~MappableFB() override = default;
 
         using renderer::software::WriteMappableBuffer::size;
+
+        /**
+         * The part of the buffer that needs writing, if the rest already holds what will be drawn there.
+         *
+         * This is only known once the buffer has been mapped with map_writeable().
+         *
+         * \return std::nullopt if the whole buffer needs writing
+         */
+        virtual auto damage() const -> std::optional<geometry::Rectangle>
+        {
+            return std::nullopt;
+        }
     };
 
     virtual auto supported_formats() const
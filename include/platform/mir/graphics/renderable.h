@@ -19,6 +19,7 @@
 
 #include <optional>
 #include <mir/geometry/rectangle.h>
+#include <mir/geometry/rectangles.h>
 #include <glm/glm.hpp>
 #include <memory>
 #include <vector>
@@ -69,6 +70,14 @@ public:
     virtual glm::mat4 transformation() const = 0;
 
     virtual bool shaped() const = 0;  // meaning the pixel format has alpha
+
+    /**
+     * Areas of screen_position(), in screen coordinates, that are known to be
+     * fully opaque even though the renderable is shaped().
+     *
+     * Only meaningful when alpha() is 1. Empty if nothing is known to be opaque.
+     */
+    virtual geometry::Rectangles opaque_region() const = 0;
 protected:
     Renderable() = default;
     Renderable(Renderable const&) = delete;
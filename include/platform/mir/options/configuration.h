@@ -30,6 +30,7 @@ extern char const* const enable_input_opt;
 extern char const* const shared_library_prober_report_opt;
 extern char const* const shell_report_opt;
 extern char const* const compositor_report_opt;
+extern char const* const compositor_metrics_opt;
 extern char const* const display_report_opt;
 extern char const* const scene_report_opt;
 extern char const* const input_report_opt;
@@ -46,6 +47,7 @@ extern char const* const wayland_extensions_opt;
 extern char const* const add_wayland_extensions_opt;
 extern char const* const drop_wayland_extensions_opt;
 extern char const* const idle_timeout_opt;
+extern char const* const damage_tracking_opt;
 
 extern char const* const enable_key_repeat_opt;
 
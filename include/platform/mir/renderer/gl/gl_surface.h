@@ -44,6 +44,16 @@ public:
     /// Size, in pixels, of the underlying surface
     virtual auto size() const -> mir::geometry::Size = 0;
 
+    /**
+     * Age, in frames, of the contents of the buffer that will be rendered into next
+     *
+     * This has the semantics of EGL_EXT_buffer_age: a value of n means the buffer holds
+     * the image committed n frames ago, and 0 means the contents are undefined.
+     *
+     * \note Only meaningful after bind() has been called for the frame
+     */
+    virtual auto buffer_age() const -> int = 0;
+
     enum class Layout
     {
         TopRowFirst,            //< First row has y-coördinate 0, y increases with each row.
@@ -23,7 +23,10 @@
 #include <boost/throw_exception.hpp>
 
 #include <algorithm>
+#include <mutex>
+#include <new>
 #include <stdexcept>
+#include <vector>
 
 namespace mi = mir::input;
 namespace mf = mir::frontend;
@@ -44,6 +47,101 @@ mir::EventUPtr make_uptr_event(T* e)
 {
     return mir::EventUPtr(e, ([](MirEvent* e) { delete reinterpret_cast<T*>(e); }));
 }
+
+/**
+ * Recycles the storage of one type of input event
+ *
+ * Input events are created at the rate devices report them (1000Hz for some mice)
+ * and cloned for each surface they're delivered to, then destroyed on whichever
+ * thread last used them. Keeping some freed blocks to reuse saves a round trip
+ * through the allocator for each of them.
+ */
+template<typename Type>
+class EventPool
+{
+public:
+    static_assert(alignof(Type) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+    static auto instance() -> EventPool&
+    {
+        // Deliberately leaked: events can be destroyed during static destruction
+        static auto const pool = new EventPool;
+        return *pool;
+    }
+
+    template<typename... Args>
+    auto make(Args&&... args) -> Type*
+    {
+        auto const block = take();
+        try
+        {
+            return new (block) Type(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            give_back(block);
+            throw;
+        }
+    }
+
+    static void destroy(MirEvent* event)
+    {
+        auto const typed = reinterpret_cast<Type*>(event);
+        typed->~Type();
+        instance().give_back(typed);
+    }
+
+private:
+    EventPool()
+    {
+        free_blocks.reserve(max_free_blocks);
+    }
+
+    auto take() -> void*
+    {
+        {
+            std::lock_guard lock{mutex};
+            if (!free_blocks.empty())
+            {
+                auto const block = free_blocks.back();
+                free_blocks.pop_back();
+                return block;
+            }
+        }
+        return ::operator new(sizeof(Type));
+    }
+
+    void give_back(void* block)
+    {
+        {
+            std::lock_guard lock{mutex};
+            if (free_blocks.size() < max_free_blocks)
+            {
+                free_blocks.push_back(block);
+                return;
+            }
+        }
+        ::operator delete(block);
+    }
+
+    // Enough for a burst of events queued for several surfaces
+    static size_t constexpr max_free_blocks{64};
+
+    std::mutex mutex;
+    std::vector<void*> free_blocks;
+};
+
+template<typename Type, typename... Args>
+auto new_pooled_event(Args&&... args) -> Type*
+{
+    return EventPool<Type>::instance().make(std::forward<Args>(args)...);
+}
+
+template <class T>
+mir::EventUPtr make_pooled_uptr_event(T* e)
+{
+    return mir::EventUPtr(e, &EventPool<T>::destroy);
+}
 }
 
 mir::EventUPtr mev::make_surface_orientation_event(mf::SurfaceId const& surface_id, MirOrientation orientation)
@@ -151,7 +249,7 @@ mir::EventUPtr mev::make_key_event(
     int scan_code,
     MirInputEventModifiers modifiers)
 {
-    auto e = new_event<MirKeyboardEvent>();
+    auto e = new_pooled_event<MirKeyboardEvent>();
 
     e->set_device_id(device_id);
     e->set_event_time(timestamp);
@@ -160,7 +258,7 @@ mir::EventUPtr mev::make_key_event(
     e->set_scan_code(scan_code);
     e->set_modifiers(modifiers);
 
-    return make_uptr_event(e);
+    return make_pooled_uptr_event(e);
 }
 
 void mev::set_modifier(MirEvent& event, MirInputEventModifiers modifiers)
@@ -199,13 +297,13 @@ mir::EventUPtr mev::make_touch_event(
     std::chrono::nanoseconds timestamp,
     MirInputEventModifiers modifiers)
 {
-    auto e = new_event<MirTouchEvent>();
+    auto e = new_pooled_event<MirTouchEvent>();
 
     e->set_device_id(device_id);
     e->set_event_time(timestamp);
     e->set_modifiers(modifiers);
 
-    return make_uptr_event(e);
+    return make_pooled_uptr_event(e);
 }
 
 void mev::add_touch(
@@ -247,7 +345,7 @@ mir::EventUPtr mev::make_pointer_event(
     events::ScrollAxisV1H h_scroll,
     events::ScrollAxisV1V v_scroll)
 {
-    return make_uptr_event(new MirPointerEvent(
+    return make_pooled_uptr_event(new_pooled_event<MirPointerEvent>(
         device_id,
         timestamp,
         mods,
@@ -372,6 +470,26 @@ mir::EventUPtr mev::make_input_configure_event(
 
 mir::EventUPtr mev::clone_event(MirEvent const& event)
 {
+    // Input events are cloned for every surface they're delivered to
+    if (event.type() == mir_event_type_input)
+    {
+        auto const input_event = event.to_input();
+        switch (input_event->input_type())
+        {
+        case mir_input_event_type_key:
+            return make_pooled_uptr_event(new_pooled_event<MirKeyboardEvent>(*input_event->to_keyboard()));
+
+        case mir_input_event_type_touch:
+            return make_pooled_uptr_event(new_pooled_event<MirTouchEvent>(*input_event->to_touch()));
+
+        case mir_input_event_type_pointer:
+            return make_pooled_uptr_event(new_pooled_event<MirPointerEvent>(*input_event->to_pointer()));
+
+        default:
+            break;
+        }
+    }
+
     return make_uptr_event(event.clone());
 }
 
@@ -430,8 +548,8 @@ mir::EventUPtr mev::make_touch_event(
     std::vector<mev::TouchContactV1> const& contacts)
 {
     std::vector<mev::TouchContact> contacts_new{begin(contacts), end(contacts)};
-    auto e = new_event<MirTouchEvent>(device_id, timestamp, modifiers, contacts_new);
-    return make_uptr_event(e);
+    auto e = new_pooled_event<MirTouchEvent>(device_id, timestamp, modifiers, contacts_new);
+    return make_pooled_uptr_event(e);
 }
 
 // Intentionally uses TouchContactV2 instad of TouchContact as a reminder that a new copy of this function will be needed
@@ -442,8 +560,8 @@ mir::EventUPtr mev::make_touch_event(
     MirInputEventModifiers modifiers,
     std::vector<mev::TouchContactV2> const& contacts)
 {
-    auto e = new_event<MirTouchEvent>(device_id, timestamp, modifiers, contacts);
-    return make_uptr_event(e);
+    auto e = new_pooled_event<MirTouchEvent>(device_id, timestamp, modifiers, contacts);
+    return make_pooled_uptr_event(e);
 }
 
 void mev::set_window_id(MirEvent& event, int window_id)
@@ -200,3 +200,28 @@ std::ostream& geom::operator<<(std::ostream& out, Rectangles const& value)
     out << ']';
     return out;
 }
+
+geom::Rectangles geom::difference_of(Rectangles const& region, Rectangle const& hole)
+{
+    Rectangles result;
+    for (auto const& rect : region)
+    {
+        auto const overlap = intersection_of(rect, hole);
+        if (overlap.size.width == Width{0} || overlap.size.height == Height{0})
+        {
+            result.add(rect);
+            continue;
+        }
+
+        // Full-width bands above and below the overlap, then what's left either side of it
+        if (overlap.top() > rect.top())
+            result.add(rect_from_points(rect.top_left, {rect.right(), overlap.top()}));
+        if (overlap.bottom() < rect.bottom())
+            result.add(rect_from_points({rect.left(), overlap.bottom()}, rect.bottom_right()));
+        if (overlap.left() > rect.left())
+            result.add(rect_from_points({rect.left(), overlap.top()}, overlap.bottom_left()));
+        if (overlap.right() < rect.right())
+            result.add(rect_from_points(overlap.top_right(), {rect.right(), overlap.bottom()}));
+    }
+    return result;
+}
@@ -29,10 +29,14 @@ class CompositorReport
 public:
     typedef const void* SubCompositorId;  // e.g. thread/display buffer ID
     virtual void added_display(int width, int height, int x, int y, SubCompositorId id) = 0;
+    virtual void began_scene_snapshot(SubCompositorId id) = 0;
     virtual void began_frame(SubCompositorId id) = 0;
+    virtual void filtered_occlusions(SubCompositorId id) = 0;
     virtual void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) = 0;
     virtual void rendered_frame(SubCompositorId id) = 0;
     virtual void finished_frame(SubCompositorId id) = 0;
+    /// The frame finished by \a id has been posted, \a missed_vblanks later than it could have been
+    virtual void posted_frame(SubCompositorId id, int missed_vblanks) = 0;
     virtual void started() = 0;
     virtual void stopped() = 0;
     virtual void scheduled() = 0;
@@ -18,6 +18,7 @@
 #define MIR_COMPOSITOR_SCENE_H_
 
 #include "compositor_id.h"
+#include "mir/geometry/rectangle.h"
 
 #include <memory>
 #include <vector>
@@ -65,6 +66,14 @@ public:
     virtual void register_compositor(CompositorID id) = 0;
     virtual void unregister_compositor(CompositorID id) = 0;
 
+    /**
+     * Let the scene know that compositor \a id only draws \a area.
+     *
+     * The scene may then leave out of scene_elements_for() and frames_pending() anything
+     * entirely outside \a area. Scenes are free to ignore this.
+     */
+    virtual void set_compositor_area(CompositorID /*id*/, geometry::Rectangle const& /*area*/) {}
+
     virtual void add_observer(std::shared_ptr<scene::Observer> const& observer) = 0;
     virtual void remove_observer(std::weak_ptr<scene::Observer> const& observer) = 0;
 
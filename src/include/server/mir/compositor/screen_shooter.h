@@ -49,6 +49,17 @@ public:
         mir::geometry::Rectangle const& area,
         std::function<void(std::optional<time::Timestamp>)>&& callback) = 0;
 
+    /// As capture(), but \a buffer already holds the previous capture of \a area and only \a buffer_damage (in
+    /// buffer coordinates) has changed since. Implementations may update more of \a buffer than that.
+    virtual void capture_with_damage(
+        std::shared_ptr<renderer::software::WriteMappableBuffer> const& buffer,
+        mir::geometry::Rectangle const& area,
+        mir::geometry::Rectangle const& /*buffer_damage*/,
+        std::function<void(std::optional<time::Timestamp>)>&& callback)
+    {
+        capture(buffer, area, std::move(callback));
+    }
+
 private:
     ScreenShooter(ScreenShooter const&) = delete;
     ScreenShooter& operator=(ScreenShooter const&) = delete;
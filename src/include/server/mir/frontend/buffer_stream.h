@@ -20,6 +20,7 @@
 #include <mir_toolkit/common.h>
 #include "mir/graphics/buffer_id.h"
 #include "mir/geometry/size.h"
+#include "mir/geometry/rectangle.h"
 #include <functional>
 #include <memory>
 
@@ -39,10 +40,17 @@ class BufferStream
 public:
     virtual ~BufferStream() = default;
 
+    /// Submit a buffer, treating its entire content as changed
     virtual void submit_buffer(std::shared_ptr<graphics::Buffer> const& buffer) = 0;
+    /// Submit a buffer that differs from the previously submitted one only within \a damage
+    /// (in buffer coordinates)
+    virtual void submit_buffer(
+        std::shared_ptr<graphics::Buffer> const& buffer,
+        geometry::Rectangle const& damage) = 0;
 
+    /// The callback receives the size of the submitted buffer and the damaged area of it (in buffer coordinates)
     virtual void set_frame_posted_callback(
-        std::function<void(geometry::Size const&)> const& callback) = 0;
+        std::function<void(geometry::Size const&, geometry::Rectangle const&)> const& callback) = 0;
 
     virtual void with_most_recent_buffer_do(
         std::function<void(graphics::Buffer&)> const& exec) = 0;
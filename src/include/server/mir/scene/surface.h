@@ -39,6 +39,8 @@ struct StreamInfo
     std::shared_ptr<compositor::BufferStream> stream;
     geometry::Displacement displacement;
     optional_value<geometry::Size> size;
+    /// Parts of the stream (relative to its top left) known to be opaque
+    geometry::Rectangles opaque_region{};
 };
 
 class SurfaceObserver;
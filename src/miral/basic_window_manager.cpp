@@ -79,6 +79,11 @@ miral::BasicWindowManager::Locker::Locker(BasicWindowManager* self) :
     policy{self->policy.get()}
 {
     policy->advise_begin();
+
+    // This runs for every input event, so avoid the dead workspaces mutex unless there's something to collect
+    if (!self->dead_workspaces->any_dead.exchange(false))
+        return;
+
     std::vector<std::weak_ptr<Workspace>> workspaces;
     {
         std::lock_guard const lock{self->dead_workspaces->dead_workspaces_mutex};
@@ -139,20 +144,63 @@ auto miral::BasicWindowManager::add_surface(
         shell::SurfaceSpecification const& params)> const& build)
 -> std::shared_ptr<scene::Surface>
 {
+    WindowSpecification spec;
+    geometry::Rectangles placed_on;
+    {
+        Locker lock{this};
+        spec = policy->place_new_window(info_for(session), place_new_surface(params));
+        placed_on = outputs;
+    }
+
+    // Building the surface doesn't involve the policy, so input and other window management needn't wait for it
+    auto const surface = build(session, make_surface_spec(spec));
+
     Locker lock{this};
 
-    auto& session_info = info_for(session);
+    if (app_info.find(session) == app_info.end())
+    {
+        session->destroy_surface(surface);
+        BOOST_THROW_EXCEPTION(std::runtime_error("Session was removed while adding a surface"));
+    }
 
-    WindowSpecification spec = policy->place_new_window(session_info, place_new_surface(params));
+    auto& session_info = info_for(session);
 
-    auto const surface = build(session, make_surface_spec(spec));
     Window const window{session, surface};
+
+    auto const parent_known = [this](WindowSpecification const& spec)
+        {
+            if (!spec.parent().is_set())
+                return true;
+
+            auto const parent_surface = spec.parent().value().lock();
+            return parent_surface && this->window_info.find(parent_surface) != this->window_info.end();
+        };
+
+    // The parent or outputs the window was placed against may have changed while the surface was being built.
+    // (Workspaces are taken from the parent below, so are current.)
+    if (!parent_known(spec) || outputs != placed_on)
+    {
+        WindowSpecification replacement{params};
+        if (!parent_known(replacement))
+            replacement.parent().consume();
+
+        spec = policy->place_new_window(session_info, place_new_surface(replacement));
+
+        if (spec.top_left().is_set())
+            surface->move_to(spec.top_left().value());
+        if (spec.size().is_set())
+            surface->resize(spec.size().value());
+        if (spec.state().is_set())
+            surface->configure(mir_window_attrib_state, spec.state().value());
+    }
+
     auto& window_info = this->window_info.emplace(window, WindowInfo{window, spec}).first->second;
 
     session_info.add_window(window);
 
     auto const parent_surface = spec.parent().is_set() ? spec.parent().value().lock() : nullptr;
-    auto const parent = parent_surface ? info_for(parent_surface).window() : Window{};
+    auto const parent_info = parent_surface ? this->window_info.find(parent_surface) : this->window_info.end();
+    auto const parent = parent_info != this->window_info.end() ? parent_info->second.window() : Window{};
     window_info.parent(parent);
     if (parent)
     {
@@ -290,15 +338,9 @@ void miral::BasicWindowManager::refocus(
                 // select_active_window() calls set_focus_to() which updates mru_active_windows and changes window
                 auto const w = window;
 
-                for (auto const& workspace : workspaces_containing(w))
+                if (shares_workspace(w, workspaces_containing_window))
                 {
-                    for (auto const& ww : workspaces_containing_window)
-                    {
-                        if (ww == workspace)
-                        {
-                            return !(new_focus = select_active_window(w));
-                        }
-                    }
+                    return !(new_focus = select_active_window(w));
                 }
 
                 return true;
@@ -663,6 +705,28 @@ auto miral::BasicWindowManager::workspaces_containing(Window const& window) cons
     return workspaces_containing_window;
 }
 
+auto miral::BasicWindowManager::shares_workspace(
+    Window const& window,
+    std::vector<std::shared_ptr<Workspace>> const& workspaces) const -> bool
+{
+    if (workspaces.empty())
+        return false;
+
+    auto const iter_pair = workspaces_to_windows.right.equal_range(window);
+
+    for (auto kv = iter_pair.first; kv != iter_pair.second; ++kv)
+    {
+        // Comparing owners avoids locking each weak_ptr (an expired one can't share an owner with a live workspace)
+        for (auto const& workspace : workspaces)
+        {
+            if (!kv->second.owner_before(workspace) && !workspace.owner_before(kv->second))
+                return true;
+        }
+    }
+
+    return false;
+}
+
 auto miral::BasicWindowManager::active_display_area() const -> std::shared_ptr<DisplayArea>
 {
     // If a window has input focus, return its display area
@@ -719,11 +783,8 @@ auto miral::BasicWindowManager::display_area_for(WindowInfo const& info) const -
 
     for (auto& area : display_areas)
     {
-        for (auto& area_window : area->attached_windows)
-        {
-            if (area_window == window)
-                return area;
-        }
+        if (area->attached_windows.contains(window))
+            return area;
     }
 
     // If the window is not explicity attached to any area, find the area it overlaps most with
@@ -783,32 +844,20 @@ void miral::BasicWindowManager::focus_next_within_application()
         {
             while (++current != end(siblings))
             {
-                for (auto const& workspace : workspaces_containing(*current))
+                if (shares_workspace(*current, workspaces_containing_window) &&
+                    prev != select_active_window(*current))
                 {
-                    for (auto const& ww : workspaces_containing_window)
-                    {
-                        if (ww == workspace)
-                        {
-                            if (prev != select_active_window(*current))
-                                return;
-                        }
-                    }
+                    return;
                 }
             }
         }
 
         for (current = begin(siblings); *current != prev; ++current)
         {
-            for (auto const& workspace : workspaces_containing(*current))
+            if (shares_workspace(*current, workspaces_containing_window) &&
+                prev != select_active_window(*current))
             {
-                for (auto const& ww : workspaces_containing_window)
-                {
-                    if (ww == workspace)
-                    {
-                        if (prev != select_active_window(*current))
-                            return;
-                    }
-                }
+                return;
             }
         }
 
@@ -840,32 +889,20 @@ void miral::BasicWindowManager::focus_prev_within_application()
         {
             while (++current != rend(siblings))
             {
-                for (auto const& workspace : workspaces_containing(*current))
+                if (shares_workspace(*current, workspaces_containing_window) &&
+                    prev != select_active_window(*current))
                 {
-                    for (auto const& ww : workspaces_containing_window)
-                    {
-                        if (ww == workspace)
-                        {
-                            if (prev != select_active_window(*current))
-                                return;
-                        }
-                    }
+                    return;
                 }
             }
         }
 
         for (current = rbegin(siblings); *current != prev; ++current)
         {
-            for (auto const& workspace : workspaces_containing(*current))
+            if (shares_workspace(*current, workspaces_containing_window) &&
+                prev != select_active_window(*current))
             {
-                for (auto const& ww : workspaces_containing_window)
-                {
-                    if (ww == workspace)
-                    {
-                        if (prev != select_active_window(*current))
-                            return;
-                    }
-                }
+                return;
             }
         }
 
@@ -928,8 +965,13 @@ auto miral::BasicWindowManager::window_to_select_application(const Application a
 auto miral::BasicWindowManager::window_at(geometry::Point cursor) const
 -> Window
 {
-    auto surface_at = focus_controller->surface_at(cursor);
-    return surface_at ? info_for(surface_at).window() : Window{};
+    // The surface may not be known yet if add_surface() is still building it
+    if (auto const surface_at = focus_controller->surface_at(cursor))
+    {
+        if (auto const info = window_info.find(surface_at); info != window_info.end())
+            return info->second.window();
+    }
+    return Window{};
 }
 
 auto miral::BasicWindowManager::active_output() -> geometry::Rectangle const
@@ -1582,15 +1624,9 @@ void miral::BasicWindowManager::set_state(miral::WindowInfo& window_info, MirWin
                         if (candidate == window)
                             return true;
                         auto const w = candidate;
-                        for (auto const& workspace : workspaces_containing(w))
+                        if (shares_workspace(w, workspaces_containing_window))
                         {
-                            for (auto const& ww : workspaces_containing_window)
-                            {
-                                if (ww == workspace)
-                                {
-                                    return !(select_active_window(w));
-                                }
-                            }
+                            return !(select_active_window(w));
                         }
 
                         return true;
@@ -1881,14 +1917,8 @@ auto miral::BasicWindowManager::can_activate_window_for_session_in_workspace(
             if (w.application() != session)
                 return true;
 
-            for (auto const& workspace : workspaces_containing(w))
-            {
-                for (auto const& ww : workspaces)
-                {
-                    if (ww == workspace)
-                        return !(new_focus = select_active_window(w));
-                }
-            }
+            if (shares_workspace(w, workspaces))
+                return !(new_focus = select_active_window(w));
 
             return true;
         });
@@ -2489,6 +2519,7 @@ public:
     {
         std::lock_guard lock {dead_workspaces->dead_workspaces_mutex};
         dead_workspaces->workspaces.push_back(self);
+        dead_workspaces->any_dead = true;
     }
 
 private:
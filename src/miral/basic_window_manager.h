@@ -38,6 +38,7 @@
 #include <optional>
 #include <functional>
 
+#include <atomic>
 #include <map>
 #include <mutex>
 
@@ -242,6 +243,7 @@ private:
     {
         std::mutex mutable dead_workspaces_mutex;
         std::vector<std::weak_ptr<Workspace>> workspaces;
+        std::atomic<bool> any_dead{false}; ///< Whether there may be anything in workspaces
     };
 
     std::shared_ptr<DeadWorkspaces> const dead_workspaces{std::make_shared<DeadWorkspaces>()};
@@ -304,6 +306,9 @@ private:
     void refocus(Application const& application, Window const& parent,
                  std::vector<std::shared_ptr<Workspace>> const& workspaces_containing_window);
     auto workspaces_containing(Window const& window) const -> std::vector<std::shared_ptr<Workspace>>;
+    /// Whether \a window is in any of \a workspaces, without building the list of workspaces containing it
+    auto shares_workspace(Window const& window, std::vector<std::shared_ptr<Workspace>> const& workspaces) const
+        -> bool;
     auto active_display_area() const -> std::shared_ptr<DisplayArea>;
     auto display_area_for_output_id(int output_id) const -> std::shared_ptr<DisplayArea>; ///< returns null if not found
     auto display_area_for(WindowInfo const& info) const -> std::shared_ptr<DisplayArea>;
@@ -31,25 +31,40 @@ bool visible(miral::Window const& window)
 
 void miral::MRUWindowList::push(Window const& window)
 {
-    windows.erase(remove(begin(windows), end(windows), window), end(windows));
-    windows.push_back(window);
+    if (auto const found = positions.find(window); found != positions.end())
+    {
+        windows.splice(windows.begin(), windows, found->second);
+    }
+    else
+    {
+        windows.push_front(window);
+        positions.emplace(window, windows.begin());
+    }
 }
 
 void miral::MRUWindowList::erase(Window const& window)
 {
-    windows.erase(remove(begin(windows), end(windows), window), end(windows));
+    if (auto const found = positions.find(window); found != positions.end())
+    {
+        windows.erase(found->second);
+        positions.erase(found);
+    }
 }
 
 auto miral::MRUWindowList::top() const -> Window
 {
-    auto const& found = std::find_if(rbegin(windows), rend(windows), visible);
-    return (found != rend(windows)) ? *found: Window{};
+    auto const& found = std::find_if(begin(windows), end(windows), visible);
+    return (found != end(windows)) ? *found: Window{};
 }
 
 void miral::MRUWindowList::enumerate(Enumerator const& enumerator) const
 {
-    for (auto i = windows.rbegin(); i != windows.rend(); ++i)
-        if (visible(*i))
-            if (!enumerator(const_cast<Window&>(*i)))
+    // The enumerator may push the window it is given, which moves it to the front: step past it first
+    for (auto i = windows.begin(); i != windows.end();)
+    {
+        auto const current = i++;
+        if (visible(*current))
+            if (!enumerator(const_cast<Window&>(*current)))
                 break;
+    }
 }
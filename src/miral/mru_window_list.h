@@ -20,7 +20,8 @@
 #include <miral/window.h>
 
 #include <functional>
-#include <vector>
+#include <list>
+#include <map>
 
 namespace miral
 {
@@ -37,7 +38,10 @@ public:
     void enumerate(Enumerator const& enumerator) const;
 
 private:
-    std::vector<Window> windows;
+    /// Most recently used first
+    std::list<Window> windows;
+    /// Where each window is in windows. Ordered by owner, so found even once its surface has gone
+    std::map<Window, std::list<Window>::iterator> positions;
 };
 }
 
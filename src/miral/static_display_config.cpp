@@ -63,6 +63,7 @@ char const* const mode = "mode";
 char const* const orientation = "orientation";
 char const* const scale = "scale";
 char const* const group = "group";
+char const* const vrr = "vrr";
 char const* const orientation_value[] = { "normal", "left", "inverted", "right" };
 char const* const layout_suffix = "-layout";
 
@@ -209,6 +210,11 @@ try
                         output_config.group_id = group_id.as<int>();
                     }
 
+                    if (auto const v = port_config[vrr])
+                    {
+                        output_config.vrr = v.as<bool>();
+                    }
+
                     if (auto const m = port_config[mode])
                     {
                         std::istringstream in{m.as<std::string>()};
@@ -393,6 +399,12 @@ void miral::YamlFileDisplayConfig::serialize_output_configuration(
                    "\n        scale: " << conf_output.scale
                 << "\n        group: " << conf_output.logical_group_id.as_value()
                 << "\t# Outputs with the same non-zero value are treated as a single display";
+
+            if (conf_output.vrr_capable)
+            {
+                out << "\n        vrr: " << (conf_output.vrr_enabled ? "on" : "off")
+                    << "\t# Vary the refresh rate to suit fullscreen content, defaults to off";
+            }
         }
     }
     else
@@ -481,6 +493,8 @@ void miral::YamlFileDisplayConfig::apply_to_output(mg::UserDisplayConfigurationO
         {
             conf_output.logical_group_id = mg::DisplayConfigurationLogicalGroupId{};
         }
+
+        conf_output.vrr_enabled = conf.vrr.is_set() && conf.vrr.value();
     }
     else
     {
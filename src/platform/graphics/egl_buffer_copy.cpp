@@ -15,6 +15,7 @@
  */
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
@@ -303,9 +304,7 @@ public:
                 GLubyte const idx[] = { 0, 1, 3, 2 };
                 glDrawElements (GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, idx);
 
-                // TODO: Actually use the sync
-                glFinish();
-                sync->set_value({});
+                sync->set_value(state->flush_with_fence());
 
                 // Unbind all our resources
                 glBindTexture(GL_TEXTURE_2D, 0);
@@ -327,6 +326,43 @@ private:
         GLBufferHandle tex_data;
         PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES;
         PFNGLEGLIMAGETARGETRENDERBUFFERSTORAGEOESPROC glEGLImageTargetRenderbufferStorageOES;
+
+        // Only set if the display supports EGL_ANDROID_native_fence_sync
+        PFNEGLCREATESYNCKHRPROC eglCreateSyncKHR{nullptr};
+        PFNEGLDESTROYSYNCKHRPROC eglDestroySyncKHR{nullptr};
+        PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID{nullptr};
+
+        /**
+         * Submit the commands so far, returning a fence that signals when they complete
+         *
+         * If we can't get a fence, we wait for the commands to complete instead.
+         */
+        auto flush_with_fence() -> std::optional<mir::Fd>
+        {
+            if (eglDupNativeFenceFDANDROID)
+            {
+                auto const dpy = eglGetCurrentDisplay();
+                EGLint const attribs[] = {
+                    EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID,
+                    EGL_NONE};
+                if (auto const sync = eglCreateSyncKHR(dpy, EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+                    sync != EGL_NO_SYNC_KHR)
+                {
+                    // The fence only gets an fd once it has been flushed
+                    glFlush();
+                    auto const fence = eglDupNativeFenceFDANDROID(dpy, sync);
+                    eglDestroySyncKHR(dpy, sync);
+
+                    if (fence != EGL_NO_NATIVE_FENCE_FD_ANDROID)
+                    {
+                        return mir::Fd{fence};
+                    }
+                }
+            }
+
+            glFinish();
+            return std::nullopt;
+        }
     };
     /* This has to be initialised on the EGL thread, but it contains non-default-initialisable state.
      *
@@ -351,6 +387,21 @@ private:
         state->glEGLImageTargetTexture2DOES =
             reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(eglGetProcAddress("glEGLImageTargetTexture2DOES"));
 
+        auto const egl_extensions = eglQueryString(eglGetCurrentDisplay(), EGL_EXTENSIONS);
+        if (egl_extensions && strstr(egl_extensions, "EGL_ANDROID_native_fence_sync"))
+        {
+            state->eglCreateSyncKHR =
+                reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"));
+            state->eglDestroySyncKHR =
+                reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"));
+            state->eglDupNativeFenceFDANDROID =
+                reinterpret_cast<PFNEGLDUPNATIVEFENCEFDANDROIDPROC>(eglGetProcAddress("eglDupNativeFenceFDANDROID"));
+        }
+        else
+        {
+            mir::log_info("EGL_ANDROID_native_fence_sync not supported; cross-GPU copies will be synchronous");
+        }
+
         state->prog = link_shader(compile_shader(GL_VERTEX_SHADER, vshader), compile_shader(GL_FRAGMENT_SHADER, fshader));
 
         glUseProgram(state->prog);
@@ -32,6 +32,8 @@
 #include "mir/graphics/egl_context_executor.h"
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cerrno>
 #include <cstdint>
 #include <cstring>
 #include <stdexcept>
@@ -45,6 +47,8 @@
 #include <utility>
 #include <drm_fourcc.h>
 #include <wayland-server.h>
+#include <poll.h>
+#include <unistd.h>
 
 namespace mg = mir::graphics;
 namespace mgc = mg::common;
@@ -395,10 +399,7 @@ auto export_egl_image(
 }
 
 /**
- * Reimport dmabufs into EGL
- *
- * This is necessary to call each time the buffer is re-submitted by the client,
- * to ensure any state is properly synchronised.
+ * Import dmabufs into EGL
  *
  * \return  An EGLImageKHR handle to the imported
  * \throws  A std::system_error containing the EGL error on failure.
@@ -509,6 +510,50 @@ BufferGLDescription const* descriptor_for_format_and_modifiers(
 
 }
 
+class DMABufTex;
+
+/**
+ * The intermediate buffer a dmabuf is copied into for a GPU that can't import it
+ *
+ * This lives as long as the client's wl_buffer, so each of a client's buffers gets
+ * an intermediate buffer that is reused for every frame rather than allocated anew.
+ */
+struct CrossGPUCopy
+{
+    ~CrossGPUCopy()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        if (src_image != EGL_NO_IMAGE_KHR)
+        {
+            destroy_image(importing_dpy, src_image);
+        }
+        if (importable_image != EGL_NO_IMAGE_KHR)
+        {
+            destroy_image(importing_dpy, importable_image);
+        }
+        src_image = EGL_NO_IMAGE_KHR;
+        importable_image = EGL_NO_IMAGE_KHR;
+        importable_buf.reset();
+        dpy = EGL_NO_DISPLAY;
+        tex.reset();
+    }
+
+    std::mutex mutex;   ///< Guards the state below
+
+    EGLDisplay importing_dpy{EGL_NO_DISPLAY};
+    PFNEGLDESTROYIMAGEKHRPROC destroy_image{nullptr};
+    EGLImageKHR src_image{EGL_NO_IMAGE_KHR};        ///< The client's buffer, on importing_dpy
+    EGLImageKHR importable_image{EGL_NO_IMAGE_KHR}; ///< The intermediate buffer, on importing_dpy
+    std::shared_ptr<mg::DMABufBuffer> importable_buf;
+
+    EGLDisplay dpy{EGL_NO_DISPLAY};                 ///< The display tex has been imported on
+    std::shared_ptr<DMABufTex> tex;                 ///< The intermediate buffer, on dpy
+};
+
 /**
  * Holds on to all imported dmabuf buffers, and allows looking up by wl_buffer
  *
@@ -573,12 +618,39 @@ public:
     {
         return planes_;
     }
+
+    /**
+     * The texture this buffer has been imported as on \a dpy, calling \a import if there isn't one
+     *
+     * Clients cycle through the same few buffers, so we keep the import for the lifetime of
+     * the wl_buffer rather than importing it on every commit.
+     */
+    auto texture_for(
+        EGLDisplay dpy,
+        std::function<std::shared_ptr<DMABufTex>()> const& import) const -> std::shared_ptr<DMABufTex>
+    {
+        if (!texture || texture_dpy != dpy)
+        {
+            texture = import();
+            texture_dpy = dpy;
+        }
+        return texture;
+    }
+
+    auto cross_gpu_copy() const -> std::shared_ptr<CrossGPUCopy> const&
+    {
+        return cross_gpu_copy_;
+    }
 private:
     int32_t const width, height;
     mg::DRMFormat const format_;
     uint32_t const flags;
     std::optional<uint64_t> const modifier_;
     std::vector<PlaneInfo> const planes_;
+
+    mutable EGLDisplay texture_dpy{EGL_NO_DISPLAY};
+    mutable std::shared_ptr<DMABufTex> texture;
+    std::shared_ptr<CrossGPUCopy> const cross_gpu_copy_{std::make_shared<CrossGPUCopy>()};
 };
 
 class LinuxDmaBufParams : public mir::wayland::LinuxBufferParamsV1
@@ -842,6 +914,66 @@ GLuint get_tex_id()
     return tex;
 }
 
+/**
+ * Make the current context wait for \a fence before it runs any further commands
+ *
+ * If \a dpy can't wait for the fence on the GPU we wait for it here.
+ */
+void wait_for_fence(EGLDisplay dpy, mir::Fd const& fence)
+{
+    auto const extensions = eglQueryString(dpy, EGL_EXTENSIONS);
+    if (extensions &&
+        strstr(extensions, "EGL_ANDROID_native_fence_sync") &&
+        strstr(extensions, "EGL_KHR_wait_sync"))
+    {
+        auto const create_sync =
+            reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"));
+        auto const wait_sync =
+            reinterpret_cast<PFNEGLWAITSYNCKHRPROC>(eglGetProcAddress("eglWaitSyncKHR"));
+        auto const destroy_sync =
+            reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"));
+
+        // On success the EGLSync takes ownership of the fd
+        if (auto const fd = dup(fence); fd >= 0)
+        {
+            EGLint const attribs[] = {EGL_SYNC_NATIVE_FENCE_FD_ANDROID, fd, EGL_NONE};
+            if (auto const sync = create_sync(dpy, EGL_SYNC_NATIVE_FENCE_ANDROID, attribs); sync != EGL_NO_SYNC_KHR)
+            {
+                auto const waited = wait_sync(dpy, sync, 0);
+                destroy_sync(dpy, sync);
+                if (waited == EGL_TRUE)
+                {
+                    return;
+                }
+            }
+            else
+            {
+                close(fd);
+            }
+        }
+    }
+
+    pollfd wait_for{fence, POLLIN, 0};
+    while (poll(&wait_for, 1, -1) < 0 && errno == EINTR)
+    {
+    }
+}
+
+/**
+ * The modifiers \a formats supports for \a format, if it supports the format at all
+ */
+auto modifiers_for(mg::DmaBufFormatDescriptors const& formats, uint32_t format) -> std::vector<uint64_t> const*
+{
+    for (size_t i = 0; i < formats.num_formats(); ++i)
+    {
+        if (static_cast<uint32_t>(formats[i].format) == format)
+        {
+            return &formats[i].modifiers;
+        }
+    }
+    return nullptr;
+}
+
 class DMABufTex : public mg::gl::Texture
 {
 public:
@@ -851,7 +983,17 @@ public:
         mg::DMABufBuffer const& dma_buf,
         BufferGLDescription const& descriptor,
         std::shared_ptr<mgc::EGLContextExecutor> egl_delegate)
-        : tex{get_tex_id()},
+        : dpy{dpy},
+          base_extensions{extensions.base(dpy)},
+          image{import_egl_image(
+            dma_buf.size().width.as_int(),
+            dma_buf.size().height.as_int(),
+            dma_buf.format(),
+            dma_buf.modifier(),
+            dma_buf.planes(),
+            dpy,
+            extensions)},
+          tex{get_tex_id()},
           desc{descriptor},
           layout_{dma_buf.layout()},
           egl_delegate{std::move(egl_delegate)}
@@ -860,21 +1002,8 @@ public:
 
         auto const target = descriptor.target;
 
-        EGLImage image = import_egl_image(
-            dma_buf.size().width.as_int(),
-            dma_buf.size().height.as_int(),
-            dma_buf.format(),
-            dma_buf.modifier(),
-            dma_buf.planes(),
-            dpy,
-            extensions);
-
         glBindTexture(target, tex);
-        extensions.base(dpy).glEGLImageTargetTexture2DOES(target, image);
-
-        // tex is now an EGLImage sibling, so we can free the EGLImage without
-        // freeing the backing data.
-        extensions.base(dpy).eglDestroyImageKHR(dpy, image);
+        base_extensions.glEGLImageTargetTexture2DOES(target, image);
 
         glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -885,12 +1014,31 @@ public:
     ~DMABufTex() override
     {
         egl_delegate->spawn(
-            [tex = tex]()
+            [tex = tex, dpy = dpy, image = image, destroy_image = base_extensions.eglDestroyImageKHR]()
             {
                 glDeleteTextures(1, &tex);
+                destroy_image(dpy, image);
             });
     }
 
+    /**
+     * Prepare to texture from the buffer's contents after the client has resubmitted it
+     *
+     * Changes to the buffer are visible through GL_TEXTURE_EXTERNAL_OES textures, but
+     * a GL_TEXTURE_2D needs respecifying from the EGLImage to be sure of seeing them.
+     * This is much cheaper than importing the buffer again.
+     *
+     * \note Must be called with a current EGL context
+     */
+    void resubmitted()
+    {
+        if (desc.target == GL_TEXTURE_2D)
+        {
+            glBindTexture(desc.target, tex);
+            base_extensions.glEGLImageTargetTexture2DOES(desc.target, image);
+        }
+    }
+
     mg::gl::Program const& shader(mg::gl::ProgramFactory& cache) const override
     {
         /* We rely on the fact that `desc` is a reference to a statically-allocated namespaced
@@ -917,6 +1065,9 @@ public:
     {
     }
 private:
+    EGLDisplay const dpy;
+    mg::EGLExtensions::BaseExtensions const base_extensions;
+    EGLImageKHR const image;    ///< Kept so that the texture can be respecified
     GLuint const tex;
     BufferGLDescription const& desc;
     Layout const layout_;
@@ -928,18 +1079,17 @@ class DmabufTexBuffer :
     public mg::DMABufBuffer
 {
 public:
-    // Note: Must be called with a current EGL context
     DmabufTexBuffer(
         EGLDisplay dpy,
-        mg::EGLExtensions const& extensions,
+        std::shared_ptr<DMABufTex> tex,
+        std::shared_ptr<CrossGPUCopy> cross_gpu_copy,
         mg::DMABufBuffer const& dma_buf,
-        BufferGLDescription const& descriptor,
         std::shared_ptr<mg::DMABufEGLProvider> provider,
-        std::shared_ptr<mgc::EGLContextExecutor> egl_delegate,
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release)
         : dpy{dpy},
-          tex{dpy, extensions, dma_buf, descriptor, std::move(egl_delegate)},
+          tex{std::move(tex)},
+          cross_gpu_copy_{std::move(cross_gpu_copy)},
           provider_{std::move(provider)},
           on_consumed{std::move(on_consumed)},
           on_release{std::move(on_release)},
@@ -998,7 +1148,7 @@ public:
         on_consumed();
         on_consumed = [](){};
 
-        return &tex;
+        return tex.get();
     }
 
     auto format() const -> mg::DRMFormat override
@@ -1018,16 +1168,22 @@ public:
 
     auto layout() const -> mg::gl::Texture::Layout override
     {
-        return tex.layout();
+        return tex->layout();
     }
 
     auto provider() const -> std::shared_ptr<mg::DMABufEGLProvider>
     {
         return provider_;
     }
+
+    auto cross_gpu_copy() const -> std::shared_ptr<CrossGPUCopy> const&
+    {
+        return cross_gpu_copy_;
+    }
 private:
     EGLDisplay const dpy;
-    DMABufTex tex;
+    std::shared_ptr<DMABufTex> const tex;
+    std::shared_ptr<CrossGPUCopy> const cross_gpu_copy_;
 
     std::shared_ptr<mg::DMABufEGLProvider> const provider_;
 
@@ -1143,13 +1299,37 @@ auto mg::DMABufEGLProvider::import_dma_buf(
         dma_buf.format(),
         dma_buf.modifier().value_or(DRM_FORMAT_MOD_INVALID),
         *this);
+
+    // Note: Importing must be done with a current EGL context
+    auto const import = [&]()
+        {
+            return std::make_shared<DMABufTex>(dpy, *egl_extensions, dma_buf, *descriptor, egl_delegate);
+        };
+
+    std::shared_ptr<DMABufTex> tex;
+    std::shared_ptr<CrossGPUCopy> cross_gpu_copy;
+    if (auto const wl_dmabuf = dynamic_cast<WlDmaBufBuffer const*>(&dma_buf))
+    {
+        bool imported{false};
+        tex = wl_dmabuf->texture_for(dpy, [&]() { imported = true; return import(); });
+        if (!imported)
+        {
+            tex->resubmitted();
+        }
+        cross_gpu_copy = wl_dmabuf->cross_gpu_copy();
+    }
+    else
+    {
+        tex = import();
+        cross_gpu_copy = std::make_shared<CrossGPUCopy>();
+    }
+
     return std::make_shared<DmabufTexBuffer>(
         dpy,
-        *egl_extensions,
+        std::move(tex),
+        std::move(cross_gpu_copy),
         dma_buf,
-        *descriptor,
         shared_from_this(),
-        egl_delegate,
         std::move(on_consumed),
         std::move(on_release));
 }
@@ -1211,82 +1391,122 @@ auto mg::DMABufEGLProvider::as_texture(std::shared_ptr<Buffer> buffer)
                 return nullptr;
             }
 
-            /* TODO: Be smarter about finding a shared pixel format; everything *should* do
-             * ARGB8888, but if the buffer is in a higher bitdepth this will lose colour information
-             */
-            auto const& supported_formats = *formats;
-            auto const& modifiers =
-                [&supported_formats]() -> std::vector<uint64_t> const&
+            auto const& copy = dmabuf_tex->cross_gpu_copy();
+            std::lock_guard lock{copy->mutex};
+
+            bool const reused{copy->tex && copy->dpy == dpy};
+            if (!reused)
+            {
+                auto const& base_extension = importing_provider->egl_extensions->base(importing_provider->dpy);
+
+                /* The intermediate buffer is in the client's format if it's one we can render to and
+                 * import, so as not to lose colour information; failing that we fall back to a
+                 * 10bpc format for deep buffers, and to ARGB8888, which everything *should* do.
+                 */
+                std::vector<mg::DRMFormat> candidates;
+                if (auto const& components = dmabuf_tex->format().components())
+                {
+                    candidates.push_back(dmabuf_tex->format());
+                    if (components->red_bits > 8)
+                    {
+                        candidates.push_back(mg::DRMFormat{DRM_FORMAT_ARGB2101010});
+                    }
+                }
+                candidates.push_back(mg::DRMFormat{DRM_FORMAT_ARGB8888});
+
+                std::shared_ptr<mg::DMABufBuffer> importable_buf;
+                for (auto const& format : candidates)
                 {
-                    for (size_t i = 0; i < supported_formats.num_formats(); ++i)
+                    if (auto const modifiers = modifiers_for(*formats, format))
                     {
-                        if (supported_formats[i].format == DRM_FORMAT_ARGB8888)
+                        importable_buf = importing_provider->allocate_importable_image(
+                            format,
+                            std::span<uint64_t const>{modifiers->data(), modifiers->size()},
+                            dmabuf_tex->size());
+                        if (importable_buf)
                         {
-                            return supported_formats[i].modifiers;
+                            break;
                         }
                     }
-                    BOOST_THROW_EXCEPTION((std::runtime_error{"Platform doesn't support ARGB8888?!"}));
-                }();
-
-            auto importable_buf = importing_provider->allocate_importable_image(
-                mg::DRMFormat{DRM_FORMAT_ARGB8888},
-                std::span<uint64_t const>{modifiers.data(), modifiers.size()},
-                dmabuf_tex->size());
+                }
 
-            if (!importable_buf)
-            {
-                mir::log_warning("Failed to allocate common-format buffer for cross-GPU buffer import");
-                return nullptr;
-            }
+                if (!importable_buf)
+                {
+                    mir::log_warning("Failed to allocate common-format buffer for cross-GPU buffer import");
+                    return nullptr;
+                }
 
-            auto src_image = import_egl_image(
-                dmabuf_tex->size().width.as_int(), dmabuf_tex->size().height.as_int(),
-                dmabuf_tex->format(),
-                dmabuf_tex->modifier(),
-                dmabuf_tex->planes(),
-                importing_provider->dpy,
-                *importing_provider->egl_extensions);
-            auto importable_image = import_egl_image(
-                importable_buf->size().width.as_int(), importable_buf->size().height.as_int(),
-                importable_buf->format(),
-                importable_buf->modifier(),
-                importable_buf->planes(),
-                importing_provider->dpy,
-                *importing_provider->egl_extensions);
-            auto sync = importing_provider->blitter->blit(src_image, importable_image, dmabuf_tex->size());
-            if (sync)
-            {
-                BOOST_THROW_EXCEPTION((std::logic_error{"EGL_ANDROID_native_fence_sync support not implemented yet"}));
-            }
-            auto importable_dmabuf = export_egl_image(*importing_provider->dmabuf_export_ext, importing_provider->dpy, importable_image, dmabuf_tex->size());
+                // Reset the copy, so it stays consistent if anything below throws
+                copy->reset();
+                copy->importing_dpy = importing_provider->dpy;
+                copy->destroy_image = base_extension.eglDestroyImageKHR;
+                copy->importable_buf = importable_buf;
 
-            auto base_extension = importing_provider->egl_extensions->base(importing_provider->dpy);
-            base_extension.eglDestroyImageKHR(importing_provider->dpy, src_image);
-            base_extension.eglDestroyImageKHR(importing_provider->dpy, importable_image);
+                copy->src_image = import_egl_image(
+                    dmabuf_tex->size().width.as_int(), dmabuf_tex->size().height.as_int(),
+                    dmabuf_tex->format(),
+                    dmabuf_tex->modifier(),
+                    dmabuf_tex->planes(),
+                    importing_provider->dpy,
+                    *importing_provider->egl_extensions);
+                copy->importable_image = import_egl_image(
+                    importable_buf->size().width.as_int(), importable_buf->size().height.as_int(),
+                    importable_buf->format(),
+                    importable_buf->modifier(),
+                    importable_buf->planes(),
+                    importing_provider->dpy,
+                    *importing_provider->egl_extensions);
+                auto importable_dmabuf = export_egl_image(
+                    *importing_provider->dmabuf_export_ext,
+                    importing_provider->dpy,
+                    copy->importable_image,
+                    dmabuf_tex->size());
+
+                auto descriptor = descriptor_for_format_and_modifiers(
+                    importable_dmabuf->format(),
+                    importable_dmabuf->modifier().value_or(DRM_FORMAT_MOD_INVALID),
+                    *this);
+                if (!descriptor)
+                {
+                    /* To get here we have to have failed to find the format/modifier descriptor for a
+                     * buffer that we've explicitly allocated to be importable by us.
+                     *
+                     * This is a logic bug, so go noisily.
+                     */
+                    BOOST_THROW_EXCEPTION((std::logic_error{"Failed to find import parameterns for buffer we explicitly allocated for import"}));
+                }
 
-            if (auto descriptor = descriptor_for_format_and_modifiers(
-                        importable_dmabuf->format(),
-                        importable_dmabuf->modifier().value_or(DRM_FORMAT_MOD_INVALID),
-                        *this))
-            {
-                /* We're being naughty here and using the fact that `as_texture()` has a side-effect
-                 * of invoking the buffer's `on_consumed()` callback.
-                 */
-                dmabuf_tex->as_texture();
-                return std::make_shared<DMABufTex>(
+                copy->tex = std::make_shared<DMABufTex>(
                     dpy,
                     *egl_extensions,
                     *importable_dmabuf,
                     *descriptor,
                     egl_delegate);
+                copy->dpy = dpy;
             }
 
-            /* To get here we have to have failed to find the format/modifier descriptor for a
-             * buffer that we've explicitly allocated to be importable by us.
-             *
-             * This is a logic bug, so go noisily.
+            if (auto const fence = importing_provider->blitter->blit(
+                    copy->src_image, copy->importable_image, dmabuf_tex->size()))
+            {
+                wait_for_fence(dpy, *fence);
+            }
+
+            if (reused)
+            {
+                copy->tex->resubmitted();
+            }
+
+            /* We're being naughty here and using the fact that `as_texture()` has a side-effect
+             * of invoking the buffer's `on_consumed()` callback.
              */
-            BOOST_THROW_EXCEPTION((std::logic_error{"Failed to find import parameterns for buffer we explicitly allocated for import"}));
+            dmabuf_tex->as_texture();
+
+            // The client's buffer must not be released until the copy from it is complete
+            auto const keep_alive =
+                std::make_shared<std::pair<std::shared_ptr<Buffer>, std::shared_ptr<DMABufTex>>>(
+                    std::move(dmabuf_tex),
+                    copy->tex);
+            return std::shared_ptr<gl::Texture>(keep_alive, keep_alive->second.get());
         }
     }
     return nullptr;
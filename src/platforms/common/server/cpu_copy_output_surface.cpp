@@ -14,7 +14,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
 #include <GLES2/gl2ext.h>
 
 #include <EGL/egl.h>
@@ -28,6 +28,11 @@
 
 #include "cpu_copy_output_surface.h"
 
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <vector>
+
 namespace mg = mir::graphics;
 namespace mgc = mg::common;
 namespace geom = mir::geometry;
@@ -69,15 +74,11 @@ private:
 
 using RenderbufferHandle = GLHandle<&glGenRenderbuffers, &glDeleteRenderbuffers>;
 using FramebufferHandle = GLHandle<&glGenFramebuffers, &glDeleteFramebuffers>;
+using BufferHandle = GLHandle<&glGenBuffers, &glDeleteBuffers>;
 
 auto create_current_context(EGLDisplay dpy, EGLContext share_ctx)
     -> EGLContext
 {
-    static const EGLint context_attr[] = {
-        EGL_CONTEXT_CLIENT_VERSION, 2,
-        EGL_NONE
-    };
-
     auto egl_extensions = eglQueryString(dpy, EGL_EXTENSIONS);
     if (strstr(egl_extensions, "EGL_KHR_no_config_context") == nullptr)
     {
@@ -86,7 +87,25 @@ auto create_current_context(EGLDisplay dpy, EGLContext share_ctx)
     }
 
     eglBindAPI(EGL_OPENGL_ES_API);
-    auto ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, share_ctx, context_attr);
+
+    // GLES 3 lets us read back through a pixel pack buffer without stalling; GLES 2 will do otherwise
+    EGLContext ctx = EGL_NO_CONTEXT;
+    for (EGLint const version : {3, 2})
+    {
+        EGLint const context_attr[] = {
+            EGL_CONTEXT_CLIENT_VERSION, version,
+            EGL_NONE
+        };
+        ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, share_ctx, context_attr);
+        if (ctx != EGL_NO_CONTEXT)
+        {
+            break;
+        }
+    }
+    if (ctx == EGL_NO_CONTEXT)
+    {
+        BOOST_THROW_EXCEPTION(mg::egl_error("Failed to create EGL context"));
+    }
 
     if (eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx) != EGL_TRUE)
     {
@@ -95,29 +114,155 @@ auto create_current_context(EGLDisplay dpy, EGLContext share_ctx)
     return ctx;
 }
 
-auto select_format_from(mg::CPUAddressableDisplayAllocator const& provider) -> mg::DRMFormat
+auto gl_major_version() -> GLint
+{
+    // GL_MAJOR_VERSION is new in GLES 3; a GLES 2 context flags an error and leaves major alone
+    GLint major{2};
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    while (glGetError() != GL_NO_ERROR)
+    {
+    }
+    return major;
+}
+
+auto can_read_bgra() -> bool
+{
+    auto const gl_extensions = reinterpret_cast<char const*>(glGetString(GL_EXTENSIONS));
+    return gl_extensions && strstr(gl_extensions, "GL_EXT_read_format_bgra");
+}
+
+/*
+ * Conversions from the bytes glReadPixels() gives for GL_RGBA/GL_UNSIGNED_BYTE (R, G, B, A)
+ * into the (little-endian) byte order of DRM formats
+ */
+void rgba_to_bgra(unsigned char const* from, unsigned char* to, size_t pixels)
+{
+    for (size_t i = 0; i != pixels; ++i, from += 4, to += 4)
+    {
+        to[0] = from[2]; to[1] = from[1]; to[2] = from[0]; to[3] = from[3];
+    }
+}
+
+void rgba_to_abgr(unsigned char const* from, unsigned char* to, size_t pixels)
+{
+    for (size_t i = 0; i != pixels; ++i, from += 4, to += 4)
+    {
+        to[0] = from[3]; to[1] = from[2]; to[2] = from[1]; to[3] = from[0];
+    }
+}
+
+void rgba_to_argb(unsigned char const* from, unsigned char* to, size_t pixels)
+{
+    for (size_t i = 0; i != pixels; ++i, from += 4, to += 4)
+    {
+        to[0] = from[3]; to[1] = from[0]; to[2] = from[1]; to[3] = from[2];
+    }
+}
+
+template<int high_channel, int low_channel>
+void rgba_to_565(unsigned char const* from, unsigned char* to, size_t pixels)
+{
+    for (size_t i = 0; i != pixels; ++i, from += 4, to += 2)
+    {
+        uint16_t const pixel = (from[high_channel] >> 3) << 11 | (from[1] >> 2) << 5 | from[low_channel] >> 3;
+        to[0] = pixel & 0xff;
+        to[1] = pixel >> 8;
+    }
+}
+
+/// How to get \a format out of GL
+struct ReadbackFormat
+{
+    GLenum gl_format;           ///< For glReadPixels(), always with GL_UNSIGNED_BYTE
+    /// Rearranges rows read from GL into the DRM format; nullptr if they are already in it
+    void (*convert)(unsigned char const* from, unsigned char* to, size_t pixels);
+    size_t bytes_per_pixel;     ///< Of the DRM format
+};
+
+auto readback_format_for(uint32_t format, bool bgra_readable) -> std::optional<ReadbackFormat>
+{
+    switch (format)
+    {
+    case DRM_FORMAT_ARGB8888:
+    case DRM_FORMAT_XRGB8888:
+        if (bgra_readable)
+        {
+            return ReadbackFormat{GL_BGRA_EXT, nullptr, 4};
+        }
+        return ReadbackFormat{GL_RGBA, &rgba_to_bgra, 4};
+    case DRM_FORMAT_ABGR8888:
+    case DRM_FORMAT_XBGR8888:
+        return ReadbackFormat{GL_RGBA, nullptr, 4};
+    case DRM_FORMAT_RGBA8888:
+    case DRM_FORMAT_RGBX8888:
+        return ReadbackFormat{GL_RGBA, &rgba_to_abgr, 4};
+    case DRM_FORMAT_BGRA8888:
+    case DRM_FORMAT_BGRX8888:
+        return ReadbackFormat{GL_RGBA, &rgba_to_argb, 4};
+    case DRM_FORMAT_RGB565:
+        return ReadbackFormat{GL_RGBA, &rgba_to_565<0, 2>, 2};
+    case DRM_FORMAT_BGR565:
+        return ReadbackFormat{GL_RGBA, &rgba_to_565<2, 0>, 2};
+    }
+    return std::nullopt;
+}
+
+auto select_format_from(mg::CPUAddressableDisplayAllocator const& provider, bool bgra_readable) -> mg::DRMFormat
 {
     std::optional<mg::DRMFormat> best_format;
     for (auto const format : provider.supported_formats())
     {
-        switch(static_cast<uint32_t>(format))
+        if (auto const readback = readback_format_for(format, bgra_readable))
         {
-        case DRM_FORMAT_ARGB8888:
-        case DRM_FORMAT_XRGB8888:
-            // ?RGB8888 is the easiest for us
-            return format;
-        case DRM_FORMAT_RGBA8888:
-        case DRM_FORMAT_RGBX8888:
-            // RGB?8888 requires an EGL extension, but is OK
-            best_format = format;
-            break;
+            if (!readback->convert)
+            {
+                // GL can read straight into these
+                return format;
+            }
+            if (!best_format)
+            {
+                // Otherwise we need to convert each pixel, but that's OK
+                best_format = format;
+            }
         }
     }
     if (best_format)
     {
         return *best_format;
     }
-    BOOST_THROW_EXCEPTION((std::runtime_error{"Non-?RGB8888 formats not yet supported for display"}));
+    BOOST_THROW_EXCEPTION((std::runtime_error{"None of the display's formats can be read back from GL"}));
+}
+
+/**
+ * Copy pixels read back as \a readback into \a area of \a mapping
+ *
+ * \param pixels         The pixel read back for the top left of \a area
+ * \param source_stride  The distance between rows of \a pixels
+ */
+void copy_into(
+    mir::renderer::software::Mapping<unsigned char>& mapping,
+    geom::Rectangle const& area,
+    unsigned char const* pixels,
+    size_t source_stride,
+    ReadbackFormat const& readback)
+{
+    auto const width = area.size.width.as_uint32_t();
+    auto const height = area.size.height.as_uint32_t();
+    size_t const dest_stride = mapping.stride().as_uint32_t();
+    auto dest = mapping.data() +
+        area.top_left.y.as_uint32_t() * dest_stride +
+        area.top_left.x.as_uint32_t() * readback.bytes_per_pixel;
+    for (uint32_t row = 0; row != height; ++row, pixels += source_stride, dest += dest_stride)
+    {
+        if (readback.convert)
+        {
+            readback.convert(pixels, dest, width);
+        }
+        else
+        {
+            memcpy(dest, pixels, width * readback.bytes_per_pixel);
+        }
+    }
 }
 }
 
@@ -137,6 +282,7 @@ public:
     auto commit() -> std::unique_ptr<mg::Framebuffer>;
 
     auto size() const -> geom::Size;
+    auto buffer_age() const -> int;
     auto layout() const -> Layout;
 
 private:
@@ -144,8 +290,19 @@ private:
     EGLDisplay const dpy;
     EGLContext const ctx;
     DRMFormat const format;
+    ReadbackFormat const readback;
     RenderbufferHandle const colour_buffer;
     FramebufferHandle const fbo;
+    /**
+     * Where glReadPixels() copies to, if the context is GLES 3
+     *
+     * Reading into a pixel pack buffer returns without waiting for rendering to finish, so the GPU
+     * finishes the frame while we wait for a buffer to display it in.
+     */
+    std::optional<BufferHandle> const pixel_pack;
+    /// Where glReadPixels() copies to otherwise, if we can't read straight into the display buffer
+    std::vector<unsigned char> staging;
+    bool committed{false};
 };
 
 mgc::CPUCopyOutputSurface::CPUCopyOutputSurface(
@@ -183,6 +340,11 @@ auto mgc::CPUCopyOutputSurface::size() const -> geom::Size
     return impl->size();
 }
 
+auto mgc::CPUCopyOutputSurface::buffer_age() const -> int
+{
+    return impl->buffer_age();
+}
+
 auto mgc::CPUCopyOutputSurface::layout() const -> Layout
 {
     return impl->layout();
@@ -195,8 +357,21 @@ mgc::CPUCopyOutputSurface::Impl::Impl(
     : allocator{allocator},
       dpy{dpy},
       ctx{create_current_context(dpy, share_ctx)},
-      format{select_format_from(allocator)}
+      format{select_format_from(allocator, can_read_bgra())},
+      readback{*readback_format_for(format, can_read_bgra())},
+      pixel_pack{gl_major_version() >= 3 ? std::make_optional<BufferHandle>() : std::nullopt}
 {
+    if (pixel_pack)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, *pixel_pack);
+        glBufferData(
+            GL_PIXEL_PACK_BUFFER,
+            size().width.as_uint32_t() * size().height.as_uint32_t() * 4,
+            nullptr,
+            GL_STREAM_READ);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
     glBindRenderbuffer(GL_RENDERBUFFER, colour_buffer);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8_OES, size().width.as_int(), size().height.as_int());
 
@@ -259,33 +434,73 @@ void mgc::CPUCopyOutputSurface::Impl::release_current()
 
 auto mgc::CPUCopyOutputSurface::Impl::commit() -> std::unique_ptr<mg::Framebuffer>
 {
-    auto fb = allocator.alloc_fb(format);
+    auto const width = size().width.as_uint32_t();
+    auto const height = size().height.as_uint32_t();
+
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    GLsync readback_done{nullptr};
+    if (pixel_pack)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, *pixel_pack);
+        glReadPixels(0, 0, width, height, readback.gl_format, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback_done = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+
+    auto fb = allocator.alloc_fb(format);
+    auto mapping = fb->map_writeable();
+
+    // Only what's changed if the buffer already holds the rest, and never more than fits in it
+    geom::Rectangle const copyable{
+        {0, 0},
+        {std::min(width, fb->size().width.as_uint32_t()), std::min(height, fb->size().height.as_uint32_t())}};
+    auto const copied = fb->damage() ? intersection_of(*fb->damage(), copyable) : copyable;
+    auto const copied_left = copied.top_left.x.as_uint32_t();
+    auto const copied_top = copied.top_left.y.as_uint32_t();
+
+    if (pixel_pack)
     {
-        /* TODO: We can usefully put this *into* DRMFormat */
-        GLenum pixel_layout = GL_INVALID_ENUM;
-        if (format == DRM_FORMAT_ARGB8888 || format == DRM_FORMAT_XRGB8888)
+        glClientWaitSync(readback_done, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(readback_done);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, *pixel_pack);
+        auto const pixels = static_cast<unsigned char const*>(
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * 4, GL_MAP_READ_BIT));
+        if (pixels)
         {
-            pixel_layout = GL_BGRA_EXT;
+            size_t const stride = width * 4;
+            copy_into(*mapping, copied, pixels + copied_top * stride + copied_left * 4, stride, readback);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
         }
-        else if (format == DRM_FORMAT_RGBA8888 || format == DRM_FORMAT_RGBX8888)
+        else
         {
-            pixel_layout = GL_RGBA;
+            mir::log_warning("Failed to map pixel pack buffer; frame not copied to display");
         }
-        auto mapping = fb->map_writeable();
-        /*
-         * TODO: This introduces a pipeline stall; GL must wait for all previous rendering commands
-         * to complete before glReadPixels returns. We could instead do something fancy with
-         * pixel buffer objects to defer this cost.
-         */
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    else if (!readback.convert && mapping->stride().as_uint32_t() == width * readback.bytes_per_pixel &&
+             copied == geom::Rectangle{{0, 0}, size()})
+    {
         /*
-         * TODO: We are assuming that the framebuffer pixel format is RGBX
+         * Without GLES 3 this stalls until GL has finished all previous rendering commands,
+         * but at least we don't need to copy the pixels again.
          */
+        glReadPixels(0, 0, width, height, readback.gl_format, GL_UNSIGNED_BYTE, mapping->data());
+    }
+    else if (copied.size.width.as_int() > 0 && copied.size.height.as_int() > 0)
+    {
+        auto const copied_width = copied.size.width.as_uint32_t();
+        auto const copied_height = copied.size.height.as_uint32_t();
+        staging.resize(copied_width * copied_height * 4);
         glReadPixels(
-            0, 0,
-            fb->size().width.as_uint32_t(), fb->size().height.as_uint32_t(),
-            pixel_layout, GL_UNSIGNED_BYTE, mapping->data());
+            copied_left, copied_top, copied_width, copied_height,
+            readback.gl_format, GL_UNSIGNED_BYTE, staging.data());
+        copy_into(*mapping, copied, staging.data(), copied_width * 4, readback);
     }
+
+    committed = true;
     return fb;
 }
 
@@ -294,6 +509,12 @@ auto mgc::CPUCopyOutputSurface::Impl::size() const -> geom::Size
     return allocator.output_size();
 }
 
+auto mgc::CPUCopyOutputSurface::Impl::buffer_age() const -> int
+{
+    // We always render into the same renderbuffer, and copy all of it out on commit()
+    return committed ? 1 : 0;
+}
+
 auto mgc::CPUCopyOutputSurface::Impl::layout() const -> Layout
 {
     return Layout::TopRowFirst;
@@ -49,6 +49,8 @@ public:
 
     auto size() const -> geometry::Size override;
 
+    auto buffer_age() const -> int override;
+
     auto layout() const -> Layout override;
 
 private:
@@ -29,6 +29,8 @@
 
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
+#include <optional>
 #include <string.h>
 #include <endian.h>
 
@@ -133,11 +135,25 @@ MirPixelFormat mgc::ShmBuffer::pixel_format() const
     return pixel_format_;
 }
 
+auto mgc::ShmBuffer::gl_pixel_format(GLenum& format, GLenum& type) const -> bool
+{
+    if (mg::get_gl_pixel_format(pixel_format_, format, type))
+    {
+        return true;
+    }
+
+    mir::log_error(
+        "Buffer %i has non-GL-compatible pixel format %i; rendering will be incomplete",
+        id().as_value(),
+        pixel_format());
+    return false;
+}
+
 void mgc::ShmBuffer::upload_to_texture(void const* pixels, geom::Stride const& stride)
 {
     GLenum format, type;
 
-    if (mg::get_gl_pixel_format(pixel_format_, format, type))
+    if (gl_pixel_format(format, type))
     {
         auto const stride_in_px =
             stride.as_int() / MIR_BYTES_PER_PIXEL(pixel_format());
@@ -168,12 +184,41 @@ void mgc::ShmBuffer::upload_to_texture(void const* pixels, geom::Stride const& s
         glPixelStorei(GL_UNPACK_ALIGNMENT, 4);          // 4 is default; word alignment.
         glFinish();
     }
-    else
+}
+
+void mgc::ShmBuffer::upload_to_texture(
+    void const* pixels,
+    geom::Stride const& stride,
+    geom::Rectangle const& area)
+{
+    GLenum format, type;
+
+    if (gl_pixel_format(format, type))
     {
-        mir::log_error(
-            "Buffer %i has non-GL-compatible pixel format %i; rendering will be incomplete",
-            id().as_value(),
-            pixel_format());
+        auto const bytes_per_pixel = MIR_BYTES_PER_PIXEL(pixel_format());
+        auto const stride_in_px = stride.as_int() / bytes_per_pixel;
+
+        // GL_UNPACK_SKIP_{ROWS,PIXELS} aren't in GLES2, so point at the first pixel of the area instead
+        auto const area_pixels =
+            static_cast<unsigned char const*>(pixels) +
+            area.top_left.y.as_int() * stride.as_int() +
+            area.top_left.x.as_int() * bytes_per_pixel;
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, stride_in_px);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        glTexSubImage2D(
+            GL_TEXTURE_2D,
+            0,
+            area.top_left.x.as_int(), area.top_left.y.as_int(),
+            area.size.width.as_int(), area.size.height.as_int(),
+            format,
+            type,
+            area_pixels);
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glFinish();
     }
 }
 
@@ -287,11 +332,105 @@ void mgc::ShmBuffer::add_syncpoint()
 {
 }
 
+/**
+ * A texture shared by the successive MappableBackedShmBuffers of a surface
+ *
+ * The texture holds the content of one of those buffers. Each buffer records how it differs from
+ * the one before, so bringing the texture up to date with the most recent buffer only needs the
+ * area that has changed since then to be uploaded.
+ */
+class mgc::MappableBackedShmBuffer::SharedTexture
+{
+public:
+    SharedTexture(geom::Size size, MirPixelFormat format, std::shared_ptr<EGLContextExecutor> egl_delegate)
+        : size{size},
+          format{format},
+          egl_delegate{std::move(egl_delegate)}
+    {
+    }
+
+    ~SharedTexture()
+    {
+        if (tex_id != 0)
+        {
+            egl_delegate->spawn(
+                [id = tex_id]()
+                {
+                    glDeleteTextures(1, &id);
+                });
+        }
+    }
+
+    /// Register a new most-recent buffer, differing from the previous one by \a damage
+    auto add_buffer(geom::Rectangle const& damage) -> uint64_t
+    {
+        std::lock_guard lock{mutex};
+        if (is_empty(stale_area))
+        {
+            stale_area = damage;
+        }
+        else if (!is_empty(damage))
+        {
+            geom::Point const top_left{
+                std::min(stale_area.left(), damage.left()),
+                std::min(stale_area.top(), damage.top())};
+            geom::Point const bottom_right{
+                std::max(stale_area.right(), damage.right()),
+                std::max(stale_area.bottom(), damage.bottom())};
+            stale_area = {top_left, as_size(bottom_right - top_left)};
+        }
+        return ++latest_generation;
+    }
+
+    static auto is_empty(geom::Rectangle const& area) -> bool
+    {
+        return area.size.width.as_int() <= 0 || area.size.height.as_int() <= 0;
+    }
+
+    geom::Size const size;
+    MirPixelFormat const format;
+
+    std::mutex mutex;
+    GLuint tex_id{0};
+    uint64_t latest_generation{0};
+    /// The generation of the buffer whose content the texture holds, if any
+    std::optional<uint64_t> content_generation;
+    /// The area that differs between the texture and the most recent buffer
+    geom::Rectangle stale_area;
+
+private:
+    std::shared_ptr<EGLContextExecutor> const egl_delegate;
+};
+
 mgc::MappableBackedShmBuffer::MappableBackedShmBuffer(
     std::shared_ptr<mrs::RWMappableBuffer> data,
     std::shared_ptr<EGLContextExecutor> egl_delegate)
     : ShmBuffer(data->size(), data->format(), std::move(egl_delegate)),
-      data{std::move(data)}
+      data{std::move(data)},
+      generation{0}
+{
+}
+
+mgc::MappableBackedShmBuffer::MappableBackedShmBuffer(
+    std::shared_ptr<mrs::RWMappableBuffer> data,
+    std::shared_ptr<Buffer> const& previous,
+    geom::Rectangle const& damage,
+    std::shared_ptr<EGLContextExecutor> egl_delegate)
+    : ShmBuffer(data->size(), data->format(), egl_delegate),
+      data{std::move(data)},
+      shared_texture{
+          [&]()
+          {
+              auto const previous_shm = std::dynamic_pointer_cast<MappableBackedShmBuffer>(previous);
+              if (previous_shm && previous_shm->shared_texture &&
+                  previous_shm->shared_texture->size == ShmBuffer::size() &&
+                  previous_shm->shared_texture->format == ShmBuffer::pixel_format())
+              {
+                  return previous_shm->shared_texture;
+              }
+              return std::make_shared<SharedTexture>(ShmBuffer::size(), ShmBuffer::pixel_format(), egl_delegate);
+          }()},
+      generation{shared_texture->add_buffer(intersection_of(damage, geom::Rectangle{{}, ShmBuffer::size()}))}
 {
 }
 
@@ -310,8 +449,53 @@ auto mgc::MappableBackedShmBuffer::map_rw() -> std::unique_ptr<mrs::Mapping<unsi
     return data->map_rw();
 }
 
+auto mgc::MappableBackedShmBuffer::bind_shared_texture() -> bool
+{
+    std::lock_guard lock{shared_texture->mutex};
+    if (generation != shared_texture->latest_generation)
+    {
+        // A newer buffer owns the shared texture, so it can't show our content
+        return false;
+    }
+
+    bool const needs_initialisation = shared_texture->tex_id == 0;
+    if (needs_initialisation)
+    {
+        glGenTextures(1, &shared_texture->tex_id);
+    }
+    glBindTexture(GL_TEXTURE_2D, shared_texture->tex_id);
+    if (needs_initialisation)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    if (shared_texture->content_generation != generation)
+    {
+        auto const mapping = data->map_readable();
+        if (!shared_texture->content_generation)
+        {
+            upload_to_texture(mapping->data(), mapping->stride());
+        }
+        else if (!SharedTexture::is_empty(shared_texture->stale_area))
+        {
+            upload_to_texture(mapping->data(), mapping->stride(), shared_texture->stale_area);
+        }
+        shared_texture->content_generation = generation;
+        shared_texture->stale_area = {};
+    }
+    return true;
+}
+
 void mgc::MappableBackedShmBuffer::bind()
 {
+    if (shared_texture && bind_shared_texture())
+    {
+        return;
+    }
+
     mgc::ShmBuffer::bind();
     std::lock_guard lock{uploaded_mutex};
     if (!uploaded)
@@ -339,10 +523,12 @@ auto mgc::MappableBackedShmBuffer::size() const -> geometry::Size
 
 mgc::NotifyingMappableBackedShmBuffer::NotifyingMappableBackedShmBuffer(
     std::shared_ptr<mrs::RWMappableBuffer> data,
+    std::shared_ptr<Buffer> const& previous,
+    geom::Rectangle const& damage,
     std::shared_ptr<mgc::EGLContextExecutor> egl_delegate,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release)
-    :  MappableBackedShmBuffer(std::move(data), std::move(egl_delegate)),
+    :  MappableBackedShmBuffer(std::move(data), previous, damage, std::move(egl_delegate)),
        on_consumed{std::move(on_consumed)},
        on_release{std::move(on_release)}
 {
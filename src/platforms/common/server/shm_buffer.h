@@ -20,6 +20,7 @@
 #include "mir/graphics/buffer_basic.h"
 #include "mir/geometry/dimensions.h"
 #include "mir/geometry/size.h"
+#include "mir/geometry/rectangle.h"
 #include "mir_toolkit/common.h"
 #include "mir_toolkit/mir_native_buffer.h"
 #include "mir/renderer/sw/pixel_source.h"
@@ -65,7 +66,18 @@ protected:
 
     /// \note This must be called with a current GL context
     void upload_to_texture(void const* pixels, geometry::Stride const& stride);
+
+    /**
+     * Upload the \a area of \a pixels into the texture currently bound to GL_TEXTURE_2D,
+     * which must already hold a full image of this buffer's size and format
+     *
+     * \note This must be called with a current GL context
+     */
+    void upload_to_texture(void const* pixels, geometry::Stride const& stride, geometry::Rectangle const& area);
 private:
+    /// Set the GL pixel format and type to upload this buffer's pixels as, logging if there are none
+    auto gl_pixel_format(GLenum& format, GLenum& type) const -> bool;
+
     geometry::Size const size_;
     MirPixelFormat const pixel_format_;
     std::shared_ptr<EGLContextExecutor> const egl_delegate;
@@ -118,6 +130,19 @@ public:
         std::shared_ptr<renderer::software::RWMappableBuffer> data,
         std::shared_ptr<EGLContextExecutor> egl_delegate);
 
+    /**
+     * \param previous [in]    The buffer previously submitted for the same surface, or nullptr
+     * \param damage [in]      The area of \a data that differs from \a previous
+     *
+     * If \a previous is a MappableBackedShmBuffer of the same size and format this buffer shares
+     * its texture, and binding uploads only what has been damaged since the texture was last updated.
+     */
+    MappableBackedShmBuffer(
+        std::shared_ptr<renderer::software::RWMappableBuffer> data,
+        std::shared_ptr<Buffer> const& previous,
+        geometry::Rectangle const& damage,
+        std::shared_ptr<EGLContextExecutor> egl_delegate);
+
     auto map_writeable() -> std::unique_ptr<renderer::software::Mapping<unsigned char>> override;
     auto map_readable() -> std::unique_ptr<renderer::software::Mapping<unsigned char const>> override;
     auto map_rw() -> std::unique_ptr<renderer::software::Mapping<unsigned char>> override;
@@ -131,7 +156,14 @@ public:
     MappableBackedShmBuffer(MappableBackedShmBuffer const&) = delete;
     MappableBackedShmBuffer& operator=(MappableBackedShmBuffer const&) = delete;
 private:
+    class SharedTexture;
+
+    /// Bring the shared texture up to date and bind it, if it can show this buffer
+    auto bind_shared_texture() -> bool;
+
     std::shared_ptr<renderer::software::RWMappableBuffer> const data;
+    std::shared_ptr<SharedTexture> const shared_texture;
+    uint64_t const generation;
     std::mutex uploaded_mutex;
     bool uploaded{false};
 };
@@ -141,6 +173,8 @@ class NotifyingMappableBackedShmBuffer : public MappableBackedShmBuffer
 public:
     NotifyingMappableBackedShmBuffer(
         std::shared_ptr<renderer::software::RWMappableBuffer> data,
+        std::shared_ptr<Buffer> const& previous,
+        geometry::Rectangle const& damage,
         std::shared_ptr<common::EGLContextExecutor> egl_delegate,
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release);
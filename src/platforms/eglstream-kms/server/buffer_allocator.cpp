@@ -538,11 +538,15 @@ mir::graphics::eglstream::BufferAllocator::buffer_from_resource(
 
 auto mge::BufferAllocator::buffer_from_shm(
     std::shared_ptr<renderer::software::RWMappableBuffer> data,
+    std::shared_ptr<Buffer> const& previous,
+    geometry::Rectangle const& damage,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release) -> std::shared_ptr<Buffer>
 {
     return std::make_shared<mgc::NotifyingMappableBackedShmBuffer>(
         std::move(data),
+        previous,
+        damage,
         egl_delegate,
         std::move(on_consumed),
         std::move(on_release));
@@ -677,6 +681,12 @@ public:
         return size_;
     }
 
+    auto buffer_age() const -> int override
+    {
+        // EGLStream consumers don't give us back previous frames
+        return 0;
+    }
+
     auto layout() const -> Layout override
     {
         return Layout::GL;
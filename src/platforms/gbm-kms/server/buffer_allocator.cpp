@@ -225,11 +225,15 @@ std::shared_ptr<mg::Buffer> mgg::BufferAllocator::buffer_from_resource(
 
 auto mgg::BufferAllocator::buffer_from_shm(
     std::shared_ptr<renderer::software::RWMappableBuffer> data,
+    std::shared_ptr<Buffer> const& previous,
+    geometry::Rectangle const& damage,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release) -> std::shared_ptr<Buffer>
 {
     return std::make_shared<mgc::NotifyingMappableBackedShmBuffer>(
         std::move(data),
+        previous,
+        damage,
         egl_delegate,
         std::move(on_consumed),
         std::move(on_release));
@@ -323,6 +327,21 @@ public:
         return geom::Size{width, height};
     }
 
+    auto buffer_age() const -> int override
+    {
+        if (!has_buffer_age)
+        {
+            return 0;
+        }
+
+        EGLint age;
+        if (eglQuerySurface(dpy, egl_surf, EGL_BUFFER_AGE_EXT, &age) != EGL_TRUE)
+        {
+            return 0;
+        }
+        return age;
+    }
+
     auto layout() const -> Layout override
     {
         return Layout::GL;
@@ -466,7 +485,8 @@ private:
         : surface{std::move(std::get<0>(renderables))},
           egl_surf{std::get<2>(renderables)},
           dpy{dpy},
-          ctx{std::get<1>(renderables)}
+          ctx{std::get<1>(renderables)},
+          has_buffer_age{mg::has_egl_extension(dpy, "EGL_EXT_buffer_age")}
     {
     }
 
@@ -474,6 +494,7 @@ private:
     EGLSurface const egl_surf;
     EGLDisplay const dpy;
     EGLContext const ctx;
+    bool const has_buffer_age;
 };
 }
 
@@ -540,10 +561,33 @@ auto mgg::GLRenderingProvider::surface_for_sink(
         *cpu_allocator);
 }
 
-auto mgg::GLRenderingProvider::make_framebuffer_provider(DisplaySink& /*sink*/)
+auto mgg::GLRenderingProvider::make_framebuffer_provider(DisplaySink& sink)
     -> std::unique_ptr<FramebufferProvider>
 {
-    // TODO: Make this not a null implementation, so bypass/overlays can work again
+    if (bound_display && bound_display->on_this_sink(sink))
+    {
+        if (auto gbm_allocator = sink.acquire_compatible_allocator<GBMDisplayAllocator>())
+        {
+            class ScanoutFramebufferProvider : public FramebufferProvider
+            {
+            public:
+                explicit ScanoutFramebufferProvider(GBMDisplayAllocator const& allocator)
+                    : allocator{allocator}
+                {
+                }
+
+                auto buffer_to_framebuffer(std::shared_ptr<Buffer> buffer) -> std::unique_ptr<Framebuffer> override
+                {
+                    return allocator.framebuffer_for(buffer);
+                }
+
+            private:
+                GBMDisplayAllocator const& allocator;
+            };
+            return std::make_unique<ScanoutFramebufferProvider>(*gbm_allocator);
+        }
+    }
+
     class NullFramebufferProvider : public FramebufferProvider
     {
     public:
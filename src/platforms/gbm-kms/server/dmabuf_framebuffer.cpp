@@ -0,0 +1,158 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dmabuf_framebuffer.h"
+#include "mir/graphics/buffer.h"
+#include "mir/graphics/dmabuf_buffer.h"
+#include "mir/log.h"
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace mg = mir::graphics;
+namespace mgg = mir::graphics::gbm;
+namespace geom = mir::geometry;
+
+namespace
+{
+/// GEM handles for the planes of a buffer, closed when done with
+class GEMHandles
+{
+public:
+    explicit GEMHandles(int drm_fd)
+        : drm_fd{drm_fd}
+    {
+    }
+
+    ~GEMHandles()
+    {
+        // Planes in the same buffer object share a handle, which must only be closed once
+        std::sort(std::begin(handles), std::end(handles));
+        auto const last = std::unique(std::begin(handles), std::end(handles));
+        for (auto handle = std::begin(handles); handle != last; ++handle)
+        {
+            if (*handle)
+            {
+                drm_gem_close close_args{*handle, 0};
+                drmIoctl(drm_fd, DRM_IOCTL_GEM_CLOSE, &close_args);
+            }
+        }
+    }
+
+    uint32_t handles[4]{0, 0, 0, 0};
+
+private:
+    int const drm_fd;
+};
+}
+
+auto mgg::DMABufFramebuffer::import(mir::Fd const& drm_fd, std::shared_ptr<Buffer> const& buffer)
+    -> std::unique_ptr<DMABufFramebuffer>
+{
+    auto const dmabuf = dynamic_cast<DMABufBuffer*>(buffer->native_buffer_base());
+    if (!dmabuf)
+    {
+        return nullptr;
+    }
+
+    auto const& planes = dmabuf->planes();
+    if (planes.empty() || planes.size() > 4)
+    {
+        return nullptr;
+    }
+
+    GEMHandles gem{drm_fd};
+    uint32_t pitches[4]{0, 0, 0, 0};
+    uint32_t offsets[4]{0, 0, 0, 0};
+    uint64_t modifiers[4]{0, 0, 0, 0};
+    for (size_t i = 0; i != planes.size(); ++i)
+    {
+        if (drmPrimeFDToHandle(drm_fd, planes[i].dma_buf, &gem.handles[i]))
+        {
+            mir::log_debug("Can't scan out client buffer: drmPrimeFDToHandle failed (%s)", strerror(errno));
+            return nullptr;
+        }
+        pitches[i] = planes[i].stride;
+        offsets[i] = planes[i].offset;
+        modifiers[i] = dmabuf->modifier().value_or(0);
+    }
+
+    auto const format = dmabuf->format();
+    auto const size = dmabuf->size();
+    uint32_t fb_id{0};
+    auto const err =
+        dmabuf->modifier() ?
+            drmModeAddFB2WithModifiers(
+                drm_fd,
+                size.width.as_uint32_t(), size.height.as_uint32_t(),
+                format,
+                gem.handles, pitches, offsets, modifiers,
+                &fb_id,
+                DRM_MODE_FB_MODIFIERS) :
+            drmModeAddFB2(
+                drm_fd,
+                size.width.as_uint32_t(), size.height.as_uint32_t(),
+                format,
+                gem.handles, pitches, offsets,
+                &fb_id,
+                0);
+    if (err)
+    {
+        mir::log_debug("Can't scan out client buffer: drmModeAddFB2 failed (%s)", strerror(-err));
+        return nullptr;
+    }
+
+    // The framebuffer holds its own reference to the buffer object, so gem can close the handles
+    return std::unique_ptr<DMABufFramebuffer>{new DMABufFramebuffer{drm_fd, buffer, fb_id, format, size}};
+}
+
+mgg::DMABufFramebuffer::DMABufFramebuffer(
+    mir::Fd drm_fd,
+    std::shared_ptr<Buffer> buffer,
+    uint32_t fb_id,
+    DRMFormat format,
+    geom::Size size)
+    : drm_fd{std::move(drm_fd)},
+      buffer{std::move(buffer)},
+      fb_id{fb_id},
+      format_{format},
+      size_{size}
+{
+}
+
+mgg::DMABufFramebuffer::~DMABufFramebuffer()
+{
+    drmModeRmFB(drm_fd, fb_id);
+}
+
+mgg::DMABufFramebuffer::operator uint32_t() const
+{
+    return fb_id;
+}
+
+auto mgg::DMABufFramebuffer::size() const -> geom::Size
+{
+    return size_;
+}
+
+auto mgg::DMABufFramebuffer::format() const -> DRMFormat
+{
+    return format_;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_GBM_DMABUF_FRAMEBUFFER_H_
+#define MIR_GRAPHICS_GBM_DMABUF_FRAMEBUFFER_H_
+
+#include "kms_framebuffer.h"
+#include "mir/graphics/drm_formats.h"
+#include "mir/fd.h"
+
+#include <memory>
+
+namespace mir
+{
+namespace graphics
+{
+class Buffer;
+
+namespace gbm
+{
+/**
+ * A KMS framebuffer scanning out a client's dmabuf buffer
+ *
+ * The client buffer is held for as long as the framebuffer exists.
+ */
+class DMABufFramebuffer : public FBHandle
+{
+public:
+    /**
+     * Import \a buffer into KMS
+     *
+     * \returns nullptr if \a buffer isn't backed by dmabufs, or KMS can't scan it out
+     */
+    static auto import(mir::Fd const& drm_fd, std::shared_ptr<Buffer> const& buffer)
+        -> std::unique_ptr<DMABufFramebuffer>;
+
+    ~DMABufFramebuffer();
+
+    operator uint32_t() const override;
+    auto size() const -> geometry::Size override;
+
+    auto format() const -> DRMFormat;
+
+private:
+    DMABufFramebuffer(
+        mir::Fd drm_fd,
+        std::shared_ptr<Buffer> buffer,
+        uint32_t fb_id,
+        DRMFormat format,
+        geometry::Size size);
+
+    mir::Fd const drm_fd;
+    std::shared_ptr<Buffer> const buffer;
+    uint32_t const fb_id;
+    DRMFormat const format_;
+    geometry::Size const size_;
+};
+}
+}
+}
+
+#endif /* MIR_GRAPHICS_GBM_DMABUF_FRAMEBUFFER_H_ */
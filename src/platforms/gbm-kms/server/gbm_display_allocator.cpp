@@ -16,6 +16,7 @@
 
 #include "gbm_display_allocator.h"
 #include "kms_framebuffer.h"
+#include "dmabuf_framebuffer.h"
 
 #include <drm_fourcc.h>
 #include <xf86drmMode.h>
@@ -25,13 +26,28 @@ namespace mg = mir::graphics;
 namespace mgg = mir::graphics::gbm;
 namespace geom = mir::geometry;
 
-mgg::GBMDisplayAllocator::GBMDisplayAllocator(mir::Fd drm_fd, std::shared_ptr<struct gbm_device> gbm, geom::Size size)
+mgg::GBMDisplayAllocator::GBMDisplayAllocator(
+    mir::Fd drm_fd,
+    std::shared_ptr<struct gbm_device> gbm,
+    geom::Size size,
+    bool scanout_client_buffers)
     : fd{std::move(drm_fd)},
       gbm{std::move(gbm)},
-      size{size}
+      size{size},
+      scanout_client_buffers{scanout_client_buffers}
 {
 }
 
+auto mgg::GBMDisplayAllocator::framebuffer_for(std::shared_ptr<Buffer> const& buffer) const
+    -> std::unique_ptr<Framebuffer>
+{
+    if (!scanout_client_buffers)
+    {
+        return nullptr;
+    }
+    return DMABufFramebuffer::import(fd, buffer);
+}
+
 auto mgg::GBMDisplayAllocator::supported_formats() const -> std::vector<DRMFormat>
 {
     // TODO: Pull out of KMS plane info
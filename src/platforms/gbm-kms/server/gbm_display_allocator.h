@@ -22,16 +22,28 @@ namespace mir::graphics::gbm
 class GBMDisplayAllocator : public graphics::GBMDisplayAllocator
 {
 public:
-    GBMDisplayAllocator(mir::Fd drm_fd, std::shared_ptr<struct gbm_device> gbm, geometry::Size size);
+    GBMDisplayAllocator(
+        mir::Fd drm_fd,
+        std::shared_ptr<struct gbm_device> gbm,
+        geometry::Size size,
+        bool scanout_client_buffers);
 
     auto supported_formats() const -> std::vector<DRMFormat> override;
 
     auto modifiers_for_format(DRMFormat format) const -> std::vector<uint64_t> override;
 
     auto make_surface(DRMFormat format, std::span<uint64_t> modifier) -> std::unique_ptr<GBMSurface> override;
+
+    /**
+     * A framebuffer to scan \a buffer out of directly, bypassing composition
+     *
+     * \returns nullptr if \a buffer can't be scanned out, or client buffers aren't to be
+     */
+    auto framebuffer_for(std::shared_ptr<Buffer> const& buffer) const -> std::unique_ptr<Framebuffer>;
 private:
     mir::Fd const fd;
     std::shared_ptr<struct gbm_device> const gbm;
     geometry::Size const size;
+    bool const scanout_client_buffers;
 };
 }
@@ -0,0 +1,826 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "atomic_kms_output.h"
+#include "kms_framebuffer.h"
+#include "page_flipper.h"
+#include "kms-utils/kms_connector.h"
+#include "mir/fatal.h"
+#include "mir/log.h"
+
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+namespace mg = mir::graphics;
+namespace mgg = mg::gbm;
+namespace mgk = mg::kms;
+namespace geom = mir::geometry;
+
+namespace
+{
+using AtomicRequest = std::unique_ptr<drmModeAtomicReq, decltype(&drmModeAtomicFree)>;
+
+auto make_request() -> AtomicRequest
+{
+    return {drmModeAtomicAlloc(), &drmModeAtomicFree};
+}
+
+/// DRM plane source coordinates are 16.16 fixed point
+auto to_fixed_point(float value) -> uint64_t
+{
+    return static_cast<uint64_t>(std::lround(value * 65536));
+}
+
+/// How long before a vblank a commit must be made to reach the screen with it
+std::chrono::milliseconds const commit_margin{2};
+
+/// Checks a change that will go with a later commit
+auto test_commit(int drm_fd, drmModeAtomicReq* request) -> int
+{
+    return drmModeAtomicCommit(drm_fd, request, DRM_MODE_ATOMIC_TEST_ONLY, nullptr);
+}
+}
+
+mgg::AtomicKMSOutput::AtomicKMSOutput(
+    int drm_fd,
+    kms::DRMModeConnectorUPtr&& connector,
+    std::shared_ptr<PageFlipper> const& page_flipper)
+    : RealKMSOutput(drm_fd, std::move(connector), page_flipper)
+{
+}
+
+mgg::AtomicKMSOutput::~AtomicKMSOutput()
+{
+    if (mode_blob)
+    {
+        drmModeDestroyPropertyBlob(drm_fd_, mode_blob);
+    }
+    if (cursor_fb)
+    {
+        drmModeRmFB(drm_fd_, cursor_fb);
+    }
+    if (committed_cursor_fb && committed_cursor_fb != cursor_fb)
+    {
+        drmModeRmFB(drm_fd_, committed_cursor_fb);
+    }
+    if (staged_gamma_lut)
+    {
+        drmModeDestroyPropertyBlob(drm_fd_, staged_gamma_lut);
+    }
+}
+
+bool mgg::AtomicKMSOutput::set_crtc(FBHandle const& fb)
+{
+    if (!ensure_crtc())
+    {
+        mir::log_error("Output %s has no associated CRTC to set a framebuffer on",
+                       mgk::connector_name(connector).c_str());
+        return false;
+    }
+
+    std::lock_guard lock{commit_mutex};
+
+    find_planes();
+    if (!primary_plane)
+    {
+        return RealKMSOutput::set_crtc(fb);
+    }
+
+    uint32_t new_mode_blob{0};
+    if (auto const ret = drmModeCreatePropertyBlob(
+            drm_fd_, &connector->modes[mode_index], sizeof(drmModeModeInfo), &new_mode_blob))
+    {
+        mir::log_error("Failed to create mode blob: %s (%i)", strerror(-ret), -ret);
+        return false;
+    }
+
+    int ret{0};
+    try
+    {
+        auto const crtc_id = current_crtc->crtc_id;
+        mgk::ObjectProperties crtc_props{drm_fd_, crtc_id, DRM_MODE_OBJECT_CRTC};
+        mgk::ObjectProperties connector_props{drm_fd_, connector->connector_id, DRM_MODE_OBJECT_CONNECTOR};
+
+        auto const modeset = [&](bool show_overlays)
+            {
+                auto request = make_request();
+                drmModeAtomicAddProperty(request.get(), crtc_id, crtc_props.id_for("MODE_ID"), new_mode_blob);
+                drmModeAtomicAddProperty(request.get(), crtc_id, crtc_props.id_for("ACTIVE"), 1);
+                drmModeAtomicAddProperty(
+                    request.get(), connector->connector_id, connector_props.id_for("CRTC_ID"), crtc_id);
+                add_planes(request.get(), fb, show_overlays);
+                add_staged_changes(request.get());
+
+                return drmModeAtomicCommit(drm_fd_, request.get(), DRM_MODE_ATOMIC_ALLOW_MODESET, nullptr);
+            };
+
+        ret = modeset(true);
+        if (ret && !staged_overlays.empty())
+        {
+            mir::log_warning("Failed to set CRTC with overlay planes; not using overlay planes");
+            overlays_failed = true;
+            ret = modeset(false);
+        }
+    }
+    catch (std::exception const& error)
+    {
+        mir::log_error("Failed to set CRTC: %s", error.what());
+        ret = -EINVAL;
+    }
+
+    if (ret)
+    {
+        mir::log_error("Failed to set CRTC: %s (%i)", strerror(-ret), -ret);
+        drmModeDestroyPropertyBlob(drm_fd_, new_mode_blob);
+        current_crtc = nullptr;
+        return false;
+    }
+
+    if (mode_blob)
+    {
+        drmModeDestroyPropertyBlob(drm_fd_, mode_blob);
+    }
+    mode_blob = new_mode_blob;
+    staged_overlays.clear();
+    staged_changes_committed();
+    frame_due = false;
+    // The modeset has completed, and with it any commit in flight
+    commit_in_flight = false;
+    hold_staged_until = {};
+
+    using_saved_crtc = false;
+    return true;
+}
+
+void mgg::AtomicKMSOutput::clear_crtc()
+{
+    try
+    {
+        if (!ensure_crtc())
+        {
+            return;
+        }
+    }
+    catch (...)
+    {
+        // As for legacy KMS, an output we can't find a CRTC for can't be displaying anything
+        return;
+    }
+
+    std::lock_guard lock{commit_mutex};
+
+    find_planes();
+    if (!primary_plane)
+    {
+        RealKMSOutput::clear_crtc();
+        return;
+    }
+
+    int result{0};
+    try
+    {
+        auto const crtc_id = current_crtc->crtc_id;
+        mgk::ObjectProperties crtc_props{drm_fd_, crtc_id, DRM_MODE_OBJECT_CRTC};
+        mgk::ObjectProperties connector_props{drm_fd_, connector->connector_id, DRM_MODE_OBJECT_CONNECTOR};
+
+        auto request = make_request();
+        drmModeAtomicAddProperty(request.get(), crtc_id, crtc_props.id_for("MODE_ID"), 0);
+        drmModeAtomicAddProperty(request.get(), crtc_id, crtc_props.id_for("ACTIVE"), 0);
+        drmModeAtomicAddProperty(request.get(), connector->connector_id, connector_props.id_for("CRTC_ID"), 0);
+
+        // Planes must be disabled with the CRTC they are on
+        for (auto const& [plane_id, _] : plane_properties)
+        {
+            add_plane(request.get(), plane_id, PlaneState{0, {}, {}});
+        }
+
+        result = drmModeAtomicCommit(drm_fd_, request.get(), DRM_MODE_ATOMIC_ALLOW_MODESET, nullptr);
+    }
+    catch (std::exception const& error)
+    {
+        mir::log_warning("Couldn't clear output %s: %s", mgk::connector_name(connector).c_str(), error.what());
+    }
+
+    if (result)
+    {
+        if (result == -EACCES || result == -EPERM)
+        {
+            /* We don't have modesetting rights.
+             *
+             * This can happen during session switching if (eg) logind has already
+             * revoked device access before notifying us.
+             *
+             * Whatever we're switching to can handle the CRTCs; this should not be fatal.
+             */
+            mir::log_info("Couldn't clear output %s (drmModeAtomicCommit: %s (%i))",
+                mgk::connector_name(connector).c_str(),
+                strerror(-result),
+                -result);
+        }
+        else
+        {
+            fatal_error("Couldn't clear output %s (drmModeAtomicCommit = %d)",
+                        mgk::connector_name(connector).c_str(), result);
+        }
+    }
+
+    staged_overlays.clear();
+    current_crtc = nullptr;
+}
+
+bool mgg::AtomicKMSOutput::schedule_page_flip(FBHandle const& fb)
+{
+    std::unique_lock lg(power_mutex);
+    if (power_mode != mir_power_mode_on)
+        return true;
+    if (!current_crtc)
+    {
+        mir::log_error("Output %s has no associated CRTC to schedule page flips on",
+                       mgk::connector_name(connector).c_str());
+        return false;
+    }
+
+    std::unique_lock lock{commit_mutex};
+
+    find_planes();
+    if (!primary_plane)
+    {
+        return page_flipper->schedule_flip(current_crtc->crtc_id, fb, connector->connector_id);
+    }
+
+    auto const crtc_id = current_crtc->crtc_id;
+    if (page_flipper->flip_pending(crtc_id))
+    {
+        /* Changes committed on their own are still in flight, and the frame
+         * can't be shown before they are. Hold any more back for the frame.
+         */
+        frame_due = true;
+        lock.unlock();
+        page_flipper->wait_for_flip(crtc_id);
+        lock.lock();
+    }
+    frame_due = false;
+
+    auto const flip = [&](bool show_overlays)
+        {
+            auto request = make_request();
+            add_planes(request.get(), fb, show_overlays);
+            add_staged_changes(request.get());
+            return page_flipper->schedule_commit(crtc_id, connector->connector_id, request.get());
+        };
+
+    auto scheduled = flip(true);
+    if (!scheduled && !staged_overlays.empty())
+    {
+        /* Each overlay was tested as it was set, but the hardware may not manage
+         * them all together with this frame. Show the frame without them.
+         */
+        mir::log_warning("Failed to show client buffers on overlay planes; not using overlay planes");
+        overlays_failed = true;
+        scheduled = flip(false);
+    }
+
+    if (scheduled)
+    {
+        staged_overlays.clear();
+        staged_changes_committed();
+        commit_in_flight = true;
+    }
+    return scheduled;
+}
+
+void mgg::AtomicKMSOutput::commit_staged_changes()
+{
+    std::lock_guard lock{commit_mutex};
+    commit_staged_changes_locked();
+}
+
+auto mgg::AtomicKMSOutput::overlay_planes() -> std::vector<OverlayPlane>
+{
+    if (!current_crtc)
+    {
+        return {};
+    }
+
+    std::lock_guard lock{commit_mutex};
+    find_planes();
+    return overlays;
+}
+
+bool mgg::AtomicKMSOutput::set_plane(
+    uint32_t plane_id,
+    FBHandle const& fb,
+    geom::Rectangle const& destination,
+    geom::RectangleF const& source)
+{
+    if (!current_crtc)
+    {
+        return false;
+    }
+
+    std::lock_guard lock{commit_mutex};
+
+    if (overlays_failed || !plane_properties.contains(plane_id))
+    {
+        return false;
+    }
+
+    PlaneState const state{fb, destination, source};
+
+    // Test the overlays for this frame so far together, as they will be committed
+    auto request = make_request();
+    for (auto const& [staged_id, staged] : staged_overlays)
+    {
+        add_plane(request.get(), staged_id, staged);
+    }
+    add_plane(request.get(), plane_id, state);
+
+    if (auto const ret = drmModeAtomicCommit(drm_fd_, request.get(), DRM_MODE_ATOMIC_TEST_ONLY, nullptr))
+    {
+        mir::log_warning("Overlay plane %u can't show the buffer: %s (%i)", plane_id, strerror(-ret), -ret);
+        return false;
+    }
+
+    staged_overlays.insert_or_assign(plane_id, state);
+    return true;
+}
+
+bool mgg::AtomicKMSOutput::clear_plane(uint32_t plane_id)
+{
+    if (!current_crtc)
+    {
+        return false;
+    }
+
+    std::lock_guard lock{commit_mutex};
+
+    if (!plane_properties.contains(plane_id))
+    {
+        return false;
+    }
+
+    staged_overlays.insert_or_assign(plane_id, PlaneState{0, {}, {}});
+    return true;
+}
+
+bool mgg::AtomicKMSOutput::set_cursor(gbm_bo* buffer)
+{
+    if (!current_crtc)
+    {
+        return true;
+    }
+
+    std::lock_guard lock{commit_mutex};
+
+    find_planes();
+    if (!cursor_plane)
+    {
+        return RealKMSOutput::set_cursor(buffer);
+    }
+
+    uint32_t const width = gbm_bo_get_width(buffer);
+    uint32_t const height = gbm_bo_get_height(buffer);
+    uint32_t const handles[4] = {gbm_bo_get_handle(buffer).u32, 0, 0, 0};
+    uint32_t const pitches[4] = {gbm_bo_get_stride(buffer), 0, 0, 0};
+    uint32_t const offsets[4] = {0, 0, 0, 0};
+
+    uint32_t fb_id{0};
+    if (auto const ret = drmModeAddFB2(
+            drm_fd_, width, height, gbm_bo_get_format(buffer), handles, pitches, offsets, &fb_id, 0))
+    {
+        mir::log_warning("set_cursor: drmModeAddFB2 failed (%s)", strerror(-ret));
+        has_cursor_ = false;
+        return false;
+    }
+
+    auto request = make_request();
+    add_plane(request.get(), cursor_plane, PlaneState{
+        fb_id,
+        {cursor_position, {width, height}},
+        {{0, 0}, {width, height}}});
+    if (auto const ret = test_commit(drm_fd_, request.get()))
+    {
+        mir::log_warning("set_cursor: cursor plane can't show the image (%s)", strerror(-ret));
+        drmModeRmFB(drm_fd_, fb_id);
+        has_cursor_ = false;
+        return false;
+    }
+
+    // An image that was replaced before it was committed has never been shown
+    if (cursor_fb && cursor_fb != committed_cursor_fb)
+    {
+        drmModeRmFB(drm_fd_, cursor_fb);
+    }
+    cursor_fb = fb_id;
+    cursor_size = {width, height};
+    cursor_dirty = true;
+    has_cursor_ = true;
+
+    commit_staged_changes_locked();
+    return true;
+}
+
+void mgg::AtomicKMSOutput::move_cursor(geom::Point destination)
+{
+    if (!current_crtc)
+    {
+        return;
+    }
+
+    std::lock_guard lock{commit_mutex};
+
+    find_planes();
+    if (!cursor_plane)
+    {
+        RealKMSOutput::move_cursor(destination);
+        return;
+    }
+
+    cursor_position = destination;
+    if (cursor_fb)
+    {
+        cursor_dirty = true;
+        commit_staged_changes_locked();
+    }
+}
+
+bool mgg::AtomicKMSOutput::clear_cursor()
+{
+    if (!current_crtc)
+    {
+        return true;
+    }
+
+    std::lock_guard lock{commit_mutex};
+
+    find_planes();
+    if (!cursor_plane)
+    {
+        return RealKMSOutput::clear_cursor();
+    }
+
+    has_cursor_ = false;
+    if (!cursor_fb)
+    {
+        return true;
+    }
+
+    if (cursor_fb != committed_cursor_fb)
+    {
+        drmModeRmFB(drm_fd_, cursor_fb);
+    }
+    cursor_fb = 0;
+    cursor_dirty = true;
+
+    commit_staged_changes_locked();
+    return true;
+}
+
+void mgg::AtomicKMSOutput::set_gamma(GammaCurves const& gamma)
+{
+    if (!ensure_crtc())
+    {
+        mir::log_warning("Output %s has no associated CRTC to set gamma on",
+                         mgk::connector_name(connector).c_str());
+        return;
+    }
+
+    if (gamma.red.size() != gamma.green.size() ||
+        gamma.green.size() != gamma.blue.size())
+    {
+        BOOST_THROW_EXCEPTION(
+            std::invalid_argument("set_gamma: mismatch gamma LUT sizes"));
+    }
+
+    auto const crtc_id = current_crtc->crtc_id;
+    mgk::ObjectProperties crtc_props{drm_fd_, crtc_id, DRM_MODE_OBJECT_CRTC};
+    if (gamma.red.empty() || !crtc_props.has_property("GAMMA_LUT") || !crtc_props.has_property("GAMMA_LUT_SIZE"))
+    {
+        RealKMSOutput::set_gamma(gamma);
+        return;
+    }
+
+    // The LUT must be the size the CRTC expects, which needn't be the legacy gamma size
+    std::vector<drm_color_lut> lut(crtc_props["GAMMA_LUT_SIZE"]);
+    for (size_t i = 0; i != lut.size(); ++i)
+    {
+        auto const from = i * gamma.red.size() / lut.size();
+        lut[i] = drm_color_lut{gamma.red[from], gamma.green[from], gamma.blue[from], 0};
+    }
+
+    uint32_t lut_blob{0};
+    if (auto const ret = drmModeCreatePropertyBlob(
+            drm_fd_, lut.data(), lut.size() * sizeof(drm_color_lut), &lut_blob))
+    {
+        mir::log_warning("Failed to create gamma LUT blob: %s", strerror(-ret));
+        return;
+    }
+
+    auto const lut_property = crtc_props.id_for("GAMMA_LUT");
+    auto request = make_request();
+    drmModeAtomicAddProperty(request.get(), crtc_id, lut_property, lut_blob);
+    if (auto const ret = test_commit(drm_fd_, request.get()))
+    {
+        mir::log_warning("Failed to set gamma LUT: %s", strerror(-ret));
+        drmModeDestroyPropertyBlob(drm_fd_, lut_blob);
+        return;
+    }
+
+    std::lock_guard lock{commit_mutex};
+
+    // A LUT that was replaced before it was committed is no longer needed
+    if (staged_gamma_lut)
+    {
+        drmModeDestroyPropertyBlob(drm_fd_, staged_gamma_lut);
+    }
+    staged_gamma_lut = lut_blob;
+    gamma_lut_property = lut_property;
+
+    commit_staged_changes_locked();
+}
+
+auto mgg::AtomicKMSOutput::set_crtc_property(uint32_t property_id, uint64_t value) -> int
+{
+    if (!current_crtc)
+    {
+        return -ENODEV;
+    }
+
+    auto request = make_request();
+    drmModeAtomicAddProperty(request.get(), current_crtc->crtc_id, property_id, value);
+    if (auto const ret = test_commit(drm_fd_, request.get()))
+    {
+        return ret;
+    }
+
+    std::lock_guard lock{commit_mutex};
+
+    staged_crtc_properties.insert_or_assign(property_id, value);
+    commit_staged_changes_locked();
+    return 0;
+}
+
+void mgg::AtomicKMSOutput::find_planes()
+{
+    if (planes_crtc_id == current_crtc->crtc_id)
+    {
+        return;
+    }
+
+    planes_crtc_id = current_crtc->crtc_id;
+    primary_plane = 0;
+    cursor_plane = 0;
+    overlays.clear();
+    plane_properties.clear();
+    staged_overlays.clear();
+
+    try
+    {
+        // Planes identify the CRTCs they can be used with by index, not id
+        mgk::DRMModeResources resources{drm_fd_};
+        uint32_t crtc_mask{0};
+        uint32_t crtc_bit{1};
+        for (auto& crtc : resources.crtcs())
+        {
+            if (crtc->crtc_id == planes_crtc_id)
+            {
+                crtc_mask = crtc_bit;
+                break;
+            }
+            crtc_bit <<= 1;
+        }
+
+        // With DRM_CLIENT_CAP_ATOMIC all planes are listed, including the primary and cursor planes
+        mgk::PlaneResources plane_resources{drm_fd_};
+        for (auto& plane : plane_resources.planes())
+        {
+            if (!(plane->possible_crtcs & crtc_mask))
+            {
+                continue;
+            }
+
+            mgk::ObjectProperties props{drm_fd_, plane->plane_id, DRM_MODE_OBJECT_PLANE};
+            if (!props.has_property("type"))
+            {
+                continue;
+            }
+
+            switch (props["type"])
+            {
+            case DRM_PLANE_TYPE_PRIMARY:
+                if (primary_plane)
+                    continue;
+                primary_plane = plane->plane_id;
+                break;
+
+            case DRM_PLANE_TYPE_CURSOR:
+                if (cursor_plane)
+                    continue;
+                cursor_plane = plane->plane_id;
+                break;
+
+            case DRM_PLANE_TYPE_OVERLAY:
+                // A plane that could move to another CRTC might be wanted by the output there too
+                if (plane->possible_crtcs != crtc_mask)
+                    continue;
+                overlays.push_back(OverlayPlane{
+                    plane->plane_id,
+                    {plane->formats, plane->formats + plane->count_formats}});
+                break;
+
+            default:
+                continue;
+            }
+
+            plane_properties.emplace(plane->plane_id, std::move(props));
+        }
+    }
+    catch (std::exception const& error)
+    {
+        mir::log_warning("Failed to find planes for output %s: %s",
+                         mgk::connector_name(connector).c_str(), error.what());
+        primary_plane = 0;
+        cursor_plane = 0;
+        overlays.clear();
+        plane_properties.clear();
+    }
+}
+
+void mgg::AtomicKMSOutput::add_plane(drmModeAtomicReq* request, uint32_t plane_id, PlaneState const& state) const
+{
+    auto const& props = plane_properties.at(plane_id);
+
+    if (!state.fb)
+    {
+        drmModeAtomicAddProperty(request, plane_id, props.id_for("FB_ID"), 0);
+        drmModeAtomicAddProperty(request, plane_id, props.id_for("CRTC_ID"), 0);
+        return;
+    }
+
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("FB_ID"), state.fb);
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("CRTC_ID"), planes_crtc_id);
+
+    /* Source viewport. Coordinates are 16.16 fixed point format */
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("SRC_X"), to_fixed_point(state.source.top_left.x.as_value()));
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("SRC_Y"), to_fixed_point(state.source.top_left.y.as_value()));
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("SRC_W"), to_fixed_point(state.source.size.width.as_value()));
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("SRC_H"), to_fixed_point(state.source.size.height.as_value()));
+
+    /* Destination viewport. Coordinates are *not* 16.16 */
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("CRTC_X"), state.destination.top_left.x.as_int());
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("CRTC_Y"), state.destination.top_left.y.as_int());
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("CRTC_W"), state.destination.size.width.as_uint32_t());
+    drmModeAtomicAddProperty(request, plane_id, props.id_for("CRTC_H"), state.destination.size.height.as_uint32_t());
+}
+
+void mgg::AtomicKMSOutput::add_planes(drmModeAtomicReq* request, FBHandle const& fb, bool show_overlays) const
+{
+    auto const& mode = connector->modes[mode_index];
+    geom::Size const mode_size{mode.hdisplay, mode.vdisplay};
+
+    add_plane(request, primary_plane, PlaneState{
+        fb,
+        {{0, 0}, mode_size},
+        {{fb_offset.dx.as_int(), fb_offset.dy.as_int()}, {mode_size.width.as_int(), mode_size.height.as_int()}}});
+
+    for (auto const& [plane_id, state] : staged_overlays)
+    {
+        add_plane(request, plane_id, show_overlays ? state : PlaneState{0, {}, {}});
+    }
+}
+
+void mgg::AtomicKMSOutput::add_staged_changes(drmModeAtomicReq* request) const
+{
+    if (cursor_dirty && cursor_plane)
+    {
+        add_plane(request, cursor_plane, cursor_state());
+    }
+
+    for (auto const& [property_id, value] : staged_crtc_properties)
+    {
+        drmModeAtomicAddProperty(request, planes_crtc_id, property_id, value);
+    }
+
+    if (staged_gamma_lut)
+    {
+        drmModeAtomicAddProperty(request, planes_crtc_id, gamma_lut_property, staged_gamma_lut);
+    }
+}
+
+void mgg::AtomicKMSOutput::commit_staged_changes_locked()
+{
+    if (!current_crtc)
+    {
+        return;
+    }
+
+    auto const now = std::chrono::steady_clock::now();
+    auto const pending = page_flipper->flip_pending(current_crtc->crtc_id);
+
+    /* This is called once page flip events have been handled, so a commit is
+     * seen to complete close to the vblank it reached the screen at.
+     */
+    if (commit_in_flight && !pending)
+    {
+        commit_in_flight = false;
+        hold_staged_until = now + hold_after_flip();
+    }
+
+    if (!cursor_dirty && staged_crtc_properties.empty() && !staged_gamma_lut)
+    {
+        return;
+    }
+
+    /* A frame being scheduled, or a commit in flight, is followed by schedule_page_flip()
+     * or commit_staged_changes(), which commit the changes then. Committing them now
+     * would hold the CRTC until the next vblank, and a frame with it.
+     */
+    if (frame_due || pending)
+    {
+        return;
+    }
+
+    // Committed any time before the next vblank, the changes reach the screen with it
+    if (now < hold_staged_until)
+    {
+        page_flipper->schedule_wakeup(hold_staged_until);
+        return;
+    }
+
+    find_planes();
+
+    auto request = make_request();
+    add_staged_changes(request.get());
+    if (!page_flipper->schedule_commit(current_crtc->crtc_id, connector->connector_id, request.get()))
+    {
+        mir::log_warning("Failed to commit cursor and CRTC changes to output %s",
+                         mgk::connector_name(connector).c_str());
+        return;
+    }
+
+    staged_changes_committed();
+    commit_in_flight = true;
+}
+
+void mgg::AtomicKMSOutput::staged_changes_committed()
+{
+    if (cursor_dirty)
+    {
+        // The commit keeps the previous image until the new one is on screen
+        if (committed_cursor_fb && committed_cursor_fb != cursor_fb)
+        {
+            drmModeRmFB(drm_fd_, committed_cursor_fb);
+        }
+        committed_cursor_fb = cursor_fb;
+        cursor_dirty = false;
+    }
+
+    staged_crtc_properties.clear();
+
+    if (staged_gamma_lut)
+    {
+        // The CRTC holds its own reference to the blob
+        drmModeDestroyPropertyBlob(drm_fd_, staged_gamma_lut);
+        staged_gamma_lut = 0;
+    }
+}
+
+auto mgg::AtomicKMSOutput::hold_after_flip() const -> std::chrono::steady_clock::duration
+{
+    auto const refresh_rate = max_refresh_rate();
+    if (refresh_rate <= 0)
+    {
+        return {};
+    }
+
+    auto const frame_interval =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds{1}) / refresh_rate;
+    return std::max(frame_interval - commit_margin, std::chrono::steady_clock::duration::zero());
+}
+
+auto mgg::AtomicKMSOutput::cursor_state() const -> PlaneState
+{
+    return PlaneState{
+        cursor_fb,
+        {cursor_position, cursor_size},
+        {{0, 0}, {cursor_size.width.as_int(), cursor_size.height.as_int()}}};
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_GBM_ATOMIC_KMS_OUTPUT_H_
+#define MIR_GRAPHICS_GBM_ATOMIC_KMS_OUTPUT_H_
+
+#include "real_kms_output.h"
+
+#include <chrono>
+#include <unordered_map>
+
+namespace mir
+{
+namespace graphics
+{
+namespace gbm
+{
+
+/**
+ * A KMSOutput driven by atomic commits
+ *
+ * The mode, primary plane and overlay planes of a frame are committed together,
+ * without blocking, and complete like a page flip. Overlay plane changes are
+ * tested when they are made, so set_plane() fails for a configuration the
+ * hardware can't show. Cursor, gamma and other CRTC changes are tested too, and
+ * go with the next frame, or are committed on their own shortly before the
+ * next vblank if no frame comes by then.
+ *
+ * Requires DRM_CLIENT_CAP_ATOMIC to have been set on the DRM fd.
+ */
+class AtomicKMSOutput : public RealKMSOutput
+{
+public:
+    AtomicKMSOutput(
+        int drm_fd,
+        kms::DRMModeConnectorUPtr&& connector,
+        std::shared_ptr<PageFlipper> const& page_flipper);
+    ~AtomicKMSOutput();
+
+    bool set_crtc(FBHandle const& fb) override;
+    void clear_crtc() override;
+    bool schedule_page_flip(FBHandle const& fb) override;
+    void commit_staged_changes() override;
+
+    auto overlay_planes() -> std::vector<OverlayPlane> override;
+    bool set_plane(
+        uint32_t plane_id,
+        FBHandle const& fb,
+        geometry::Rectangle const& destination,
+        geometry::RectangleF const& source) override;
+    bool clear_plane(uint32_t plane_id) override;
+
+    bool set_cursor(gbm_bo* buffer) override;
+    void move_cursor(geometry::Point destination) override;
+    bool clear_cursor() override;
+
+    void set_gamma(GammaCurves const& gamma) override;
+
+protected:
+    auto set_crtc_property(uint32_t property_id, uint64_t value) -> int override;
+
+private:
+    /// The state of a plane, to be set with the next commit. An fb of 0 disables the plane.
+    struct PlaneState
+    {
+        uint32_t fb;
+        geometry::Rectangle destination;
+        geometry::RectangleF source;
+    };
+
+    void find_planes();
+    void add_plane(drmModeAtomicReq* request, uint32_t plane_id, PlaneState const& state) const;
+    void add_planes(drmModeAtomicReq* request, FBHandle const& fb, bool show_overlays) const;
+    void add_staged_changes(drmModeAtomicReq* request) const;
+    void commit_staged_changes_locked();
+    void staged_changes_committed();
+    auto hold_after_flip() const -> std::chrono::steady_clock::duration;
+    auto cursor_state() const -> PlaneState;
+
+    std::mutex commit_mutex;    ///< Guards the state below
+
+    uint32_t planes_crtc_id{0}; ///< The CRTC the planes below were found for
+    uint32_t primary_plane{0};
+    uint32_t cursor_plane{0};
+    std::vector<OverlayPlane> overlays;
+    std::unordered_map<uint32_t, kms::ObjectProperties> plane_properties;
+
+    std::unordered_map<uint32_t, PlaneState> staged_overlays;   ///< Overlay changes for the next commit
+    bool overlays_failed{false};
+
+    /// A frame is being scheduled, so staged changes wait to go with it
+    bool frame_due{false};
+    bool commit_in_flight{false};   ///< A commit has yet to be seen to complete
+    /// Staged changes wait until then for a frame to go with
+    std::chrono::steady_clock::time_point hold_staged_until;
+
+    uint32_t mode_blob{0};
+
+    uint32_t cursor_fb{0};
+    uint32_t committed_cursor_fb{0};    ///< The cursor image on screen, or about to be
+    geometry::Size cursor_size;
+    geometry::Point cursor_position;
+    bool cursor_dirty{false};           ///< The cursor has changed since it was last committed
+
+    std::unordered_map<uint32_t, uint64_t> staged_crtc_properties;  ///< CRTC changes for the next commit
+    uint32_t staged_gamma_lut{0};       ///< A GAMMA_LUT blob for the next commit
+    uint32_t gamma_lut_property{0};
+};
+
+}
+}
+}
+
+#endif /* MIR_GRAPHICS_GBM_ATOMIC_KMS_OUTPUT_H_ */
@@ -53,6 +53,7 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 
+#include <cstring>
 #include <stdexcept>
 #include <algorithm>
 #include <unordered_map>
@@ -140,22 +141,43 @@ void log_drm_details(mir::Fd const& drm_fd)
     }
 }
 
+auto enable_atomic_kms(mir::Fd const& drm_fd, mgg::AtomicKMSOption atomic_option) -> bool
+{
+    if (atomic_option != mgg::AtomicKMSOption::allowed)
+    {
+        return false;
+    }
+
+    if (drmSetClientCap(drm_fd, DRM_CLIENT_CAP_ATOMIC, 1))
+    {
+        mir::log_info("Driver does not support atomic KMS (%s); using legacy KMS", strerror(errno));
+        return false;
+    }
+
+    mir::log_info("Using atomic KMS");
+    return true;
+}
+
 }
 
 mgg::Display::Display(
     mir::Fd drm_fd,
     std::shared_ptr<struct gbm_device> gbm,
     mgg::BypassOption bypass_option,
+    mgg::AtomicKMSOption atomic_option,
     std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy,
     std::shared_ptr<DisplayReport> const& listener)
     : drm_fd{std::move(drm_fd)},
       gbm{std::move(gbm)},
       listener(listener),
       monitor(mir::udev::Context()),
+      atomic_kms{enable_atomic_kms(this->drm_fd, atomic_option)},
+      page_flipper{std::make_shared<KMSPageFlipper>(this->drm_fd, listener)},
       output_container{
           std::make_shared<RealKMSOutputContainer>(
             this->drm_fd,
-            std::make_shared<KMSPageFlipper>(this->drm_fd, listener))},
+            page_flipper,
+            atomic_kms)},
       current_display_configuration{output_container},
       dirty_configuration{false},
       bypass_option(bypass_option)
@@ -233,6 +255,30 @@ void mgg::Display::register_configuration_change_handler(
                                             conf_change_handler();
                                        });
             }));
+
+    if (atomic_kms)
+    {
+        /* Atomic commits don't block, so their completion events can be handled here
+         * rather than by whichever compositor thread next waits for a flip. Changes
+         * held back while a flip was in flight, or for a frame that didn't come,
+         * can then be committed.
+         */
+        handlers.register_fd_handler(
+            {drm_fd, page_flipper->events_handled_fd(), page_flipper->wakeup_fd()},
+            this,
+            make_module_ptr<std::function<void(int)>>(
+                [this](int)
+                {
+                    page_flipper->handle_events();
+
+                    std::lock_guard lg{configuration_mutex};
+                    output_container->for_each_output(
+                        [](std::shared_ptr<KMSOutput> const& output)
+                        {
+                            output->commit_staged_changes();
+                        });
+                }));
+    }
 }
 
 void mgg::Display::pause()
@@ -397,6 +443,7 @@ void mgg::Display::configure_locked(
                     auto const mode_index = kms_conf.get_kms_mode_index(conf_output.id,
                                                                   conf_output.current_mode_index);
                     kms_output->configure(conf_output.top_left - bounding_rect.top_left, mode_index);
+                    kms_output->set_variable_refresh(conf_output.vrr_enabled);
                     if (!comp)
                     {
                         kms_output->set_power_mode(conf_output.power_mode);
@@ -52,6 +52,7 @@ class GBMHelper;
 
 class DisplaySink;
 class KMSOutput;
+class KMSPageFlipper;
 class Cursor;
 
 class Display : public graphics::Display
@@ -61,6 +62,7 @@ public:
         mir::Fd drm_fd,
         std::shared_ptr<struct gbm_device> gbm,
         BypassOption bypass_option,
+        AtomicKMSOption atomic_option,
         std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy,
         std::shared_ptr<DisplayReport> const& listener);
     ~Display();
@@ -90,6 +92,8 @@ private:
     std::shared_ptr<struct gbm_device> const gbm;
     std::shared_ptr<DisplayReport> const listener;
     mir::udev::Monitor monitor;
+    bool const atomic_kms;
+    std::shared_ptr<KMSPageFlipper> const page_flipper;
     std::shared_ptr<KMSOutputContainer> const output_container;
     std::vector<std::unique_ptr<DisplaySink>> display_sinks;
     mutable RealKMSDisplayConfiguration current_display_configuration;
@@ -19,6 +19,7 @@
 #include "kms_output.h"
 #include "cpu_addressable_fb.h"
 #include "gbm_display_allocator.h"
+#include "dmabuf_framebuffer.h"
 #include "mir/fd.h"
 #include "mir/graphics/display_report.h"
 #include "mir/graphics/platform.h"
@@ -51,12 +52,13 @@ namespace geom = mir::geometry;
 mgg::DisplaySink::DisplaySink(
     mir::Fd drm_fd,
     std::shared_ptr<struct gbm_device> gbm,
-    mgg::BypassOption,
+    mgg::BypassOption bypass_option,
     std::shared_ptr<DisplayReport> const& listener,
     std::vector<std::shared_ptr<KMSOutput>> const& outputs,
     geom::Rectangle const& area,
     glm::mat2 const& transformation)
-    : gbm{std::move(gbm)},
+    : bypass_option{bypass_option},
+      gbm{std::move(gbm)},
       listener(listener),
       outputs(outputs),
       area(area),
@@ -118,8 +120,8 @@ void mgg::DisplaySink::set_transformation(glm::mat2 const& t, geometry::Rectangl
 
 bool mgg::DisplaySink::overlay(std::vector<DisplayElement> const& renderable_list)
 {
-    // TODO: implement more than the most basic case.
-    if (renderable_list.size() != 1)
+    // The bottom element goes on the primary plane, and must cover the whole display
+    if (renderable_list.empty())
     {
         return false;
     }
@@ -136,12 +138,124 @@ bool mgg::DisplaySink::overlay(std::vector<DisplayElement> const& renderable_lis
         return false;
     }
 
-    if (auto fb = std::dynamic_pointer_cast<graphics::FBHandle>(renderable_list[0].buffer))
+    auto fb = std::dynamic_pointer_cast<graphics::FBHandle>(renderable_list[0].buffer);
+    if (!fb)
     {
-        next_swap = std::move(fb);
-        return true;
+        return false;
+    }
+
+    auto overlays = assign_overlays(renderable_list.begin() + 1, renderable_list.end());
+    if (!overlays)
+    {
+        return false;
     }
-    return false;
+
+    next_swap = std::move(fb);
+    next_overlays = std::move(*overlays);
+    return true;
+}
+
+bool mgg::DisplaySink::accepts_overlays(std::vector<DisplayElement> const& overlays)
+{
+    return !overlays.empty() && assign_overlays(overlays.begin(), overlays.end()).has_value();
+}
+
+auto mgg::DisplaySink::assign_overlays(DisplayElements first, DisplayElements last)
+    -> std::optional<std::vector<PlaneOverlay>>
+{
+    std::vector<PlaneOverlay> overlays;
+    if (first == last)
+    {
+        return overlays;
+    }
+
+    /* Only outputs using atomic KMS offer overlay planes. They test each plane as it is set,
+     * but that's after the frame below has been rendered, so we only try the cases the
+     * hardware is (nearly) certain to handle: unscaled client buffers, on a single
+     * untransformed output, on planes dedicated to our CRTC.
+     */
+    if (overlay_planes_failed || bypass_option != BypassOption::allowed ||
+        outputs.size() != 1 || transform != glm::mat2{1})
+    {
+        return std::nullopt;
+    }
+
+    std::vector<uint32_t> formats;
+    for (auto element = first; element != last; ++element)
+    {
+        auto fb = std::dynamic_pointer_cast<DMABufFramebuffer const>(element->buffer);
+        if (!fb)
+        {
+            return std::nullopt;
+        }
+
+        // Planes may not support scaling or cropping, so only show whole, unscaled buffers
+        auto const& destination = element->screen_positon;
+        auto const& source = element->source_position;
+        if (!view_area().contains(destination) ||
+            destination.size != fb->size() ||
+            source.top_left != geom::PointF{0, 0} ||
+            source.size.width.as_value() != destination.size.width.as_int() ||
+            source.size.height.as_value() != destination.size.height.as_int())
+        {
+            return std::nullopt;
+        }
+
+        formats.push_back(fb->format());
+        overlays.push_back(PlaneOverlay{
+            0,
+            std::move(fb),
+            {as_point(destination.top_left - view_area().top_left), destination.size},
+            source});
+    }
+
+    auto const plane_ids = assign_overlay_planes(outputs.front()->overlay_planes(), formats);
+    if (!plane_ids)
+    {
+        return std::nullopt;
+    }
+
+    for (size_t i = 0; i != overlays.size(); ++i)
+    {
+        overlays[i].plane_id = (*plane_ids)[i];
+    }
+    return overlays;
+}
+
+void mgg::DisplaySink::update_overlay_planes()
+{
+    if (next_overlays.empty() && visible_overlays.empty())
+    {
+        return;
+    }
+
+    auto const& output = outputs.front();
+    for (auto const& overlay : next_overlays)
+    {
+        if (!output->set_plane(overlay.plane_id, *overlay.fb, overlay.destination, overlay.source))
+        {
+            mir::log_warning("Failed to show client buffer on overlay plane; not using overlay planes");
+            overlay_planes_failed = true;
+        }
+    }
+
+    for (auto const& overlay : visible_overlays)
+    {
+        auto const still_used = std::any_of(
+            next_overlays.begin(), next_overlays.end(),
+            [&](auto const& next) { return next.plane_id == overlay.plane_id; });
+
+        if (!still_used)
+        {
+            output->clear_plane(overlay.plane_id);
+        }
+    }
+
+    /* With atomic KMS the planes change with the page flip, so the buffers
+     * on screen are released once it completes (see wait_for_page_flip()).
+     */
+    scheduled_overlays = std::move(next_overlays);
+    next_overlays.clear();
 }
 
 void mgg::DisplaySink::for_each_display_sink(std::function<void(graphics::DisplaySink&)> const& f)
@@ -189,6 +303,8 @@ void mgg::DisplaySink::post()
     scheduled_fb = std::move(next_swap);
     next_swap = nullptr;
 
+    update_overlay_planes();
+
     /*
      * Try to schedule a page flip as first preference to avoid tearing.
      * [will complete in a background thread]
@@ -206,6 +322,8 @@ void mgg::DisplaySink::post()
         // SetCrtc is immediate, so the FB is now visible and we have nothing pending
         visible_fb = std::move(scheduled_fb);
         scheduled_fb = nullptr;
+        visible_overlays = std::move(scheduled_overlays);
+        scheduled_overlays.clear();
 
         needs_set_crtc = false;
     }
@@ -237,7 +355,8 @@ void mgg::DisplaySink::post()
         /*
          * Not in clone mode? We can afford to wait for the page flip then,
          * making us double-buffered (noticeably less laggy than the triple
-         * buffering that clone mode requires).
+         * buffering that clone mode requires). The frame scheduler also
+         * takes vblank timing from when post() returns.
          */
         if (outputs.size() == 1)
             wait_for_page_flip();
@@ -256,7 +375,15 @@ void mgg::DisplaySink::post()
     {
         auto const& output = outputs.front();
         auto const min_frame_interval = 1000ms / output->max_refresh_rate();
-        if (predicted_render_time < min_frame_interval)
+
+        /*
+         * With variable refresh the display waits for the bypassed client's
+         * next frame, so we should flip it as soon as it arrives rather than
+         * pacing it to the maximum refresh rate.
+         */
+        bool const paced_by_client = holding_client_buffers && output->has_variable_refresh();
+
+        if (!paced_by_client && predicted_render_time < min_frame_interval)
             recommend_sleep = min_frame_interval - predicted_render_time;
     }
 }
@@ -291,6 +418,8 @@ void mgg::DisplaySink::wait_for_page_flip()
         // The previously-scheduled FB has been page-flipped, and is now visible
         visible_fb = std::move(scheduled_fb);
         scheduled_fb = nullptr;
+        visible_overlays = std::move(scheduled_overlays);
+        scheduled_overlays.clear();
 
         page_flips_pending = false;
     }
@@ -344,7 +473,11 @@ auto mgg::DisplaySink::maybe_create_allocator(DisplayAllocator::Tag const& type_
     {
         if (!gbm_allocator)
         {
-            gbm_allocator = std::make_unique<GBMDisplayAllocator>(drm_fd(), gbm, outputs.front()->size());
+            gbm_allocator = std::make_unique<GBMDisplayAllocator>(
+                drm_fd(),
+                gbm,
+                outputs.front()->size(),
+                bypass_option == BypassOption::allowed);
         }
         return gbm_allocator.get();
     }
@@ -28,6 +28,7 @@
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <optional>
 
 namespace mir
 {
@@ -62,6 +63,7 @@ public:
     void set_next_image(std::unique_ptr<Framebuffer> content) override;
 
     bool overlay(std::vector<DisplayElement> const& renderlist) override;
+    bool accepts_overlays(std::vector<DisplayElement> const& overlays) override;
 
     void for_each_display_sink(
         std::function<void(graphics::DisplaySink&)> const& f) override;
@@ -82,8 +84,24 @@ protected:
     auto maybe_create_allocator(DisplayAllocator::Tag const& type_tag) -> DisplayAllocator* override;
 
 private:
+    /// A client buffer to be shown on a KMS overlay plane
+    struct PlaneOverlay
+    {
+        uint32_t plane_id;
+        std::shared_ptr<FBHandle const> fb;
+        geometry::Rectangle destination;  ///< In CRTC coordinates
+        geometry::RectangleF source;
+    };
+
     bool schedule_page_flip(FBHandle const& bufobj);
     void set_crtc(FBHandle const&);
+    using DisplayElements = std::vector<DisplayElement>::const_iterator;
+
+    /// Planes for the elements from \a first to \a last, which are to go above the primary plane
+    auto assign_overlays(DisplayElements first, DisplayElements last) -> std::optional<std::vector<PlaneOverlay>>;
+    void update_overlay_planes();
+
+    BypassOption const bypass_option;
 
     std::shared_ptr<struct gbm_device> const gbm;
     bool holding_client_buffers{false};
@@ -101,6 +119,10 @@ private:
     std::shared_ptr<FBHandle const> next_swap{nullptr};    //< Next frame to submit to the hardware
     std::shared_ptr<FBHandle const> scheduled_fb{nullptr}; //< Frame currently submitted to the hardware, not yet on-screen
     std::shared_ptr<FBHandle const> visible_fb{nullptr};   //< Frame currently onscreen
+    std::vector<PlaneOverlay> next_overlays;               //< Overlays to show with next_swap
+    std::vector<PlaneOverlay> scheduled_overlays;          //< Overlays to show with scheduled_fb
+    std::vector<PlaneOverlay> visible_overlays;            //< Overlays currently onscreen
+    bool overlay_planes_failed{false};
 
     geometry::Rectangle area;
     glm::mat2 transform;
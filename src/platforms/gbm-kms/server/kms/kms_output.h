@@ -20,11 +20,13 @@
 #include "mir/geometry/size.h"
 #include "mir/geometry/point.h"
 #include "mir/geometry/displacement.h"
+#include "mir/geometry/rectangle.h"
 #include "mir/graphics/display_configuration.h"
 #include "mir/graphics/frame.h"
 #include "mir/graphics/dmabuf_buffer.h"
 #include "mir_toolkit/common.h"
 #include "kms-utils/drm_mode_resources.h"
+#include "plane_assignment.h"
 
 #include <gbm.h>
 
@@ -71,6 +73,31 @@ public:
     virtual void clear_crtc() = 0;
     virtual bool schedule_page_flip(FBHandle const& fb) = 0;
     virtual void wait_for_page_flip() = 0;
+    /**
+     * Commit cursor and CRTC changes that were held back while a page flip was in flight
+     *
+     * This is called once page flip events have been handled. Outputs that make
+     * such changes immediately have nothing to do.
+     */
+    virtual void commit_staged_changes() = 0;
+
+    /**
+     * The overlay planes that can be shown on this output's CRTC, from bottom to top
+     *
+     * Only outputs driven by atomic KMS, where plane changes are made with the page flip, have any.
+     */
+    virtual auto overlay_planes() -> std::vector<OverlayPlane> = 0;
+    /**
+     * Show \a source of \a fb at \a destination (in CRTC coordinates) on an overlay plane
+     *
+     * This takes effect with the next page flip.
+     */
+    virtual bool set_plane(
+        uint32_t plane_id,
+        FBHandle const& fb,
+        geometry::Rectangle const& destination,
+        geometry::RectangleF const& source) = 0;
+    virtual bool clear_plane(uint32_t plane_id) = 0;
 
     virtual bool set_cursor(gbm_bo* buffer) = 0;
     virtual void move_cursor(geometry::Point destination) = 0;
@@ -80,6 +107,14 @@ public:
     virtual void set_power_mode(MirPowerMode mode) = 0;
     virtual void set_gamma(GammaCurves const& gamma) = 0;
 
+    /**
+     * Let the refresh rate follow the frames flipped to, where the output is capable
+     * of it (VESA Adaptive-Sync). Each frame is then shown as soon as it is flipped to,
+     * rather than at the next fixed vblank.
+     */
+    virtual void set_variable_refresh(bool enabled) = 0;
+    virtual bool has_variable_refresh() const = 0;
+
     /**
      * Re-probe the hardware state of this connector.
      *
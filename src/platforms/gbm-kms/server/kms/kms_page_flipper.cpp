@@ -25,6 +25,12 @@
 #include <xf86drmMode.h>
 #include <chrono>
 #include <cstring>
+#include <iterator>
+#include <system_error>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 
 namespace mg = mir::graphics;
 namespace mgg = mir::graphics::gbm;
@@ -42,6 +48,58 @@ void page_flip_handler(int /*fd*/, unsigned int seq,
                                               seq, ns);
 }
 
+auto page_flip_event_context() -> drmEventContext
+{
+    drmEventContext evctx;
+    memset(&evctx, 0, sizeof evctx);
+    evctx.version = 2;  // We only support the old v2 page_flip_handler
+    evctx.page_flip_handler = &page_flip_handler;
+    return evctx;
+}
+
+/* Another thread may have handled the events since we saw the fd become readable,
+ * and drmHandleEvent() would then block until the next one arrives.
+ */
+bool events_waiting(int drm_fd)
+{
+    pollfd fd{drm_fd, POLLIN, 0};
+    return poll(&fd, 1, 0) > 0;
+}
+
+auto make_eventfd() -> mir::Fd
+{
+    mir::Fd fd{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)};
+    if (fd < 0)
+    {
+        BOOST_THROW_EXCEPTION((
+            std::system_error{errno, std::system_category(), "Failed to create page flip eventfd"}));
+    }
+    return fd;
+}
+
+auto make_timerfd() -> mir::Fd
+{
+    // std::chrono::steady_clock is CLOCK_MONOTONIC
+    mir::Fd fd{timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)};
+    if (fd < 0)
+    {
+        BOOST_THROW_EXCEPTION((
+            std::system_error{errno, std::system_category(), "Failed to create page flip timerfd"}));
+    }
+    return fd;
+}
+
+void signal(int fd)
+{
+    eventfd_write(fd, 1);
+}
+
+void clear(int fd)
+{
+    // Nothing to read just means nobody signalled
+    eventfd_t unused;
+    eventfd_read(fd, &unused);
+}
 }
 
 mgg::KMSPageFlipper::KMSPageFlipper(
@@ -50,7 +108,10 @@ mgg::KMSPageFlipper::KMSPageFlipper(
     drm_fd{drm_fd},
     report{report},
     pending_page_flips(),
-    worker_tid()
+    worker_tid(),
+    wake_fd{make_eventfd()},
+    events_handled_fd_{make_eventfd()},
+    wakeup_fd_{make_timerfd()}
 {
     uint64_t mono = 0;
     if (drmGetCap(drm_fd, DRM_CAP_TIMESTAMP_MONOTONIC, &mono) || !mono)
@@ -86,12 +147,93 @@ bool mgg::KMSPageFlipper::schedule_flip(uint32_t crtc_id,
     return (ret == 0);
 }
 
+bool mgg::KMSPageFlipper::schedule_commit(uint32_t crtc_id,
+                                          uint32_t connector_id,
+                                          drmModeAtomicReq* request)
+{
+    std::unique_lock lock{pf_mutex};
+
+    if (pending_page_flips.find(crtc_id) != pending_page_flips.end())
+        BOOST_THROW_EXCEPTION(std::logic_error("Page flip for crtc_id is already scheduled"));
+
+    pending_page_flips[crtc_id] = PageFlipEventData{crtc_id, connector_id, this};
+
+    /*
+     * Each commit for the CRTC completes with an event before the next is
+     * made, so this doesn't wait for one that is in flight.
+     */
+    auto ret = drmModeAtomicCommit(drm_fd, request,
+                                   DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT,
+                                   &pending_page_flips[crtc_id]);
+
+    if (ret)
+        pending_page_flips.erase(crtc_id);
+
+    return (ret == 0);
+}
+
+void mgg::KMSPageFlipper::handle_events()
+{
+    auto evctx = page_flip_event_context();
+
+    clear(events_handled_fd_);
+
+    {
+        std::unique_lock lock{pf_mutex};
+
+        uint64_t expirations;
+        if (read(wakeup_fd_, &expirations, sizeof expirations) == sizeof expirations)
+            wakeup.reset();
+
+        if (!events_waiting(drm_fd))
+            return;
+
+        drmHandleEvent(drm_fd, &evctx);
+    }
+
+    /* The worker may be waiting on the DRM fd for the event we just handled */
+    signal(wake_fd);
+    pf_cv.notify_all();
+}
+
+auto mgg::KMSPageFlipper::events_handled_fd() const -> int
+{
+    return events_handled_fd_;
+}
+
+auto mgg::KMSPageFlipper::wakeup_fd() const -> int
+{
+    return wakeup_fd_;
+}
+
+void mgg::KMSPageFlipper::schedule_wakeup(std::chrono::steady_clock::time_point time)
+{
+    std::unique_lock lock{pf_mutex};
+
+    // The main loop commits every output's staged changes, so the earliest wakeup serves all
+    if (wakeup && *wakeup <= time)
+        return;
+
+    auto const since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch());
+    itimerspec expiry{};
+    expiry.it_value.tv_sec = since_epoch.count() / 1000000000;
+    expiry.it_value.tv_nsec = since_epoch.count() % 1000000000;
+
+    // An all-zero expiry would disarm the timer rather than expire at once
+    if (expiry.it_value.tv_sec == 0 && expiry.it_value.tv_nsec == 0)
+        expiry.it_value.tv_nsec = 1;
+
+    if (timerfd_settime(wakeup_fd_, TFD_TIMER_ABSTIME, &expiry, nullptr))
+    {
+        BOOST_THROW_EXCEPTION((
+            std::system_error{errno, std::system_category(), "Failed to set page flip timerfd"}));
+    }
+    wakeup = time;
+}
+
 mg::Frame mgg::KMSPageFlipper::wait_for_flip(uint32_t crtc_id)
 {
-    drmEventContext evctx;
-    memset(&evctx, 0, sizeof evctx);
-    evctx.version = 2;  // We only support the old v2 page_flip_handler
-    evctx.page_flip_handler = &page_flip_handler;
+    auto evctx = page_flip_event_context();
 
     static std::thread::id const invalid_tid;
 
@@ -118,31 +260,42 @@ mg::Frame mgg::KMSPageFlipper::wait_for_flip(uint32_t crtc_id)
 
     while (!done)
     {
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(drm_fd, &fds);
-
         /*
          * Wait for a page flip event. When we get a page flip event,
          * page_flip_handler(), called through drmHandleEvent(), will update
          * the pending_page_flips map.
+         *
+         * The main loop may handle our event instead, and then signals wake_fd.
          */
-        auto ret = select(drm_fd + 1, &fds, nullptr, nullptr, nullptr);
+        pollfd fds[] = {{drm_fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+        auto const ret = poll(fds, std::size(fds), -1);
+        bool handled{false};
 
         {
             std::unique_lock lock{pf_mutex};
 
-            if (ret > 0)
-            {
-                drmHandleEvent(drm_fd, &evctx);
-            }
-            else if (ret < 0 && errno != EINTR)
+            if (ret < 0 && errno != EINTR)
             {
                 std::string const msg("Error while waiting for page-flip event");
                 BOOST_THROW_EXCEPTION(
                     boost::enable_error_info(
                         std::runtime_error(msg)) << boost::errinfo_errno(errno));
             }
+            else if (ret > 0 && (fds[0].revents & (POLLERR | POLLNVAL)))
+            {
+                BOOST_THROW_EXCEPTION(std::runtime_error("Error while waiting for page-flip event: DRM fd is invalid"));
+            }
+
+            if (fds[1].revents & POLLIN)
+            {
+                clear(wake_fd);
+            }
+
+            if ((fds[0].revents & POLLIN) && events_waiting(drm_fd))
+            {
+                drmHandleEvent(drm_fd, &evctx);
+                handled = true;
+            }
 
             done = page_flip_is_done(crtc_id);
             /* Give up loop control if we are done */
@@ -150,6 +303,10 @@ mg::Frame mgg::KMSPageFlipper::wait_for_flip(uint32_t crtc_id)
                 worker_tid = invalid_tid;
         }
 
+        /* Other outputs' flips may have completed, which the main loop acts on */
+        if (handled)
+            signal(events_handled_fd_);
+
         /*
          * Wake up other (non-worker) threads, so they can check whether
          * their page-flip events have arrived, or whether they can become
@@ -160,6 +317,13 @@ mg::Frame mgg::KMSPageFlipper::wait_for_flip(uint32_t crtc_id)
     return completed_page_flips[crtc_id];
 }
 
+bool mgg::KMSPageFlipper::flip_pending(uint32_t crtc_id)
+{
+    std::unique_lock lock{pf_mutex};
+
+    return !page_flip_is_done(crtc_id);
+}
+
 std::thread::id mgg::KMSPageFlipper::debug_get_worker_tid()
 {
     std::unique_lock lock{pf_mutex};
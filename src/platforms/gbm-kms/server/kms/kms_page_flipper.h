@@ -18,11 +18,13 @@
 #define MIR_GRAPHICS_GBM_KMS_PAGE_FLIPPER_H_
 
 #include "page_flipper.h"
+#include "mir/fd.h"
 
 #include <unordered_map>
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <optional>
 #include <thread>
 #include <ctime>
 #include <sys/time.h>
@@ -51,7 +53,25 @@ public:
     KMSPageFlipper(int drm_fd, std::shared_ptr<DisplayReport> const& report);
 
     bool schedule_flip(uint32_t crtc_id, uint32_t fb_id, uint32_t connector_id) override;
+    bool schedule_commit(uint32_t crtc_id, uint32_t connector_id, drmModeAtomicReq* request) override;
     Frame wait_for_flip(uint32_t crtc_id) override;
+    bool flip_pending(uint32_t crtc_id) override;
+    void schedule_wakeup(std::chrono::steady_clock::time_point time) override;
+
+    /**
+     * Handle any page flip events waiting on the DRM fd
+     *
+     * This is for the main loop to call when the DRM fd, events_handled_fd()
+     * or wakeup_fd() is readable. A thread blocked in wait_for_flip() is woken
+     * to check whether its flip has completed.
+     */
+    void handle_events();
+
+    /// Readable when wait_for_flip() has handled page flip events that the main loop didn't
+    auto events_handled_fd() const -> int;
+
+    /// Readable once the time passed to schedule_wakeup() has come
+    auto wakeup_fd() const -> int;
 
     std::thread::id debug_get_worker_tid();
 
@@ -66,6 +86,10 @@ private:
     std::mutex pf_mutex;
     std::condition_variable pf_cv;
     std::thread::id worker_tid;
+    mir::Fd const wake_fd;              ///< Wakes the worker when handle_events() has handled events
+    mir::Fd const events_handled_fd_;   ///< Tells the main loop the worker has handled events
+    mir::Fd const wakeup_fd_;           ///< A timer for schedule_wakeup()
+    std::optional<std::chrono::steady_clock::time_point> wakeup;    ///< When wakeup_fd_ is set to expire
     clockid_t clock_id;
 };
 
@@ -18,7 +18,9 @@
 #define MIR_GRAPHICS_GBM_PAGE_FLIPPER_H_
 
 #include "mir/graphics/frame.h"
+#include <chrono>
 #include <cstdint>
+#include <xf86drmMode.h>
 
 namespace mir
 {
@@ -33,7 +35,13 @@ public:
     virtual ~PageFlipper() {}
 
     virtual bool schedule_flip(uint32_t crtc_id, uint32_t fb_id, uint32_t connector_id) = 0;
+    /// Commit an atomic \a request for \a crtc_id, to complete like a page flip
+    virtual bool schedule_commit(uint32_t crtc_id, uint32_t connector_id, drmModeAtomicReq* request) = 0;
     virtual Frame wait_for_flip(uint32_t crtc_id) = 0;
+    /// Whether a flip or commit scheduled for \a crtc_id has yet to complete
+    virtual bool flip_pending(uint32_t crtc_id) = 0;
+    /// Have the main loop call KMSOutput::commit_staged_changes() no later than \a time
+    virtual void schedule_wakeup(std::chrono::steady_clock::time_point time) = 0;
 
 protected:
     PageFlipper() = default;
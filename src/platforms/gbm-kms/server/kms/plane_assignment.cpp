@@ -0,0 +1,54 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "plane_assignment.h"
+
+#include <algorithm>
+
+namespace mgg = mir::graphics::gbm;
+
+auto mgg::assign_overlay_planes(std::vector<OverlayPlane> const& planes, std::vector<uint32_t> const& formats)
+    -> std::optional<std::vector<uint32_t>>
+{
+    std::vector<uint32_t> assignment;
+    assignment.reserve(formats.size());
+
+    /*
+     * As the stacking order has to be kept, taking the lowest plane that will do for each
+     * buffer in turn leaves as many planes as possible for those above it.
+     */
+    auto next_plane = planes.begin();
+    for (auto const format : formats)
+    {
+        next_plane = std::find_if(
+            next_plane,
+            planes.end(),
+            [format](OverlayPlane const& plane)
+            {
+                return std::find(plane.formats.begin(), plane.formats.end(), format) != plane.formats.end();
+            });
+
+        if (next_plane == planes.end())
+        {
+            return std::nullopt;
+        }
+
+        assignment.push_back(next_plane->id);
+        ++next_plane;
+    }
+
+    return assignment;
+}
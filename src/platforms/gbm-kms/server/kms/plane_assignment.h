@@ -0,0 +1,54 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_GBM_PLANE_ASSIGNMENT_H_
+#define MIR_GRAPHICS_GBM_PLANE_ASSIGNMENT_H_
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace mir
+{
+namespace graphics
+{
+namespace gbm
+{
+
+/// A KMS overlay plane that can be shown on a CRTC
+struct OverlayPlane
+{
+    uint32_t id;
+    std::vector<uint32_t> formats;  ///< The DRM fourcc formats the plane can scan out
+};
+
+/**
+ * Choose an overlay plane for each of a stack of buffers
+ *
+ * Both \a planes and \a formats are ordered from bottom to top, and the planes chosen keep
+ * the buffers in the same stacking order.
+ *
+ * \param [in] planes   The overlay planes available
+ * \param [in] formats  The DRM fourcc format of each buffer
+ * \returns the id of the plane chosen for each buffer, or std::nullopt if the buffers don't all fit
+ */
+auto assign_overlay_planes(std::vector<OverlayPlane> const& planes, std::vector<uint32_t> const& formats)
+    -> std::optional<std::vector<uint32_t>>;
+}
+}
+}
+
+#endif /* MIR_GRAPHICS_GBM_PLANE_ASSIGNMENT_H_ */
@@ -83,8 +83,9 @@ mgg::Platform::Platform(
     std::shared_ptr<DisplayReport> const& listener,
     ConsoleServices& vt,
     EmergencyCleanupRegistry& registry,
-    BypassOption bypass_option)
-    : Platform(master_fd_for_device(device, vt), listener, registry, bypass_option)
+    BypassOption bypass_option,
+    AtomicKMSOption atomic_option)
+    : Platform(master_fd_for_device(device, vt), listener, registry, bypass_option, atomic_option)
 {
 }
 
@@ -92,13 +93,15 @@ mgg::Platform::Platform(
     std::tuple<std::unique_ptr<Device>, mir::Fd> drm,
     std::shared_ptr<DisplayReport> const& listener,
     EmergencyCleanupRegistry&,
-    BypassOption bypass_option)
+    BypassOption bypass_option,
+    AtomicKMSOption atomic_option)
     : udev{std::make_shared<mir::udev::Context>()},
       listener{listener},
       device_handle{std::move(std::get<0>(drm))},
       drm_fd{std::move(std::get<1>(drm))},
       gbm_display_provider{maybe_make_gbm_provider(drm_fd)},
-      bypass_option_{bypass_option}
+      bypass_option_{bypass_option},
+      atomic_option{atomic_option}
 {
     if (drm_fd == mir::Fd::invalid)
     {
@@ -399,6 +402,7 @@ mir::UniqueModulePtr<mg::Display> mgg::Platform::create_display(
         drm_fd,
         gbm_device_from_provider(gbm_display_provider),
         bypass_option_,
+        atomic_option,
         initial_conf_policy,
         listener);
 }
@@ -52,7 +52,8 @@ public:
         std::shared_ptr<DisplayReport> const& reporter,
         ConsoleServices& vt,
         EmergencyCleanupRegistry& emergency_cleanup_registry,
-        BypassOption bypass_option);
+        BypassOption bypass_option,
+        AtomicKMSOption atomic_option);
 
     /* From Platform */
     UniqueModulePtr<graphics::Display> create_display(
@@ -74,7 +75,8 @@ private:
         std::tuple<std::unique_ptr<Device>, mir::Fd> drm,
         std::shared_ptr<DisplayReport> const& reporter,
         EmergencyCleanupRegistry& emergency_cleanup_registry,
-        BypassOption bypass_option);
+        BypassOption bypass_option,
+        AtomicKMSOption atomic_option);
     
     std::unique_ptr<Device> const device_handle;
     mir::Fd const drm_fd;
@@ -82,6 +84,7 @@ private:
     std::shared_ptr<GBMDisplayProvider> gbm_display_provider;
 
     BypassOption const bypass_option_;
+    AtomicKMSOption const atomic_option;
 };
 
 class RenderingPlatform : public graphics::RenderingPlatform
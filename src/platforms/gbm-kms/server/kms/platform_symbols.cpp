@@ -49,6 +49,7 @@ namespace mo = mir::options;
 namespace
 {
 char const* bypass_option_name{"bypass"};
+char const* atomic_kms_option_name{"kms-atomic"};
 
 }
 
@@ -71,8 +72,12 @@ mir::UniqueModulePtr<mg::DisplayPlatform> create_display_platform(
     if (!options->get<bool>(bypass_option_name))
         bypass_option = mgg::BypassOption::prohibited;
 
+    auto atomic_option = mgg::AtomicKMSOption::prohibited;
+    if (options->get<bool>(atomic_kms_option_name))
+        atomic_option = mgg::AtomicKMSOption::allowed;
+
     return mir::make_module_ptr<mgg::Platform>(
-        *device.device, report, *console, *emergency_cleanup_registry, bypass_option);
+        *device.device, report, *console, *emergency_cleanup_registry, bypass_option, atomic_option);
 }
 
 auto create_rendering_platform(
@@ -92,7 +97,10 @@ void add_graphics_platform_options(boost::program_options::options_description&
     config.add_options()
         (bypass_option_name,
          boost::program_options::value<bool>()->default_value(false),
-         "[platform-specific] utilize the bypass optimization for fullscreen surfaces.");
+         "[platform-specific] scan out client buffers directly, for fullscreen surfaces and on overlay planes.")
+        (atomic_kms_option_name,
+         boost::program_options::value<bool>()->default_value(false),
+         "[platform-specific] use atomic KMS, where the driver supports it, to update each output in a single non-blocking commit.");
     mgg::Quirks::add_quirks_option(config);
 }
 
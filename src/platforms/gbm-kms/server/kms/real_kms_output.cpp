@@ -256,6 +256,31 @@ void mgg::RealKMSOutput::wait_for_page_flip()
     page_flipper->wait_for_flip(current_crtc->crtc_id);
 }
 
+void mgg::RealKMSOutput::commit_staged_changes()
+{
+    // Legacy KMS changes the cursor and CRTC properties immediately
+}
+
+auto mgg::RealKMSOutput::overlay_planes() -> std::vector<OverlayPlane>
+{
+    // drmModeSetPlane() takes effect immediately, so overlays would tear and lag the primary plane
+    return {};
+}
+
+bool mgg::RealKMSOutput::set_plane(
+    uint32_t /*plane_id*/,
+    FBHandle const& /*fb*/,
+    geom::Rectangle const& /*destination*/,
+    geom::RectangleF const& /*source*/)
+{
+    return false;
+}
+
+bool mgg::RealKMSOutput::clear_plane(uint32_t /*plane_id*/)
+{
+    return false;
+}
+
 bool mgg::RealKMSOutput::set_cursor(gbm_bo* buffer)
 {
     int result = 0;
@@ -389,6 +414,72 @@ void mgg::RealKMSOutput::set_gamma(mg::GammaCurves const& gamma)
     // TODO: return bool in future? Then do what with it?
 }
 
+void mgg::RealKMSOutput::set_variable_refresh(bool enabled)
+{
+    if (!enabled && !variable_refresh_crtc)
+        return;
+
+    if (!ensure_crtc())
+    {
+        mir::log_warning("Output %s has no associated CRTC to set variable refresh on",
+                         mgk::connector_name(connector).c_str());
+        return;
+    }
+
+    auto const crtc_id = current_crtc->crtc_id;
+    if (enabled == (variable_refresh_crtc == crtc_id))
+        return;
+
+    try
+    {
+        mgk::ObjectProperties connector_props{drm_fd_, connector->connector_id, DRM_MODE_OBJECT_CONNECTOR};
+        if (enabled && !(connector_props.has_property("vrr_capable") && connector_props["vrr_capable"]))
+        {
+            mir::log_info("Output %s does not support variable refresh", mgk::connector_name(connector).c_str());
+            return;
+        }
+
+        mgk::ObjectProperties crtc_props{drm_fd_, crtc_id, DRM_MODE_OBJECT_CRTC};
+        if (!crtc_props.has_property("VRR_ENABLED"))
+        {
+            mir::log_info("Driver does not support variable refresh on output %s",
+                          mgk::connector_name(connector).c_str());
+            return;
+        }
+
+        if (auto const ret = set_crtc_property(crtc_props.id_for("VRR_ENABLED"), enabled))
+        {
+            mir::log_warning("Failed to %s variable refresh on output %s: %s",
+                             enabled ? "enable" : "disable",
+                             mgk::connector_name(connector).c_str(),
+                             strerror(-ret));
+            return;
+        }
+
+        variable_refresh_crtc = enabled ? crtc_id : 0;
+    }
+    catch (std::exception const& error)
+    {
+        mir::log_warning("Failed to set variable refresh on output %s: %s",
+                         mgk::connector_name(connector).c_str(), error.what());
+    }
+}
+
+bool mgg::RealKMSOutput::has_variable_refresh() const
+{
+    return current_crtc && variable_refresh_crtc == current_crtc->crtc_id;
+}
+
+auto mgg::RealKMSOutput::set_crtc_property(uint32_t property_id, uint64_t value) -> int
+{
+    if (!current_crtc)
+    {
+        return -ENODEV;
+    }
+
+    return drmModeObjectSetProperty(drm_fd_, current_crtc->crtc_id, DRM_MODE_OBJECT_CRTC, property_id, value);
+}
+
 void mgg::RealKMSOutput::refresh_hardware_state()
 {
     connector = kms::get_connector(drm_fd_, connector->connector_id);
@@ -449,6 +540,20 @@ MirSubpixelArrangement kms_subpixel_to_mir_subpixel(uint32_t subpixel)
     }
 }
 
+bool connector_is_vrr_capable(int drm_fd, uint32_t connector_id)
+{
+    try
+    {
+        mgk::ObjectProperties connector_props{drm_fd, connector_id, DRM_MODE_OBJECT_CONNECTOR};
+        return connector_props.has_property("vrr_capable") && connector_props["vrr_capable"];
+    }
+    catch (std::exception const& error)
+    {
+        mir::log_debug("Couldn't read vrr_capable for connector %u: %s", connector_id, error.what());
+        return false;
+    }
+}
+
 std::vector<uint8_t> edid_for_connector(int drm_fd, uint32_t connector_id)
 {
     std::vector<uint8_t> edid;
@@ -539,11 +644,13 @@ void mgg::RealKMSOutput::update_from_hardware_state(
                                         mir_pixel_format_xrgb_8888};
 
     std::vector<uint8_t> edid;
+    bool vrr_capable{false};
     if (connected) {
         /* Only ask for the EDID on connected outputs. There's obviously no monitor EDID
          * when there is no monitor connected!
          */
         edid = edid_for_connector(drm_fd_, connector->connector_id);
+        vrr_capable = connector_is_vrr_capable(drm_fd_, connector->connector_id);
     }
 
     drmModeModeInfo current_mode_info = drmModeModeInfo();
@@ -600,6 +707,7 @@ void mgg::RealKMSOutput::update_from_hardware_state(
     output.subpixel_arrangement = kms_subpixel_to_mir_subpixel(connector->subpixel);
     output.gamma = gamma;
     output.edid = edid;
+    output.vrr_capable = vrr_capable;
 }
 
 int mgg::RealKMSOutput::drm_fd() const
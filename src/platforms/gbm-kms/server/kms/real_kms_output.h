@@ -53,6 +53,15 @@ public:
     void clear_crtc() override;
     bool schedule_page_flip(FBHandle const& fb) override;
     void wait_for_page_flip() override;
+    void commit_staged_changes() override;
+
+    auto overlay_planes() -> std::vector<OverlayPlane> override;
+    bool set_plane(
+        uint32_t plane_id,
+        FBHandle const& fb,
+        geometry::Rectangle const& destination,
+        geometry::RectangleF const& source) override;
+    bool clear_plane(uint32_t plane_id) override;
 
     bool set_cursor(gbm_bo* buffer) override;
     void move_cursor(geometry::Point destination) override;
@@ -62,14 +71,19 @@ public:
     void set_power_mode(MirPowerMode mode) override;
     void set_gamma(GammaCurves const& gamma) override;
 
+    void set_variable_refresh(bool enabled) override;
+    bool has_variable_refresh() const override;
+
     void refresh_hardware_state() override;
     void update_from_hardware_state(DisplayConfigurationOutput& output) const override;
 
     int drm_fd() const override;
 
-private:
+protected:
     bool ensure_crtc();
     void restore_saved_crtc();
+    /// Set a property of the current CRTC. Returns 0 on success, or a negative errno
+    virtual auto set_crtc_property(uint32_t property_id, uint64_t value) -> int;
 
     int const drm_fd_;
     std::shared_ptr<PageFlipper> const page_flipper;
@@ -82,6 +96,8 @@ private:
     bool using_saved_crtc;
     bool has_cursor_;
 
+    uint32_t variable_refresh_crtc{0};  ///< The CRTC we set VRR_ENABLED on, if any
+
     MirPowerMode power_mode;
     int dpms_enum_id;
 
@@ -17,15 +17,18 @@
 #include <algorithm>
 #include "real_kms_output_container.h"
 #include "real_kms_output.h"
+#include "atomic_kms_output.h"
 #include "kms-utils/drm_mode_resources.h"
 
 namespace mgg = mir::graphics::gbm;
 
 mgg::RealKMSOutputContainer::RealKMSOutputContainer(
     mir::Fd drm_fd,
-    std::shared_ptr<PageFlipper> page_flipper)
+    std::shared_ptr<PageFlipper> page_flipper,
+    bool atomic_kms)
     : drm_fd{std::move(drm_fd)},
-      page_flipper{std::move(page_flipper)}
+      page_flipper{std::move(page_flipper)},
+      atomic_kms{atomic_kms}
 {
 }
 
@@ -64,6 +67,13 @@ void mgg::RealKMSOutputContainer::update_from_hardware_state()
             new_outputs.push_back(*existing_output);
             new_outputs.back()->refresh_hardware_state();
         }
+        else if (atomic_kms)
+        {
+            new_outputs.push_back(std::make_shared<AtomicKMSOutput>(
+                drm_fd,
+                std::move(connector),
+                page_flipper));
+        }
         else
         {
             new_outputs.push_back(std::make_shared<RealKMSOutput>(
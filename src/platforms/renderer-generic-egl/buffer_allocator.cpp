@@ -315,11 +315,15 @@ std::shared_ptr<mg::Buffer> mge::BufferAllocator::buffer_from_resource(
 
 auto mge::BufferAllocator::buffer_from_shm(
     std::shared_ptr<renderer::software::RWMappableBuffer> data,
+    std::shared_ptr<Buffer> const& previous,
+    geometry::Rectangle const& damage,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release) -> std::shared_ptr<Buffer>
 {
     return std::make_shared<mgc::NotifyingMappableBackedShmBuffer>(
         std::move(data),
+        previous,
+        damage,
         egl_delegate,
         std::move(on_consumed),
         std::move(on_release));
@@ -379,6 +383,12 @@ public:
         return fb->size();
     }
 
+    auto buffer_age() const -> int override
+    {
+        // We don't know anything about the lifetime of the host's buffers
+        return 0;
+    }
+
     auto layout() const -> Layout override
     {
         return Layout::GL;
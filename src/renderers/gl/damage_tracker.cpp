@@ -0,0 +1,180 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "damage_tracker.h"
+#include "mir/graphics/buffer.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace mg = mir::graphics;
+namespace mrg = mir::renderer::gl;
+namespace geom = mir::geometry;
+
+namespace
+{
+auto is_empty(geom::Rectangle const& rect) -> bool
+{
+    return rect.size.width.as_int() <= 0 || rect.size.height.as_int() <= 0;
+}
+
+/// The bounding rectangle of a and b, ignoring either if it is empty
+auto bounding_union(geom::Rectangle const& a, geom::Rectangle const& b) -> geom::Rectangle
+{
+    if (is_empty(a))
+        return b;
+    if (is_empty(b))
+        return a;
+
+    geom::Point const top_left{std::min(a.left(), b.left()), std::min(a.top(), b.top())};
+    geom::Point const bottom_right{std::max(a.right(), b.right()), std::max(a.bottom(), b.bottom())};
+    return {top_left, as_size(bottom_right - top_left)};
+}
+}
+
+auto mrg::area_affected_by(mg::Renderable const& renderable, geom::Rectangle const& viewport) -> geom::Rectangle
+{
+    if (renderable.transformation() != glm::mat4{1})
+    {
+        // We don't try to work out where an arbitrarily transformed renderable ends up
+        return viewport;
+    }
+
+    auto area = intersection_of(renderable.screen_position(), viewport);
+    if (auto const clip = renderable.clip_area())
+    {
+        area = intersection_of(area, *clip);
+    }
+    return area;
+}
+
+auto mrg::DamageTracker::RenderableState::same_appearance_as(RenderableState const& other) const -> bool
+{
+    return buffer == other.buffer &&
+           position == other.position &&
+           clip_area == other.clip_area &&
+           alpha == other.alpha &&
+           transformation == other.transformation &&
+           shaped == other.shaped;
+}
+
+auto mrg::DamageTracker::add_frame(mg::RenderableList const& renderables, geom::Rectangle const& viewport)
+    -> geom::Rectangle
+{
+    std::vector<RenderableState> current_frame;
+    current_frame.reserve(renderables.size());
+    for (auto const& renderable : renderables)
+    {
+        auto const buffer = renderable->buffer();
+        current_frame.push_back(RenderableState{
+            renderable->id(),
+            buffer ? buffer->id() : mg::BufferID{},
+            renderable->screen_position(),
+            renderable->clip_area(),
+            renderable->alpha(),
+            renderable->transformation(),
+            renderable->shaped(),
+            area_affected_by(*renderable, viewport)});
+    }
+
+    geom::Rectangle damage;
+    if (previous_viewport != viewport)
+    {
+        damage = viewport;
+    }
+    else
+    {
+        std::unordered_map<mg::Renderable::ID, size_t> previous_index;
+        for (size_t i = 0; i != previous_frame.size(); ++i)
+        {
+            previous_index.emplace(previous_frame[i].id, i);
+        }
+
+        std::vector<bool> still_present(previous_frame.size(), false);
+        std::optional<size_t> last_matched;
+        bool restacked{false};
+
+        for (auto const& state : current_frame)
+        {
+            auto const match = previous_index.find(state.id);
+            if (match == previous_index.end())
+            {
+                damage = bounding_union(damage, state.extent);
+                continue;
+            }
+
+            auto const& previous = previous_frame[match->second];
+            still_present[match->second] = true;
+            if (last_matched && match->second < *last_matched)
+            {
+                restacked = true;
+            }
+            last_matched = match->second;
+
+            if (!state.same_appearance_as(previous))
+            {
+                damage = bounding_union(damage, bounding_union(previous.extent, state.extent));
+            }
+        }
+
+        for (size_t i = 0; i != previous_frame.size(); ++i)
+        {
+            if (!still_present[i])
+            {
+                damage = bounding_union(damage, previous_frame[i].extent);
+            }
+        }
+
+        if (restacked)
+        {
+            // Working out exactly what a change in stacking order exposes isn't worth it
+            damage = viewport;
+        }
+    }
+
+    previous_frame = std::move(current_frame);
+    previous_viewport = viewport;
+
+    history.push_front(damage);
+    if (history.size() > static_cast<size_t>(max_buffer_age))
+    {
+        history.pop_back();
+    }
+
+    return damage;
+}
+
+auto mrg::DamageTracker::damage_for_buffer_age(int age) const -> std::optional<geom::Rectangle>
+{
+    if (age <= 0 || static_cast<size_t>(age) > history.size())
+    {
+        return std::nullopt;
+    }
+
+    geom::Rectangle damage;
+    for (auto frame = history.begin(); frame != history.begin() + age; ++frame)
+    {
+        damage = bounding_union(damage, *frame);
+    }
+    return damage;
+}
+
+void mrg::DamageTracker::reset()
+{
+    previous_frame.clear();
+    previous_viewport = std::nullopt;
+    history.clear();
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_GL_DAMAGE_TRACKER_H_
+#define MIR_RENDERER_GL_DAMAGE_TRACKER_H_
+
+#include <mir/geometry/rectangle.h>
+#include <mir/graphics/buffer_id.h>
+#include <mir/graphics/renderable.h>
+
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace mir
+{
+namespace renderer
+{
+namespace gl
+{
+/**
+ * Works out which area of an output changes from one frame to the next
+ *
+ * A renderer drawing into a buffer that still holds an earlier frame (see EGL_EXT_buffer_age)
+ * only needs to repaint the union of the damage of the frames since.
+ */
+class DamageTracker
+{
+public:
+    /// Number of frames of history kept; older buffers are always repainted in full
+    static int constexpr max_buffer_age = 4;
+
+    /**
+     * Record the renderables making up the next frame of \a viewport
+     *
+     * \returns the area of the viewport that differs from the previous frame
+     */
+    auto add_frame(graphics::RenderableList const& renderables, geometry::Rectangle const& viewport)
+        -> geometry::Rectangle;
+
+    /**
+     * The area to repaint to bring a buffer holding the frame from \a age frames ago up to date
+     * with the most recently added frame
+     *
+     * \returns std::nullopt if the whole viewport needs repainting
+     */
+    auto damage_for_buffer_age(int age) const -> std::optional<geometry::Rectangle>;
+
+    /// Forget all history, so the next frame added is treated as entirely new
+    void reset();
+
+private:
+    struct RenderableState
+    {
+        graphics::Renderable::ID id;
+        graphics::BufferID buffer;
+        geometry::Rectangle position;
+        std::optional<geometry::Rectangle> clip_area;
+        float alpha;
+        glm::mat4 transformation;
+        bool shaped;
+        geometry::Rectangle extent;
+
+        auto same_appearance_as(RenderableState const& other) const -> bool;
+    };
+
+    std::vector<RenderableState> previous_frame;
+    std::optional<geometry::Rectangle> previous_viewport;
+    std::deque<geometry::Rectangle> history;  ///< Frame-to-frame damage, most recent first
+};
+
+/// The area of \a viewport that drawing \a renderable can affect
+auto area_affected_by(graphics::Renderable const& renderable, geometry::Rectangle const& viewport)
+    -> geometry::Rectangle;
+}
+}
+}
+
+#endif // MIR_RENDERER_GL_DAMAGE_TRACKER_H_
@@ -38,8 +38,11 @@
 #include <boost/throw_exception.hpp>
 #include <stdexcept>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <sstream>
 #include <mutex>
+#include <limits>
 
 namespace mg = mir::graphics;
 namespace mgl = mir::gl;
@@ -252,6 +255,251 @@ private:
     std::mutex compilation_mutex;
 };
 
+class mrg::Renderer::VertexBuffers
+{
+public:
+    // NOTE: This must be called with a current GL context
+    VertexBuffers()
+    {
+        glGenBuffers(ids.size(), ids.data());
+    }
+
+    ~VertexBuffers()
+    {
+        glDeleteBuffers(ids.size(), ids.data());
+    }
+
+    VertexBuffers(VertexBuffers const&) = delete;
+    VertexBuffers& operator=(VertexBuffers const&) = delete;
+
+    /**
+     * Move on to the next buffer, making sure it holds \a vertices
+     *
+     * Buffers are used in turn so we don't overwrite one the GPU may still be reading from an
+     * earlier frame. When the geometry hasn't changed since a buffer was last used there's
+     * nothing to upload.
+     */
+    void upload(std::vector<mgl::Vertex> const& vertices)
+    {
+        current = (current + 1) % ids.size();
+        bind();
+
+        auto& held = contents[current];
+        if (vertices.empty() ||
+            (held.size() == vertices.size() &&
+             std::memcmp(held.data(), vertices.data(), vertices.size() * sizeof(mgl::Vertex)) == 0))
+        {
+            return;
+        }
+
+        glBufferData(
+            GL_ARRAY_BUFFER,
+            vertices.size() * sizeof(mgl::Vertex),
+            vertices.data(),
+            GL_DYNAMIC_DRAW);
+        held = vertices;
+    }
+
+    /// Bind the buffer most recently uploaded to
+    void bind() const
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, ids[current]);
+    }
+
+private:
+    std::array<GLuint, 3> ids{};
+    std::array<std::vector<mgl::Vertex>, 3> contents;
+    size_t current{0};
+};
+
+namespace
+{
+void delete_texture(GLuint id)
+{
+    glDeleteTextures(1, &id);
+}
+
+void delete_framebuffer(GLuint id)
+{
+    glDeleteFramebuffers(1, &id);
+}
+
+using TextureHandle = GLHandle<&delete_texture>;
+using FramebufferHandle = GLHandle<&delete_framebuffer>;
+
+auto gen_texture() -> GLuint
+{
+    GLuint id;
+    glGenTextures(1, &id);
+    return id;
+}
+
+auto gen_framebuffer() -> GLuint
+{
+    GLuint id;
+    glGenFramebuffers(1, &id);
+    return id;
+}
+
+/// A texture of the size a larger buffer is drawn at, and a framebuffer to draw the buffer into it with
+class ScaledTexture : public mg::gl::Texture
+{
+public:
+    // NOTE: This must be called with a current GL context
+    explicit ScaledTexture(geom::Size size)
+        : size{size},
+          texture{gen_texture()},
+          framebuffer{gen_framebuffer()}
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(
+            GL_TEXTURE_2D, 0, GL_RGBA,
+            size.width.as_int(), size.height.as_int(),
+            0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        GLint previous_framebuffer{0};
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        auto const status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer));
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(
+                "Framebuffer for scaled texture incomplete: " + std::to_string(status)));
+        }
+    }
+
+    auto shader(mg::gl::ProgramFactory& factory) const -> mg::gl::Program const& override
+    {
+        static int rgba_shader{0};
+        return factory.compile_fragment_shader(
+            &rgba_shader,
+            "",
+            "uniform sampler2D tex;\n"
+            "vec4 sample_to_rgba(in vec2 texcoord)\n"
+            "{\n"
+            "    return texture2D(tex, texcoord);\n"
+            "}\n");
+    }
+
+    auto layout() const -> Layout override
+    {
+        return Layout::GL;
+    }
+
+    void bind() override
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+
+    void add_syncpoint() override
+    {
+    }
+
+    geom::Size const size;
+    TextureHandle const texture;
+    FramebufferHandle const framebuffer;
+};
+}
+
+/**
+ * Copies of buffers that are drawn much smaller than they are, at the size they're drawn on this output
+ *
+ * Scaled XWayland windows, for example, have buffers larger than they appear. Rather than sample all of such a
+ * buffer every frame, once it has been drawn unchanged in a second frame it is drawn into a texture of the size it
+ * appears, and that is used until the renderable's buffer changes. A buffer only drawn once isn't copied, so clients
+ * that submit a buffer every frame cost no more than before.
+ */
+class mrg::Renderer::ScaledTextures
+{
+public:
+    /**
+     * Note that \a renderable is drawn \a size pixels big this frame
+     *
+     * \return the copy to draw its buffer into, or nullptr if there's nothing to do
+     */
+    auto needs_copy(
+        mg::Renderable const& renderable,
+        std::shared_ptr<mg::Buffer> const& buffer,
+        geom::Size size,
+        long long frame) -> ScaledTexture*
+    {
+        auto& entry = entries[renderable.id()];
+        entry.last_frame = frame;
+
+        if (entry.buffer.lock() != buffer)
+        {
+            entry.buffer = buffer;
+            entry.current = false;
+            return nullptr;
+        }
+
+        if (entry.current && entry.copy->size == size)
+        {
+            return nullptr;
+        }
+
+        if (!entry.copy || entry.copy->size != size)
+        {
+            try
+            {
+                entry.copy = std::make_shared<ScaledTexture>(size);
+            }
+            catch (std::exception const& error)
+            {
+                mir::log_warning("Not drawing scaled copies of buffers: %s", error.what());
+                usable = false;
+                entries.clear();
+                return nullptr;
+            }
+        }
+
+        entry.current = true;
+        return entry.copy.get();
+    }
+
+    /// The up to date copy of \a renderable's buffer, if there is one
+    auto copy_for(mg::Renderable const& renderable) const -> std::shared_ptr<mg::gl::Texture>
+    {
+        if (auto const entry = entries.find(renderable.id());
+            entry != entries.end() && entry->second.current && entry->second.buffer.lock() == renderable.buffer())
+        {
+            return entry->second.copy;
+        }
+        return nullptr;
+    }
+
+    void discard(mg::Renderable const& renderable)
+    {
+        entries.erase(renderable.id());
+    }
+
+    /// Drop copies for renderables that weren't drawn in \a frame
+    void end_frame(long long frame)
+    {
+        std::erase_if(entries, [frame](auto const& entry) { return entry.second.last_frame != frame; });
+    }
+
+    /// False if GL can't draw into the copies
+    bool usable{true};
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<mg::Buffer> buffer;       ///< The buffer the renderable was last drawn with
+        std::shared_ptr<ScaledTexture> copy;    ///< Kept across buffers so its storage can be reused
+        bool current{false};                    ///< Whether copy holds buffer
+        long long last_frame{0};
+    };
+
+    std::unordered_map<mg::Renderable::ID, Entry> entries;
+};
+
 mrg::Renderer::Program::Program(GLuint program_id)
 {
     id = program_id;
@@ -284,11 +532,22 @@ auto make_output_current(std::unique_ptr<mg::gl::OutputSurface> output) -> std::
 mrg::Renderer::Renderer(
     std::shared_ptr<graphics::GLRenderingProvider> gl_interface,
     std::unique_ptr<graphics::gl::OutputSurface> output)
+    : Renderer(std::move(gl_interface), std::move(output), false)
+{
+}
+
+mrg::Renderer::Renderer(
+    std::shared_ptr<graphics::GLRenderingProvider> gl_interface,
+    std::unique_ptr<graphics::gl::OutputSurface> output,
+    bool repaint_damage_only)
     : output_surface{make_output_current(std::move(output))},
       clear_color{0.0f, 0.0f, 0.0f, 1.0f},
       program_factory{std::make_unique<ProgramFactory>()},
+      vertex_buffers{std::make_unique<VertexBuffers>()},
+      scaled_textures{std::make_unique<ScaledTextures>()},
       display_transform(1),
-      gl_interface{std::move(gl_interface)}
+      gl_interface{std::move(gl_interface)},
+      repaint_damage_only{repaint_damage_only}
 {
     eglBindAPI(EGL_OPENGL_ES_API);
     EGLDisplay disp = eglGetCurrentDisplay();
@@ -354,16 +613,51 @@ void mrg::Renderer::tessellate(std::vector<mgl::Primitive>& primitives,
 auto mrg::Renderer::render(mg::RenderableList const& renderables) const -> std::unique_ptr<mg::Framebuffer>
 {
     output_surface->make_current();
+    update_scaled_textures(renderables);
     output_surface->bind();
 
+    repaint_area = std::nullopt;
+    if (repaint_damage_only)
+    {
+        damage_tracker.add_frame(renderables, viewport);
+
+        // Without knowing where the viewport lands in the window we can't limit drawing to part of it
+        if (gl_viewport)
+        {
+            repaint_area = damage_tracker.damage_for_buffer_age(output_surface->buffer_age());
+        }
+    }
+
+    if (repaint_area)
+    {
+        glEnable(GL_SCISSOR_TEST);
+        set_scissor(window_area_for(*repaint_area));
+    }
+
     glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     glClear(GL_COLOR_BUFFER_BIT);
 
     ++frameno;
-    for (auto const& r : renderables)
+    prepare_geometry(renderables);
+
+    forget_gl_state();
+    for (auto const& geometry : frame_geometry)
     {
-        draw(*r);
+        draw(*geometry.renderable);
+    }
+
+    if (current_program)
+    {
+        glDisableVertexAttribArray(current_program->texcoord_attr);
+        glDisableVertexAttribArray(current_program->position_attr);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    forget_gl_state();
+
+    if (repaint_area)
+    {
+        glDisable(GL_SCISSOR_TEST);
     }
 
     auto output = output_surface->commit();
@@ -381,19 +675,25 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
     if (clip_area)
     {
         glEnable(GL_SCISSOR_TEST);
-        glScissor(
-            clip_area.value().top_left.x.as_int() -
-                viewport.top_left.x.as_int(),
-            viewport.top_left.y.as_int() +
-                viewport.size.height.as_int() -
-                clip_area.value().top_left.y.as_int() -
-                clip_area.value().size.height.as_int(),
-            clip_area.value().size.width.as_int(), 
-            clip_area.value().size.height.as_int()
-        );
+        geom::Rectangle const clip_scissor{
+            {
+                clip_area.value().top_left.x.as_int() -
+                    viewport.top_left.x.as_int(),
+                viewport.top_left.y.as_int() +
+                    viewport.size.height.as_int() -
+                    clip_area.value().top_left.y.as_int() -
+                    clip_area.value().size.height.as_int()
+            },
+            clip_area.value().size
+        };
+        set_scissor(repaint_area ? intersection_of(clip_scissor, window_area_for(*repaint_area)) : clip_scissor);
     }
 
-    auto const texture = gl_interface->as_texture(renderable.buffer());
+    auto texture = scaled_textures->copy_for(renderable);
+    if (!texture)
+    {
+        texture = gl_interface->as_texture(renderable.buffer());
+    }
 
     // All the programs are held by program_factory through its lifetime. Using pointers avoids
     // -Wdangling-reference.
@@ -408,7 +708,33 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
                 return &family.opaque;
         }(renderable.alpha() < 1.0f);
 
-    glUseProgram(prog->id);
+    // Geometry is normally tessellated up front, for everything render() draws...
+    PrimitiveRange const* first_primitive{nullptr};
+    size_t primitive_count{0};
+    std::vector<mgl::Vertex> client_vertices;
+    std::vector<PrimitiveRange> client_primitives;
+    if (next_geometry < frame_geometry.size() && frame_geometry[next_geometry].renderable == &renderable)
+    {
+        auto const& geometry = frame_geometry[next_geometry++];
+        first_primitive = frame_primitives.data() + geometry.first_primitive;
+        primitive_count = geometry.primitive_count;
+        use_program(*prog);
+    }
+    else
+    {
+        // ...but anything else is drawn straight from client memory
+        primitives.clear();
+        tessellate(primitives, renderable);
+        for (auto const& p : primitives)
+        {
+            client_primitives.push_back({p.type, static_cast<GLint>(client_vertices.size()), p.nvertices});
+            client_vertices.insert(client_vertices.end(), p.vertices, p.vertices + p.nvertices);
+        }
+        first_primitive = client_primitives.data();
+        primitive_count = client_primitives.size();
+        use_program(*prog, client_vertices.data());
+    }
+
     if (prog->last_used_frameno != frameno)
     {   // Avoid reloading the screen-global uniforms on every renderable
         // TODO: We actually only need to bind these *once*, right? Not once per frame?
@@ -454,21 +780,12 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
     if (prog->alpha_uniform >= 0)
         glUniform1f(prog->alpha_uniform, renderable.alpha());
 
-    glEnableVertexAttribArray(prog->position_attr);
-    glEnableVertexAttribArray(prog->texcoord_attr);
-
-    primitives.clear();
-    tessellate(primitives, renderable);
+    auto const split = opaque_split_for(renderable);
 
     // if we fail to load the texture, we need to carry on (part of lp:1629275)
     try
     {
-        typedef struct  // Represents parameters of glBlendFuncSeparate()
-        {
-            GLenum src_rgb, dst_rgb, src_alpha, dst_alpha;
-        } BlendSeparate;
-
-        BlendSeparate client_blend;
+        BlendFunc client_blend;
 
         // These renderable method names could be better (see LP: #1236224)
         if (renderable.shaped())  // Client is RGBA:
@@ -490,33 +807,26 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
             glBlendColor(0.0f, 0.0f, 0.0f, renderable.alpha());
         }
 
-        for (auto const& p : primitives)
+        for (auto p = first_primitive; p != first_primitive + primitive_count; ++p)
         {
-            BlendSeparate blend;
-
-            blend = client_blend;
             texture->bind();
 
-            glVertexAttribPointer(prog->position_attr, 3, GL_FLOAT,
-                                  GL_FALSE, sizeof(mgl::Vertex),
-                                  &p.vertices[0].position);
-            glVertexAttribPointer(prog->texcoord_attr, 2, GL_FLOAT,
-                                  GL_FALSE, sizeof(mgl::Vertex),
-                                  &p.vertices[0].texcoord);
-
-            if (blend.dst_rgb == GL_ZERO)
+            if (!split.empty())
             {
-                glDisable(GL_BLEND);
+                glEnable(GL_SCISSOR_TEST);
+                for (auto const& part : split)
+                {
+                    set_scissor(part.window_area);
+                    set_blend(part.blend ? std::optional{client_blend} : std::nullopt);
+                    glDrawArrays(p->type, p->first, p->count);
+                }
             }
             else
             {
-                glEnable(GL_BLEND);
-                glBlendFuncSeparate(blend.src_rgb,   blend.dst_rgb,
-                                    blend.src_alpha, blend.dst_alpha);
+                set_blend(client_blend.dst_rgb == GL_ZERO ? std::nullopt : std::optional{client_blend});
+                glDrawArrays(p->type, p->first, p->count);
             }
 
-            glDrawArrays(p.type, 0, p.nvertices);
-
             // We're done with the texture for now
             texture->add_syncpoint();
         }
@@ -526,14 +836,366 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
         report_exception();
     }
 
-    glDisableVertexAttribArray(prog->texcoord_attr);
-    glDisableVertexAttribArray(prog->position_attr);
-    if (renderable.clip_area())
+    if (!client_vertices.empty())
     {
-        glDisable(GL_SCISSOR_TEST);
+        // Don't leave the vertex attributes pointing at memory we're about to free
+        use_program(*prog);
+    }
+
+    if (clip_area || !split.empty())
+    {
+        if (repaint_area)
+        {
+            set_scissor(window_area_for(*repaint_area));
+        }
+        else
+        {
+            glDisable(GL_SCISSOR_TEST);
+        }
     }
 }
 
+void mrg::Renderer::update_scaled_textures(mg::RenderableList const& renderables) const
+{
+    if (!gl_viewport || !scaled_textures->usable)
+    {
+        return;
+    }
+
+    // The display transform may turn the window sideways
+    bool const sideways = std::abs(display_transform[0][0]) < 0.5f;
+    // Copies are drawn to their own framebuffer and viewport, so note the output's to put back afterwards
+    struct SavedState
+    {
+        GLint framebuffer;
+        std::array<GLint, 4> viewport;
+    };
+    std::optional<SavedState> saved_state;
+
+    for (auto const& renderable : renderables)
+    {
+        auto const buffer = renderable->buffer();
+        if (!buffer || renderable->transformation() != glm::mat4{1})
+        {
+            continue;
+        }
+
+        auto const window_size = window_area_for(renderable->screen_position()).size;
+        geom::Size const drawn_size = sideways ?
+            geom::Size{window_size.height.as_int(), window_size.width.as_int()} :
+            window_size;
+        auto const buffer_size = buffer->size();
+
+        // A copy needs to save a fair amount of sampling to be worth making
+        if (drawn_size.width.as_int() <= 0 || drawn_size.height.as_int() <= 0 ||
+            drawn_size.width.as_int() * 4 > buffer_size.width.as_int() * 3 ||
+            drawn_size.height.as_int() * 4 > buffer_size.height.as_int() * 3)
+        {
+            continue;
+        }
+
+        auto const copy = scaled_textures->needs_copy(*renderable, buffer, drawn_size, frameno);
+        if (!copy)
+        {
+            continue;
+        }
+
+        if (!saved_state)
+        {
+            saved_state.emplace();
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &saved_state->framebuffer);
+            glGetIntegerv(GL_VIEWPORT, saved_state->viewport.data());
+            glDisable(GL_SCISSOR_TEST);
+            glDisable(GL_BLEND);
+        }
+
+        try
+        {
+            draw_scaled_copy(*gl_interface->as_texture(buffer), copy->framebuffer, copy->size);
+        }
+        catch (std::exception const&)
+        {
+            scaled_textures->discard(*renderable);
+            report_exception();
+        }
+    }
+
+    scaled_textures->end_frame(frameno);
+
+    if (saved_state)
+    {
+        auto const& [framebuffer, viewport] = *saved_state;
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        // The copies changed the program and blending behind draw()'s back
+        forget_gl_state();
+    }
+}
+
+void mrg::Renderer::draw_scaled_copy(mg::gl::Texture& source, GLuint framebuffer, geom::Size size) const
+{
+    auto const& prog = static_cast<::Program const&>(source.shader(*program_factory)).opaque;
+    auto const width = static_cast<GLfloat>(size.width.as_int());
+    auto const height = static_cast<GLfloat>(size.height.as_int());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, size.width.as_int(), size.height.as_int());
+    glUseProgram(prog.id);
+
+    for (auto i = 0u; i < prog.tex_uniforms.size(); ++i)
+    {
+        if (prog.tex_uniforms[i] != -1)
+        {
+            glUniform1i(prog.tex_uniforms[i], i);
+        }
+    }
+
+    // The top row of the buffer goes in the first row of the copy, as the GL layout expects
+    auto const buffer_to_gl_coords = glm::scale(
+        glm::translate(glm::mat4{1.0f}, glm::vec3{-1.0f, -1.0f, 0.0f}),
+        glm::vec3{2.0f / width, 2.0f / height, 1.0f});
+    glm::mat4 const identity{1.0f};
+    glm::mat4 transform{1.0f};
+    if (source.layout() == mg::gl::Texture::Layout::TopRowFirst)
+    {
+        transform = glm::mat4{
+            1.0, 0.0, 0.0, 0.0,
+            0.0, -1.0, 0.0, 0.0,
+            0.0, 0.0, 1.0, 0.0,
+            0.0, 0.0, 0.0, 1.0
+        };
+    }
+    glUniformMatrix4fv(prog.screen_to_gl_coords_uniform, 1, GL_FALSE, glm::value_ptr(buffer_to_gl_coords));
+    glUniformMatrix4fv(prog.display_transform_uniform, 1, GL_FALSE, glm::value_ptr(identity));
+    glUniformMatrix4fv(prog.transform_uniform, 1, GL_FALSE, glm::value_ptr(transform));
+    glUniform2f(prog.centre_uniform, width / 2.0f, height / 2.0f);
+
+    mgl::Vertex const vertices[]{
+        {{0.0f,  0.0f,   0.0f}, {0.0f, 0.0f}},
+        {{0.0f,  height, 0.0f}, {0.0f, 1.0f}},
+        {{width, 0.0f,   0.0f}, {1.0f, 0.0f}},
+        {{width, height, 0.0f}, {1.0f, 1.0f}},
+    };
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glEnableVertexAttribArray(prog.position_attr);
+    glEnableVertexAttribArray(prog.texcoord_attr);
+    glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT, GL_FALSE, sizeof(mgl::Vertex), vertices[0].position);
+    glVertexAttribPointer(prog.texcoord_attr, 2, GL_FLOAT, GL_FALSE, sizeof(mgl::Vertex), vertices[0].texcoord);
+
+    glActiveTexture(GL_TEXTURE0);
+    source.bind();
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    source.add_syncpoint();
+
+    glDisableVertexAttribArray(prog.texcoord_attr);
+    glDisableVertexAttribArray(prog.position_attr);
+}
+
+void mrg::Renderer::prepare_geometry(mg::RenderableList const& renderables) const
+{
+    frame_vertices.clear();
+    frame_primitives.clear();
+    frame_geometry.clear();
+    next_geometry = 0;
+
+    for (auto const& r : renderables)
+    {
+        if (repaint_area && !repaint_area->overlaps(area_affected_by(*r, viewport)))
+        {
+            continue;
+        }
+
+        primitives.clear();
+        tessellate(primitives, *r);
+
+        frame_geometry.push_back({r.get(), frame_primitives.size(), primitives.size()});
+        for (auto const& p : primitives)
+        {
+            frame_primitives.push_back({p.type, static_cast<GLint>(frame_vertices.size()), p.nvertices});
+            frame_vertices.insert(frame_vertices.end(), p.vertices, p.vertices + p.nvertices);
+        }
+    }
+
+    vertex_buffers->upload(frame_vertices);
+}
+
+void mrg::Renderer::use_program(Program const& prog, mgl::Vertex const* client_vertices) const
+{
+    if (&prog == current_program && client_vertices == current_vertices)
+    {
+        return;
+    }
+
+    if (&prog != current_program)
+    {
+        glUseProgram(prog.id);
+    }
+
+    if (current_program &&
+        (current_program->position_attr != prog.position_attr ||
+         current_program->texcoord_attr != prog.texcoord_attr))
+    {
+        glDisableVertexAttribArray(current_program->texcoord_attr);
+        glDisableVertexAttribArray(current_program->position_attr);
+    }
+    glEnableVertexAttribArray(prog.position_attr);
+    glEnableVertexAttribArray(prog.texcoord_attr);
+
+    // With a buffer bound the "pointers" are offsets into it
+    if (client_vertices)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    else
+    {
+        vertex_buffers->bind();
+    }
+    auto const base = reinterpret_cast<char const*>(client_vertices);
+    glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT, GL_FALSE, sizeof(mgl::Vertex),
+                          base + offsetof(mgl::Vertex, position));
+    glVertexAttribPointer(prog.texcoord_attr, 2, GL_FLOAT, GL_FALSE, sizeof(mgl::Vertex),
+                          base + offsetof(mgl::Vertex, texcoord));
+
+    current_program = &prog;
+    current_vertices = client_vertices;
+}
+
+void mrg::Renderer::set_blend(std::optional<BlendFunc> const& func) const
+{
+    if (current_blend && *current_blend == func)
+    {
+        return;
+    }
+
+    if (!func)
+    {
+        glDisable(GL_BLEND);
+    }
+    else
+    {
+        if (!current_blend || !*current_blend)
+        {
+            glEnable(GL_BLEND);
+        }
+        glBlendFuncSeparate(func->src_rgb, func->dst_rgb, func->src_alpha, func->dst_alpha);
+    }
+    current_blend = func;
+}
+
+void mrg::Renderer::forget_gl_state() const
+{
+    current_program = nullptr;
+    current_vertices = nullptr;
+    current_blend = std::nullopt;
+}
+
+auto mrg::Renderer::window_area_for(geom::Rectangle const& area) const -> geom::Rectangle
+{
+    if (!gl_viewport)
+    {
+        return area;
+    }
+    if (area.size.width.as_int() <= 0 || area.size.height.as_int() <= 0)
+    {
+        return {};
+    }
+
+    /*
+     * Follow the scene corners through the same steps as the vertex shader: into
+     * normalised device coordinates (with y up), through the display transform,
+     * and then into the part of the window selected by glViewport().
+     */
+    auto const& window = *gl_viewport;
+    float min_x{std::numeric_limits<float>::max()}, min_y{std::numeric_limits<float>::max()};
+    float max_x{std::numeric_limits<float>::lowest()}, max_y{std::numeric_limits<float>::lowest()};
+    for (auto const& corner : {area.top_left, area.top_right(), area.bottom_left(), area.bottom_right()})
+    {
+        glm::vec4 const device{
+            2.0f * (corner.x - viewport.top_left.x).as_int() / viewport.size.width.as_int() - 1.0f,
+            1.0f - 2.0f * (corner.y - viewport.top_left.y).as_int() / viewport.size.height.as_int(),
+            0.0f,
+            1.0f};
+        auto const transformed = display_transform * device;
+        auto const x = window.top_left.x.as_int() + (transformed[0] + 1.0f) / 2.0f * window.size.width.as_int();
+        auto const y = window.top_left.y.as_int() + (transformed[1] + 1.0f) / 2.0f * window.size.height.as_int();
+        min_x = std::min(min_x, x);
+        min_y = std::min(min_y, y);
+        max_x = std::max(max_x, x);
+        max_y = std::max(max_y, y);
+    }
+
+    // Round outwards, but don't let float error grow the area by a whole pixel
+    auto const tolerance = 1.0f / 256;
+    geom::Point const top_left{std::floor(min_x + tolerance), std::floor(min_y + tolerance)};
+    geom::Point const bottom_right{std::ceil(max_x - tolerance), std::ceil(max_y - tolerance)};
+    return {top_left, as_size(bottom_right - top_left)};
+}
+
+auto mrg::Renderer::opaque_split_for(mg::Renderable const& renderable) const -> std::vector<ScissoredDraw>
+{
+    std::vector<ScissoredDraw> split;
+
+    if (!gl_viewport || !renderable.shaped() || renderable.alpha() != 1.0f ||
+        renderable.transformation() != glm::mat4{1})
+    {
+        return split;
+    }
+
+    // Unless scene pixels land exactly on window pixels the opaque and blended parts would overlap
+    auto const& window_size = gl_viewport->size;
+    if (window_size != viewport.size &&
+        window_size != geom::Size{viewport.size.height.as_int(), viewport.size.width.as_int()})
+    {
+        return split;
+    }
+
+    auto drawn_area = intersection_of(renderable.screen_position(), viewport);
+    if (auto const clip_area = renderable.clip_area())
+    {
+        drawn_area = intersection_of(drawn_area, *clip_area);
+    }
+    if (repaint_area)
+    {
+        drawn_area = intersection_of(drawn_area, *repaint_area);
+    }
+
+    geom::Rectangles blended{drawn_area};
+    for (auto const& opaque : renderable.opaque_region())
+    {
+        for (auto const& part : blended)
+        {
+            auto const unblended = intersection_of(part, opaque);
+            if (unblended.size != geom::Size{})
+            {
+                split.push_back({window_area_for(unblended), false});
+            }
+        }
+        blended = difference_of(blended, opaque);
+    }
+
+    if (split.empty())
+    {
+        // Nothing opaque gets drawn, so there's nothing to gain
+        return split;
+    }
+
+    for (auto const& part : blended)
+    {
+        split.push_back({window_area_for(part), true});
+    }
+    return split;
+}
+
+void mrg::Renderer::set_scissor(geom::Rectangle const& window_area) const
+{
+    glScissor(
+        window_area.top_left.x.as_int(),
+        window_area.top_left.y.as_int(),
+        window_area.size.width.as_int(),
+        window_area.size.height.as_int());
+}
+
 void mrg::Renderer::set_viewport(geometry::Rectangle const& rect)
 {
     if (rect == viewport)
@@ -608,6 +1270,11 @@ void mrg::Renderer::update_gl_viewport()
         GLint offset_y = (output_height - reduced_height) / 2;
 
         glViewport(offset_x, offset_y, reduced_width, reduced_height);
+        gl_viewport = geom::Rectangle{{offset_x, offset_y}, {reduced_width, reduced_height}};
+    }
+    else
+    {
+        gl_viewport = std::nullopt;
     }
 }
 
@@ -635,6 +1302,8 @@ void mrg::Renderer::set_output_transform(glm::mat2 const& t)
     {
         display_transform = new_display_transform;
         update_gl_viewport();
+        // Whatever the output buffers hold was drawn with the old transform
+        damage_tracker.reset();
     }
 }
 
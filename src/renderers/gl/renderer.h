@@ -23,7 +23,10 @@
 #include <mir/graphics/renderable.h>
 #include <mir/gl/primitive.h>
 
+#include "damage_tracker.h"
+
 #include <GLES2/gl2.h>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -31,7 +34,7 @@
 namespace mir
 {
 namespace graphics { class GLRenderingProvider; }
-namespace graphics::gl { class OutputSurface; }
+namespace graphics::gl { class OutputSurface; class Texture; }
 namespace renderer
 {
 namespace gl
@@ -41,6 +44,14 @@ class Renderer : public renderer::Renderer
 {
 public:
     Renderer(std::shared_ptr<graphics::GLRenderingProvider> gl_interface, std::unique_ptr<graphics::gl::OutputSurface> output);
+    /**
+     * \param [in] repaint_damage_only  Where the output surface reports the age of its buffers,
+     *                                 only repaint the areas that have changed since they were drawn
+     */
+    Renderer(
+        std::shared_ptr<graphics::GLRenderingProvider> gl_interface,
+        std::unique_ptr<graphics::gl::OutputSurface> output,
+        bool repaint_damage_only);
     virtual ~Renderer();
 
     // These are called with a valid GL context:
@@ -97,18 +108,97 @@ protected:
 
     mutable long long frameno = 0;
 
+    /**
+     * Draw \a renderable, using the geometry tessellated for it at the start of the frame
+     *
+     * Successive calls within a frame skip GL state changes (program, vertex attributes, blending)
+     * that are already in effect.
+     */
     virtual void draw(graphics::Renderable const& renderable) const;
 
 private:
     void update_gl_viewport();
+    /// The area of the GL window that scene area \a area is drawn to
+    auto window_area_for(geometry::Rectangle const& area) const -> geometry::Rectangle;
+    void set_scissor(geometry::Rectangle const& window_area) const;
+
+    /// An area of the GL window to draw a renderable in, and whether that needs blending
+    struct ScissoredDraw
+    {
+        geometry::Rectangle window_area;
+        bool blend;
+    };
+    /**
+     * Split drawing a shaped renderable into its opaque_region(), which can be drawn without
+     * blending, and the rest
+     *
+     * \returns an empty vector if the renderable should just be drawn in one go
+     */
+    auto opaque_split_for(graphics::Renderable const& renderable) const -> std::vector<ScissoredDraw>;
+
+    /// Parameters of glBlendFuncSeparate()
+    struct BlendFunc
+    {
+        GLenum src_rgb, dst_rgb, src_alpha, dst_alpha;
+
+        auto operator==(BlendFunc const&) const -> bool = default;
+    };
+
+    /// A tessellated primitive, as a range of this frame's vertices
+    struct PrimitiveRange
+    {
+        GLenum type;
+        GLint first;
+        GLsizei count;
+    };
+
+    /// The primitives to draw a renderable with this frame
+    struct RenderableGeometry
+    {
+        graphics::Renderable const* renderable;
+        size_t first_primitive;
+        size_t primitive_count;
+    };
+
+    /// Bring the scaled copies of buffers drawn much smaller than they are up to date
+    void update_scaled_textures(graphics::RenderableList const& renderables) const;
+    /// Draw all of \a source into \a framebuffer, which is \a size pixels big
+    void draw_scaled_copy(graphics::gl::Texture& source, GLuint framebuffer, geometry::Size size) const;
+    /// Tessellate everything to be drawn this frame into one set of vertices, and upload them
+    void prepare_geometry(graphics::RenderableList const& renderables) const;
+    /// Use \a prog with vertices taken from \a client_vertices, or the vertex buffer if null
+    void use_program(Program const& prog, mir::gl::Vertex const* client_vertices = nullptr) const;
+    /// Blend with \a func, or not at all
+    void set_blend(std::optional<BlendFunc> const& func) const;
+    /// Forget the GL state we've set, as something else may have changed it
+    void forget_gl_state() const;
 
     class ProgramFactory;
     std::unique_ptr<ProgramFactory> const program_factory;
+    class VertexBuffers;
+    std::unique_ptr<VertexBuffers> const vertex_buffers;
+    class ScaledTextures;
+    std::unique_ptr<ScaledTextures> const scaled_textures;
     geometry::Rectangle viewport;
     glm::mat4 screen_to_gl_coords;
     glm::mat4 display_transform;
     std::vector<mir::gl::Primitive> mutable primitives;
+    std::vector<mir::gl::Vertex> mutable frame_vertices;
+    std::vector<PrimitiveRange> mutable frame_primitives;
+    std::vector<RenderableGeometry> mutable frame_geometry;
+    size_t mutable next_geometry{0};
+
+    // The GL state draw() has set up, so it isn't set again for the next renderable
+    mutable Program const* current_program{nullptr};
+    mutable mir::gl::Vertex const* current_vertices{nullptr};
+    std::optional<std::optional<BlendFunc>> mutable current_blend;
     std::shared_ptr<graphics::GLRenderingProvider> const gl_interface;
+
+    bool const repaint_damage_only;
+    DamageTracker mutable damage_tracker;
+    std::optional<geometry::Rectangle> gl_viewport;
+    /// The damaged part of the scene being repainted this frame, if not the whole viewport
+    std::optional<geometry::Rectangle> mutable repaint_area;
 };
 
 }
@@ -21,9 +21,14 @@
 
 namespace mrg = mir::renderer::gl;
 
+mrg::RendererFactory::RendererFactory(bool repaint_damage_only)
+    : repaint_damage_only{repaint_damage_only}
+{
+}
+
 auto mrg::RendererFactory::create_renderer_for(
     std::unique_ptr<graphics::gl::OutputSurface> output_surface,
     std::shared_ptr<graphics::GLRenderingProvider> gl_provider) const -> std::unique_ptr<mir::renderer::Renderer>
 {
-    return std::make_unique<Renderer>(std::move(gl_provider), std::move(output_surface));
+    return std::make_unique<Renderer>(std::move(gl_provider), std::move(output_surface), repaint_damage_only);
 }
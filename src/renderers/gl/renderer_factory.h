@@ -33,9 +33,17 @@ namespace gl
 class RendererFactory : public renderer::RendererFactory
 {
 public:
+    RendererFactory() = default;
+
+    /// \param repaint_damage_only  Whether renderers only repaint what changed since their buffer was drawn
+    explicit RendererFactory(bool repaint_damage_only);
+
     auto create_renderer_for(
         std::unique_ptr<graphics::gl::OutputSurface> output_surface,
         std::shared_ptr<graphics::GLRenderingProvider> gl_provider) const -> std::unique_ptr<renderer::Renderer> override;
+
+private:
+    bool const repaint_damage_only{false};
 };
 
 }
@@ -42,14 +42,32 @@ public:
     class FB : public mg::CPUAddressableDisplayAllocator::MappableFB
     {
     public:
-        FB(std::shared_ptr<mrs::WriteMappableBuffer> buffer)
-            : buffer{std::move(buffer)}
+        FB(
+            OneShotBufferDisplayProvider& provider,
+            std::shared_ptr<mrs::WriteMappableBuffer> buffer,
+            geom::Rectangle const& area,
+            std::optional<geom::Rectangle> const& damage)
+            : provider{provider},
+              buffer{std::move(buffer)},
+              area{area},
+              damage_{damage}
         {
         }
 
         auto map_writeable() -> std::unique_ptr<mrs::Mapping<unsigned char>> override
         {
-            return buffer->map_writeable();
+            auto mapping = buffer->map_writeable();
+
+            // The damage is only what's changed since the last capture, so any other target needs writing in full
+            Target const target{mapping->data(), buffer->size(), buffer->stride(), area};
+            if (provider.last_capture != target)
+            {
+                damage_ = std::nullopt;
+            }
+            provider.last_capture = std::nullopt;
+            provider.pending_capture = target;
+
+            return mapping;
         }
         auto size() const -> geom::Size override
         {
@@ -63,8 +81,15 @@ public:
         {
             return buffer->stride();
         }
+        auto damage() const -> std::optional<geom::Rectangle> override
+        {
+            return damage_;
+        }
     private:
+        OneShotBufferDisplayProvider& provider;
         std::shared_ptr<mrs::WriteMappableBuffer> const buffer;
+        geom::Rectangle const area;
+        std::optional<geom::Rectangle> damage_;
     };
 
     auto supported_formats() const -> std::vector<graphics::DRMFormat> override
@@ -82,7 +107,11 @@ public:
         {
             BOOST_THROW_EXCEPTION((std::runtime_error{"Mismatched pixel formats"}));
         }
-        return std::make_unique<FB>(std::exchange(next_buffer, nullptr));
+        return std::make_unique<FB>(
+            *this,
+            std::exchange(next_buffer, nullptr),
+            next_area,
+            std::exchange(next_damage, std::nullopt));
     }
 
     auto output_size() const -> geom::Size override
@@ -94,16 +123,44 @@ public:
         return next_buffer->size();
     }
 
-    void set_next_buffer(std::shared_ptr<mrs::WriteMappableBuffer> buffer)
+    void set_next_buffer(
+        std::shared_ptr<mrs::WriteMappableBuffer> buffer,
+        geom::Rectangle const& area,
+        std::optional<geom::Rectangle> const& damage)
     {
         if (next_buffer)
         {
             BOOST_THROW_EXCEPTION((std::logic_error{"Attempt to set next buffer with a buffer already pending"}));
         }
         next_buffer = std::move(buffer);
+        next_area = area;
+        next_damage = damage;
+    }
+
+    /// Note that the buffer last mapped now holds a complete capture
+    void capture_completed()
+    {
+        last_capture = std::exchange(pending_capture, std::nullopt);
     }
 private:
+    /// Where a capture was written, and of what
+    struct Target
+    {
+        unsigned char const* pixels;
+        geom::Size size;
+        geom::Stride stride;
+        geom::Rectangle area;
+
+        auto operator==(Target const&) const -> bool = default;
+    };
+
     std::shared_ptr<mrs::WriteMappableBuffer> next_buffer;
+    geom::Rectangle next_area;
+    std::optional<geom::Rectangle> next_damage;
+
+    /// The target of the last capture to complete, unless one has been started since
+    std::optional<Target> last_capture;
+    std::optional<Target> pending_capture;
 };
 
 class OffscreenDisplaySink : public mg::DisplaySink
@@ -167,7 +224,8 @@ mc::BasicScreenShooter::Self::Self(
 
 auto mc::BasicScreenShooter::Self::render(
     std::shared_ptr<mrs::WriteMappableBuffer> const& buffer,
-    geom::Rectangle const& area) -> time::Timestamp
+    geom::Rectangle const& area,
+    std::optional<geom::Rectangle> const& buffer_damage) -> time::Timestamp
 {
     std::lock_guard lock{mutex};
 
@@ -181,12 +239,13 @@ auto mc::BasicScreenShooter::Self::render(
     }
     scene_elements.clear();
 
-    auto& renderer = renderer_for_buffer(buffer);
+    auto& renderer = renderer_for_buffer(buffer, area, buffer_damage);
     renderer.set_viewport(area);
     /* We don't need the result of this `render` call, as we know it's
      * going into the buffer we just set
      */
     renderer.render(renderable_list);
+    output->capture_completed();
 
     // Because we might be called on a different thread next time we need to
     // ensure the renderer doesn't keep the EGL context current
@@ -194,15 +253,17 @@ auto mc::BasicScreenShooter::Self::render(
     return captured_time;
 }
 
-auto mc::BasicScreenShooter::Self::renderer_for_buffer(std::shared_ptr<mrs::WriteMappableBuffer> buffer)
-    -> mr::Renderer&
+auto mc::BasicScreenShooter::Self::renderer_for_buffer(
+    std::shared_ptr<mrs::WriteMappableBuffer> buffer,
+    geom::Rectangle const& area,
+    std::optional<geom::Rectangle> const& buffer_damage) -> mr::Renderer&
 {
     auto const buffer_size = buffer->size();
     if (buffer_size.height == geom::Height{0} || buffer_size.width == geom::Width{0})
     {
         BOOST_THROW_EXCEPTION((std::runtime_error{"Attempt to capture to a zero-sized buffer"}));
     }
-    output->set_next_buffer(std::move(buffer));
+    output->set_next_buffer(std::move(buffer), area, buffer_damage);
     if (buffer_size != last_rendered_size)
     {
         // We need to build a new Renderer, at the new size
@@ -264,16 +325,34 @@ void mc::BasicScreenShooter::capture(
     std::shared_ptr<mrs::WriteMappableBuffer> const& buffer,
     geom::Rectangle const& area,
     std::function<void(std::optional<time::Timestamp>)>&& callback)
+{
+    schedule_capture(buffer, area, std::nullopt, std::move(callback));
+}
+
+void mc::BasicScreenShooter::capture_with_damage(
+    std::shared_ptr<mrs::WriteMappableBuffer> const& buffer,
+    geom::Rectangle const& area,
+    geom::Rectangle const& buffer_damage,
+    std::function<void(std::optional<time::Timestamp>)>&& callback)
+{
+    schedule_capture(buffer, area, buffer_damage, std::move(callback));
+}
+
+void mc::BasicScreenShooter::schedule_capture(
+    std::shared_ptr<mrs::WriteMappableBuffer> const& buffer,
+    geom::Rectangle const& area,
+    std::optional<geom::Rectangle> const& buffer_damage,
+    std::function<void(std::optional<time::Timestamp>)>&& callback)
 {
     // TODO: use an atomic to keep track of number of in-flight captures, and error if it's too many
 
-    executor.spawn([weak_self=std::weak_ptr{self}, buffer, area, callback=std::move(callback)]
+    executor.spawn([weak_self=std::weak_ptr{self}, buffer, area, buffer_damage, callback=std::move(callback)]
         {
             if (auto const self = weak_self.lock())
             {
                 try
                 {
-                    callback(self->render(buffer, area));
+                    callback(self->render(buffer, area, buffer_damage));
                     return;
                 }
                 catch (...)
@@ -52,7 +52,19 @@ public:
         geometry::Rectangle const& area,
         std::function<void(std::optional<time::Timestamp>)>&& callback) override;
 
+    void capture_with_damage(
+        std::shared_ptr<renderer::software::WriteMappableBuffer> const& buffer,
+        geometry::Rectangle const& area,
+        geometry::Rectangle const& buffer_damage,
+        std::function<void(std::optional<time::Timestamp>)>&& callback) override;
+
 private:
+    void schedule_capture(
+        std::shared_ptr<renderer::software::WriteMappableBuffer> const& buffer,
+        geometry::Rectangle const& area,
+        std::optional<geometry::Rectangle> const& buffer_damage,
+        std::function<void(std::optional<time::Timestamp>)>&& callback);
+
     struct Self
     {
         class OneShotBufferDisplayProvider;
@@ -65,10 +77,13 @@ private:
 
         auto render(
             std::shared_ptr<renderer::software::WriteMappableBuffer> const& buffer,
-            geometry::Rectangle const& area) -> time::Timestamp;
+            geometry::Rectangle const& area,
+            std::optional<geometry::Rectangle> const& buffer_damage) -> time::Timestamp;
 
-        auto renderer_for_buffer(std::shared_ptr<renderer::software::WriteMappableBuffer> buffer)
-            -> renderer::Renderer&;
+        auto renderer_for_buffer(
+            std::shared_ptr<renderer::software::WriteMappableBuffer> buffer,
+            geometry::Rectangle const& area,
+            std::optional<geometry::Rectangle> const& buffer_damage) -> renderer::Renderer&;
 
         std::mutex mutex;
         std::shared_ptr<Scene> const scene;
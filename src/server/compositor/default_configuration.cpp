@@ -98,9 +98,10 @@ mir::DefaultServerConfiguration::the_compositor()
 std::shared_ptr<mir::renderer::RendererFactory> mir::DefaultServerConfiguration::the_renderer_factory()
 {
     return renderer_factory(
-        []()
+        [this]()
         {
-            return std::make_shared<mir::renderer::gl::RendererFactory>();
+            return std::make_shared<mir::renderer::gl::RendererFactory>(
+                the_options()->get<bool>(options::damage_tracking_opt));
         });
 }
 
@@ -27,8 +27,120 @@
 #include "mir/renderer/renderer.h"
 #include "occlusion.h"
 
+#include <algorithm>
+
 namespace mc = mir::compositor;
 namespace mg = mir::graphics;
+namespace geom = mir::geometry;
+
+namespace
+{
+/// A renderable clipped to the part of it left visible by those above it
+class VisibleRenderable : public mg::Renderable
+{
+public:
+    VisibleRenderable(std::shared_ptr<mg::Renderable> renderable, geom::Rectangle const& visible_area)
+        : renderable{std::move(renderable)},
+          visible_area{visible_area}
+    {
+    }
+
+    auto id() const -> ID override { return renderable->id(); }
+    auto buffer() const -> std::shared_ptr<mg::Buffer> override { return renderable->buffer(); }
+    auto screen_position() const -> geom::Rectangle override { return renderable->screen_position(); }
+    auto clip_area() const -> std::optional<geom::Rectangle> override { return visible_area; }
+    auto alpha() const -> float override { return renderable->alpha(); }
+    auto transformation() const -> glm::mat4 override { return renderable->transformation(); }
+    auto shaped() const -> bool override { return renderable->shaped(); }
+    auto opaque_region() const -> geom::Rectangles override { return renderable->opaque_region(); }
+
+private:
+    std::shared_ptr<mg::Renderable> const renderable;
+    geom::Rectangle const visible_area;
+};
+
+/**
+ * The renderable to draw for \a renderable, given the region of \a view_area it is visible in
+ *
+ * If some of it is hidden, it is clipped to the bounding rectangle of the visible part, so
+ * the renderer doesn't draw over pixels that get drawn over again.
+ */
+auto clipped_to_visible(
+    std::shared_ptr<mg::Renderable> const& renderable,
+    geom::Rectangles const& visible_region,
+    geom::Rectangle const& view_area) -> std::shared_ptr<mg::Renderable>
+{
+    if (renderable->transformation() != glm::mat4{1})
+    {
+        return renderable;
+    }
+
+    auto drawn_area = intersection_of(renderable->screen_position(), view_area);
+    if (auto const clip = renderable->clip_area())
+    {
+        drawn_area = intersection_of(drawn_area, *clip);
+    }
+
+    auto const visible_area = visible_region.bounding_rectangle();
+    if (visible_area == drawn_area)
+    {
+        return renderable;
+    }
+    return std::make_shared<VisibleRenderable>(renderable, visible_area);
+}
+
+/**
+ * \a renderable as a DisplayElement showing \a fb, for the display to scan out in place of
+ * rendering the whole scene
+ */
+auto display_element_for(mg::Renderable const& renderable, std::shared_ptr<mg::Framebuffer> fb)
+    -> mg::DisplayElement
+{
+    geom::Rectangle clipped_dest;
+    if (renderable.clip_area())
+    {
+        clipped_dest = intersection_of(renderable.screen_position(), *renderable.clip_area());
+    }
+    else
+    {
+        clipped_dest = renderable.screen_position();
+    }
+    geom::SizeF const source_size{
+        clipped_dest.size.width.as_value(),
+        clipped_dest.size.height.as_value()};
+    geom::PointF const source_origin{
+        clipped_dest.top_left.x.as_value() - renderable.screen_position().top_left.x.as_value(),
+        clipped_dest.top_left.y.as_value() - renderable.screen_position().top_left.y.as_value()
+    };
+
+    return mg::DisplayElement{
+        renderable.screen_position(),
+        geom::RectangleF{source_origin, source_size},
+        std::move(fb)
+    };
+}
+
+/**
+ * The visible part of \a renderable as a DisplayElement showing \a fb, for an overlay plane
+ * above a rendered primary plane
+ */
+auto overlay_element_for(mg::Renderable const& renderable, std::shared_ptr<mg::Framebuffer> fb)
+    -> mg::DisplayElement
+{
+    auto element = display_element_for(renderable, std::move(fb));
+    if (auto const clip = renderable.clip_area())
+    {
+        element.screen_positon = intersection_of(renderable.screen_position(), *clip);
+    }
+    return element;
+}
+
+/// Whether the display hardware could show \a renderable without the renderer's help
+auto could_overlay(mg::Renderable const& renderable) -> bool
+{
+    return renderable.alpha() == 1.0f && renderable.transformation() == glm::mat4{1};
+}
+}
 
 mc::DefaultDisplayBufferCompositor::DefaultDisplayBufferCompositor(
     mg::DisplaySink& display_sink,
@@ -51,17 +163,18 @@ bool mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
     report->began_frame(this);
 
     auto const& view_area = display_sink.view_area();
-    auto const& occlusions = mc::filter_occlusions_from(scene_elements, view_area);
+    auto const& occlusions = mc::filter_occlusions_from(scene_elements, view_area, visible_regions);
+    report->filtered_occlusions(this);
 
     for (auto const& element : occlusions)
         element->occluded();
 
-    mg::RenderableList renderable_list;
+    renderable_list.clear();
     renderable_list.reserve(scene_elements.size());
-    for (auto const& element : scene_elements)
+    for (size_t i = 0; i != scene_elements.size(); ++i)
     {
-        element->rendered();
-        renderable_list.push_back(element->renderable());
+        scene_elements[i]->rendered();
+        renderable_list.push_back(clipped_to_visible(scene_elements[i]->renderable(), visible_regions[i], view_area));
     }
 
     /*
@@ -74,41 +187,37 @@ bool mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
      */
     scene_elements.clear();  // Those in use are still in renderable_list
 
-    std::vector<mg::DisplayElement> framebuffers;
+    /* Work down from the top of the stack collecting framebuffers the display can scan out
+     * directly. If everything can be scanned out we don't need to render at all; otherwise
+     * we may still be able to put the top of the stack on overlay planes and render the rest.
+     */
+    framebuffers.clear();
     framebuffers.reserve(renderable_list.size());
 
-    for (auto const& renderable : renderable_list)
+    for (auto renderable = renderable_list.rbegin(); renderable != renderable_list.rend(); ++renderable)
     {
-        auto fb = fb_adaptor->buffer_to_framebuffer(renderable->buffer());
-        if (!fb)
+        if (!could_overlay(**renderable))
         {
             break;
         }
-        geometry::Rectangle clipped_dest;
-        if (renderable->clip_area())
-        {
-            clipped_dest = intersection_of(renderable->screen_position(), *renderable->clip_area());
-        }
-        else
+        auto fb = fb_adaptor->buffer_to_framebuffer((*renderable)->buffer());
+        if (!fb)
         {
-            clipped_dest = renderable->screen_position();
+            break;
         }
-        geometry::SizeF const source_size{
-            clipped_dest.size.width.as_value(),
-            clipped_dest.size.height.as_value()};
-        geometry::PointF const source_origin{
-            clipped_dest.top_left.x.as_value() - renderable->screen_position().top_left.x.as_value(),
-            clipped_dest.top_left.y.as_value() - renderable->screen_position().top_left.y.as_value()
-        };
-
-        framebuffers.emplace_back(mg::DisplayElement{
-            renderable->screen_position(),
-            geometry::RectangleF{source_origin, source_size},
-            std::move(fb)
-        });
+        framebuffers.push_back(display_element_for(**renderable, std::move(fb)));
     }
+    std::reverse(framebuffers.begin(), framebuffers.end());
 
-    if (framebuffers.size() == renderable_list.size() && display_sink.overlay(framebuffers))
+    auto const overlaid = framebuffers.size();
+    auto const first_overlaid = renderable_list.end() - overlaid;
+    overlaid_ids.clear();
+    for (auto renderable = first_overlaid; renderable != renderable_list.end(); ++renderable)
+    {
+        overlaid_ids.push_back((*renderable)->id());
+    }
+
+    if (overlaid == renderable_list.size() && display_sink.overlay(framebuffers))
     {
         report->renderables_in_frame(this, renderable_list);
         renderer->suspend();
@@ -118,7 +227,47 @@ bool mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
         renderer->set_output_transform(display_sink.transformation());
         renderer->set_viewport(view_area);
 
-        display_sink.set_next_image(renderer->render(renderable_list));
+        bool posted{false};
+        if (overlaid > 0 && overlaid < renderable_list.size() && overlaid_ids != rejected_overlays)
+        {
+            for (size_t i = 0; i != overlaid; ++i)
+            {
+                framebuffers[i] = overlay_element_for(*first_overlaid[i], std::move(framebuffers[i].buffer));
+            }
+
+            // Find out whether the display will take the overlays before rendering anything
+            if (display_sink.accepts_overlays(framebuffers))
+            {
+                // Render what's below the overlays onto the primary plane
+                underneath.assign(renderable_list.begin(), first_overlaid);
+                auto const primary_size = view_area.size;
+                framebuffers.insert(
+                    framebuffers.begin(),
+                    mg::DisplayElement{
+                        view_area,
+                        geom::RectangleF{
+                            {0, 0},
+                            {primary_size.width.as_value(), primary_size.height.as_value()}},
+                        renderer->render(underneath)});
+                underneath.clear();
+
+                /* The display promised to take these, so this only fails if it's broken. Then
+                 * we've no choice but to render everything; at least it won't happen again.
+                 */
+                posted = display_sink.overlay(framebuffers);
+            }
+
+            if (!posted)
+            {
+                // Don't keep trying (and failing) with the same overlays every frame
+                rejected_overlays = overlaid_ids;
+            }
+        }
+
+        if (!posted)
+        {
+            display_sink.set_next_image(renderer->render(renderable_list));
+        }
 
         report->renderables_in_frame(this, renderable_list);
         report->rendered_frame(this);
@@ -137,6 +286,10 @@ bool mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
         renderable_list.clear();
     }
 
+    // Drop this frame's references to client buffers, but keep the storage for the next frame
+    renderable_list.clear();
+    framebuffers.clear();
+
     report->finished_frame(this);
     return true;
 }
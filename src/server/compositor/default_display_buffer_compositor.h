@@ -19,7 +19,11 @@
 
 #include "mir/compositor/display_buffer_compositor.h"
 #include "mir/graphics/platform.h"
+#include "mir/graphics/renderable.h"
+#include "mir/graphics/display_sink.h"
+#include "mir/geometry/rectangles.h"
 #include <memory>
+#include <vector>
 
 namespace mir
 {
@@ -57,6 +61,15 @@ private:
     std::unique_ptr<graphics::RenderingProvider::FramebufferProvider> const fb_adaptor;
     std::shared_ptr<compositor::CompositorReport> const report;
     bool completed_first_render = false;
+    /// The renderables last refused as overlays by the display_sink
+    std::vector<graphics::Renderable::ID> rejected_overlays;
+
+    /// Scratch space for composite(), kept between frames so steady-state frames reuse its storage
+    std::vector<geometry::Rectangles> visible_regions;
+    graphics::RenderableList renderable_list;
+    graphics::RenderableList underneath;
+    std::vector<graphics::DisplayElement> framebuffers;
+    std::vector<graphics::Renderable::ID> overlaid_ids;
 };
 
 }
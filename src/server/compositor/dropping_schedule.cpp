@@ -18,6 +18,9 @@
 #include "mir/graphics/buffer.h"
 
 #include <boost/throw_exception.hpp>
+
+#include <algorithm>
+
 namespace mg = mir::graphics;
 namespace mc = mir::compositor;
 
@@ -25,16 +28,32 @@ mc::DroppingSchedule::DroppingSchedule()
 {
 }
 
+mc::DroppingSchedule::~DroppingSchedule() = default;
+
 void mc::DroppingSchedule::schedule(std::shared_ptr<mg::Buffer> const& buffer)
 {
-    std::lock_guard lk(mutex);
-    the_only_buffer = buffer;
+    // While we fill one slot, at most one other is waiting and one being emptied
+    // so, of three, one is always free
+    auto free_slot = std::find_if(
+        slots.begin(), slots.end(),
+        [](Slot& slot) { return !slot.in_use.exchange(true, std::memory_order_acquire); });
+    if (free_slot == slots.end())
+        BOOST_THROW_EXCEPTION(std::logic_error("no free slot to schedule buffer in"));
+
+    free_slot->buffer = buffer;
+    auto const displaced = waiting.exchange(free_slot - slots.begin(), std::memory_order_acq_rel);
+
+    // Whoever swaps a slot out owns it, so the displaced buffer is ours to drop
+    if (displaced != no_slot)
+    {
+        slots[displaced].buffer.reset();
+        slots[displaced].in_use.store(false, std::memory_order_release);
+    }
 }
 
 unsigned int mc::DroppingSchedule::num_scheduled()
 {
-    std::lock_guard lk(mutex);
-    if (the_only_buffer)
+    if (waiting.load(std::memory_order_acquire) != no_slot)
         return 1;
     else
         return 0;
@@ -42,10 +61,11 @@ unsigned int mc::DroppingSchedule::num_scheduled()
 
 std::shared_ptr<mg::Buffer> mc::DroppingSchedule::next_buffer()
 {
-    std::lock_guard lk(mutex);
-    if (!the_only_buffer)
+    auto const taken = waiting.exchange(no_slot, std::memory_order_acq_rel);
+    if (taken == no_slot)
         BOOST_THROW_EXCEPTION(std::logic_error("no buffer scheduled"));
-    auto buffer = the_only_buffer;
-    the_only_buffer = nullptr;
+
+    auto buffer = std::move(slots[taken].buffer);
+    slots[taken].in_use.store(false, std::memory_order_release);
     return buffer;
 }
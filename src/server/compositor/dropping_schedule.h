@@ -17,25 +17,48 @@
 #ifndef MIR_COMPOSITOR_DROPPING_SCHEDULE_H_
 #define MIR_COMPOSITOR_DROPPING_SCHEDULE_H_
 #include "schedule.h"
+#include <array>
+#include <atomic>
 #include <memory>
-#include <mutex>
 
 namespace mir
 {
 namespace graphics { class Buffer; }
 namespace compositor
 {
+/**
+ * A single-slot mailbox: each scheduled buffer replaces whatever was waiting.
+ *
+ * The waiting buffer is published by atomically swapping the index of a preallocated
+ * slot, so a client scheduling a buffer never waits on a compositor taking one, or vice
+ * versa, and neither allocates.
+ *
+ * Calls to schedule() must be serialized with each other, and with any calls to
+ * next_buffer() but those from one other thread. (The Stream schedules and drains
+ * buffers under its mutex, and the arbiter takes them under its own.)
+ */
 class DroppingSchedule : public Schedule
 {
 public:
     DroppingSchedule();
+    ~DroppingSchedule();
     void schedule(std::shared_ptr<graphics::Buffer> const& buffer) override;
     unsigned int num_scheduled() override;
     std::shared_ptr<graphics::Buffer> next_buffer() override;
 
 private:
-    std::mutex mutable mutex;
-    std::shared_ptr<graphics::Buffer> the_only_buffer;
+    struct Slot
+    {
+        std::shared_ptr<graphics::Buffer> buffer;
+        std::atomic<bool> in_use{false};
+    };
+
+    /// One slot being filled, one waiting, and one being emptied
+    static size_t constexpr slot_count = 3;
+    static size_t constexpr no_slot = slot_count;
+
+    std::array<Slot, slot_count> slots;
+    std::atomic<size_t> waiting{no_slot};   ///< The slot holding the scheduled buffer, if any
 };
 }
 }
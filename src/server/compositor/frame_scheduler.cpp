@@ -0,0 +1,106 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_scheduler.h"
+
+#include <algorithm>
+
+namespace mc = mir::compositor;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+/* Time allowed on top of the worst recent composite time, for the page flip to be scheduled,
+ * the GPU to finish, and the occasional slower frame.
+ */
+auto constexpr safety_margin = 2ms;
+
+/// Frames starting within this time of the previous post() returning are back-to-back
+auto constexpr back_to_back = 1ms;
+}
+
+mc::FrameScheduler::FrameScheduler(Clock::duration frame_interval)
+    : frame_interval{frame_interval}
+{
+}
+
+auto mc::FrameScheduler::frame_posted(
+    Clock::time_point started,
+    Clock::time_point posting,
+    Clock::time_point posted) -> int
+{
+    int missed_vblanks{0};
+    if (synchronised && frame_interval > Clock::duration::zero())
+    {
+        // A frame started at this time was expected to make this vblank...
+        auto const target = first_vblank_from(started + predicted_composite_time());
+        if (posted > target)
+        {
+            // ...allowing for post() not returning exactly on the vblank
+            missed_vblanks = (posted - target + frame_interval / 2) / frame_interval;
+        }
+    }
+
+    composite_times[next_timing] = posting - started;
+    next_timing = (next_timing + 1) % history_size;
+
+    /* If nothing but compositing happened between two post()s and they still came a frame
+     * apart then post() waits for the display. (Frames we've delayed can't tell us.)
+     */
+    if (last_vblank && started >= *last_vblank && started - *last_vblank < back_to_back)
+    {
+        synchronised = posted - *last_vblank >= frame_interval * 3 / 4;
+    }
+    last_vblank = posted;
+
+    return missed_vblanks;
+}
+
+auto mc::FrameScheduler::synchronised_to_display() const -> bool
+{
+    return synchronised;
+}
+
+auto mc::FrameScheduler::predicted_composite_time() const -> Clock::duration
+{
+    // Aim for the worst case: missing a vblank costs a whole frame, starting early very little
+    return *std::max_element(composite_times.begin(), composite_times.end()) + safety_margin;
+}
+
+auto mc::FrameScheduler::first_vblank_from(Clock::time_point time) const -> Clock::time_point
+{
+    auto vblank = *last_vblank + frame_interval;
+    if (vblank < time)
+    {
+        auto const missed = (time - vblank + frame_interval - 1ns) / frame_interval;
+        vblank += missed * frame_interval;
+    }
+    return vblank;
+}
+
+auto mc::FrameScheduler::delay_before_next_frame(Clock::time_point now) const -> Clock::duration
+{
+    if (!synchronised || !last_vblank || frame_interval <= Clock::duration::zero())
+    {
+        return Clock::duration::zero();
+    }
+
+    // The first vblank we can still hope to make, and when to start to be ready just in time for it
+    auto const next_vblank = first_vblank_from(now + predicted_composite_time());
+    auto const start = next_vblank - predicted_composite_time();
+    return std::max(start - now, Clock::duration::zero());
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_FRAME_SCHEDULER_H_
+#define MIR_COMPOSITOR_FRAME_SCHEDULER_H_
+
+#include <array>
+#include <chrono>
+#include <optional>
+
+namespace mir
+{
+namespace compositor
+{
+
+/**
+ * Decides when a compositing thread should start work on its next frame
+ *
+ * Compositing is started "just in time": as late as possible while still finishing before the
+ * next vblank, given how long recent frames have taken. Sampling the scene as late as possible
+ * keeps the latency between a client's update and it reaching the screen down.
+ *
+ * The vblank timing is taken from when DisplaySyncGroup::post() returns, which on most
+ * platforms waits for a frame to reach the screen. Until frames posted back-to-back have been
+ * seen to be held to the refresh rate there's no vblank to aim for, so there's no delay.
+ */
+class FrameScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// \param frame_interval  The refresh interval of the (slowest) output being composited for
+    explicit FrameScheduler(Clock::duration frame_interval);
+
+    /**
+     * Record the timing of a composited frame
+     *
+     * \param [in] started  When the thread started compositing the frame
+     * \param [in] posting  When compositing finished, and post() was called
+     * \param [in] posted   When post() returned
+     * \returns            How many vblanks later than it should have been the frame reached the
+     *                      display (always 0 until synchronised to the display)
+     */
+    auto frame_posted(Clock::time_point started, Clock::time_point posting, Clock::time_point posted) -> int;
+
+    /// Whether post() has been seen to keep to the display's refresh rate
+    auto synchronised_to_display() const -> bool;
+
+    /// How long to wait from \a now before starting on the next frame
+    auto delay_before_next_frame(Clock::time_point now) const -> Clock::duration;
+
+    /// How long compositing a frame is expected to take, allowing for a safety margin
+    auto predicted_composite_time() const -> Clock::duration;
+
+private:
+    static size_t constexpr history_size = 16;
+
+    /// The first vblank at or after \a time, extrapolated from the last one seen
+    auto first_vblank_from(Clock::time_point time) const -> Clock::time_point;
+
+    Clock::duration const frame_interval;
+    std::array<Clock::duration, history_size> composite_times{};  ///< Ring buffer of recent timings
+    size_t next_timing{0};
+    std::optional<Clock::time_point> last_vblank;
+    bool synchronised{false};
+};
+
+} // namespace compositor
+} // namespace mir
+
+#endif // MIR_COMPOSITOR_FRAME_SCHEDULER_H_
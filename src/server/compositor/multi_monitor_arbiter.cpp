@@ -20,16 +20,17 @@
 #include "schedule.h"
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
+
 namespace mg = mir::graphics;
 namespace mc = mir::compositor;
 namespace mf = mir::frontend;
 
 mc::MultiMonitorArbiter::MultiMonitorArbiter(
     std::shared_ptr<Schedule> const& schedule) :
-    schedule(schedule)
+    schedule(schedule.get()),
+    schedules{schedule}
 {
-    // We're highly unlikely to have more than 6 outputs
-    current_buffer_users.reserve(6);
 }
 
 mc::MultiMonitorArbiter::~MultiMonitorArbiter()
@@ -44,11 +45,10 @@ std::shared_ptr<mg::Buffer> mc::MultiMonitorArbiter::compositor_acquire(composit
     if (!current_buffer || is_user_of_current_buffer(id))
     {
         // And if there is a scheduled buffer
-        if (schedule->num_scheduled() > 0)
+        if (schedule.load()->num_scheduled() > 0)
         {
             // Advance the current buffer
-            current_buffer = schedule->next_buffer();
-            clear_current_users();
+            advance_current_buffer();
         }
         // Otherwise leave the current buffer alone
     }
@@ -69,10 +69,9 @@ std::shared_ptr<mg::Buffer> mc::MultiMonitorArbiter::snapshot_acquire()
 
     if (!current_buffer)
     {
-        if (schedule->num_scheduled() > 0)
+        if (schedule.load()->num_scheduled() > 0)
         {
-            current_buffer = schedule->next_buffer();
-            clear_current_users();
+            advance_current_buffer();
         }
         else
         {
@@ -86,71 +85,119 @@ std::shared_ptr<mg::Buffer> mc::MultiMonitorArbiter::snapshot_acquire()
 void mc::MultiMonitorArbiter::set_schedule(std::shared_ptr<Schedule> const& new_schedule)
 {
     std::lock_guard lk(mutex);
-    schedule = new_schedule;
+    // buffer_ready_for() may still be looking at the old schedule, so never release one
+    if (std::find(schedules.begin(), schedules.end(), new_schedule) == schedules.end())
+        schedules.push_back(new_schedule);
+    schedule.store(new_schedule.get(), std::memory_order_release);
 }
 
 bool mc::MultiMonitorArbiter::buffer_ready_for(mc::CompositorID id)
 {
-    std::lock_guard lk(mutex);
     // If there are scheduled buffers then there is one ready for any compositor
-    if (schedule->num_scheduled() > 0)
-        return true;
-    // If we have a current buffer that the compositor isn't yet using, it is ready
-    else if (current_buffer && !is_user_of_current_buffer(id))
+    if (schedule.load(std::memory_order_acquire)->num_scheduled() > 0)
         return true;
-    // There are no scheduled buffers and either no current buffer, or a current buffer already used by this compositor
-    else
+
+    // Otherwise there is one ready if there is a current buffer that the compositor isn't yet using
+    auto const generation = current_generation.load(std::memory_order_acquire);
+    if (generation == 0)
         return false;
+
+    if (auto const user = user_slot_for(id))
+        return user->generation.load(std::memory_order_acquire) != generation;
+
+    if (has_overflow_users.load(std::memory_order_acquire))
+    {
+        std::lock_guard lk(mutex);
+        return !is_user_of_current_buffer(id);
+    }
+
+    // This compositor has never acquired a buffer
+    return true;
 }
 
 void mc::MultiMonitorArbiter::advance_schedule()
 {
     std::lock_guard lk(mutex);
-    if (schedule->num_scheduled() > 0)
+    if (schedule.load()->num_scheduled() > 0)
     {
-        current_buffer = schedule->next_buffer();
-        clear_current_users();
+        advance_current_buffer();
     } 
 }
 
+void mc::MultiMonitorArbiter::advance_current_buffer()
+{
+    current_buffer = schedule.load()->next_buffer();
+    // Every compositor stops being a user of the current buffer, without touching their slots
+    current_generation.store(current_generation.load() + 1, std::memory_order_release);
+}
+
 void mc::MultiMonitorArbiter::add_current_buffer_user(mc::CompositorID id)
 {
-    // First try and find an empty slot in our vector…
-    for (auto& slot : current_buffer_users)
+    auto const generation = current_generation.load();
+
+    // First try and find this compositor's slot, or claim an empty one…
+    // (a null id would look like an empty slot, so that always goes in the overflow list)
+    for (auto& user : users)
     {
-        if (slot == id)
+        if (!id)
+            break;
+
+        auto const user_id = user.id.load(std::memory_order_relaxed);
+        if (user_id == id)
         {
+            user.generation.store(generation, std::memory_order_release);
             return;
         }
-        else if (!slot)
+        else if (!user_id)
         {
-            slot = id;
+            // Publish the generation before the id, so a reader finding the id sees it
+            user.generation.store(generation, std::memory_order_relaxed);
+            user.id.store(id, std::memory_order_release);
             return;
         }
     }
-    //…no empty slot, so we'll need to grow the vector.
-    current_buffer_users.push_back({id});
+
+    //…no slot to spare, so fall back to the (locked) overflow list.
+    for (auto& user : overflow_users)
+    {
+        if (user.first == id)
+        {
+            user.second = generation;
+            return;
+        }
+    }
+    overflow_users.emplace_back(id, generation);
+    has_overflow_users.store(true, std::memory_order_release);
 }
 
-bool mc::MultiMonitorArbiter::is_user_of_current_buffer(mir::compositor::CompositorID id)
+bool mc::MultiMonitorArbiter::is_user_of_current_buffer(mir::compositor::CompositorID id) const
 {
+    auto const generation = current_generation.load();
+
+    if (auto const user = user_slot_for(id))
+        return user->generation.load() == generation;
+
     return std::any_of(
-        current_buffer_users.begin(),
-        current_buffer_users.end(),
-        [id](auto const& slot)
+        overflow_users.begin(),
+        overflow_users.end(),
+        [id, generation](auto const& user)
         {
-            if (slot)
-            {
-                return *slot == id;
-            }
-            return false;
+            return user.first == id && user.second == generation;
         });
 }
 
-void mc::MultiMonitorArbiter::clear_current_users()
+auto mc::MultiMonitorArbiter::user_slot_for(mc::CompositorID id) const -> User const*
 {
-    for (auto& slot : current_buffer_users)
+    for (auto const& user : users)
     {
-        slot = {};
+        if (!id)
+            break;
+
+        auto const user_id = user.id.load(std::memory_order_acquire);
+        if (user_id == id)
+            return &user;
+        else if (!user_id)
+            break;  // Slots are claimed in order and never released
     }
+    return nullptr;
 }
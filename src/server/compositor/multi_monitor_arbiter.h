@@ -21,10 +21,12 @@
 #include "mir/compositor/compositor_id.h"
 #include "mir/graphics/buffer_id.h"
 #include "buffer_acquisition.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <vector>
-#include <optional>
 
 namespace mir
 {
@@ -33,6 +35,13 @@ namespace compositor
 {
 class Schedule;
 
+/**
+ * Hands the buffers of a Schedule out to the compositors of each output
+ *
+ * Acquiring and advancing are serialised by a mutex, but buffer_ready_for() only reads atomics, so
+ * compositors polling for work never block behind a client submitting a buffer or another compositor
+ * acquiring one.
+ */
 class MultiMonitorArbiter : public BufferAcquisition 
 {
 public:
@@ -42,19 +51,36 @@ public:
 
     std::shared_ptr<graphics::Buffer> compositor_acquire(compositor::CompositorID id) override;
     std::shared_ptr<graphics::Buffer> snapshot_acquire() override;
+    /// Switch to \a schedule; every schedule passed here is kept alive as long as the arbiter
     void set_schedule(std::shared_ptr<Schedule> const& schedule);
     bool buffer_ready_for(compositor::CompositorID id);
     void advance_schedule();
 
 private:
+    /// A compositor, and the generation of the current buffer it last acquired
+    struct User
+    {
+        std::atomic<compositor::CompositorID> id{nullptr};
+        std::atomic<uint64_t> generation{0};
+    };
+
+    void advance_current_buffer();
     void add_current_buffer_user(compositor::CompositorID id);
-    bool is_user_of_current_buffer(compositor::CompositorID id);
-    void clear_current_users();
+    bool is_user_of_current_buffer(compositor::CompositorID id) const;
+    auto user_slot_for(compositor::CompositorID id) const -> User const*;
 
     std::mutex mutable mutex;
     std::shared_ptr<graphics::Buffer> current_buffer;
-    std::vector<std::optional<compositor::CompositorID>> current_buffer_users;
-    std::shared_ptr<Schedule> schedule;
+    /// Bumped each time current_buffer changes; 0 while there is none
+    std::atomic<uint64_t> current_generation{0};
+
+    // We're highly unlikely to have more outputs than this; any more spill into overflow_users
+    std::array<User, 8> users;
+    std::vector<std::pair<compositor::CompositorID, uint64_t>> overflow_users;
+    std::atomic<bool> has_overflow_users{false};
+
+    std::atomic<Schedule*> schedule;
+    std::vector<std::shared_ptr<Schedule>> schedules;
 };
 
 }
@@ -15,7 +15,9 @@
  */
 
 #include "multi_threaded_compositor.h"
+#include "frame_scheduler.h"
 #include "mir/graphics/display.h"
+#include "mir/graphics/display_configuration.h"
 #include "mir/graphics/display_sink.h"
 #include "mir/compositor/display_buffer_compositor.h"
 #include "mir/compositor/display_buffer_compositor_factory.h"
@@ -34,6 +36,7 @@
 #include <thread>
 #include <chrono>
 #include <condition_variable>
+#include <optional>
 #include <boost/throw_exception.hpp>
 
 using namespace std::literals::chrono_literals;
@@ -42,6 +45,47 @@ namespace mc = mir::compositor;
 namespace mg = mir::graphics;
 namespace ms = mir::scene;
 
+namespace
+{
+/**
+ * The refresh interval of the slowest output \a group is showing on, if known
+ *
+ * Outputs in the same group are posted together, so the slowest sets the pace.
+ * An output with variable refresh has no fixed interval: it is paced by content.
+ */
+auto frame_interval_of(mg::DisplaySyncGroup& group, mg::DisplayConfiguration const& config)
+    -> std::optional<std::chrono::steady_clock::duration>
+{
+    std::optional<double> slowest_hz;
+    bool variable_refresh{false};
+    group.for_each_display_sink([&](mg::DisplaySink& sink)
+        {
+            auto const view_area = sink.view_area();
+            config.for_each_output([&](mg::DisplayConfigurationOutput const& output)
+                {
+                    if (!output.used || !output.connected || output.current_mode_index >= output.modes.size())
+                        return;
+
+                    if (!output.extents().overlaps(view_area))
+                        return;
+
+                    if (output.vrr_capable && output.vrr_enabled)
+                        variable_refresh = true;
+
+                    auto const hz = output.modes[output.current_mode_index].vrefresh_hz;
+                    if (hz > 0 && (!slowest_hz || hz < *slowest_hz))
+                        slowest_hz = hz;
+                });
+        });
+
+    if (!slowest_hz || variable_refresh)
+        return std::nullopt;
+
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>{1.0 / *slowest_hz});
+}
+}
+
 namespace mir
 {
 namespace compositor
@@ -56,6 +100,7 @@ public:
         std::shared_ptr<mc::Scene> const& scene,
         std::shared_ptr<DisplayListener> const& display_listener,
         std::chrono::milliseconds fixed_composite_delay,
+        std::optional<FrameScheduler::Clock::duration> frame_interval,
         std::shared_ptr<CompositorReport> const& report) :
         compositor_factory{db_compositor_factory},
         group(group),
@@ -68,6 +113,8 @@ public:
         started_future{started.get_future()},
         stopped_future{stopped.get_future()}
     {
+        if (frame_interval)
+            scheduler.emplace(*frame_interval);
     }
 
     void operator()() noexcept  // noexcept is important! (LP: #1237332)
@@ -107,7 +154,10 @@ public:
             [this,&compositors]
             {
                 for (auto& compositor : compositors)
+                {
                     scene->register_compositor(std::get<1>(compositor).get());
+                    scene->set_compositor_area(std::get<1>(compositor).get(), std::get<0>(compositor)->view_area());
+                }
             },
             [this,&compositors]{
                 for (auto& compositor : compositors)
@@ -116,12 +166,16 @@ public:
 
         started.set_value();
 
+        std::vector<CompositorReport::SubCompositorId> composited;
+        composited.reserve(compositors.size());
+
         try
         {
             std::unique_lock lock{run_mutex};
             while (running)
             {
                 /* Wait until compositing has been scheduled or we are stopped */
+                bool const idle = frames_scheduled <= 0;
                 run_cv.wait(lock, [&]{ return (frames_scheduled > 0) || !running; });
 
                 /*
@@ -141,17 +195,34 @@ public:
                     not_posted_yet = false;
                     lock.unlock();
 
-                    bool needs_post = false;
+                    /*
+                     * Coming out of idle there's no hurry to start work; the frame won't reach
+                     * the screen before the next vblank anyway. Starting just in time for it
+                     * means the frame shows the latest scene.
+                     */
+                    if (idle && scheduler && force_sleep < std::chrono::milliseconds::zero())
+                        std::this_thread::sleep_for(scheduler->delay_before_next_frame(FrameScheduler::Clock::now()));
+
+                    auto const started = FrameScheduler::Clock::now();
+                    composited.clear();
                     for (auto& tuple : compositors)
                     {
                         auto& compositor = std::get<1>(tuple);
+                        report->began_scene_snapshot(compositor.get());
                         if (compositor->composite(scene->scene_elements_for(compositor.get())))
-                            needs_post = true;
+                            composited.push_back(compositor.get());
                     }
 
                     // We can skip the post if none of the compositors ended up compositing
-                    if (needs_post)
+                    if (!composited.empty())
+                    {
+                        auto const posting = FrameScheduler::Clock::now();
                         group.post();
+                        auto const missed_vblanks =
+                            scheduler ? scheduler->frame_posted(started, posting, FrameScheduler::Clock::now()) : 0;
+                        for (auto const id : composited)
+                            report->posted_frame(id, missed_vblanks);
+                    }
 
                     /*
                      * "Predictive bypass" optimization: If the last frame was
@@ -159,10 +230,17 @@ public:
                      * beneficial to sleep for most of the next frame. This reduces
                      * the latency between snapshotting the scene and post()
                      * completing by almost a whole frame.
+                     *
+                     * Where we know the output's refresh rate we work out how long
+                     * from how long frames have actually been taking; otherwise we
+                     * take the display's word for it.
                      */
-                    auto delay = force_sleep >= std::chrono::milliseconds::zero() ?
-                                 force_sleep : group.recommended_sleep();
-                    std::this_thread::sleep_for(delay);
+                    if (force_sleep >= std::chrono::milliseconds::zero())
+                        std::this_thread::sleep_for(force_sleep);
+                    else if (scheduler)
+                        std::this_thread::sleep_for(scheduler->delay_before_next_frame(FrameScheduler::Clock::now()));
+                    else
+                        std::this_thread::sleep_for(group.recommended_sleep());
 
                     lock.lock();
 
@@ -260,6 +338,7 @@ private:
     std::mutex run_mutex;
     std::condition_variable run_cv;
     std::shared_ptr<DisplayListener> const display_listener;
+    std::optional<FrameScheduler> scheduler;
     std::shared_ptr<CompositorReport> const report;
     std::promise<void> started;
     std::future<void> started_future;
@@ -375,12 +454,14 @@ void mc::MultiThreadedCompositor::stop()
 
 void mc::MultiThreadedCompositor::create_compositing_threads()
 {
+    auto const config = display->configuration();
+
     /* Start the display buffer compositing threads */
-    display->for_each_display_sync_group([this](mg::DisplaySyncGroup& group)
+    display->for_each_display_sync_group([this, &config](mg::DisplaySyncGroup& group)
     {
         auto thread_functor = std::make_unique<mc::CompositingFunctor>(
             display_buffer_compositor_factory, group, scene, display_listener,
-            fixed_composite_delay, report);
+            fixed_composite_delay, frame_interval_of(group, *config), report);
 
         mir::thread_pool_executor.spawn(std::ref(*thread_functor));
         thread_functors.push_back(std::move(thread_functor));
@@ -19,6 +19,7 @@
 #include "mir/graphics/renderable.h"
 #include "occlusion.h"
 
+#include <algorithm>
 #include <vector>
 
 using namespace mir::geometry;
@@ -27,37 +28,70 @@ using namespace mir::compositor;
 
 namespace
 {
-bool renderable_is_occluded(
-    Renderable const& renderable, 
+bool is_empty(Rectangle const& rect)
+{
+    return rect.size.width == Width{0} || rect.size.height == Height{0};
+}
+
+/// The parts of \a rect not covered by any of \a coverage
+Rectangles visible_part_of(Rectangle const& rect, Rectangles const& coverage)
+{
+    Rectangles visible{rect};
+    for (auto const& covered : coverage)
+    {
+        visible = difference_of(visible, covered);
+        if (visible.size() == 0)
+            break;
+    }
+    return visible;
+}
+
+/**
+ * The region of \a area that \a renderable may be visible in, given the opaque \a coverage
+ * of everything above it. Opaque parts of \a renderable are added to \a coverage.
+ */
+Rectangles visible_region_of(
+    Renderable const& renderable,
     Rectangle const& area,
-    std::vector<Rectangle>& coverage)
+    Rectangles& coverage)
 {
     static glm::mat4 const identity(1);
-    static Rectangle const empty{};
 
     if (renderable.transformation() != identity)
-        return false;  // Weirdly transformed. Assume never occluded.
+        return Rectangles{area};  // Weirdly transformed. Assume never occluded.
 
-    auto const& window = renderable.screen_position();
-    auto const& clipped_window = intersection_of(window, area);
+    auto drawn_area = intersection_of(renderable.screen_position(), area);
+    if (auto const clip = renderable.clip_area())
+        drawn_area = intersection_of(drawn_area, *clip);
 
-    if (clipped_window == empty)
-        return true;  // Not in the area; definitely occluded.
+    if (is_empty(drawn_area))
+        return {};  // Not in the area; definitely occluded.
 
-    bool occluded = false;
-    for (auto const& r : coverage)
+    auto visible = visible_part_of(drawn_area, coverage);
+
+    if (renderable.alpha() == 1.0f)
     {
-        if (r.contains(clipped_window))
+        if (!renderable.shaped())
         {
-            occluded = true;
-            break;
+            for (auto const& piece : visible)
+                coverage.add(piece);
+        }
+        else
+        {
+            // Only the parts the client has told us are opaque
+            for (auto const& opaque : renderable.opaque_region())
+            {
+                for (auto const& piece : visible)
+                {
+                    auto const covered = intersection_of(piece, opaque);
+                    if (!is_empty(covered))
+                        coverage.add(covered);
+                }
+            }
         }
     }
 
-    if (!occluded && renderable.alpha() == 1.0f && !renderable.shaped())
-        coverage.push_back(clipped_window);
-
-    return occluded;
+    return visible;
 }
 }
 
@@ -65,23 +99,42 @@ SceneElementSequence mir::compositor::filter_occlusions_from(
     SceneElementSequence& elements,
     Rectangle const& area)
 {
-    SceneElementSequence occluded;
-    std::vector<Rectangle> coverage;
+    std::vector<Rectangles> visible_regions;
+    return filter_occlusions_from(elements, area, visible_regions);
+}
 
-    auto it = elements.rbegin();
-    while (it != elements.rend())
+SceneElementSequence mir::compositor::filter_occlusions_from(
+    SceneElementSequence& elements,
+    Rectangle const& area,
+    std::vector<Rectangles>& visible_regions)
+{
+    // Work down from the top of the stack, as only what's above an element can hide it
+    visible_regions.resize(elements.size());
+    Rectangles coverage;
+    for (auto i = elements.size(); i-- != 0;)
+        visible_regions[i] = visible_region_of(*elements[i]->renderable(), area, coverage);
+
+    // Close up the gaps left by the occluded elements in place, so the caller's storage gets reused
+    SceneElementSequence occluded;
+    size_t visible = 0;
+    for (size_t i = 0; i != elements.size(); ++i)
     {
-        auto const renderable = (*it)->renderable();
-        if (renderable_is_occluded(*renderable, area, coverage))
+        if (visible_regions[i].size() == 0)
         {
-            occluded.insert(occluded.begin(), *it);
-            it = SceneElementSequence::reverse_iterator(elements.erase(std::prev(it.base())));
+            occluded.push_back(std::move(elements[i]));
         }
         else
         {
-            it++;
+            if (visible != i)
+            {
+                elements[visible] = std::move(elements[i]);
+                visible_regions[visible] = std::move(visible_regions[i]);
+            }
+            ++visible;
         }
     }
 
+    elements.resize(visible);
+    visible_regions.resize(visible);
     return occluded;
 }
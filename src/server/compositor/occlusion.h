@@ -18,6 +18,9 @@
 #define MIR_COMPOSITOR_OCCLUSION_H_
 
 #include "mir/compositor/scene.h"
+#include "mir/geometry/rectangles.h"
+
+#include <vector>
 
 namespace mir
 {
@@ -26,6 +29,18 @@ namespace compositor
 
 SceneElementSequence filter_occlusions_from(SceneElementSequence& list, geometry::Rectangle const& area);
 
+/**
+ * As above, also reporting which parts of the remaining elements can be seen
+ *
+ * \param [out] visible_regions  Set to the region of \a area in which each element remaining in
+ *                               \a list may be visible, as non-overlapping rectangles. Indices match
+ *                               those of \a list.
+ */
+SceneElementSequence filter_occlusions_from(
+    SceneElementSequence& list,
+    geometry::Rectangle const& area,
+    std::vector<geometry::Rectangles>& visible_regions);
+
 } // namespace compositor
 } // namespace mir
 
@@ -28,12 +28,12 @@ void mc::QueueingSchedule::schedule(std::shared_ptr<graphics::Buffer> const& buf
     if (it != queue.end())
         queue.erase(it);
     queue.emplace_back(buffer);
+    queued.store(queue.size(), std::memory_order_release);
 }
 
 unsigned int mc::QueueingSchedule::num_scheduled()
 {
-    std::lock_guard lk(mutex);
-    return queue.size();
+    return queued.load(std::memory_order_acquire);
 }
 
 std::shared_ptr<mg::Buffer> mc::QueueingSchedule::next_buffer()
@@ -43,5 +43,6 @@ std::shared_ptr<mg::Buffer> mc::QueueingSchedule::next_buffer()
         BOOST_THROW_EXCEPTION(std::logic_error("no buffer scheduled"));
     auto buffer = queue.front();
     queue.pop_front();
+    queued.store(queue.size(), std::memory_order_release);
     return buffer;
 }
@@ -17,6 +17,7 @@
 #ifndef MIR_COMPOSITOR_QUEUEING_SCHEDULE_H_
 #define MIR_COMPOSITOR_QUEUEING_SCHEDULE_H_
 #include "schedule.h"
+#include <atomic>
 #include <memory>
 #include <deque>
 #include <mutex>
@@ -36,6 +37,8 @@ public:
 private:
     std::mutex mutable mutex;
     std::deque<std::shared_ptr<graphics::Buffer>> queue;
+    /// Mirrors queue.size(), so compositors polling for work needn't take the mutex
+    std::atomic<unsigned int> queued{0};
 };
 }
 }
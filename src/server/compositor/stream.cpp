@@ -28,6 +28,19 @@ namespace geom = mir::geometry;
 namespace mg = mir::graphics;
 namespace geom = mir::geometry;
 
+namespace
+{
+auto pack(geom::Size size) -> uint64_t
+{
+    return uint64_t{static_cast<uint32_t>(size.width.as_int())} << 32 | static_cast<uint32_t>(size.height.as_int());
+}
+
+auto unpack(uint64_t packed) -> geom::Size
+{
+    return {static_cast<int32_t>(packed >> 32), static_cast<int32_t>(packed & 0xffffffff)};
+}
+}
+
 enum class mc::Stream::ScheduleMode {
     Queueing,
     Dropping
@@ -36,12 +49,14 @@ enum class mc::Stream::ScheduleMode {
 mc::Stream::Stream(
     geom::Size size, MirPixelFormat pf) :
     schedule_mode(ScheduleMode::Queueing),
-    schedule(std::make_shared<mc::QueueingSchedule>()),
+    queueing_schedule(std::make_shared<mc::QueueingSchedule>()),
+    dropping_schedule(std::make_shared<mc::DroppingSchedule>()),
+    schedule(queueing_schedule),
     arbiter(std::make_shared<mc::MultiMonitorArbiter>(schedule)),
-    latest_buffer_size(size),
+    latest_buffer_size(pack(size)),
     pf(pf),
     first_frame_posted(false),
-    frame_callback{[](auto){}}
+    frame_callback{[](auto, auto){}}
 {
 }
 
@@ -52,16 +67,30 @@ void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer)
     if (!buffer)
         BOOST_THROW_EXCEPTION(std::invalid_argument("cannot submit null buffer"));
 
+    submit_buffer(buffer, geom::Rectangle{{}, buffer->size()});
+}
+
+void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer, geom::Rectangle const& damage)
+{
+    if (!buffer)
+        BOOST_THROW_EXCEPTION(std::invalid_argument("cannot submit null buffer"));
+
+    geom::Rectangle const buffer_rect{{}, buffer->size()};
+    geom::Rectangle effective_damage;
     {
         std::lock_guard lk(mutex);
+        // If the size has changed nothing of the previous content carries over
+        effective_damage = buffer->size() == unpack(latest_buffer_size) ?
+            intersection_of(damage, buffer_rect) :
+            buffer_rect;
         pf = buffer->pixel_format();
-        latest_buffer_size = buffer->size();
+        latest_buffer_size = pack(buffer->size());
         schedule->schedule(buffer);
         first_frame_posted = true;
     }
     {
         std::lock_guard lock{callback_mutex};
-        frame_callback(buffer->size());
+        frame_callback(buffer->size(), effective_damage);
     }
 }
 
@@ -73,12 +102,11 @@ void mc::Stream::with_most_recent_buffer_do(std::function<void(mg::Buffer&)> con
 
 MirPixelFormat mc::Stream::pixel_format() const
 {
-    std::lock_guard lk(mutex);
     return pf;
 }
 
 void mc::Stream::set_frame_posted_callback(
-    std::function<void(geometry::Size const&)> const& callback)
+    std::function<void(geometry::Size const&, geometry::Rectangle const&)> const& callback)
 {
     std::lock_guard lock{callback_mutex};
     frame_callback = callback;
@@ -91,10 +119,11 @@ std::shared_ptr<mg::Buffer> mc::Stream::lock_compositor_buffer(void const* id)
 
 geom::Size mc::Stream::stream_size()
 {
-    std::lock_guard lk(mutex);
+    auto const size = unpack(latest_buffer_size);
+    auto const scale = scale_.load();
     return geom::Size{
-        roundf(latest_buffer_size.width.as_int() / scale_),
-        roundf(latest_buffer_size.height.as_int() / scale_)};
+        roundf(size.width.as_int() / scale),
+        roundf(size.height.as_int() / scale)};
 }
 
 void mc::Stream::allow_framedropping(bool dropping)
@@ -102,12 +131,12 @@ void mc::Stream::allow_framedropping(bool dropping)
     std::lock_guard lk(mutex);
     if (dropping && schedule_mode == ScheduleMode::Queueing)
     {
-        transition_schedule(std::make_shared<mc::DroppingSchedule>(), lk);
+        transition_schedule(dropping_schedule, lk);
         schedule_mode = ScheduleMode::Dropping;
     }
     else if (!dropping && schedule_mode == ScheduleMode::Dropping)
     {
-        transition_schedule(std::make_shared<mc::QueueingSchedule>(), lk);
+        transition_schedule(queueing_schedule, lk);
         schedule_mode = ScheduleMode::Queueing;
     }
 }
@@ -118,7 +147,7 @@ bool mc::Stream::framedropping() const
 }
 
 void mc::Stream::transition_schedule(
-    std::shared_ptr<mc::Schedule>&& new_schedule, std::lock_guard<std::mutex> const&)
+    std::shared_ptr<mc::Schedule> const& new_schedule, std::lock_guard<std::mutex> const&)
 {
     std::vector<std::shared_ptr<mg::Buffer>> transferred_buffers;
     while(schedule->num_scheduled())
@@ -131,7 +160,8 @@ void mc::Stream::transition_schedule(
 
 int mc::Stream::buffers_ready_for_compositor(void const* id) const
 {
-    std::lock_guard lk(mutex);
+    // The arbiter answers this without locking, so compositors polling for work
+    // never wait behind a client submitting a buffer
     if (arbiter->buffer_ready_for(id))
         return 1;
     return 0;
@@ -161,6 +191,5 @@ bool mc::Stream::has_submitted_buffer() const
 
 void mc::Stream::set_scale(float scale)
 {
-    std::lock_guard lk(mutex);
     scale_ = scale;
 }
@@ -22,16 +22,18 @@
 #include "multi_monitor_arbiter.h"
 
 #include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <memory>
 #include <set>
-#include <atomic>
 
 namespace mir
 {
 namespace compositor
 {
 class Schedule;
+class QueueingSchedule;
+class DroppingSchedule;
 class Stream : public BufferStream
 {
 public:
@@ -39,10 +41,11 @@ public:
     ~Stream();
 
     void submit_buffer(std::shared_ptr<graphics::Buffer> const& buffer) override;
+    void submit_buffer(std::shared_ptr<graphics::Buffer> const& buffer, geometry::Rectangle const& damage) override;
     void with_most_recent_buffer_do(std::function<void(graphics::Buffer&)> const& exec) override;
     MirPixelFormat pixel_format() const override;
     void set_frame_posted_callback(
-        std::function<void(geometry::Size const&)> const& callback) override;
+        std::function<void(geometry::Size const&, geometry::Rectangle const&)> const& callback) override;
     std::shared_ptr<graphics::Buffer>
         lock_compositor_buffer(void const* user_id) override;
     geometry::Size stream_size() override;
@@ -55,19 +58,24 @@ public:
 
 private:
     enum class ScheduleMode;
-    void transition_schedule(std::shared_ptr<Schedule>&& new_schedule, std::lock_guard<std::mutex> const&);
+    void transition_schedule(std::shared_ptr<Schedule> const& new_schedule, std::lock_guard<std::mutex> const&);
 
+    // Guards changes of schedule, and submissions against them.
+    // The compositor-facing queries only read atomics, so don't wait on it.
     std::mutex mutable mutex;
-    ScheduleMode schedule_mode;
+    std::atomic<ScheduleMode> schedule_mode;
+    // Both schedules live as long as the stream, so switching never frees one the arbiter is reading
+    std::shared_ptr<QueueingSchedule> const queueing_schedule;
+    std::shared_ptr<DroppingSchedule> const dropping_schedule;
     std::shared_ptr<Schedule> schedule;
     std::shared_ptr<MultiMonitorArbiter> const arbiter;
-    geometry::Size latest_buffer_size;
-    float scale_{1.0f};
-    MirPixelFormat pf;
+    std::atomic<uint64_t> latest_buffer_size;   ///< Packed, as geometry::Size can't be std::atomic
+    std::atomic<float> scale_{1.0f};
+    std::atomic<MirPixelFormat> pf;
     std::atomic<bool> first_frame_posted;
 
     std::mutex callback_mutex;
-    std::function<void(geometry::Size const&)> frame_callback;
+    std::function<void(geometry::Size const&, geometry::Rectangle const&)> frame_callback;
 };
 }
 }
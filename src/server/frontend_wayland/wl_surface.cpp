@@ -39,6 +39,7 @@
 #include "mir/shell/surface_specification.h"
 #include "mir/log.h"
 
+#include <algorithm>
 #include <chrono>
 #include <boost/throw_exception.hpp>
 #include <wayland-server-protocol.h>
@@ -48,6 +49,66 @@ namespace geom = mir::geometry;
 namespace mw = mir::wayland;
 namespace msh = mir::shell;
 
+namespace
+{
+/// Clips a client-supplied rectangle to the buffer. Arithmetic is done at 64 bits as clients commonly post damage of
+/// INT32_MAX width and height to mean "everything"
+auto clip_to_buffer(int64_t x, int64_t y, int64_t width, int64_t height, geom::Size const& buffer_size)
+    -> geom::Rectangle
+{
+    auto const left = std::clamp<int64_t>(x, 0, buffer_size.width.as_int());
+    auto const top = std::clamp<int64_t>(y, 0, buffer_size.height.as_int());
+    auto const right = std::clamp<int64_t>(x + std::max<int64_t>(width, 0), left, buffer_size.width.as_int());
+    auto const bottom = std::clamp<int64_t>(y + std::max<int64_t>(height, 0), top, buffer_size.height.as_int());
+
+    return {
+        geom::Point{static_cast<int>(left), static_cast<int>(top)},
+        geom::Size{static_cast<int>(right - left), static_cast<int>(bottom - top)}};
+}
+
+/// The bounding rectangle, in buffer coordinates, of all the damage posted in state.
+///
+/// A commit without any (visible) damage is treated as damaging the whole buffer: not all clients are careful to post
+/// damage, and the new buffer needs to reach the compositor regardless so that frame callbacks are sent.
+auto damage_in_buffer_coords(mf::WlSurfaceState const& state, int scale, geom::Size const& buffer_size)
+    -> geom::Rectangle
+{
+    geom::Rectangles damage;
+    auto const add_damage = [&](geom::Rectangle const& rect)
+        {
+            if (rect.size.width.as_int() > 0 && rect.size.height.as_int() > 0)
+                damage.add(rect);
+        };
+
+    for (auto const& rect : state.buffer_damage)
+    {
+        add_damage(clip_to_buffer(
+            rect.left().as_int(),
+            rect.top().as_int(),
+            rect.size.width.as_int(),
+            rect.size.height.as_int(),
+            buffer_size));
+    }
+
+    for (auto const& rect : state.surface_damage)
+    {
+        add_damage(clip_to_buffer(
+            int64_t{rect.left().as_int()} * scale,
+            int64_t{rect.top().as_int()} * scale,
+            int64_t{rect.size.width.as_int()} * scale,
+            int64_t{rect.size.height.as_int()} * scale,
+            buffer_size));
+    }
+
+    if (damage.size() == 0)
+    {
+        return {{}, buffer_size};
+    }
+
+    return damage.bounding_rectangle();
+}
+}
+
 mf::WlSurfaceState::Callback::Callback(wl_resource* new_resource)
     : mw::Callback{new_resource, Version<1>()}
 {
@@ -67,10 +128,19 @@ void mf::WlSurfaceState::update_from(WlSurfaceState const& source)
     if (source.input_shape)
         input_shape = source.input_shape;
 
+    if (source.opaque_region)
+        opaque_region = source.opaque_region;
+
     frame_callbacks.insert(end(frame_callbacks),
                            begin(source.frame_callbacks),
                            end(source.frame_callbacks));
 
+    for (auto const& rect : source.surface_damage)
+        surface_damage.add(rect);
+
+    for (auto const& rect : source.buffer_damage)
+        buffer_damage.add(rect);
+
     if (source.surface_data_invalidated)
         surface_data_invalidated = true;
 }
@@ -79,6 +149,7 @@ bool mf::WlSurfaceState::surface_data_needs_refresh() const
 {
     return offset ||
            input_shape ||
+           opaque_region ||
            surface_data_invalidated;
 }
 
@@ -211,7 +282,15 @@ void mf::WlSurface::populate_surface_data(std::vector<shell::StreamSpecification
 {
     geometry::Displacement offset = parent_offset + offset_;
 
-    buffer_streams.push_back(msh::StreamSpecification{stream, offset, {}});
+    geom::Rectangles opaque;
+    for (auto const& rect : opaque_region)
+    {
+        auto const clipped = intersection_of(rect, {{}, buffer_size_.value_or(geom::Size{})});
+        if (clipped.size != geom::Size{})
+            opaque.add(clipped);
+    }
+
+    buffer_streams.push_back(msh::StreamSpecification{stream, offset, {}, std::move(opaque)});
     geom::Rectangle surface_rect = {geom::Point{} + offset, buffer_size_.value_or(geom::Size{})};
     if (input_shape)
     {
@@ -275,20 +354,12 @@ void mf::WlSurface::attach(std::optional<wl_resource*> const& buffer, int32_t x,
 
 void mf::WlSurface::damage(int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    (void)x;
-    (void)y;
-    (void)width;
-    (void)height;
-    // This isn't essential, but could enable optimizations
+    pending.surface_damage.add({{x, y}, {width, height}});
 }
 
 void mf::WlSurface::damage_buffer(int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    (void)x;
-    (void)y;
-    (void)width;
-    (void)height;
-    // This isn't essential, but could enable optimizations
+    pending.buffer_damage.add({{x, y}, {width, height}});
 }
 
 void mf::WlSurface::frame(wl_resource* new_callback)
@@ -299,8 +370,15 @@ void mf::WlSurface::frame(wl_resource* new_callback)
 
 void mf::WlSurface::set_opaque_region(std::optional<wl_resource*> const& region)
 {
-    (void)region;
-    // This isn't essential, but could enable optimizations
+    if (region)
+    {
+        pending.opaque_region = WlRegion::from(region.value())->rectangle_vector();
+    }
+    else
+    {
+        // A null region means nothing is known to be opaque
+        pending.opaque_region = std::vector<geom::Rectangle>{};
+    }
 }
 
 void mf::WlSurface::set_input_region(std::optional<wl_resource*> const& region)
@@ -331,8 +409,14 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
     if (state.input_shape)
         input_shape = state.input_shape.value();
 
+    if (state.opaque_region)
+        opaque_region = state.opaque_region.value();
+
     if (state.scale)
+    {
+        buffer_scale_ = state.scale.value();
         stream->set_scale(state.scale.value());
+    }
 
     auto const executor_send_frame_callbacks = [executor = wayland_executor, weak_self = mw::make_weak(this)]()
         {
@@ -368,13 +452,19 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
                         });
                 };
             std::shared_ptr<graphics::Buffer> mir_buffer;
+            std::optional<geom::Rectangle> damage;
 
             if (auto const shm_buffer = ShmBuffer::from(weak_buffer.value()))
             {
+                auto const shm_data = shm_buffer->data();
+                damage = damage_in_buffer_coords(state, buffer_scale_, shm_data->size());
                 mir_buffer = allocator->buffer_from_shm(
-                    shm_buffer->data(),
+                    shm_data,
+                    last_shm_buffer.lock(),
+                    *damage,
                     std::move(executor_send_frame_callbacks),
                     std::move(release_buffer));
+                last_shm_buffer = mir_buffer;
                 tracepoint(
                     mir_server_wayland,
                     sw_buffer_committed,
@@ -387,6 +477,7 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
                     weak_buffer.value(),
                     std::move(executor_send_frame_callbacks),
                     std::move(release_buffer));
+                last_shm_buffer.reset();
                 tracepoint(
                     mir_server_wayland,
                     hw_buffer_committed,
@@ -394,7 +485,11 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
                     mir_buffer->id().as_value());
             }
 
-            stream->submit_buffer(mir_buffer);
+            if (!damage)
+            {
+                damage = damage_in_buffer_coords(state, buffer_scale_, mir_buffer->size());
+            }
+            stream->submit_buffer(mir_buffer, *damage);
             auto const new_buffer_size = stream->stream_size();
 
             if (std::make_optional(new_buffer_size) != buffer_size_)
@@ -427,6 +522,9 @@ void mf::WlSurface::commit()
     if (pending.input_shape && *pending.input_shape == input_shape)
         pending.input_shape = std::nullopt;
 
+    if (pending.opaque_region && *pending.opaque_region == opaque_region)
+        pending.opaque_region = std::nullopt;
+
     // order is important
     auto const state = std::move(pending);
     pending = WlSurfaceState();
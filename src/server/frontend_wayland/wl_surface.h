@@ -26,6 +26,7 @@
 #include "mir/geometry/size.h"
 #include "mir/geometry/point.h"
 #include "mir/geometry/rectangle.h"
+#include "mir/geometry/rectangles.h"
 
 #include <vector>
 #include <map>
@@ -79,7 +80,13 @@ struct WlSurfaceState
     std::optional<int> scale;
     std::optional<geometry::Displacement> offset;
     std::optional<std::optional<std::vector<geometry::Rectangle>>> input_shape;
+    /// An empty vector means nothing is known to be opaque
+    std::optional<std::vector<geometry::Rectangle>> opaque_region;
     std::vector<wayland::Weak<Callback>> frame_callbacks;
+    /// Damage posted with wl_surface.damage (in surface coordinates)
+    geometry::Rectangles surface_damage;
+    /// Damage posted with wl_surface.damage_buffer (in buffer coordinates)
+    geometry::Rectangles buffer_damage;
 
 private:
     // only set to true if invalidate_surface_data() is called
@@ -154,9 +161,13 @@ private:
 
     WlSurfaceState pending;
     geometry::Displacement offset_;
+    int buffer_scale_{1};
     std::optional<geometry::Size> buffer_size_;
+    /// The last SHM buffer committed, which the next can reuse the texture of
+    std::weak_ptr<graphics::Buffer> last_shm_buffer;
     std::vector<wayland::Weak<WlSurfaceState::Callback>> frame_callbacks;
     std::optional<std::vector<mir::geometry::Rectangle>> input_shape;
+    std::vector<mir::geometry::Rectangle> opaque_region;
     std::vector<SceneSurfaceCreatedCallback> scene_surface_created_callbacks;
 
     void send_frame_callbacks();
@@ -32,6 +32,7 @@
 #include "shm.h"
 
 #include <boost/throw_exception.hpp>
+#include <algorithm>
 #include <mutex>
 #include <optional>
 
@@ -57,6 +58,15 @@ auto translate_and_scale(
     rect.top_left.y = output_space.top_left.y + displacement.dy * y_scale;
     return rect;
 }
+
+/// Damage scaled into buffer space may have lost part of a pixel at each edge, so take those pixels too
+auto padded(geom::Rectangle const& damage, geom::Rectangle const& buffer) -> geom::Rectangle
+{
+    geom::Rectangle const grown{
+        damage.top_left - geom::Displacement{1, 1},
+        geom::Size{damage.size.width + geom::DeltaX{2}, damage.size.height + geom::DeltaY{2}}};
+    return intersection_of(grown, buffer);
+}
 }
 
 class mf::WlrScreencopyV1DamageTracker::Area
@@ -120,6 +130,12 @@ public:
 
     void capture_on_damage(WlrScreencopyV1DamageTracker::Frame* frame);
 
+    /// Whether \a buffer holds the most recent capture made with \a params
+    auto holds_last_capture(WlrScreencopyV1DamageTracker::FrameParams const& params, ShmBuffer const& buffer) const
+        -> bool;
+    /// Note that \a buffer has been captured into with \a params (or, if that failed, now holds who knows what)
+    void captured_into(WlrScreencopyV1DamageTracker::FrameParams const& params, ShmBuffer& buffer, bool succeeded);
+
 private:
     /// From wayland::WlrScreencopyManagerV1
     /// @{
@@ -134,6 +150,14 @@ private:
 
     std::shared_ptr<WlrScreencopyV1Ctx> const ctx;
     WlrScreencopyV1DamageTracker damage_tracker;
+
+    /// Buffers a client reuses only need the damage since their last capture copied into them
+    struct LastCapture
+    {
+        WlrScreencopyV1DamageTracker::FrameParams params;
+        wayland::Weak<ShmBuffer> buffer;
+    };
+    std::vector<LastCapture> last_captures;
 };
 
 class WlrScreencopyFrameV1
@@ -174,6 +198,7 @@ private:
     bool copy_has_been_called{false};
     bool should_send_damage{false};
     std::shared_ptr<renderer::software::WriteMappableBuffer> target;
+    wayland::Weak<ShmBuffer> target_buffer;
     /// @}
 };
 }
@@ -370,6 +395,32 @@ void mf::WlrScreencopyManagerV1::capture_on_damage(WlrScreencopyV1DamageTracker:
     damage_tracker.capture_on_damage(frame);
 }
 
+auto mf::WlrScreencopyManagerV1::holds_last_capture(
+    WlrScreencopyV1DamageTracker::FrameParams const& params,
+    ShmBuffer const& buffer) const -> bool
+{
+    return std::any_of(
+        begin(last_captures),
+        end(last_captures),
+        [&](auto const& capture){ return capture.params == params && capture.buffer.is(buffer); });
+}
+
+void mf::WlrScreencopyManagerV1::captured_into(
+    WlrScreencopyV1DamageTracker::FrameParams const& params,
+    ShmBuffer& buffer,
+    bool succeeded)
+{
+    // Any buffer that held the last capture with these params doesn't any more, nor does this hold its old capture
+    std::erase_if(
+        last_captures,
+        [&](auto const& capture){ return !capture.buffer || capture.params == params || capture.buffer.is(buffer); });
+
+    if (succeeded)
+    {
+        last_captures.push_back({params, mw::make_weak(&buffer)});
+    }
+}
+
 void mf::WlrScreencopyManagerV1::capture_output(
     wl_resource* frame,
     int32_t overlay_cursor,
@@ -425,7 +476,7 @@ void mf::WlrScreencopyFrameV1::capture(geom::Rectangle buffer_space_damage)
             "WlrScreencopyFrameV1::capture() called without a target, copy %s been called",
             copy_has_been_called ? "has" : "has not");
     }
-    ctx->screen_shooter->capture(std::move(target), params.output_space_area,
+    auto callback =
         [wayland_executor=ctx->wayland_executor, buffer_space_damage, self=mw::make_weak(this)]
             (std::optional<time::Timestamp> captured_time)
         {
@@ -436,7 +487,23 @@ void mf::WlrScreencopyFrameV1::capture(geom::Rectangle buffer_space_damage)
                         self.value().report_result(captured_time, buffer_space_damage);
                     }
                 });
-        });
+        };
+
+    auto const whole_buffer = params.full_buffer_space_damage();
+    if (buffer_space_damage != whole_buffer &&
+        manager && target_buffer && manager.value().holds_last_capture(params, target_buffer.value()))
+    {
+        // The client is reusing the buffer it got last time, so only what's changed needs copying
+        ctx->screen_shooter->capture_with_damage(
+            std::move(target),
+            params.output_space_area,
+            padded(buffer_space_damage, whole_buffer),
+            std::move(callback));
+    }
+    else
+    {
+        ctx->screen_shooter->capture(std::move(target), params.output_space_area, std::move(callback));
+    }
 }
 
 void mf::WlrScreencopyFrameV1::prepare_target(wl_resource* buffer)
@@ -457,6 +524,7 @@ void mf::WlrScreencopyFrameV1::prepare_target(wl_resource* buffer)
             Error::invalid_buffer,
             "Copy target is not a wl_shm buffer"));
     }
+    target_buffer = mw::make_weak(shm_buffer);
     auto shm_data = shm_buffer->data();
     if (shm_data->format() != mir_pixel_format_argb_8888)
     {
@@ -508,6 +576,11 @@ void mf::WlrScreencopyFrameV1::report_result(
     std::optional<time::Timestamp> captured_time,
     geom::Rectangle buffer_space_damage)
 {
+    if (manager && target_buffer)
+    {
+        manager.value().captured_into(params, target_buffer.value(), captured_time.has_value());
+    }
+
     if (captured_time)
     {
         send_flags_event(Flags::y_invert);
@@ -30,7 +30,15 @@ void mf::ScaledBufferStream::submit_buffer(std::shared_ptr<graphics::Buffer> con
     inner->submit_buffer(buffer);
 }
 
-void mf::ScaledBufferStream::set_frame_posted_callback(std::function<void(geometry::Size const&)> const& callback)
+void mf::ScaledBufferStream::submit_buffer(
+    std::shared_ptr<graphics::Buffer> const& buffer,
+    geometry::Rectangle const& damage)
+{
+    inner->submit_buffer(buffer, damage);
+}
+
+void mf::ScaledBufferStream::set_frame_posted_callback(
+    std::function<void(geometry::Size const&, geometry::Rectangle const&)> const& callback)
 {
     // Does this need to be scaled? I don't ? think ? so? compositor::Stream seems to leave it unscaled.
     inner->set_frame_posted_callback(callback);
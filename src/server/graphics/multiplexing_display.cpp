@@ -89,6 +89,7 @@ public:
                     output.gamma = mutable_output.gamma;
                     output.custom_logical_size = mutable_output.custom_logical_size;
                     output.custom_attribute = std::move(mutable_output.custom_attribute);
+                    output.vrr_enabled = mutable_output.vrr_enabled;
                 });
         }
     }
@@ -49,6 +49,10 @@ void mrl::CompositorReport::added_display(int width, int height, int x, int y, S
     logger->log(ml::Severity::informational, msg, component);
 }
 
+void mrl::CompositorReport::began_scene_snapshot(SubCompositorId)
+{
+}
+
 void mrl::CompositorReport::began_frame(SubCompositorId id)
 {
     std::lock_guard lock(mutex);
@@ -60,6 +64,10 @@ void mrl::CompositorReport::began_frame(SubCompositorId id)
     inst.bypassed = true;
 }
 
+void mrl::CompositorReport::filtered_occlusions(SubCompositorId)
+{
+}
+
 void mrl::CompositorReport::renderables_in_frame(SubCompositorId, mir::graphics::RenderableList const&)
 {
 }
@@ -164,6 +172,10 @@ void mrl::CompositorReport::finished_frame(SubCompositorId id)
     inst.prev_bypassed = inst.bypassed;
 }
 
+void mrl::CompositorReport::posted_frame(SubCompositorId, int)
+{
+}
+
 void mrl::CompositorReport::started()
 {
     logger->log(ml::Severity::informational, "Started", component);
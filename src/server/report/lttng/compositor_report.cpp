@@ -36,11 +36,21 @@ void mir::report::lttng::CompositorReport::added_display(int width, int height,
     mir_tracepoint(mir_server_compositor, added_display, width, height, x, y, id);
 }
 
+void mir::report::lttng::CompositorReport::began_scene_snapshot(SubCompositorId id)
+{
+    mir_tracepoint(mir_server_compositor, began_scene_snapshot, id);
+}
+
 void mir::report::lttng::CompositorReport::began_frame(SubCompositorId id)
 {
     mir_tracepoint(mir_server_compositor, began_frame, id);
 }
 
+void mir::report::lttng::CompositorReport::filtered_occlusions(SubCompositorId id)
+{
+    mir_tracepoint(mir_server_compositor, filtered_occlusions, id);
+}
+
 void mir::report::lttng::CompositorReport::renderables_in_frame(
     SubCompositorId id, graphics::RenderableList const& list)
 {
@@ -60,3 +70,8 @@ void mir::report::lttng::CompositorReport::finished_frame(SubCompositorId id)
 {
     mir_tracepoint(mir_server_compositor, finished_frame, id);
 }
+
+void mir::report::lttng::CompositorReport::posted_frame(SubCompositorId id, int missed_vblanks)
+{
+    mir_tracepoint(mir_server_compositor, posted_frame, id, missed_vblanks);
+}
@@ -34,10 +34,13 @@ public:
     CompositorReport() = default;
     virtual ~CompositorReport() = default;
     void added_display(int width, int height, int x, int y, SubCompositorId id) override;
+    void began_scene_snapshot(SubCompositorId id) override;
     void began_frame(SubCompositorId id) override;
+    void filtered_occlusions(SubCompositorId id) override;
     void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) override;
     void rendered_frame(SubCompositorId id) override;
     void finished_frame(SubCompositorId id) override;
+    void posted_frame(SubCompositorId id, int missed_vblanks) override;
     void started() override;
     void stopped() override;
     void scheduled() override;
@@ -57,6 +57,13 @@ TRACEPOINT_EVENT_CLASS(
     )
 )
 
+TRACEPOINT_EVENT_INSTANCE(
+    mir_server_compositor,
+    subcompositor_event,
+    began_scene_snapshot,
+    TP_ARGS(void const*, id)
+)
+
 TRACEPOINT_EVENT_INSTANCE(
     mir_server_compositor,
     subcompositor_event,
@@ -64,6 +71,13 @@ TRACEPOINT_EVENT_INSTANCE(
     TP_ARGS(void const*, id)
 )
 
+TRACEPOINT_EVENT_INSTANCE(
+    mir_server_compositor,
+    subcompositor_event,
+    filtered_occlusions,
+    TP_ARGS(void const*, id)
+)
+
 TRACEPOINT_EVENT_INSTANCE(
     mir_server_compositor,
     subcompositor_event,
@@ -78,6 +92,16 @@ TRACEPOINT_EVENT_INSTANCE(
     TP_ARGS(void const*, id)
 )
 
+TRACEPOINT_EVENT(
+    mir_server_compositor,
+    posted_frame,
+    TP_ARGS(void const*, id, int, missed_vblanks),
+    TP_FIELDS(
+        ctf_integer_hex(uintptr_t, id, (uintptr_t)(id))
+        ctf_integer(int, missed_vblanks, missed_vblanks)
+    )
+)
+
 TRACEPOINT_EVENT(
     mir_server_compositor,
     buffers_in_frame,
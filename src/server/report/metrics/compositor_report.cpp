@@ -0,0 +1,380 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "compositor_report.h"
+
+#include "mir/executor.h"
+#include "mir/log.h"
+
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+
+namespace mrm = mir::report::metrics;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto const export_interval = 1s;
+
+auto as_usec(mir::time::Duration duration) -> uint64_t
+{
+    auto const usec = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    return usec > 0 ? usec : 0;
+}
+
+/// Microseconds as seconds, without going through floating point
+void write_seconds(std::ostream& out, uint64_t usec)
+{
+    out << usec / 1000000 << '.' << std::setw(6) << std::setfill('0') << usec % 1000000;
+}
+
+void write_header(std::ostream& out, char const* name, char const* type, char const* help)
+{
+    out << "# HELP " << name << ' ' << help << '\n'
+        << "# TYPE " << name << ' ' << type << '\n';
+}
+}
+
+struct mrm::CompositorReport::ExportState
+{
+    std::atomic<bool> busy{false};
+    std::atomic<bool> warned{false};
+};
+
+void mrm::CompositorReport::Histogram::observe(time::Duration duration)
+{
+    auto const usec = as_usec(duration);
+    auto const bucket = usec <= 64 ? 0 : std::min<size_t>(std::bit_width((usec - 1) >> 6), buckets - 1);
+
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_usec.fetch_add(usec, std::memory_order_relaxed);
+}
+
+void mrm::CompositorReport::Histogram::reset()
+{
+    for (auto& count : counts)
+        count = 0;
+    sum_usec = 0;
+}
+
+void mrm::CompositorReport::Histogram::write(std::ostream& out, char const* name, std::string const& labels) const
+{
+    uint64_t cumulative{0};
+    for (size_t i = 0; i != buckets - 1; ++i)
+    {
+        cumulative += counts[i].load(std::memory_order_relaxed);
+        out << name << "_bucket{" << labels << ",le=\"";
+        write_seconds(out, uint64_t{64} << i);
+        out << "\"} " << cumulative << '\n';
+    }
+    cumulative += counts[buckets - 1].load(std::memory_order_relaxed);
+    out << name << "_bucket{" << labels << ",le=\"+Inf\"} " << cumulative << '\n';
+
+    out << name << "_sum{" << labels << "} ";
+    write_seconds(out, sum_usec.load(std::memory_order_relaxed));
+    out << '\n' << name << "_count{" << labels << "} " << cumulative << '\n';
+}
+
+void mrm::CompositorReport::Output::reset()
+{
+    for (auto histogram : {&scene_snapshot, &occlusion, &render, &post, &latency})
+        histogram->reset();
+    frames = 0;
+    bypassed_frames = 0;
+    missed_vblanks = 0;
+
+    snapshot_started = {};
+    scheduled = {};
+    frame_started = {};
+    occlusions_filtered = {};
+    frame_finished = {};
+    bypassed = false;
+}
+
+mrm::CompositorReport::CompositorReport(
+    std::shared_ptr<compositor::CompositorReport> const& wrapped,
+    std::string const& filename,
+    std::shared_ptr<time::Clock> const& clock,
+    Executor& exporter) :
+    wrapped{wrapped},
+    filename{filename},
+    clock{clock},
+    exporter{exporter},
+    export_state{std::make_shared<ExportState>()}
+{
+}
+
+auto mrm::CompositorReport::output_for(SubCompositorId id) -> Output*
+{
+    for (auto& output : outputs)
+    {
+        if (output.id.load(std::memory_order_relaxed) == id)
+            return output.ready.load(std::memory_order_acquire) ? &output : nullptr;
+    }
+    return nullptr;
+}
+
+void mrm::CompositorReport::added_display(int width, int height, int x, int y, SubCompositorId id)
+{
+    wrapped->added_display(width, height, x, y, id);
+
+    for (size_t i = 0; i != outputs.size(); ++i)
+    {
+        auto& output = outputs[i];
+        SubCompositorId unused{nullptr};
+        if (output.id.compare_exchange_strong(unused, id))
+        {
+            std::ostringstream label;
+            label << "output=\"" << i << "\",area=\"" << width << 'x' << height
+                  << std::showpos << x << y << '"';
+
+            std::lock_guard lock{labels_mutex};
+            output.label = label.str();
+            output.reset();
+            output.ready.store(true, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+void mrm::CompositorReport::began_scene_snapshot(SubCompositorId id)
+{
+    wrapped->began_scene_snapshot(id);
+
+    if (auto const output = output_for(id))
+    {
+        output->snapshot_started = clock->now();
+        output->scheduled = last_scheduled.load(std::memory_order_relaxed);
+    }
+}
+
+void mrm::CompositorReport::began_frame(SubCompositorId id)
+{
+    wrapped->began_frame(id);
+
+    if (auto const output = output_for(id))
+    {
+        auto const now = clock->now();
+        if (output->snapshot_started != time::Timestamp{})
+            output->scene_snapshot.observe(now - output->snapshot_started);
+        output->frame_started = now;
+        output->bypassed = true;
+    }
+}
+
+void mrm::CompositorReport::filtered_occlusions(SubCompositorId id)
+{
+    wrapped->filtered_occlusions(id);
+
+    if (auto const output = output_for(id))
+    {
+        auto const now = clock->now();
+        output->occlusion.observe(now - output->frame_started);
+        output->occlusions_filtered = now;
+    }
+}
+
+void mrm::CompositorReport::renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables)
+{
+    wrapped->renderables_in_frame(id, renderables);
+}
+
+void mrm::CompositorReport::rendered_frame(SubCompositorId id)
+{
+    wrapped->rendered_frame(id);
+
+    if (auto const output = output_for(id))
+    {
+        output->render.observe(clock->now() - output->occlusions_filtered);
+        output->bypassed = false;
+    }
+}
+
+void mrm::CompositorReport::finished_frame(SubCompositorId id)
+{
+    wrapped->finished_frame(id);
+
+    if (auto const output = output_for(id))
+    {
+        output->frame_finished = clock->now();
+        output->frames.fetch_add(1, std::memory_order_relaxed);
+        if (output->bypassed)
+            output->bypassed_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void mrm::CompositorReport::posted_frame(SubCompositorId id, int missed_vblanks)
+{
+    wrapped->posted_frame(id, missed_vblanks);
+
+    if (auto const output = output_for(id))
+    {
+        auto const now = clock->now();
+        output->post.observe(now - output->frame_finished);
+        if (output->scheduled != time::Timestamp{})
+            output->latency.observe(now - output->scheduled);
+        if (missed_vblanks > 0)
+            output->missed_vblanks.fetch_add(missed_vblanks, std::memory_order_relaxed);
+
+        export_metrics(now);
+    }
+}
+
+void mrm::CompositorReport::started()
+{
+    wrapped->started();
+}
+
+void mrm::CompositorReport::stopped()
+{
+    wrapped->stopped();
+
+    // The compositing threads are gone, and new ones will add their displays afresh
+    std::lock_guard lock{labels_mutex};
+    for (auto& output : outputs)
+    {
+        output.ready = false;
+        output.id = nullptr;
+    }
+}
+
+void mrm::CompositorReport::scheduled()
+{
+    wrapped->scheduled();
+
+    last_scheduled.store(clock->now(), std::memory_order_relaxed);
+}
+
+void mrm::CompositorReport::write_metrics(std::ostream& out) const
+{
+    struct HistogramFamily
+    {
+        char const* name;
+        char const* help;
+        Histogram Output::* histogram;
+    };
+    static HistogramFamily const histograms[]{
+        {"mir_compositor_scene_snapshot_seconds",
+         "Time taken to snapshot the scene for a frame",
+         &Output::scene_snapshot},
+        {"mir_compositor_occlusion_seconds",
+         "Time taken to filter occluded elements out of a frame",
+         &Output::occlusion},
+        {"mir_compositor_render_seconds",
+         "Time taken to render a frame that could not be bypassed",
+         &Output::render},
+        {"mir_compositor_post_seconds",
+         "Time from a frame being finished to it being posted to the display",
+         &Output::post},
+        {"mir_compositor_latency_seconds",
+         "Time from the scene changing to a frame showing it being posted to the display",
+         &Output::latency},
+    };
+
+    struct CounterFamily
+    {
+        char const* name;
+        char const* help;
+        std::atomic<uint64_t> Output::* counter;
+    };
+    static CounterFamily const counters[]{
+        {"mir_compositor_frames_total", "Frames composited", &Output::frames},
+        {"mir_compositor_bypassed_frames_total", "Frames posted without rendering", &Output::bypassed_frames},
+        {"mir_compositor_missed_vblanks_total", "Vblanks missed by frames posted late", &Output::missed_vblanks},
+    };
+
+    // Displays can be added (and labels rewritten) while we're writing, so work from a copy
+    std::array<std::optional<std::string>, max_outputs> labels;
+    {
+        std::lock_guard lock{labels_mutex};
+        for (size_t i = 0; i != outputs.size(); ++i)
+        {
+            if (outputs[i].ready.load(std::memory_order_acquire))
+                labels[i] = outputs[i].label;
+        }
+    }
+
+    for (auto const& family : histograms)
+    {
+        write_header(out, family.name, "histogram", family.help);
+        for (size_t i = 0; i != outputs.size(); ++i)
+        {
+            if (labels[i])
+                (outputs[i].*family.histogram).write(out, family.name, *labels[i]);
+        }
+    }
+
+    for (auto const& family : counters)
+    {
+        write_header(out, family.name, "counter", family.help);
+        for (size_t i = 0; i != outputs.size(); ++i)
+        {
+            if (labels[i])
+            {
+                out << family.name << '{' << *labels[i] << "} "
+                    << (outputs[i].*family.counter).load(std::memory_order_relaxed) << '\n';
+            }
+        }
+    }
+}
+
+void mrm::CompositorReport::export_metrics(time::Timestamp now)
+{
+    auto last = last_export.load();
+    if (now - last < export_interval || !last_export.compare_exchange_strong(last, now))
+        return;
+
+    // If the last export is still being written there's no point piling up more behind it
+    if (export_state->busy.exchange(true))
+        return;
+
+    std::ostringstream metrics;
+    write_metrics(metrics);
+
+    exporter.spawn(
+        [state = export_state, filename = filename, metrics = metrics.str()]
+        {
+            // Write alongside and rename, so readers never see a partly written file
+            auto const temporary = filename + ".new";
+            bool written;
+            {
+                std::ofstream file{temporary, std::ios::trunc};
+                file << metrics;
+                file.close();
+                written = !file.fail() && std::rename(temporary.c_str(), filename.c_str()) == 0;
+            }
+
+            if (written)
+            {
+                state->warned = false;
+            }
+            else if (!state->warned.exchange(true))
+            {
+                mir::log_warning(
+                    "Failed to write compositor metrics to %s: %s", filename.c_str(), std::strerror(errno));
+            }
+
+            state->busy = false;
+        });
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MIR_REPORT_METRICS_COMPOSITOR_REPORT_H_
+#define MIR_REPORT_METRICS_COMPOSITOR_REPORT_H_
+
+#include "mir/compositor/compositor_report.h"
+#include "mir/time/clock.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace mir
+{
+class Executor;
+
+namespace report
+{
+namespace metrics
+{
+
+/**
+ * Collects frame timing metrics for each output, passing all events on to another report
+ *
+ * Per-stage timings are kept in histograms which, with frame and missed vblank counts, are
+ * written to a file in the Prometheus text format about once a second. That's cheap enough to
+ * leave on in production and alert on dropped frames, without having to attach a tracer.
+ *
+ * Each output's metrics are only updated from its own compositing thread, so recording them is
+ * lock-free and never blocks compositing. Writing the file is left to \a exporter; output labels
+ * are only locked to take a copy of them for it, and when displays come and go.
+ */
+class CompositorReport : public compositor::CompositorReport
+{
+public:
+    CompositorReport(
+        std::shared_ptr<compositor::CompositorReport> const& wrapped,
+        std::string const& filename,
+        std::shared_ptr<time::Clock> const& clock,
+        Executor& exporter);
+
+    void added_display(int width, int height, int x, int y, SubCompositorId id) override;
+    void began_scene_snapshot(SubCompositorId id) override;
+    void began_frame(SubCompositorId id) override;
+    void filtered_occlusions(SubCompositorId id) override;
+    void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) override;
+    void rendered_frame(SubCompositorId id) override;
+    void finished_frame(SubCompositorId id) override;
+    void posted_frame(SubCompositorId id, int missed_vblanks) override;
+    void started() override;
+    void stopped() override;
+    void scheduled() override;
+
+    /// Write the current metrics in the Prometheus text exposition format
+    void write_metrics(std::ostream& out) const;
+
+    /// Outputs beyond this many are passed on, but don't have metrics collected
+    static size_t constexpr max_outputs = 16;
+
+private:
+    /// Counts of durations in buckets of up to 64µs, 128µs, 256µs... and a final unbounded one
+    class Histogram
+    {
+    public:
+        static size_t constexpr buckets = 13;
+
+        void observe(time::Duration duration);
+        void reset();
+        void write(std::ostream& out, char const* name, std::string const& labels) const;
+
+    private:
+        std::array<std::atomic<uint64_t>, buckets> counts{};
+        std::atomic<uint64_t> sum_usec{0};
+    };
+
+    struct Output
+    {
+        std::atomic<SubCompositorId> id{nullptr};
+        std::atomic<bool> ready{false};  ///< label is set, and metrics are being collected
+        std::string label;               ///< Guarded by labels_mutex
+
+        Histogram scene_snapshot;
+        Histogram occlusion;
+        Histogram render;
+        Histogram post;
+        Histogram latency;
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> bypassed_frames{0};
+        std::atomic<uint64_t> missed_vblanks{0};
+
+        // Only touched by the output's compositing thread
+        time::Timestamp snapshot_started;
+        time::Timestamp scheduled;
+        time::Timestamp frame_started;
+        time::Timestamp occlusions_filtered;
+        time::Timestamp frame_finished;
+        bool bypassed{false};
+
+        void reset();
+    };
+
+    auto output_for(SubCompositorId id) -> Output*;
+    void export_metrics(time::Timestamp now);
+
+    std::shared_ptr<compositor::CompositorReport> const wrapped;
+    std::string const filename;
+    std::shared_ptr<time::Clock> const clock;
+    Executor& exporter;
+
+    std::mutex mutable labels_mutex;
+    std::array<Output, max_outputs> outputs;
+    std::atomic<time::Timestamp> last_scheduled{};
+    std::atomic<time::Timestamp> last_export{};
+
+    struct ExportState;
+    std::shared_ptr<ExportState> const export_state;
+};
+
+} // namespace metrics
+} // namespace report
+} // namespace mir
+
+#endif // MIR_REPORT_METRICS_COMPOSITOR_REPORT_H_
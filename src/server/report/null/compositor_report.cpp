@@ -22,10 +22,18 @@ void mrn::CompositorReport::added_display(int, int, int, int, SubCompositorId)
 {
 }
 
+void mrn::CompositorReport::began_scene_snapshot(SubCompositorId)
+{
+}
+
 void mrn::CompositorReport::began_frame(SubCompositorId)
 {
 }
 
+void mrn::CompositorReport::filtered_occlusions(SubCompositorId)
+{
+}
+
 void mrn::CompositorReport::renderables_in_frame(SubCompositorId, mir::graphics::RenderableList const&)
 {
 }
@@ -38,6 +46,10 @@ void mrn::CompositorReport::finished_frame(SubCompositorId)
 {
 }
 
+void mrn::CompositorReport::posted_frame(SubCompositorId, int)
+{
+}
+
 void mrn::CompositorReport::started()
 {
 }
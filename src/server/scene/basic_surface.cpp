@@ -31,6 +31,7 @@
 
 #include <stdexcept>
 #include <algorithm>
+#include <cmath>
 
 namespace mc = mir::compositor;
 namespace ms = mir::scene;
@@ -152,6 +153,28 @@ std::shared_ptr<mc::BufferStream> default_stream(std::list<ms::StreamInfo> const
         return layers.front().stream;
 }
 
+/// Maps damage in buffer coordinates onto the logical rectangle the buffer is displayed in, rounding outwards
+auto buffer_damage_to_logical(
+    geom::Rectangle const& damage,
+    geom::Size const& buffer_size,
+    geom::Rectangle const& logical) -> geom::Rectangle
+{
+    if (buffer_size.width.as_int() <= 0 || buffer_size.height.as_int() <= 0 ||
+        logical.size.width.as_int() <= 0 || logical.size.height.as_int() <= 0)
+        return logical;
+
+    auto const x_scale = logical.size.width.as_int() / static_cast<double>(buffer_size.width.as_int());
+    auto const y_scale = logical.size.height.as_int() / static_cast<double>(buffer_size.height.as_int());
+
+    auto const left = static_cast<int>(std::floor(damage.left().as_int() * x_scale));
+    auto const top = static_cast<int>(std::floor(damage.top().as_int() * y_scale));
+    auto const right = static_cast<int>(std::ceil(damage.right().as_int() * x_scale));
+    auto const bottom = static_cast<int>(std::ceil(damage.bottom().as_int() * y_scale));
+
+    return intersection_of(
+        geom::Rectangle{logical.top_left + geom::Displacement{left, top}, geom::Size{right - left, bottom - top}},
+        logical);
+}
 }
 
 ms::BasicSurface::BasicSurface(
@@ -274,7 +297,16 @@ std::shared_ptr<mf::BufferStream> ms::BasicSurface::primary_buffer_stream() cons
 
 void ms::BasicSurface::set_input_region(std::vector<geom::Rectangle> const& input_rectangles)
 {
-    synchronised_state.lock()->custom_input_rectangles = input_rectangles;
+    geom::Point surface_top_left;
+    {
+        auto state = synchronised_state.lock();
+        if (state->custom_input_rectangles == input_rectangles)
+            return;
+        state->custom_input_rectangles = input_rectangles;
+        surface_top_left = state->surface_rect.top_left;
+    }
+    // As with set_streams(), the area the surface covers may have changed
+    observers->moved_to(this, surface_top_left);
 }
 
 std::vector<geom::Rectangle> ms::BasicSurface::get_input_region() const
@@ -683,6 +715,7 @@ public:
         std::optional<geom::Rectangle> const& clip_area,
         glm::mat4 const& transform,
         float alpha,
+        geom::Rectangles const& opaque_region,
         mg::Renderable::ID id)
     : underlying_buffer_stream{stream},
       compositor_id{compositor_id},
@@ -690,6 +723,7 @@ public:
       screen_position_(position),
       clip_area_(clip_area),
       transformation_(transform),
+      opaque_region_(opaque_region),
       id_(id)
     {
     }
@@ -720,6 +754,9 @@ public:
     bool shaped() const override
     { return mg::contains_alpha(underlying_buffer_stream->pixel_format()); }
 
+    geom::Rectangles opaque_region() const override
+    { return opaque_region_; }
+
     mg::Renderable::ID id() const override
     { return id_; }
 private:
@@ -730,6 +767,7 @@ private:
     geom::Rectangle const screen_position_;
     std::optional<geom::Rectangle> const clip_area_;
     glm::mat4 const transformation_;
+    geom::Rectangles const opaque_region_;
     mg::Renderable::ID const id_;
 };
 }
@@ -797,11 +835,23 @@ mg::RenderableList ms::BasicSurface::generate_renderables(mc::CompositorID id) c
             else
                 size = info.stream->stream_size();
 
+            geom::Rectangle const position{content_top_left_ + info.displacement, std::move(size)};
+
+            geom::Rectangles opaque_region;
+            for (auto const& opaque : info.opaque_region)
+            {
+                auto const on_screen = intersection_of(
+                    geom::Rectangle{opaque.top_left + as_displacement(position.top_left), opaque.size},
+                    position);
+                if (on_screen.size != geom::Size{})
+                    opaque_region.add(on_screen);
+            }
+
             list.emplace_back(std::make_shared<SurfaceSnapshot>(
                 info.stream, id,
-                geom::Rectangle{content_top_left_ + info.displacement, std::move(size)},
+                position,
                 state->clip_area,
-                state->transformation_matrix, state->surface_alpha, info.stream.get()));
+                state->transformation_matrix, state->surface_alpha, opaque_region, info.stream.get()));
         }
     }
     return list;
@@ -945,7 +995,7 @@ void mir::scene::BasicSurface::clear_frame_posted_callbacks(State& state)
 {
     for (auto& layer : state.layers)
     {
-        layer.stream->set_frame_posted_callback([](auto){});
+        layer.stream->set_frame_posted_callback([](auto, auto){});
     }
 }
 
@@ -956,12 +1006,15 @@ void mir::scene::BasicSurface::update_frame_posted_callbacks(State& state)
         auto const position = geom::Point{} + state.margins.left + state.margins.top + layer.displacement;
         layer.stream->set_frame_posted_callback(
             [this, observers=std::weak_ptr{observers}, position, explicit_size=layer.size, stream=layer.stream.get()]
-                (auto const&)
+                (geom::Size const& buffer_size, geom::Rectangle const& damage)
             {
                 auto const logical_size = explicit_size ? explicit_size.value() : stream->stream_size();
                 if (auto const o = observers.lock())
                 {
-                    o->frame_posted(this, 1, geom::Rectangle{position, logical_size});
+                    o->frame_posted(
+                        this,
+                        1,
+                        buffer_damage_to_logical(damage, buffer_size, geom::Rectangle{position, logical_size}));
                 }
             });
     }
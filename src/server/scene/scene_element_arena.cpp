@@ -0,0 +1,67 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scene_element_arena.h"
+
+#include <new>
+
+namespace ms = mir::scene;
+
+ms::SceneElementArena::~SceneElementArena()
+{
+    while (free_blocks)
+    {
+        auto const block = free_blocks;
+        free_blocks = block->next;
+        ::operator delete(block);
+    }
+}
+
+auto ms::SceneElementArena::allocate(std::size_t size) -> void*
+{
+    if (size > block_size)
+        return ::operator new(size);
+
+    {
+        std::lock_guard lock{mutex};
+        if (auto const block = free_blocks)
+        {
+            free_blocks = block->next;
+            return block;
+        }
+        ++blocks;
+    }
+
+    return ::operator new(block_size);
+}
+
+void ms::SceneElementArena::deallocate(void* block, std::size_t size)
+{
+    if (size > block_size)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    std::lock_guard lock{mutex};
+    free_blocks = new (block) FreeBlock{free_blocks};
+}
+
+auto ms::SceneElementArena::blocks_allocated() const -> std::size_t
+{
+    std::lock_guard lock{mutex};
+    return blocks;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_SCENE_SCENE_ELEMENT_ARENA_H_
+#define MIR_SCENE_SCENE_ELEMENT_ARENA_H_
+
+#include <cstddef>
+#include <mutex>
+
+namespace mir
+{
+namespace scene
+{
+/**
+ * Fixed-size blocks of memory for the SceneElements made each frame, recycled once released
+ *
+ * Blocks are only returned to the heap when the arena is destroyed, so the arena grows to fit the
+ * largest frame seen. Requests too big for a block go straight to the heap.
+ *
+ * Blocks may be allocated and released on any thread.
+ */
+class SceneElementArena
+{
+public:
+    static std::size_t constexpr block_size = 256;
+
+    SceneElementArena() = default;
+    ~SceneElementArena();
+
+    auto allocate(std::size_t size) -> void*;
+    void deallocate(void* block, std::size_t size);
+
+    /// The number of blocks the arena has taken from the heap
+    auto blocks_allocated() const -> std::size_t;
+
+private:
+    SceneElementArena(SceneElementArena const&) = delete;
+    SceneElementArena& operator=(SceneElementArena const&) = delete;
+
+    /// Unused blocks hold the link to the next one, so recycling needs no bookkeeping of its own
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    std::mutex mutable mutex;
+    FreeBlock* free_blocks{nullptr};
+    std::size_t blocks{0};
+};
+}
+}
+
+#endif /* MIR_SCENE_SCENE_ELEMENT_ARENA_H_ */
@@ -0,0 +1,163 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spatial_index.h"
+
+#include <algorithm>
+
+namespace ms = mir::scene;
+namespace geom = mir::geometry;
+
+namespace
+{
+/// Bounds spanning more cells than this are cheaper to check on every query than to index
+int64_t constexpr max_cells_per_surface = 1024;
+
+auto is_empty(geom::Rectangle const& rect) -> bool
+{
+    return rect.size.width.as_int() <= 0 || rect.size.height.as_int() <= 0;
+}
+
+auto floor_div(int64_t value, int64_t divisor) -> int64_t
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+template<typename Element>
+void erase_from(std::vector<Element>& elements, Element element)
+{
+    elements.erase(std::remove(elements.begin(), elements.end(), element), elements.end());
+}
+}
+
+ms::SpatialIndex::SpatialIndex(int cell_size)
+    : cell_size{cell_size}
+{
+}
+
+void ms::SpatialIndex::update(Surface const* surface, std::optional<geom::Rectangle> const& new_bounds)
+{
+    remove(surface);
+    bounds[surface] = new_bounds;
+
+    if (new_bounds && is_empty(*new_bounds))
+        return;
+
+    if (new_bounds)
+    {
+        auto const range = cells_covering(*new_bounds);
+        if ((range.right - range.left + 1) * (range.bottom - range.top + 1) <= max_cells_per_surface)
+        {
+            for (auto row = range.top; row <= range.bottom; ++row)
+            {
+                for (auto column = range.left; column <= range.right; ++column)
+                    cells[key_for(column, row)].push_back(surface);
+            }
+            return;
+        }
+    }
+
+    everywhere.push_back(surface);
+}
+
+void ms::SpatialIndex::remove(Surface const* surface)
+{
+    auto const entry = bounds.find(surface);
+    if (entry == bounds.end())
+        return;
+
+    auto const& old_bounds = entry->second;
+    erase_from(everywhere, surface);
+    if (old_bounds && !is_empty(*old_bounds))
+    {
+        auto const range = cells_covering(*old_bounds);
+        for (auto row = range.top; row <= range.bottom; ++row)
+        {
+            for (auto column = range.left; column <= range.right; ++column)
+            {
+                auto const cell = cells.find(key_for(column, row));
+                if (cell == cells.end())
+                    continue;
+
+                erase_from(cell->second, surface);
+                if (cell->second.empty())
+                    cells.erase(cell);
+            }
+        }
+    }
+    bounds.erase(entry);
+}
+
+auto ms::SpatialIndex::surfaces_at(geom::Point point) const -> std::vector<Surface const*>
+{
+    std::vector<Surface const*> result{everywhere};
+
+    auto const cell = cells.find(key_for(
+        floor_div(point.x.as_int(), cell_size),
+        floor_div(point.y.as_int(), cell_size)));
+    if (cell != cells.end())
+    {
+        for (auto const surface : cell->second)
+        {
+            if (bounds.at(surface)->contains(point))
+                result.push_back(surface);
+        }
+    }
+    return result;
+}
+
+auto ms::SpatialIndex::surfaces_intersecting(geom::Rectangle const& area) const -> std::vector<Surface const*>
+{
+    std::vector<Surface const*> result{everywhere};
+    if (is_empty(area))
+        return result;
+
+    auto const range = cells_covering(area);
+    for (auto row = range.top; row <= range.bottom; ++row)
+    {
+        for (auto column = range.left; column <= range.right; ++column)
+        {
+            auto const cell = cells.find(key_for(column, row));
+            if (cell == cells.end())
+                continue;
+
+            for (auto const surface : cell->second)
+            {
+                if (bounds.at(surface)->overlaps(area))
+                    result.push_back(surface);
+            }
+        }
+    }
+
+    // Surfaces spanning several cells will have been found more than once
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+auto ms::SpatialIndex::cells_covering(geom::Rectangle const& area) const -> CellRange
+{
+    return CellRange{
+        floor_div(area.left().as_int(), cell_size),
+        floor_div(area.top().as_int(), cell_size),
+        floor_div(int64_t{area.right().as_int()} - 1, cell_size),
+        floor_div(int64_t{area.bottom().as_int()} - 1, cell_size)};
+}
+
+auto ms::SpatialIndex::key_for(int64_t column, int64_t row) -> uint64_t
+{
+    return static_cast<uint64_t>(static_cast<uint32_t>(column)) << 32 | static_cast<uint32_t>(row);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_SCENE_SPATIAL_INDEX_H_
+#define MIR_SCENE_SPATIAL_INDEX_H_
+
+#include "mir/geometry/rectangle.h"
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace mir
+{
+namespace scene
+{
+class Surface;
+
+/**
+ * A uniform grid over screen space, recording where each surface might be found
+ *
+ * Queries return every surface whose bounds could match, in no particular order; it's up to the
+ * caller to check candidates more precisely.
+ */
+class SpatialIndex
+{
+public:
+    explicit SpatialIndex(int cell_size = 256);
+
+    /**
+     * Record that \a surface may be found anywhere in \a bounds, replacing any earlier bounds.
+     *
+     * std::nullopt means the surface could be anywhere, and is a candidate for every query.
+     */
+    void update(Surface const* surface, std::optional<geometry::Rectangle> const& bounds);
+    void remove(Surface const* surface);
+
+    auto surfaces_at(geometry::Point point) const -> std::vector<Surface const*>;
+    auto surfaces_intersecting(geometry::Rectangle const& area) const -> std::vector<Surface const*>;
+
+private:
+    struct CellRange
+    {
+        int64_t left, top, right, bottom;   ///< Inclusive
+    };
+
+    auto cells_covering(geometry::Rectangle const& area) const -> CellRange;
+    static auto key_for(int64_t column, int64_t row) -> uint64_t;
+
+    int const cell_size;
+    std::unordered_map<uint64_t, std::vector<Surface const*>> cells;
+    /// Surfaces too big (or too unpredictable) to be worth putting in cells
+    std::vector<Surface const*> everywhere;
+    std::unordered_map<Surface const*, std::optional<geometry::Rectangle>> bounds;
+};
+}
+}
+
+#endif /* MIR_SCENE_SPATIAL_INDEX_H_ */
@@ -23,6 +23,7 @@
 #include "mir/graphics/renderable.h"
 #include "mir/depth_layer.h"
 #include "mir/executor.h"
+#include "mir/geometry/rectangles.h"
 
 #include <boost/throw_exception.hpp>
 
@@ -46,14 +47,12 @@ class SurfaceSceneElement : public mc::SceneElement
 {
 public:
     SurfaceSceneElement(
-        std::string name,
         std::shared_ptr<mg::Renderable> const& renderable,
         std::shared_ptr<ms::RenderingTracker> const& tracker,
         mc::CompositorID id)
         : renderable_{renderable},
           tracker{tracker},
-          cid{id},
-          surface_name(name)
+          cid{id}
     {
     }
 
@@ -76,7 +75,6 @@ private:
     std::shared_ptr<mg::Renderable> const renderable_;
     std::shared_ptr<ms::RenderingTracker> const tracker;
     mc::CompositorID cid;
-    std::string const surface_name;
 };
 
 //note: something different than a 2D/HWC overlay
@@ -107,11 +105,54 @@ private:
 };
 
 /**
- * A SurfaceDepthLayerObserver must not outlive the SurfaceStack it was created for
+ * Hands out std::allocate_shared() storage for SceneElements from the SurfaceStack's arena
+ *
+ * Every element (with its control block) fits a block of the arena, so once the arena has grown
+ * to the size of a frame, composing another frame doesn't touch the heap for its elements.
+ */
+template<typename T>
+struct ArenaAllocator
+{
+    using value_type = T;
+
+    explicit ArenaAllocator(std::shared_ptr<ms::SceneElementArena> const& arena)
+        : arena{arena}
+    {
+    }
+
+    template<typename U>
+    ArenaAllocator(ArenaAllocator<U> const& other)
+        : arena{other.arena}
+    {
+    }
+
+    auto allocate(size_t n) -> T*
+    {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+        return static_cast<T*>(arena->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        arena->deallocate(p, n * sizeof(T));
+    }
+
+    template<typename U>
+    auto operator==(ArenaAllocator<U> const& other) const -> bool
+    {
+        return arena == other.arena;
+    }
+
+    // The control block holds a copy of the allocator, keeping the arena alive for its elements
+    std::shared_ptr<ms::SceneElementArena> arena;
+};
+
+/**
+ * A StackedSurfaceObserver must not outlive the SurfaceStack it was created for
  */
-struct SurfaceDepthLayerObserver : ms::NullSurfaceObserver
+struct StackedSurfaceObserver : ms::NullSurfaceObserver
 {
-    SurfaceDepthLayerObserver(ms::SurfaceStack* stack)
+    StackedSurfaceObserver(ms::SurfaceStack* stack)
         : stack{stack}
     {
     }
@@ -122,17 +163,68 @@ struct SurfaceDepthLayerObserver : ms::NullSurfaceObserver
         stack->raise(surface);
     }
 
+    void moved_to(ms::Surface const* surface, geom::Point const& /*top_left*/) override
+    {
+        stack->surface_extent_changed(surface);
+    }
+
+    void window_resized_to(ms::Surface const* surface, geom::Size const& /*window_size*/) override
+    {
+        stack->surface_extent_changed(surface);
+    }
+
+    void content_resized_to(ms::Surface const* surface, geom::Size const& /*content_size*/) override
+    {
+        stack->surface_extent_changed(surface);
+    }
+
+    void transformation_set_to(ms::Surface const* surface, glm::mat4 const& /*t*/) override
+    {
+        stack->surface_extent_changed(surface);
+    }
+
+    void frame_posted(ms::Surface const* surface, int /*frames_available*/, geom::Rectangle const& damage) override
+    {
+        stack->surface_damaged(surface, damage);
+    }
+
 private:
     ms::SurfaceStack* stack;
 };
 
+/// Everywhere \a surface might draw or take input, or std::nullopt if that can't be bounded
+auto extent_of(ms::Surface const& surface) -> std::optional<geom::Rectangle>
+{
+    geom::Rectangles extent{geom::Rectangle{surface.top_left(), surface.window_size()}};
+
+    auto const input_bounds = surface.input_bounds();
+    extent.add(input_bounds);
+    for (auto const& rect : surface.get_input_region())
+        extent.add(geom::Rectangle{rect.top_left + as_displacement(input_bounds.top_left), rect.size});
+
+    // The snapshots are only measured, never asked for a buffer, so the compositor id doesn't matter
+    auto const renderables = surface.generate_renderables(nullptr);
+    if (renderables.empty() && surface.clip_area())
+        return std::nullopt;    // Clipped away entirely, so we can't see where its content is
+
+    for (auto const& renderable : renderables)
+    {
+        if (renderable->transformation() != glm::mat4{1})
+            return std::nullopt;
+        extent.add(renderable->screen_position());
+    }
+
+    return extent.bounding_rectangle();
+}
 }
 
 ms::SurfaceStack::SurfaceStack(
     std::shared_ptr<SceneReport> const& report) :
     report{report},
     scene_changed{false},
-    surface_observer{std::make_shared<SurfaceDepthLayerObserver>(this)}
+    surface_observer{std::make_shared<StackedSurfaceObserver>(this)},
+    element_arena{std::make_shared<SceneElementArena>()},
+    published{std::make_shared<Snapshot const>()}
 {
 }
 
@@ -150,59 +242,67 @@ ms::SurfaceStack::~SurfaceStack() noexcept(true)
 
 mc::SceneElementSequence ms::SurfaceStack::scene_elements_for(mc::CompositorID id)
 {
-    RecursiveReadLock lg(guard);
+    auto const scene = snapshot();
+    std::vector<Occlusion> occlusions;
+    mc::SceneElementSequence elements;
 
     scene_changed = false;
-    mc::SceneElementSequence elements;
-    for (auto const& layer : surface_layers)
+    for (auto const& surface : surfaces_in(*scene, area_of(*scene, id), occlusions))
     {
-        for (auto const& surface : layer)
+        auto const tracker = scene->rendering_trackers.find(surface.get());
+        if (tracker != scene->rendering_trackers.end() && surface_can_be_shown(*scene, surface) && surface->visible())
         {
-            if (surface_can_be_shown(surface) && surface->visible())
+            for (auto& renderable : surface->generate_renderables(id))
             {
-                for (auto& renderable : surface->generate_renderables(id))
-                {
-                    elements.emplace_back(
-                        std::make_shared<SurfaceSceneElement>(
-                            surface->name(),
-                            renderable,
-                            rendering_trackers[surface.get()],
-                            id));
-                }
+                elements.emplace_back(
+                    std::allocate_shared<SurfaceSceneElement>(
+                        ArenaAllocator<SurfaceSceneElement>{element_arena},
+                        renderable,
+                        tracker->second,
+                        id));
             }
         }
     }
-    for (auto const& renderable : overlays)
+    for (auto const& renderable : scene->overlays)
     {
-        elements.emplace_back(std::make_shared<OverlaySceneElement>(renderable));
+        elements.emplace_back(
+            std::allocate_shared<OverlaySceneElement>(
+                ArenaAllocator<OverlaySceneElement>{element_arena},
+                renderable));
     }
+
+    for (auto const& occlusion : occlusions)
+        occlusion.tracker->occluded_in(occlusion.id);
+
     return elements;
 }
 
 int ms::SurfaceStack::frames_pending(mc::CompositorID id) const
 {
-    RecursiveReadLock lg(guard);
+    auto const scene = snapshot();
+    std::vector<Occlusion> occlusions;
 
     int result = scene_changed ? 1 : 0;
-    for (auto const& layer : surface_layers)
+    for (auto const& surface : surfaces_in(*scene, area_of(*scene, id), occlusions))
     {
-        for (auto const& surface : layer)
+        if (surface_can_be_shown(*scene, surface) && surface->visible())
         {
-            if (surface_can_be_shown(surface) && surface->visible())
+            auto const tracker = scene->rendering_trackers.find(surface.get());
+            if (tracker != scene->rendering_trackers.end() && tracker->second->is_exposed_in(id))
             {
-                auto const tracker = rendering_trackers.find(surface.get());
-                if (tracker != rendering_trackers.end() && tracker->second->is_exposed_in(id))
-                {
-                    // Note that we ask the surface and not a Renderable.
-                    // This is because we don't want to waste time and resources
-                    // on a snapshot till we're sure we need it...
-                    int ready = surface->buffers_ready_for_compositor(id);
-                    if (ready > result)
-                        result = ready;
-                }
+                // Note that we ask the surface and not a Renderable.
+                // This is because we don't want to waste time and resources
+                // on a snapshot till we're sure we need it...
+                int ready = surface->buffers_ready_for_compositor(id);
+                if (ready > result)
+                    result = ready;
             }
         }
     }
+
+    for (auto const& occlusion : occlusions)
+        occlusion.tracker->occluded_in(occlusion.id);
+
     return result;
 }
 
@@ -213,6 +313,7 @@ void ms::SurfaceStack::register_compositor(mc::CompositorID cid)
     registered_compositors.insert(cid);
 
     update_rendering_tracker_compositors();
+    publish();
 }
 
 void ms::SurfaceStack::unregister_compositor(mc::CompositorID cid)
@@ -220,8 +321,38 @@ void ms::SurfaceStack::unregister_compositor(mc::CompositorID cid)
     RecursiveWriteLock lg(guard);
 
     registered_compositors.erase(cid);
+    compositor_areas.erase(cid);
 
     update_rendering_tracker_compositors();
+    publish();
+}
+
+void ms::SurfaceStack::set_compositor_area(mc::CompositorID cid, geom::Rectangle const& area)
+{
+    std::vector<Occlusion> occlusions;
+    {
+        RecursiveWriteLock lg(guard);
+        compositor_areas[cid] = area;
+        publish();
+        auto const scene = snapshot();
+
+        // Surfaces we know are elsewhere won't be offered to the compositor to find out for itself
+        std::lock_guard index_lock{index_mutex};
+        update_index(*scene, occlusions);
+        for (auto const& surface : scene->stacking_order)
+        {
+            auto const extent = extents.find(surface.get());
+            auto const tracker = scene->rendering_trackers.find(surface.get());
+            if (extent != extents.end() && extent->second.bounds && !extent->second.bounds->overlaps(area) &&
+                tracker != scene->rendering_trackers.end())
+            {
+                occlusions.push_back({tracker->second, cid});
+            }
+        }
+    }
+
+    for (auto const& occlusion : occlusions)
+        occlusion.tracker->occluded_in(occlusion.id);
 }
 
 void ms::SurfaceStack::add_input_visualization(
@@ -230,6 +361,7 @@ void ms::SurfaceStack::add_input_visualization(
     {
         RecursiveWriteLock lg(guard);
         overlays.push_back(overlay);
+        publish();
     }
     emit_scene_changed();
 }
@@ -246,6 +378,7 @@ void ms::SurfaceStack::remove_input_visualization(
             BOOST_THROW_EXCEPTION(std::runtime_error("Attempt to remove an overlay which was never added or which has been previously removed"));
         }
         overlays.erase(p);
+        publish();
     }
     
     emit_scene_changed();
@@ -253,10 +386,7 @@ void ms::SurfaceStack::remove_input_visualization(
 
 void ms::SurfaceStack::emit_scene_changed()
 {
-    {
-        RecursiveWriteLock lg(guard);
-        scene_changed = true;
-    }
+    scene_changed = true;
     observers.scene_changed();
 }
 
@@ -268,6 +398,13 @@ void ms::SurfaceStack::add_surface(
         RecursiveWriteLock lg(guard);
         insert_surface_at_top_of_depth_layer(surface);
         create_rendering_tracker_for(surface);
+        {
+            std::lock_guard index_lock{index_mutex};
+            extents[surface.get()] = Extent{surface->top_left(), std::nullopt};
+            spatial_index.update(surface.get(), std::nullopt);
+            stale_extents.insert(surface.get());
+        }
+        publish();
         surface->register_interest(surface_observer, immediate_executor);
     }
     surface->set_reception_mode(input_mode);
@@ -291,7 +428,19 @@ void ms::SurfaceStack::remove_surface(std::weak_ptr<Surface> const& surface)
             if (surface != layer.end())
             {
                 layer.erase(surface);
+                {
+                    std::lock_guard index_lock{index_mutex};
+                    spatial_index.remove(keep_alive.get());
+                    extents.erase(keep_alive.get());
+                    stale_extents.erase(keep_alive.get());
+                }
+                {
+                    std::lock_guard changes_lock{changes_mutex};
+                    moved_surfaces.erase(keep_alive.get());
+                    surface_damage.erase(keep_alive.get());
+                }
                 rendering_trackers.erase(keep_alive.get());
+                publish();
                 keep_alive->unregister_interest(*surface_observer);
                 found_surface = true;
                 break;
@@ -307,37 +456,31 @@ void ms::SurfaceStack::remove_surface(std::weak_ptr<Surface> const& surface)
     // TODO: error logging when surface not found
 }
 
-namespace
-{
-template <typename Container>
-struct InReverse {
-    Container& container;
-    auto begin() -> decltype(container.rbegin()) { return container.rbegin(); }
-    auto end() -> decltype(container.rend()) { return container.rend(); }
-};
-
-template <typename Container>
-InReverse<Container> in_reverse(Container& container) { return InReverse<Container>{container}; }
-}
-
 auto ms::SurfaceStack::surface_at(geometry::Point cursor) const
 -> std::shared_ptr<Surface>
 {
-    RecursiveReadLock lg(guard);
-    for (auto const& layer : in_reverse(surface_layers))
+    auto const scene = snapshot();
+    std::vector<Occlusion> occlusions;
+    std::shared_ptr<Surface> result;
+
+    auto const candidates = surfaces_at(*scene, cursor, occlusions);
+    for (auto surface = candidates.rbegin(); surface != candidates.rend(); ++surface)
     {
-        for (auto const& surface : in_reverse(layer))
+        // TODO There's a lack of clarity about how the input area will
+        // TODO be maintained and whether this test will detect clicks on
+        // TODO decorations (it should) as these may be outside the area
+        // TODO known to the client.  But it works for now.
+        if (surface_can_be_shown(*scene, *surface) && (*surface)->input_area_contains(cursor))
         {
-            // TODO There's a lack of clarity about how the input area will
-            // TODO be maintained and whether this test will detect clicks on
-            // TODO decorations (it should) as these may be outside the area
-            // TODO known to the client.  But it works for now.
-            if (surface_can_be_shown(surface) && surface->input_area_contains(cursor))
-                    return surface;
+            result = *surface;
+            break;
         }
     }
 
-    return {};
+    for (auto const& occlusion : occlusions)
+        occlusion.tracker->occluded_in(occlusion.id);
+
+    return result;
 }
 
 auto ms::SurfaceStack::input_surface_at(geometry::Point point) const -> std::shared_ptr<input::Surface>
@@ -367,6 +510,7 @@ void ms::SurfaceStack::raise(Surface const* surface)
                 layer.erase(p);
                 insert_surface_at_top_of_depth_layer(surface_shared);
                 affected_surfaces.insert(surface_shared);
+                publish();
                 break;
             }
         }
@@ -417,6 +561,8 @@ void ms::SurfaceStack::raise(SurfaceSet const& ss)
             if (old_layer != layer)
                 surfaces_reordered = true;
         }
+        if (surfaces_reordered)
+            publish();
     }
 
     if (surfaces_reordered)
@@ -483,6 +629,7 @@ void ms::SurfaceStack::swap_z_order(SurfaceSet const& first, SurfaceSet const& s
                     return to_back.count(s2) == 0;
             });
         }
+        publish();
     }
 
     observers.surfaces_reordered(first);
@@ -517,6 +664,8 @@ void ms::SurfaceStack::send_to_back(const mir::scene::SurfaceSet &ss)
                 surfaces_reordered = true;
             }
         }
+        if (surfaces_reordered)
+            publish();
     }
 
     if (surfaces_reordered)
@@ -550,9 +699,170 @@ void ms::SurfaceStack::insert_surface_at_top_of_depth_layer(std::shared_ptr<Surf
     surface_layers[depth_index].push_back(surface);
 }
 
-auto ms::SurfaceStack::surface_can_be_shown(std::shared_ptr<Surface> const& surface) const -> bool
+void ms::SurfaceStack::publish()
+{
+    auto next = std::make_shared<Snapshot>();
+    for (auto const& layer : surface_layers)
+    {
+        for (auto const& surface : layer)
+        {
+            next->stacking_position[surface.get()] = next->stacking_order.size();
+            next->stacking_order.push_back(surface);
+        }
+    }
+    next->rendering_trackers = rendering_trackers;
+    next->overlays = overlays;
+    next->compositor_areas = compositor_areas;
+    next->screen_lock = screen_lock_handle;
+
+    published.store(std::move(next));
+}
+
+auto ms::SurfaceStack::snapshot() const -> std::shared_ptr<Snapshot const>
+{
+    return published.load();
+}
+
+void ms::SurfaceStack::surface_extent_changed(Surface const* surface)
+{
+    std::lock_guard changes_lock{changes_mutex};
+    moved_surfaces.insert(surface);
+}
+
+void ms::SurfaceStack::surface_damaged(Surface const* surface, geom::Rectangle const& damage)
+{
+    std::lock_guard changes_lock{changes_mutex};
+    auto const [existing, inserted] = surface_damage.emplace(surface, damage);
+    if (!inserted)
+        existing->second = geom::Rectangles{existing->second, damage}.bounding_rectangle();
+}
+
+auto ms::SurfaceStack::area_of(Snapshot const& scene, mc::CompositorID id) -> std::optional<geom::Rectangle>
+{
+    auto const area = scene.compositor_areas.find(id);
+    if (area == scene.compositor_areas.end())
+        return std::nullopt;
+    return area->second;
+}
+
+void ms::SurfaceStack::update_index(Snapshot const& scene, std::vector<Occlusion>& occlusions) const
+{
+    std::set<Surface const*> moved;
+    std::unordered_map<Surface const*, geom::Rectangle> damage;
+    {
+        std::lock_guard changes_lock{changes_mutex};
+        std::swap(moved, moved_surfaces);
+        std::swap(damage, surface_damage);
+    }
+
+    for (auto const surface : moved)
+    {
+        if (extents.contains(surface))
+            stale_extents.insert(surface);
+    }
+    for (auto const& [surface, damaged] : damage)
+    {
+        auto const extent = extents.find(surface);
+        if (extent == extents.end() || !extent->second.bounds)
+            continue;
+
+        // Drawing outside the bounds we know about means a buffer or subsurface has grown
+        geom::Rectangle const on_screen{damaged.top_left + as_displacement(extent->second.top_left), damaged.size};
+        if (!extent->second.bounds->contains(on_screen))
+            stale_extents.insert(surface);
+    }
+
+    for (auto stale = stale_extents.begin(); stale != stale_extents.end();)
+    {
+        // Surfaces added since scene was published are left for a later query to measure
+        auto const position = scene.stacking_position.find(*stale);
+        auto const extent = extents.find(*stale);
+        if (position == scene.stacking_position.end() || extent == extents.end())
+        {
+            ++stale;
+            continue;
+        }
+
+        auto const& surface = scene.stacking_order[position->second];
+        auto const bounds = extent_of(*surface);
+        extent->second = Extent{surface->top_left(), bounds};
+        spatial_index.update(*stale, bounds);
+        stale = stale_extents.erase(stale);
+
+        if (!bounds)
+            continue;
+
+        // Compositors that won't be offered the surface any more won't see it get occluded
+        for (auto const& [id, area] : scene.compositor_areas)
+        {
+            if (!bounds->overlaps(area))
+            {
+                auto const tracker = scene.rendering_trackers.find(surface.get());
+                if (tracker != scene.rendering_trackers.end())
+                    occlusions.push_back({tracker->second, id});
+            }
+        }
+    }
+}
+
+auto ms::SurfaceStack::surfaces_in(
+    Snapshot const& scene,
+    std::optional<geom::Rectangle> const& area,
+    std::vector<Occlusion>& occlusions) const -> std::vector<std::shared_ptr<Surface>>
+{
+    std::vector<Surface const*> candidates;
+    {
+        std::lock_guard index_lock{index_mutex};
+        update_index(scene, occlusions);
+
+        if (!area)
+            return scene.stacking_order;
+
+        candidates = spatial_index.surfaces_intersecting(*area);
+    }
+
+    return in_stacking_order(scene, candidates);
+}
+
+auto ms::SurfaceStack::surfaces_at(
+    Snapshot const& scene,
+    geom::Point point,
+    std::vector<Occlusion>& occlusions) const -> std::vector<std::shared_ptr<Surface>>
+{
+    std::vector<Surface const*> candidates;
+    {
+        std::lock_guard index_lock{index_mutex};
+        update_index(scene, occlusions);
+        candidates = spatial_index.surfaces_at(point);
+    }
+
+    return in_stacking_order(scene, candidates);
+}
+
+auto ms::SurfaceStack::in_stacking_order(Snapshot const& scene, std::vector<Surface const*> const& surfaces)
+    -> std::vector<std::shared_ptr<Surface>>
+{
+    std::vector<size_t> positions;
+    positions.reserve(surfaces.size());
+    for (auto const surface : surfaces)
+    {
+        // The index may know of surfaces added or removed since scene was published
+        auto const position = scene.stacking_position.find(surface);
+        if (position != scene.stacking_position.end())
+            positions.push_back(position->second);
+    }
+    std::sort(positions.begin(), positions.end());
+
+    std::vector<std::shared_ptr<Surface>> result;
+    result.reserve(positions.size());
+    for (auto const position : positions)
+        result.push_back(scene.stacking_order[position]);
+    return result;
+}
+
+auto ms::SurfaceStack::surface_can_be_shown(Snapshot const& scene, std::shared_ptr<Surface> const& surface) -> bool
 {
-    return screen_lock_handle.expired() || surface->visible_on_lock_screen();
+    return scene.screen_lock.expired() || surface->visible_on_lock_screen();
 }
 
 void ms::SurfaceStack::add_observer(std::shared_ptr<ms::Observer> const& observer)
@@ -585,15 +895,11 @@ auto ms::SurfaceStack::stacking_order_of(SurfaceSet const& surfaces) const -> Su
 {
     SurfaceList result;
 
-    RecursiveReadLock lk(guard);
-    for (auto const& layer : surface_layers)
+    for (auto const& surface : snapshot()->stacking_order)
     {
-        for (auto const& surface : layer)
+        if (surfaces.find(surface) != surfaces.end())
         {
-            if (surfaces.find(surface) != surfaces.end())
-            {
-                result.push_back(surface);
-            }
+            result.push_back(surface);
         }
     }
     return result;
@@ -658,6 +964,7 @@ auto ms::SurfaceStack::lock_screen() -> std::unique_ptr<mf::ScreenLockHandle>
         {
             screen_lock_handle = shared = std::make_shared<SharedScreenLock>(shared_from_this());
             is_new = true;
+            publish();
         }
     }
     if (is_new)
@@ -669,8 +976,7 @@ auto ms::SurfaceStack::lock_screen() -> std::unique_ptr<mf::ScreenLockHandle>
 
 auto ms::SurfaceStack::screen_is_locked() const -> bool
 {
-    RecursiveReadLock lk(guard);
-    return !screen_lock_handle.expired();
+    return !snapshot()->screen_lock.expired();
 }
 
 void ms::Observers::surface_added(std::shared_ptr<Surface> const& surface)
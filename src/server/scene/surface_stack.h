@@ -27,12 +27,16 @@
 
 #include "mir/basic_observers.h"
 #include "mir/scene/surface_observer.h"
+#include "scene_element_arena.h"
+#include "spatial_index.h"
 
 #include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace mir
@@ -81,6 +85,7 @@ public:
     int frames_pending(compositor::CompositorID) const override;
     void register_compositor(compositor::CompositorID id) override;
     void unregister_compositor(compositor::CompositorID id) override;
+    void set_compositor_area(compositor::CompositorID id, geometry::Rectangle const& area) override;
 
     // From Scene
     auto input_surface_at(geometry::Point point) const -> std::shared_ptr<input::Surface> override;
@@ -112,17 +117,65 @@ public:
 
     void emit_scene_changed() override;
 
+    /// \a surface may have moved, been resized or otherwise changed where it draws or takes input
+    void surface_extent_changed(Surface const* surface);
+    /// \a surface has drawn a frame, changing \a damage (relative to its top left)
+    void surface_damaged(Surface const* surface, geometry::Rectangle const& damage);
+
 private:
     SurfaceStack(const SurfaceStack&) = delete;
     SurfaceStack& operator=(const SurfaceStack&) = delete;
     void create_rendering_tracker_for(std::shared_ptr<Surface> const&);
     void update_rendering_tracker_compositors();
     void insert_surface_at_top_of_depth_layer(std::shared_ptr<Surface> const& surface);
-    auto surface_can_be_shown(std::shared_ptr<Surface> const& surface) const -> bool;
 
     struct SharedScreenLock;
     struct BasicScreenLockHandle;
 
+    /**
+     * What readers see of the stack.
+     *
+     * Never changed once published, so compositor and input threads can read it without waiting
+     * on guard. Writers publish a new one before releasing guard.
+     */
+    struct Snapshot
+    {
+        /// All the surfaces, bottom to top
+        std::vector<std::shared_ptr<Surface>> stacking_order;
+        std::unordered_map<Surface const*, size_t> stacking_position;
+        std::map<Surface*, std::shared_ptr<RenderingTracker>> rendering_trackers;
+        std::vector<std::shared_ptr<graphics::Renderable>> overlays;
+        std::map<compositor::CompositorID, geometry::Rectangle> compositor_areas;
+        /// If not expired the screen is locked
+        std::weak_ptr<SharedScreenLock> screen_lock;
+    };
+
+    /// Publish a Snapshot of the current state. Call with guard held for writing.
+    void publish();
+    auto snapshot() const -> std::shared_ptr<Snapshot const>;
+
+    static auto surface_can_be_shown(Snapshot const& scene, std::shared_ptr<Surface> const& surface) -> bool;
+
+    /// A compositor that has learnt a surface it isn't being offered is out of its sight
+    struct Occlusion
+    {
+        std::shared_ptr<RenderingTracker> tracker;
+        compositor::CompositorID id;
+    };
+
+    /// The surfaces of \a scene that might appear in \a area (all of them if std::nullopt), bottom to top
+    auto surfaces_in(
+        Snapshot const& scene,
+        std::optional<geometry::Rectangle> const& area,
+        std::vector<Occlusion>& occlusions) const -> std::vector<std::shared_ptr<Surface>>;
+    auto surfaces_at(Snapshot const& scene, geometry::Point point, std::vector<Occlusion>& occlusions) const
+        -> std::vector<std::shared_ptr<Surface>>;
+    static auto in_stacking_order(Snapshot const& scene, std::vector<Surface const*> const& surfaces)
+        -> std::vector<std::shared_ptr<Surface>>;
+    void update_index(Snapshot const& scene, std::vector<Occlusion>& occlusions) const;
+    static auto area_of(Snapshot const& scene, compositor::CompositorID id) -> std::optional<geometry::Rectangle>;
+
+    /// Serialises changes to the stack; readers use the published Snapshot instead
     RecursiveReadWriteMutex mutable guard;
 
     std::shared_ptr<SceneReport> const report;
@@ -137,6 +190,28 @@ private:
     std::vector<std::vector<std::shared_ptr<Surface>>> surface_layers;
     std::map<Surface*,std::shared_ptr<RenderingTracker>> rendering_trackers;
     std::set<compositor::CompositorID> registered_compositors;
+    std::map<compositor::CompositorID, geometry::Rectangle> compositor_areas;
+
+    /**
+     * Where each surface might be, so hit-tests and per-output queries needn't visit every surface.
+     *
+     * Brought up to date lazily by queries, which don't hold guard so need index_mutex.
+     */
+    struct Extent
+    {
+        geometry::Point top_left;                   ///< Of the surface when its bounds were measured
+        std::optional<geometry::Rectangle> bounds;  ///< std::nullopt if the surface could be anywhere
+    };
+    std::mutex mutable index_mutex;
+    SpatialIndex mutable spatial_index;
+    std::unordered_map<Surface const*, Extent> mutable extents;
+    std::set<Surface const*> mutable stale_extents;
+
+    /// What surfaces have told us since the index was last brought up to date.
+    /// Kept apart from index_mutex, as surfaces can notify while locked against a query.
+    std::mutex mutable changes_mutex;
+    std::set<Surface const*> mutable moved_surfaces;
+    std::unordered_map<Surface const*, geometry::Rectangle> mutable surface_damage;
     
     std::vector<std::shared_ptr<graphics::Renderable>> overlays;
 
@@ -145,6 +220,10 @@ private:
     std::weak_ptr<SharedScreenLock> screen_lock_handle;
     std::atomic<bool> scene_changed;
     std::shared_ptr<SurfaceObserver> surface_observer;
+    /// Where scene_elements_for() makes its elements, so frames after the first needn't use the heap
+    std::shared_ptr<SceneElementArena> const element_arena;
+
+    std::atomic<std::shared_ptr<Snapshot const>> published;
 };
 
 }
@@ -85,6 +85,11 @@ public:
         return false;
     }
 
+    auto opaque_region() const -> geom::Rectangles override
+    {
+        return {};
+    }
+
 private:
     std::shared_ptr<mg::Buffer> const buffer_;
 };
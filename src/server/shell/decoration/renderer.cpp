@@ -29,6 +29,7 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include <algorithm>
 #include <locale>
 #include <codecvt>
 
@@ -140,6 +141,37 @@ inline void render_row(
         *i = color;
 }
 
+/// Blends \a color over \a count pixels of \a dest, weighted by \a coverage, leaving the destination alpha as it was
+///
+/// The red and blue channels are worked on together in one word and green in another, and the loop has no branches,
+/// so the compiler is free to vectorize it.
+inline void blend_row(
+    uint32_t* const dest,
+    unsigned char const* const coverage,
+    int count,
+    uint32_t color)
+{
+    uint32_t const color_rb = color & 0x00FF00FF;
+    uint32_t const color_g = color & 0x0000FF00;
+    uint32_t const color_alpha = color >> 24;
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t const alpha = (coverage[i] * color_alpha) / 255;
+        uint32_t const pixel = dest[i];
+
+        // Each 16 bit lane holds at most 255 * 255, so the channels can't overflow into each other
+        uint32_t rb = (pixel & 0x00FF00FF) * (255 - alpha) + color_rb * alpha + 0x00800080;
+        uint32_t g = (pixel & 0x0000FF00) * (255 - alpha) + color_g * alpha + 0x00008000;
+
+        // x / 255, rounded, is (x + 128 + ((x + 128) >> 8)) >> 8 for the range we have here
+        rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+        g = ((g + (g >> 8)) >> 8) & 0x0000FF00;
+
+        dest[i] = (pixel & 0xFF000000) | rb | g;
+    }
+}
+
 inline void render_close_icon(
     uint32_t* const data,
     geom::Size buf_size,
@@ -213,16 +245,33 @@ public:
         Pixel color) override;
 
 private:
+    /// A rasterized glyph, kept so that redrawing a title doesn't need FreeType
+    struct Glyph
+    {
+        geom::Displacement offset;          ///< From the text's top left to the bitmap's
+        geom::Displacement advance;         ///< From this glyph's origin to the next's
+        geom::Size size;
+        std::vector<unsigned char> alpha;   ///< Coverage, one byte per pixel with no row padding
+    };
+
+    /// Titles use a handful of characters at a handful of sizes, so this is plenty
+    static size_t const max_cached_glyphs{1024};
+
     std::mutex mutex;
     FT_Library library;
     FT_Face face;
+    geom::Height char_size{};
+
+    /// Keyed by pixel height (which has the scale applied) and character
+    std::map<std::pair<int, char32_t>, Glyph> glyphs;
 
+    auto glyph_for(char32_t character, geom::Height height) -> Glyph const&;
     void set_char_size(geom::Height height);
     void rasterize_glyph(char32_t glyph);
     void render_glyph(
         Pixel* buf,
         geom::Size buf_size,
-        FT_Bitmap const* glyph,
+        Glyph const& glyph,
         geom::Point top_left,
         Pixel color);
 
@@ -318,34 +367,15 @@ void msd::Renderer::Text::Impl::render(
         return;
     }
 
-    try
-    {
-        set_char_size(height_pixels);
-    }
-    catch (std::runtime_error const& error)
-    {
-        log_warning("%s", error.what());
-        return;
-    }
-
     auto const utf32 = utf8_to_utf32(text);
 
-    for (char32_t const glyph : utf32)
+    for (char32_t const character : utf32)
     {
         try
         {
-            rasterize_glyph(glyph);
-
-            geom::Point glyph_top_left =
-                top_left +
-                geom::Displacement{
-                    face->glyph->bitmap_left,
-                    height_pixels.as_int() - face->glyph->bitmap_top};
-            render_glyph(buf, buf_size, &face->glyph->bitmap, glyph_top_left, color);
-
-            top_left += geom::Displacement{
-                face->glyph->advance.x / 64,
-                face->glyph->advance.y / 64};
+            auto const& glyph = glyph_for(character, height_pixels);
+            render_glyph(buf, buf_size, glyph, top_left + glyph.offset, color);
+            top_left += glyph.advance;
         }
         catch (std::runtime_error const& error)
         {
@@ -354,11 +384,45 @@ void msd::Renderer::Text::Impl::render(
     }
 }
 
+auto msd::Renderer::Text::Impl::glyph_for(char32_t character, geom::Height height) -> Glyph const&
+{
+    std::pair const key{height.as_int(), character};
+    if (auto const cached = glyphs.find(key); cached != glyphs.end())
+        return cached->second;
+
+    set_char_size(height);
+    rasterize_glyph(character);
+
+    FT_GlyphSlot const slot = face->glyph;
+    FT_Bitmap const& bitmap = slot->bitmap;
+
+    Glyph glyph{
+        geom::Displacement{slot->bitmap_left, height.as_int() - slot->bitmap_top},
+        geom::Displacement{slot->advance.x / 64, slot->advance.y / 64},
+        geom::Size{bitmap.width, bitmap.rows},
+        std::vector<unsigned char>(bitmap.width * bitmap.rows)};
+
+    for (unsigned row = 0; row < bitmap.rows; row++)
+    {
+        std::copy_n(bitmap.buffer + row * bitmap.pitch, bitmap.width, glyph.alpha.data() + row * bitmap.width);
+    }
+
+    if (glyphs.size() >= max_cached_glyphs)
+        glyphs.clear();
+
+    return glyphs.emplace(key, std::move(glyph)).first->second;
+}
+
 void msd::Renderer::Text::Impl::set_char_size(geom::Height height)
 {
+    if (height == char_size)
+        return;
+
     if (auto const error = FT_Set_Pixel_Sizes(face, 0, height.as_int()))
         BOOST_THROW_EXCEPTION(std::runtime_error(
             "Setting char size failed with error " + std::to_string(error)));
+
+    char_size = height;
 }
 
 void msd::Renderer::Text::Impl::rasterize_glyph(char32_t glyph)
@@ -377,40 +441,33 @@ void msd::Renderer::Text::Impl::rasterize_glyph(char32_t glyph)
 void msd::Renderer::Text::Impl::render_glyph(
     Pixel* buf,
     geom::Size buf_size,
-    FT_Bitmap const* glyph,
+    Glyph const& glyph,
     geom::Point top_left,
     Pixel color)
 {
     geom::X const buffer_left = std::max(top_left.x, geom::X{});
-    geom::X const buffer_right = std::min(top_left.x + geom::DeltaX{glyph->width}, as_x(buf_size.width));
+    geom::X const buffer_right = std::min(top_left.x + as_delta(glyph.size.width), as_x(buf_size.width));
 
     geom::Y const buffer_top = std::max(top_left.y, geom::Y{});
-    geom::Y const buffer_bottom = std::min(top_left.y + geom::DeltaY{glyph->rows}, as_y(buf_size.height));
+    geom::Y const buffer_bottom = std::min(top_left.y + as_delta(glyph.size.height), as_y(buf_size.height));
 
-    geom::Displacement const glyph_offset = as_displacement(top_left);
+    if (buffer_left >= buffer_right)
+        return;
 
-    unsigned char* const color_pixels = (unsigned char *)&color;
-    unsigned char const color_alpha = color_pixels[3];
+    geom::Displacement const glyph_offset = as_displacement(top_left);
+    geom::X const glyph_left = buffer_left - glyph_offset.dx;
 
     for (geom::Y buffer_y = buffer_top; buffer_y < buffer_bottom; buffer_y += geom::DeltaY{1})
     {
         geom::Y const glyph_y = buffer_y - glyph_offset.dy;
-        unsigned char* const glyph_row = glyph->buffer + glyph_y.as_int() * glyph->pitch;
+        unsigned char const* const glyph_row = glyph.alpha.data() + glyph_y.as_int() * glyph.size.width.as_int();
         Pixel* const buffer_row = buf + buffer_y.as_int() * buf_size.width.as_int();
 
-        for (geom::X buffer_x = buffer_left; buffer_x < buffer_right; buffer_x += geom::DeltaX{1})
-        {
-            geom::X const glyph_x = buffer_x - glyph_offset.dx;
-            unsigned char const glyph_alpha = ((int)glyph_row[glyph_x.as_int()] * color_alpha) / 255;
-            unsigned char* const buffer_pixels = (unsigned char *)(buffer_row + buffer_x.as_int());
-            for (int i = 0; i < 3; i++)
-            {
-                // Blend color with the previous buffer color based on the glyph's alpha
-                buffer_pixels[i] =
-                    ((int)buffer_pixels[i] * (255 - glyph_alpha)) / 255 +
-                    ((int)color_pixels[i] * glyph_alpha) / 255;
-            }
-        }
+        blend_row(
+            buffer_row + buffer_left.as_int(),
+            glyph_row + glyph_left.as_int(),
+            (buffer_right - buffer_left).as_int(),
+            color);
     }
 }
 
@@ -444,6 +501,50 @@ auto msd::Renderer::Text::Impl::utf8_to_utf32(std::string const& text) -> std::u
     return utf32_text;
 }
 
+std::mutex msd::Renderer::SolidColorBuffers::static_mutex;
+std::weak_ptr<msd::Renderer::SolidColorBuffers> msd::Renderer::SolidColorBuffers::singleton;
+
+auto msd::Renderer::SolidColorBuffers::instance() -> std::shared_ptr<SolidColorBuffers>
+{
+    std::lock_guard lock{static_mutex};
+    auto shared = singleton.lock();
+    if (!shared)
+    {
+        shared = std::make_shared<SolidColorBuffers>();
+        singleton = shared;
+    }
+    return shared;
+}
+
+auto msd::Renderer::SolidColorBuffers::buffer(
+    std::shared_ptr<graphics::GraphicBufferAllocator> const& allocator,
+    geom::Size size,
+    Pixel color,
+    std::function<auto(Pixel const* pixels) -> std::optional<std::shared_ptr<graphics::Buffer>>> const& make)
+    -> std::optional<std::shared_ptr<graphics::Buffer>>
+{
+    Key const key{allocator.get(), size.width.as_int(), size.height.as_int(), color};
+
+    std::lock_guard lock{mutex};
+
+    if (auto const existing = buffers.find(key); existing != buffers.end())
+    {
+        // The allocator is checked too, in case another has since taken the address of the one this was made with
+        auto const existing_allocator = existing->second.allocator.lock();
+        if (auto const buffer = existing->second.buffer.lock(); buffer && existing_allocator == allocator)
+            return buffer;
+    }
+
+    pixels.assign(area(size), color);
+    auto const made = make(pixels.data());
+
+    std::erase_if(buffers, [](auto const& entry) { return entry.second.buffer.expired(); });
+    if (made)
+        buffers[key] = Entry{allocator, made.value()};
+
+    return made;
+}
+
 msd::Renderer::Renderer(
     std::shared_ptr<graphics::GraphicBufferAllocator> const& buffer_allocator,
     std::shared_ptr<StaticGeometry const> const& static_geometry)
@@ -473,7 +574,8 @@ msd::Renderer::Renderer(
               render_minimize_icon}},
       },
       static_geometry{static_geometry},
-      text{Text::instance()}
+      text{Text::instance()},
+      solid_color_buffers{SolidColorBuffers::instance()}
 {
 }
 
@@ -483,9 +585,6 @@ void msd::Renderer::update_state(WindowState const& window_state, InputState con
     {
         scale = new_scale;
 
-        needs_solid_color_redraw = true;
-        solid_color_pixels.reset(); // force a reallocation next time it's needed
-
         needs_titlebar_redraw = true;
         titlebar_pixels.reset(); // force a reallocation next time it's needed
 
@@ -496,20 +595,6 @@ void msd::Renderer::update_state(WindowState const& window_state, InputState con
     right_border_size = window_state.right_border_rect().size;
     bottom_border_size = window_state.bottom_border_rect().size;
 
-    size_t length{0};
-    length = std::max(length, area(left_border_size));
-    length = std::max(length, area(right_border_size));
-    length = std::max(length, area(bottom_border_size));
-
-    if (auto const scaled_length{static_cast<size_t>(length * scale * scale)};
-        length != solid_color_pixels_length ||
-        scaled_length != scaled_solid_color_pixels_length)
-    {
-        solid_color_pixels_length = length;
-        scaled_solid_color_pixels_length = scaled_length;
-        solid_color_pixels.reset(); // force a reallocation next time it's needed
-    }
-
     if (window_state.titlebar_rect().size != titlebar_size)
     {
         titlebar_size = window_state.titlebar_rect().size;
@@ -524,7 +609,6 @@ void msd::Renderer::update_state(WindowState const& window_state, InputState con
     {
         current_theme = new_theme;
         needs_titlebar_redraw = true;
-        needs_solid_color_redraw = true;
     }
 
     if (window_state.window_name() != name)
@@ -569,13 +653,7 @@ auto msd::Renderer::render_titlebar() -> std::optional<std::shared_ptr<mg::Buffe
 
     if (needs_titlebar_redraw)
     {
-        for (geom::Y y{0}; y < as_y(scaled_titlebar_size.height); y += geom::DeltaY{1})
-        {
-            render_row(
-                titlebar_pixels.get(), scaled_titlebar_size,
-                {0, y}, scaled_titlebar_size.width,
-                current_theme->background_color);
-        }
+        std::fill_n(titlebar_pixels.get(), area(scaled_titlebar_size), current_theme->background_color);
 
         text->render(
             titlebar_pixels.get(),
@@ -641,8 +719,7 @@ auto msd::Renderer::render_left_border() -> std::optional<std::shared_ptr<mg::Bu
     auto const scaled_left_border_size{left_border_size * scale};
     if (!area(scaled_left_border_size))
         return std::nullopt;
-    update_solid_color_pixels();
-    return make_buffer(solid_color_pixels.get(), scaled_left_border_size);
+    return render_solid_color(scaled_left_border_size);
 }
 
 auto msd::Renderer::render_right_border() -> std::optional<std::shared_ptr<mg::Buffer>>
@@ -650,8 +727,7 @@ auto msd::Renderer::render_right_border() -> std::optional<std::shared_ptr<mg::B
     auto const scaled_right_border_size{right_border_size * scale};
     if (!area(scaled_right_border_size))
         return std::nullopt;
-    update_solid_color_pixels();
-    return make_buffer(solid_color_pixels.get(), scaled_right_border_size);
+    return render_solid_color(scaled_right_border_size);
 }
 
 auto msd::Renderer::render_bottom_border() -> std::optional<std::shared_ptr<mg::Buffer>>
@@ -659,27 +735,16 @@ auto msd::Renderer::render_bottom_border() -> std::optional<std::shared_ptr<mg::
     auto const scaled_bottom_border_size{bottom_border_size * scale};
     if (!area(scaled_bottom_border_size))
         return std::nullopt;
-    update_solid_color_pixels();
-    return make_buffer(solid_color_pixels.get(), scaled_bottom_border_size);
+    return render_solid_color(scaled_bottom_border_size);
 }
 
-void msd::Renderer::update_solid_color_pixels()
+auto msd::Renderer::render_solid_color(geometry::Size size) -> std::optional<std::shared_ptr<mg::Buffer>>
 {
-    if (!solid_color_pixels)
-    {
-        solid_color_pixels = alloc_pixels(geom::Size{scaled_solid_color_pixels_length, 1});
-        needs_solid_color_redraw = true;
-    }
-
-    if (needs_solid_color_redraw)
-    {
-        render_row(
-            solid_color_pixels.get(), geom::Size{scaled_solid_color_pixels_length, 1},
-            geom::Point{}, geom::Width{scaled_solid_color_pixels_length},
-            current_theme->background_color);
-    }
-
-    needs_solid_color_redraw = false;
+    return solid_color_buffers->buffer(
+        buffer_allocator,
+        size,
+        current_theme->background_color,
+        [&](Pixel const* pixels) { return make_buffer(pixels, size); });
 }
 
 auto msd::Renderer::make_buffer(
@@ -21,8 +21,12 @@
 
 #include "input.h"
 
+#include <functional>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 namespace mir
 {
@@ -81,6 +85,45 @@ private:
         static std::weak_ptr<Text> singleton;
     };
 
+    /// Borders of the same size and color look the same on every window, so they share a buffer
+    class SolidColorBuffers
+    {
+    public:
+        static auto instance() -> std::shared_ptr<SolidColorBuffers>;
+
+        /// Returns a live buffer of the given size and color if one exists, or else the result of \a make
+        auto buffer(
+            std::shared_ptr<graphics::GraphicBufferAllocator> const& allocator,
+            geometry::Size size,
+            Pixel color,
+            std::function<auto(Pixel const* pixels) -> std::optional<std::shared_ptr<graphics::Buffer>>> const& make)
+            -> std::optional<std::shared_ptr<graphics::Buffer>>;
+
+    private:
+        struct Key
+        {
+            graphics::GraphicBufferAllocator const* allocator;
+            int width;
+            int height;
+            Pixel color;
+
+            auto operator<=>(Key const&) const = default;
+        };
+
+        struct Entry
+        {
+            std::weak_ptr<graphics::GraphicBufferAllocator> allocator;
+            std::weak_ptr<graphics::Buffer> buffer;
+        };
+
+        std::mutex mutex;
+        std::map<Key, Entry> buffers;
+        std::vector<Pixel> pixels; ///< Scratch space to fill before a buffer is made
+
+        static std::mutex static_mutex;
+        static std::weak_ptr<SolidColorBuffers> singleton;
+    };
+
     /// A visual theme for a decoration
     /// Focused and unfocused windows use a different theme
     struct Theme
@@ -110,13 +153,9 @@ private:
     std::map<ButtonFunction, Icon const> button_icons;
     std::shared_ptr<StaticGeometry const> const static_geometry;
 
-    bool needs_solid_color_redraw{true};
     geometry::Size left_border_size;
     geometry::Size right_border_size;
     geometry::Size bottom_border_size;
-    size_t solid_color_pixels_length{0};
-    size_t scaled_solid_color_pixels_length{0};
-    std::unique_ptr<Pixel[]> solid_color_pixels; // can be nullptr
 
     geometry::Size titlebar_size{};
     std::unique_ptr<Pixel[]> titlebar_pixels; // can be nullptr
@@ -127,10 +166,11 @@ private:
     std::vector<ButtonInfo> buttons;
 
     std::shared_ptr<Text> const text;
+    std::shared_ptr<SolidColorBuffers> const solid_color_buffers;
 
     float scale{1.0f};
 
-    void update_solid_color_pixels();
+    auto render_solid_color(geometry::Size size) -> std::optional<std::shared_ptr<graphics::Buffer>>;
     auto make_buffer(
         Pixel const* pixels,
         geometry::Size size) -> std::optional<std::shared_ptr<graphics::Buffer>>;
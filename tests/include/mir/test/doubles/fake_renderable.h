@@ -78,11 +78,21 @@ public:
         return !rectangular;
     }
 
+    geometry::Rectangles opaque_region() const override
+    {
+        return opaque;
+    }
+
     void set_buffer(std::shared_ptr<graphics::Buffer> b)
     {
         buf = b;
     }
 
+    void set_opaque_region(geometry::Rectangles const& region)
+    {
+        opaque = region;
+    }
+
     std::shared_ptr<graphics::Buffer> buffer() const override
     {
         return buf;
@@ -103,6 +113,7 @@ private:
     mir::geometry::Rectangle rect;
     float opacity;
     bool rectangular;
+    geometry::Rectangles opaque;
 };
 
 } // namespace doubles
@@ -33,14 +33,20 @@ public:
     MOCK_METHOD5(added_display,
                  void(int,int,int,int,
                       compositor::CompositorReport::SubCompositorId));
+    MOCK_METHOD1(began_scene_snapshot,
+                 void(compositor::CompositorReport::SubCompositorId));
     MOCK_METHOD1(began_frame,
                  void(compositor::CompositorReport::SubCompositorId));
+    MOCK_METHOD1(filtered_occlusions,
+                 void(compositor::CompositorReport::SubCompositorId));
     MOCK_METHOD2(renderables_in_frame,
                  void(compositor::CompositorReport::SubCompositorId, graphics::RenderableList const&));
     MOCK_METHOD1(rendered_frame,
                  void(compositor::CompositorReport::SubCompositorId));
     MOCK_METHOD1(finished_frame,
                  void(compositor::CompositorReport::SubCompositorId));
+    MOCK_METHOD2(posted_frame,
+                 void(compositor::CompositorReport::SubCompositorId, int));
     MOCK_METHOD0(started, void());
     MOCK_METHOD0(stopped, void());
     MOCK_METHOD0(scheduled, void());
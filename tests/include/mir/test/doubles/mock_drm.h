@@ -102,6 +102,10 @@ public:
     MOCK_METHOD8(drmModeSetCrtc, int(int fd, uint32_t crtcId, uint32_t bufferId,
                                      uint32_t x, uint32_t y, uint32_t *connectors,
                                      int count, drmModeModeInfoPtr mode));
+    MOCK_METHOD(int, drmModeSetPlane, (int fd, uint32_t plane_id, uint32_t crtc_id, uint32_t fb_id,
+                                       uint32_t flags, int32_t crtc_x, int32_t crtc_y,
+                                       uint32_t crtc_w, uint32_t crtc_h,
+                                       uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h));
 
     MOCK_METHOD1(drmModeFreeResources, void(drmModeResPtr ptr));
     MOCK_METHOD1(drmModeFreeConnector, void(drmModeConnectorPtr ptr));
@@ -132,6 +136,15 @@ public:
     MOCK_METHOD2(drmModeGetProperty, drmModePropertyPtr(int fd, uint32_t propertyId));
     MOCK_METHOD1(drmModeFreeProperty, void(drmModePropertyPtr));
     MOCK_METHOD4(drmModeConnectorSetProperty, int(int fd, uint32_t connector_id, uint32_t property_id, uint64_t value));
+    MOCK_METHOD5(drmModeObjectSetProperty, int(int fd, uint32_t object_id, uint32_t object_type, uint32_t property_id, uint64_t value));
+
+    MOCK_METHOD(drmModeAtomicReqPtr, drmModeAtomicAlloc, ());
+    MOCK_METHOD(void, drmModeAtomicFree, (drmModeAtomicReqPtr req));
+    MOCK_METHOD(int, drmModeAtomicAddProperty,
+        (drmModeAtomicReqPtr req, uint32_t object_id, uint32_t property_id, uint64_t value));
+    MOCK_METHOD(int, drmModeAtomicCommit, (int fd, drmModeAtomicReqPtr req, uint32_t flags, void* user_data));
+    MOCK_METHOD(int, drmModeCreatePropertyBlob, (int fd, void const* data, size_t size, uint32_t* id));
+    MOCK_METHOD(int, drmModeDestroyPropertyBlob, (int fd, uint32_t id));
 
     MOCK_METHOD2(drmGetMagic, int(int fd, drm_magic_t *magic));
     MOCK_METHOD2(drmAuthMagic, int(int fd, drm_magic_t magic));
@@ -88,6 +88,10 @@ public:
     {
         return false;
     }
+    geometry::Rectangles opaque_region() const override
+    {
+        return {};
+    }
 private:
     std::shared_ptr<graphics::Buffer> make_stub_buffer(geometry::Rectangle const& rect)
     {
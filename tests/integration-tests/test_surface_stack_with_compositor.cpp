@@ -277,7 +277,7 @@ TEST_F(SurfaceStackCompositor, swapping_a_surface_that_has_been_added_triggers_a
 //test associated with lp:1290306, 1293896, 1294048, 1294051, 1294053
 TEST_F(SurfaceStackCompositor, compositor_runs_until_all_surfaces_buffers_are_consumed)
 {
-    std::function<void(mir::geometry::Size const&)> frame_callback;
+    std::function<void(mir::geometry::Size const&, mir::geometry::Rectangle const&)> frame_callback;
     ON_CALL(*mock_buffer_stream, buffers_ready_for_compositor(_))
         .WillByDefault(Return(5));
     EXPECT_CALL(*mock_buffer_stream, set_frame_posted_callback(_))
@@ -295,7 +295,7 @@ TEST_F(SurfaceStackCompositor, compositor_runs_until_all_surfaces_buffers_are_co
 
     stack.add_surface(stub_surface, mi::InputReceptionMode::normal);
     ASSERT_THAT(frame_callback, Ne(nullptr));
-    frame_callback({ 100, 100 });
+    frame_callback({ 100, 100 }, {{ 0, 0 }, { 100, 100 }});
 
     EXPECT_TRUE(stub_primary_db.has_posted_at_least(5, timeout));
     EXPECT_TRUE(stub_secondary_db.has_posted_at_least(5, timeout));
@@ -303,7 +303,7 @@ TEST_F(SurfaceStackCompositor, compositor_runs_until_all_surfaces_buffers_are_co
 
 TEST_F(SurfaceStackCompositor, bypassed_compositor_runs_until_all_surfaces_buffers_are_consumed)
 {
-    std::function<void(mir::geometry::Size const&)> frame_callback;
+    std::function<void(mir::geometry::Size const&, mir::geometry::Rectangle const&)> frame_callback;
     ON_CALL(*mock_buffer_stream, buffers_ready_for_compositor(_))
         .WillByDefault(Return(5));
     ON_CALL(*mock_buffer_stream, lock_compositor_buffer(_))
@@ -325,7 +325,7 @@ TEST_F(SurfaceStackCompositor, bypassed_compositor_runs_until_all_surfaces_buffe
 
     stack.add_surface(stub_surface, mi::InputReceptionMode::normal);
     ASSERT_THAT(frame_callback, Ne(nullptr));
-    frame_callback({ 100, 100 });
+    frame_callback({ 100, 100 }, {{ 0, 0 }, { 100, 100 }});
 
     EXPECT_TRUE(stub_primary_db.has_posted_at_least(5, timeout));
     EXPECT_TRUE(stub_secondary_db.has_posted_at_least(5, timeout));
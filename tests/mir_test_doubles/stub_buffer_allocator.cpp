@@ -88,11 +88,15 @@ auto mtd::StubBufferAllocator::buffer_from_resource(wl_resource*, std::function<
 
 auto mtd::StubBufferAllocator::buffer_from_shm(
     std::shared_ptr<mir::renderer::software::RWMappableBuffer> data,
+    std::shared_ptr<mg::Buffer> const& previous,
+    mir::geometry::Rectangle const& damage,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release) -> std::shared_ptr<mg::Buffer>
 {
     auto buffer = std::make_shared<mg::common::NotifyingMappableBackedShmBuffer>(
         std::move(data),
+        previous,
+        damage,
         std::make_shared<mg::common::EGLContextExecutor>(std::make_unique<mtd::NullGLContext>()),
         std::move(on_consumed),
         std::move(on_release));
@@ -16,6 +16,8 @@
 
 #include "test_window_manager_tools.h"
 
+#include <future>
+
 using namespace miral;
 using namespace testing;
 namespace mt = mir::test;
@@ -121,3 +123,96 @@ TEST_F(InitialWindowPlacement, initially_maximized_window_covers_only_one_output
     ASSERT_THAT(window.size(), Eq(display_area.size));
 }
 
+
+TEST_F(InitialWindowPlacement, window_management_can_proceed_while_a_new_surface_is_built)
+{
+    std::future<void> other_window_management;
+
+    auto const build = [&](
+        std::shared_ptr<mir::scene::Session> const& session,
+        mir::shell::SurfaceSpecification const& params)
+        {
+            other_window_management = std::async(std::launch::async, [this]
+                {
+                    basic_window_manager.invoke_under_lock([]{});
+                });
+
+            EXPECT_THAT(
+                other_window_management.wait_for(std::chrono::seconds{5}),
+                Eq(std::future_status::ready));
+
+            return create_surface(session, params);
+        };
+
+    mir::shell::SurfaceSpecification params;
+    params.set_size({200, 300});
+    basic_window_manager.add_surface(session, params, build);
+
+    other_window_management.get();
+}
+
+TEST_F(InitialWindowPlacement, window_is_placed_again_if_its_parent_is_removed_while_it_is_built)
+{
+    Window parent;
+    {
+        mir::shell::SurfaceSpecification params;
+        params.set_size({400, 300});
+        parent = create_window(params);
+        miral::WindowSpecification spec;
+        spec.top_left() = display_area.bottom_right() - Displacement{100, 100};
+        basic_window_manager.modify_window(basic_window_manager.info_for(parent), spec);
+    }
+
+    auto const build = [&](
+        std::shared_ptr<mir::scene::Session> const& session,
+        mir::shell::SurfaceSpecification const& params)
+        {
+            basic_window_manager.remove_surface(session, parent);
+            return create_surface(session, params);
+        };
+
+    Window child;
+    EXPECT_CALL(*window_manager_policy, advise_new_window(_))
+        .WillOnce([&child](WindowInfo const& window_info) { child = window_info.window(); });
+
+    mir::shell::SurfaceSpecification params;
+    params.type = mir_window_type_dialog;
+    params.parent = parent;
+    params.set_size({200, 100});
+    basic_window_manager.add_surface(session, params, build);
+
+    ASSERT_TRUE(child);
+    EXPECT_FALSE(basic_window_manager.info_for(child).parent());
+
+    // Centred on the parent, as it was first placed, it would have been mostly off-screen
+    Rectangle const child_area{child.top_left(), child.size()};
+    EXPECT_THAT(child_area.left(), Ge(display_area.left()));
+    EXPECT_THAT(child_area.top(), Ge(display_area.top()));
+    EXPECT_THAT(child_area.right(), Le(display_area.right()));
+    EXPECT_THAT(child_area.bottom(), Le(display_area.bottom()));
+}
+
+TEST_F(InitialWindowPlacement, window_is_placed_again_if_outputs_change_while_it_is_built)
+{
+    Rectangle const new_display_area{{2000, 0}, {1920, 1080}};
+
+    auto const build = [&](
+        std::shared_ptr<mir::scene::Session> const& session,
+        mir::shell::SurfaceSpecification const& params)
+        {
+            notify_configuration_applied(create_fake_display_configuration({new_display_area}));
+            return create_surface(session, params);
+        };
+
+    Window window;
+    EXPECT_CALL(*window_manager_policy, advise_new_window(_))
+        .WillOnce([&window](WindowInfo const& window_info) { window = window_info.window(); });
+
+    mir::shell::SurfaceSpecification params;
+    params.state = mir_window_state_maximized;
+    basic_window_manager.add_surface(session, params, build);
+
+    ASSERT_TRUE(window);
+    EXPECT_THAT(window.top_left(), Eq(new_display_area.top_left));
+    EXPECT_THAT(window.size(), Eq(new_display_area.size));
+}
@@ -187,3 +187,36 @@ TEST_F(MRUWindowList, hiding_then_showing_windows_retains_order)
     EXPECT_THAT(as_enumerated, ElementsAre(window_c, window_b, window_a));
 }
 
+
+TEST_F(MRUWindowList, pushing_the_enumerated_window_does_not_disturb_enumeration)
+{
+    mru_list.push(window_a);
+    mru_list.push(window_b);
+    mru_list.push(window_c);
+
+    std::vector<miral::Window> as_enumerated;
+
+    mru_list.enumerate([&](miral::Window& window)
+       { as_enumerated.push_back(window); mru_list.push(window); return true; });
+
+    EXPECT_THAT(as_enumerated, ElementsAre(window_c, window_b, window_a));
+    EXPECT_THAT(mru_list.top(), Eq(window_a));
+}
+
+TEST_F(MRUWindowList, a_window_whose_surface_has_been_released_can_be_erased)
+{
+    mru_list.push(window_a);
+    mru_list.push(window_b);
+    mru_list.push(window_c);
+
+    stub_session->surfaces[2].reset();
+    mru_list.erase(window_c);
+
+    std::vector<miral::Window> as_enumerated;
+
+    mru_list.enumerate([&](miral::Window& window)
+       { as_enumerated.push_back(window); return true; });
+
+    EXPECT_THAT(as_enumerated, ElementsAre(window_b, window_a));
+    EXPECT_THAT(mru_list.top(), Eq(window_b));
+}
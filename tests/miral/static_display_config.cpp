@@ -452,6 +452,22 @@ TEST_F(StaticDisplayConfig, group_can_be_set)
     EXPECT_THAT(hdmi1.logical_group_id, Eq(mg::DisplayConfigurationLogicalGroupId{2}));
 }
 
+TEST_F(StaticDisplayConfig, vrr_can_be_enabled)
+{
+    std::istringstream stream{
+        "layouts:\n"
+        "  default:\n"
+        "    cards:\n"
+        "    - HDMI-A-1:\n"
+        "        vrr: on\n"};
+
+    sdc.load_config(stream, "");
+    sdc.apply_to(dc);
+
+    EXPECT_THAT(hdmi1.vrr_enabled, Eq(true));
+    EXPECT_THAT(vga1.vrr_enabled, Eq(false));
+}
+
 TEST_F(StaticDisplayConfig, given_custom_attributes_when_they_are_not_added_they_are_not_applied)
 {
     std::istringstream stream{
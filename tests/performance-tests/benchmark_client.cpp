@@ -0,0 +1,639 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// A synthetic Wayland client for mir_compositor_benchmark
+//
+// It shows a number of windows, each redrawing as fast as frame callbacks allow,
+// and when done writes a one line JSON summary of how long those callbacks took
+// to the file descriptor it was given.
+
+#include "benchmark_samples.h"
+
+#include "xdg-shell.h"
+#ifdef MIR_BENCHMARK_DMABUF
+#include "linux-dmabuf-unstable-v1.h"
+#include <drm_fourcc.h>
+#include <gbm.h>
+#endif
+
+#include <wayland-client.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace mtb = mir::test::benchmark;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+enum class BufferType { shm, dmabuf };
+enum class Damage { full, partial, still };
+
+struct Options
+{
+    int index{0};
+    int windows{1};
+    int width{640};
+    int height{480};
+    BufferType buffers{BufferType::shm};
+    Damage damage{Damage::full};
+    std::string render_node{"/dev/dri/renderD128"};
+    std::chrono::milliseconds warmup{2s};
+    std::chrono::milliseconds duration{10s};
+    int results_fd{-1};
+};
+
+auto parse_options(int argc, char* argv[], Options& options) -> bool
+{
+    static option const long_options[] = {
+        {"index", required_argument, nullptr, 'i'},
+        {"windows", required_argument, nullptr, 'w'},
+        {"size", required_argument, nullptr, 's'},
+        {"buffers", required_argument, nullptr, 'b'},
+        {"damage", required_argument, nullptr, 'd'},
+        {"render-node", required_argument, nullptr, 'n'},
+        {"warmup-ms", required_argument, nullptr, 'u'},
+        {"duration-ms", required_argument, nullptr, 't'},
+        {"results-fd", required_argument, nullptr, 'r'},
+        {nullptr, 0, nullptr, 0}};
+
+    for (int opt; (opt = getopt_long(argc, argv, "", long_options, nullptr)) != -1;)
+    {
+        switch (opt)
+        {
+        case 'i':
+            options.index = atoi(optarg);
+            break;
+
+        case 'w':
+            options.windows = atoi(optarg);
+            break;
+
+        case 's':
+            if (!mtb::parse_size(optarg, options.width, options.height))
+                return false;
+            break;
+
+        case 'b':
+            if (strcmp(optarg, "shm") == 0)
+                options.buffers = BufferType::shm;
+            else if (strcmp(optarg, "dmabuf") == 0)
+                options.buffers = BufferType::dmabuf;
+            else
+                return false;
+            break;
+
+        case 'd':
+            if (strcmp(optarg, "full") == 0)
+                options.damage = Damage::full;
+            else if (strcmp(optarg, "partial") == 0)
+                options.damage = Damage::partial;
+            else if (strcmp(optarg, "still") == 0)
+                options.damage = Damage::still;
+            else
+                return false;
+            break;
+
+        case 'n':
+            options.render_node = optarg;
+            break;
+
+        case 'u':
+            options.warmup = std::chrono::milliseconds{atoi(optarg)};
+            break;
+
+        case 't':
+            options.duration = std::chrono::milliseconds{atoi(optarg)};
+            break;
+
+        case 'r':
+            options.results_fd = atoi(optarg);
+            break;
+
+        default:
+            return false;
+        }
+    }
+
+    return options.windows > 0 && options.results_fd >= 0;
+}
+
+auto cpu_time(rusage const& usage) -> std::chrono::microseconds
+{
+    return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+        std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+}
+
+class Client;
+
+class Window
+{
+public:
+    Window(Client& client, int index);
+    ~Window();
+
+private:
+    static int constexpr pixel_size = 4;
+
+    struct Buffer
+    {
+        wl_buffer* buffer{nullptr};
+        bool busy{false};
+        uint32_t* pixels{nullptr};
+        size_t size{0};
+#ifdef MIR_BENCHMARK_DMABUF
+        gbm_bo* bo{nullptr};
+#endif
+    };
+
+    void create_shm_buffer(Buffer& buffer);
+    void create_dmabuf_buffer(Buffer& buffer);
+    void fill(Buffer& buffer, int y, int rows, uint32_t colour);
+    void draw();
+
+    static void handle_configure(void* data, xdg_surface* xdg_surface, uint32_t serial);
+    static void handle_frame_done(void* data, wl_callback* callback, uint32_t time);
+    static void handle_release(void* data, wl_buffer* buffer);
+
+    static xdg_surface_listener const surface_listener;
+    static wl_callback_listener const frame_listener;
+    static wl_buffer_listener const buffer_listener;
+
+    Client& client;
+    wl_surface* const surface;
+    xdg_surface* const shell_surface;
+    xdg_toplevel* const toplevel;
+    std::array<Buffer, 3> buffers;
+
+    bool configured{false};
+    bool waiting_for_buffer{false};
+    wl_callback* frame_callback{nullptr};
+    Clock::time_point committed;
+    unsigned frame_count{0};
+};
+
+class Client
+{
+public:
+    explicit Client(Options const& options);
+    ~Client();
+
+    /// Draws until the warm-up and measurement are done, returning false on a protocol error
+    auto run() -> bool;
+    void write_results() const;
+
+private:
+    friend class Window;
+
+    static void handle_global(
+        void* data, wl_registry* registry, uint32_t name, char const* interface, uint32_t version);
+    static void handle_global_remove(void* data, wl_registry* registry, uint32_t name);
+    static void handle_ping(void* data, xdg_wm_base* wm_base, uint32_t serial);
+
+    static wl_registry_listener const registry_listener;
+    static xdg_wm_base_listener const wm_base_listener;
+
+    Options const options;
+    wl_display* const display;
+    wl_registry* registry{nullptr};
+    wl_compositor* compositor{nullptr};
+    wl_shm* shm{nullptr};
+    xdg_wm_base* wm_base{nullptr};
+#ifdef MIR_BENCHMARK_DMABUF
+    zwp_linux_dmabuf_v1* dmabuf{nullptr};
+    int render_node{-1};
+    gbm_device* gbm{nullptr};
+#endif
+    std::vector<std::unique_ptr<Window>> windows;
+
+    bool measuring{false};
+    mtb::Samples frame_latency;
+    std::chrono::microseconds cpu{0};
+};
+
+xdg_surface_listener const Window::surface_listener{&Window::handle_configure};
+wl_callback_listener const Window::frame_listener{&Window::handle_frame_done};
+wl_buffer_listener const Window::buffer_listener{&Window::handle_release};
+
+Window::Window(Client& client, int index) :
+    client{client},
+    surface{wl_compositor_create_surface(client.compositor)},
+    shell_surface{xdg_wm_base_get_xdg_surface(client.wm_base, surface)},
+    toplevel{xdg_surface_get_toplevel(shell_surface)}
+{
+    xdg_surface_add_listener(shell_surface, &surface_listener, this);
+
+    auto const title = "benchmark client " + std::to_string(client.options.index) +
+        " window " + std::to_string(index);
+    xdg_toplevel_set_title(toplevel, title.c_str());
+
+    for (auto& buffer : buffers)
+    {
+        if (client.options.buffers == BufferType::shm)
+            create_shm_buffer(buffer);
+        else
+            create_dmabuf_buffer(buffer);
+
+        wl_buffer_add_listener(buffer.buffer, &buffer_listener, this);
+    }
+
+    wl_surface_commit(surface);
+}
+
+Window::~Window()
+{
+    if (frame_callback)
+        wl_callback_destroy(frame_callback);
+
+    for (auto& buffer : buffers)
+    {
+        if (buffer.buffer)
+            wl_buffer_destroy(buffer.buffer);
+        if (buffer.pixels)
+            munmap(buffer.pixels, buffer.size);
+#ifdef MIR_BENCHMARK_DMABUF
+        if (buffer.bo)
+            gbm_bo_destroy(buffer.bo);
+#endif
+    }
+
+    xdg_toplevel_destroy(toplevel);
+    xdg_surface_destroy(shell_surface);
+    wl_surface_destroy(surface);
+}
+
+void Window::create_shm_buffer(Buffer& buffer)
+{
+    auto const& options = client.options;
+    auto const stride = options.width * pixel_size;
+    buffer.size = size_t(stride) * options.height;
+
+    auto const fd = memfd_create("mir-benchmark-buffer", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, buffer.size) < 0)
+    {
+        perror("Failed to create SHM buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    auto const pixels = mmap(nullptr, buffer.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pixels == MAP_FAILED)
+    {
+        perror("Failed to map SHM buffer");
+        exit(EXIT_FAILURE);
+    }
+    buffer.pixels = static_cast<uint32_t*>(pixels);
+
+    auto const pool = wl_shm_create_pool(client.shm, fd, buffer.size);
+    buffer.buffer = wl_shm_pool_create_buffer(
+        pool, 0, options.width, options.height, stride, WL_SHM_FORMAT_ARGB8888);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+}
+
+void Window::create_dmabuf_buffer([[maybe_unused]] Buffer& buffer)
+{
+#ifdef MIR_BENCHMARK_DMABUF
+    auto const& options = client.options;
+
+    buffer.bo = gbm_bo_create(
+        client.gbm, options.width, options.height, GBM_FORMAT_ARGB8888, GBM_BO_USE_LINEAR | GBM_BO_USE_RENDERING);
+    if (!buffer.bo)
+    {
+        perror("Failed to allocate dmabuf");
+        exit(EXIT_FAILURE);
+    }
+
+    auto const fd = gbm_bo_get_fd(buffer.bo);
+    auto const modifier = gbm_bo_get_modifier(buffer.bo);
+    auto const params = zwp_linux_dmabuf_v1_create_params(client.dmabuf);
+    zwp_linux_buffer_params_v1_add(
+        params, fd, 0, gbm_bo_get_offset(buffer.bo, 0), gbm_bo_get_stride(buffer.bo),
+        modifier >> 32, modifier & 0xffffffff);
+    buffer.buffer = zwp_linux_buffer_params_v1_create_immed(
+        params, options.width, options.height, DRM_FORMAT_ARGB8888, 0);
+    zwp_linux_buffer_params_v1_destroy(params);
+    close(fd);
+#else
+    fputs("This build doesn't support dmabuf clients\n", stderr);
+    exit(EXIT_FAILURE);
+#endif
+}
+
+void Window::fill(Buffer& buffer, int y, int rows, uint32_t colour)
+{
+    auto const width = client.options.width;
+
+    if (buffer.pixels)
+    {
+        std::fill_n(buffer.pixels + size_t(y) * width, size_t(rows) * width, colour);
+        return;
+    }
+
+#ifdef MIR_BENCHMARK_DMABUF
+    uint32_t stride;
+    void* map_data{nullptr};
+    auto const mapped = gbm_bo_map(buffer.bo, 0, y, width, rows, GBM_BO_TRANSFER_WRITE, &stride, &map_data);
+    if (!mapped)
+    {
+        perror("Failed to map dmabuf");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int row = 0; row != rows; ++row)
+        std::fill_n(reinterpret_cast<uint32_t*>(static_cast<char*>(mapped) + row * stride), width, colour);
+
+    gbm_bo_unmap(buffer.bo, map_data);
+#endif
+}
+
+void Window::draw()
+{
+    auto const free_buffer = std::find_if(buffers.begin(), buffers.end(), [](auto const& b) { return !b.busy; });
+    if (free_buffer == buffers.end())
+    {
+        waiting_for_buffer = true;
+        return;
+    }
+    waiting_for_buffer = false;
+
+    auto const& options = client.options;
+    uint32_t const colour = 0xff000000 | (frame_count & 0xff) * 0x010101;
+
+    if (options.damage == Damage::partial && frame_count > 0)
+    {
+        // A band an eighth of the window high, moving down a band each frame
+        auto const band = std::max(options.height / 8, 1);
+        auto const y = int(frame_count * band % (options.height - options.height % band));
+        fill(*free_buffer, y, band, colour);
+        wl_surface_damage_buffer(surface, 0, y, options.width, band);
+    }
+    else
+    {
+        fill(*free_buffer, 0, options.height, colour);
+        wl_surface_damage_buffer(surface, 0, 0, options.width, options.height);
+    }
+
+    free_buffer->busy = true;
+    wl_surface_attach(surface, free_buffer->buffer, 0, 0);
+
+    if (options.damage != Damage::still)
+    {
+        frame_callback = wl_surface_frame(surface);
+        wl_callback_add_listener(frame_callback, &frame_listener, this);
+    }
+
+    committed = Clock::now();
+    wl_surface_commit(surface);
+    ++frame_count;
+}
+
+void Window::handle_configure(void* data, xdg_surface* xdg_surface, uint32_t serial)
+{
+    auto const self = static_cast<Window*>(data);
+    xdg_surface_ack_configure(xdg_surface, serial);
+
+    if (!self->configured)
+    {
+        self->configured = true;
+        self->draw();
+    }
+}
+
+void Window::handle_frame_done(void* data, wl_callback* callback, uint32_t)
+{
+    auto const self = static_cast<Window*>(data);
+    wl_callback_destroy(callback);
+    self->frame_callback = nullptr;
+
+    if (self->client.measuring)
+        self->client.frame_latency.add(Clock::now() - self->committed);
+
+    self->draw();
+}
+
+void Window::handle_release(void* data, wl_buffer* released)
+{
+    auto const self = static_cast<Window*>(data);
+    for (auto& buffer : self->buffers)
+    {
+        if (buffer.buffer == released)
+            buffer.busy = false;
+    }
+
+    if (self->waiting_for_buffer)
+        self->draw();
+}
+
+wl_registry_listener const Client::registry_listener{&Client::handle_global, &Client::handle_global_remove};
+xdg_wm_base_listener const Client::wm_base_listener{&Client::handle_ping};
+
+Client::Client(Options const& options) :
+    options{options},
+    display{wl_display_connect(nullptr)},
+    // Enough for every window to draw at 1000Hz
+    frame_latency{size_t(options.windows) * (options.duration / 1ms + 1)}
+{
+    if (!display)
+    {
+        perror("Failed to connect to the Wayland server");
+        exit(EXIT_FAILURE);
+    }
+
+    registry = wl_display_get_registry(display);
+    wl_registry_add_listener(registry, &registry_listener, this);
+    wl_display_roundtrip(display);
+
+    if (!compositor || !shm || !wm_base)
+    {
+        fputs("Server is missing wl_compositor, wl_shm or xdg_wm_base\n", stderr);
+        exit(EXIT_FAILURE);
+    }
+
+#ifdef MIR_BENCHMARK_DMABUF
+    if (options.buffers == BufferType::dmabuf)
+    {
+        if (!dmabuf)
+        {
+            fputs("Server doesn't support zwp_linux_dmabuf_v1\n", stderr);
+            exit(EXIT_FAILURE);
+        }
+
+        render_node = open(options.render_node.c_str(), O_RDWR | O_CLOEXEC);
+        if (render_node < 0 || !(gbm = gbm_create_device(render_node)))
+        {
+            perror(("Failed to open " + options.render_node).c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+#endif
+
+    for (int i = 0; i != options.windows; ++i)
+        windows.push_back(std::make_unique<Window>(*this, i));
+}
+
+Client::~Client()
+{
+    windows.clear();
+
+#ifdef MIR_BENCHMARK_DMABUF
+    if (gbm)
+        gbm_device_destroy(gbm);
+    if (render_node >= 0)
+        close(render_node);
+    if (dmabuf)
+        zwp_linux_dmabuf_v1_destroy(dmabuf);
+#endif
+    if (wm_base)
+        xdg_wm_base_destroy(wm_base);
+    if (shm)
+        wl_shm_destroy(shm);
+    if (compositor)
+        wl_compositor_destroy(compositor);
+    wl_registry_destroy(registry);
+    wl_display_disconnect(display);
+}
+
+auto Client::run() -> bool
+{
+    auto const measure_from = Clock::now() + options.warmup;
+    auto const measure_until = measure_from + options.duration;
+    rusage usage_from{};
+
+    for (auto now = Clock::now(); now < measure_until; now = Clock::now())
+    {
+        if (!measuring && now >= measure_from)
+        {
+            measuring = true;
+            getrusage(RUSAGE_SELF, &usage_from);
+        }
+
+        while (wl_display_prepare_read(display) != 0)
+            wl_display_dispatch_pending(display);
+        wl_display_flush(display);
+
+        auto const next = measuring ? measure_until : measure_from;
+        auto const timeout = std::chrono::ceil<std::chrono::milliseconds>(next - now);
+
+        pollfd fd{wl_display_get_fd(display), POLLIN, 0};
+        if (poll(&fd, 1, timeout.count()) > 0)
+            wl_display_read_events(display);
+        else
+            wl_display_cancel_read(display);
+
+        if (wl_display_dispatch_pending(display) < 0)
+            break;
+    }
+
+    rusage usage_until{};
+    getrusage(RUSAGE_SELF, &usage_until);
+    cpu = cpu_time(usage_until) - cpu_time(usage_from);
+
+    if (auto const error = wl_display_get_error(display))
+    {
+        fprintf(stderr, "Wayland protocol error: %s\n", strerror(error));
+        return false;
+    }
+
+    return true;
+}
+
+void Client::write_results() const
+{
+    std::ostringstream out;
+    out << "{\"client\":" << options.index
+        << ",\"windows\":" << options.windows
+        << ",\"frames\":" << frame_latency.count()
+        << ",\"frame_latency\":";
+    frame_latency.write_json(out);
+    out << ",\"cpu_us\":" << cpu.count() << "}\n";
+
+    // A single write of less than PIPE_BUF bytes isn't interleaved with other clients' results
+    auto const results = out.str();
+    if (write(options.results_fd, results.data(), results.size()) != ssize_t(results.size()))
+        perror("Failed to write results");
+}
+
+void Client::handle_global(
+    void* data, wl_registry* registry, uint32_t name, char const* interface, uint32_t version)
+{
+    auto const self = static_cast<Client*>(data);
+
+    if (strcmp(interface, wl_compositor_interface.name) == 0)
+    {
+        self->compositor = static_cast<wl_compositor*>(
+            wl_registry_bind(registry, name, &wl_compositor_interface, std::min(version, 4u)));
+    }
+    else if (strcmp(interface, wl_shm_interface.name) == 0)
+    {
+        self->shm = static_cast<wl_shm*>(wl_registry_bind(registry, name, &wl_shm_interface, 1));
+    }
+    else if (strcmp(interface, xdg_wm_base_interface.name) == 0)
+    {
+        self->wm_base = static_cast<xdg_wm_base*>(wl_registry_bind(registry, name, &xdg_wm_base_interface, 1));
+        xdg_wm_base_add_listener(self->wm_base, &wm_base_listener, self);
+    }
+#ifdef MIR_BENCHMARK_DMABUF
+    else if (strcmp(interface, zwp_linux_dmabuf_v1_interface.name) == 0 && version >= 2)
+    {
+        self->dmabuf = static_cast<zwp_linux_dmabuf_v1*>(
+            wl_registry_bind(registry, name, &zwp_linux_dmabuf_v1_interface, std::min(version, 3u)));
+    }
+#endif
+}
+
+void Client::handle_global_remove(void*, wl_registry*, uint32_t)
+{
+}
+
+void Client::handle_ping(void*, xdg_wm_base* wm_base, uint32_t serial)
+{
+    xdg_wm_base_pong(wm_base, serial);
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr,
+            "Usage: %s --results-fd=<fd> [--index=<n>] [--windows=<n>] [--size=<width>x<height>]\n"
+            "    [--buffers=shm|dmabuf] [--damage=full|partial|still] [--render-node=<path>]\n"
+            "    [--warmup-ms=<ms>] [--duration-ms=<ms>]\n",
+            argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Client client{options};
+    auto const succeeded = client.run();
+    client.write_results();
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark_samples.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <ostream>
+
+namespace mtb = mir::test::benchmark;
+
+mtb::Samples::Samples(size_t capacity)
+{
+    usec.reserve(capacity);
+}
+
+void mtb::Samples::add(std::chrono::steady_clock::duration duration)
+{
+    if (usec.size() == usec.capacity())
+    {
+        ++dropped;
+        return;
+    }
+
+    usec.push_back(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+void mtb::Samples::clear()
+{
+    usec.clear();
+    dropped = 0;
+}
+
+auto mtb::Samples::count() const -> size_t
+{
+    return usec.size() + dropped;
+}
+
+void mtb::Samples::write_json(std::ostream& out) const
+{
+    out << "{\"count\":" << count();
+
+    if (!usec.empty())
+    {
+        auto sorted = usec;
+        std::sort(sorted.begin(), sorted.end());
+
+        // Nearest-rank percentiles: the smallest sample at least p% of samples don't exceed
+        auto const percentile = [&sorted](int p)
+            {
+                auto const rank = (p * sorted.size() + 99) / 100;
+                return sorted[std::max<size_t>(rank, 1) - 1];
+            };
+
+        out << ",\"mean_us\":" << std::accumulate(sorted.begin(), sorted.end(), int64_t{0}) / int64_t(sorted.size())
+            << ",\"p50_us\":" << percentile(50)
+            << ",\"p90_us\":" << percentile(90)
+            << ",\"p99_us\":" << percentile(99)
+            << ",\"max_us\":" << sorted.back();
+    }
+
+    out << '}';
+}
+
+auto mtb::parse_size(char const* value, int& width, int& height) -> bool
+{
+    char trailing;
+    return sscanf(value, "%dx%d%c", &width, &height, &trailing) == 2 && width > 0 && height > 0;
+}
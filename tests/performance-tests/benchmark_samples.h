@@ -0,0 +1,55 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_TEST_BENCHMARK_SAMPLES_H_
+#define MIR_TEST_BENCHMARK_SAMPLES_H_
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace mir { namespace test { namespace benchmark {
+
+/// Durations measured for one stage of a frame
+///
+/// Storage is reserved up front so that recording a sample never allocates,
+/// and doesn't show up in the allocations being counted. Samples beyond the
+/// capacity are counted, but otherwise dropped.
+class Samples
+{
+public:
+    explicit Samples(size_t capacity);
+
+    void add(std::chrono::steady_clock::duration duration);
+    void clear();
+
+    auto count() const -> size_t;
+
+    /// Writes the count, mean, median, 90th, 99th percentile and maximum as a JSON object
+    void write_json(std::ostream& out) const;
+
+private:
+    std::vector<int64_t> usec;
+    uint64_t dropped{0};
+};
+
+/// Parses a "<width>x<height>" option value, returning false if it isn't one
+auto parse_size(char const* value, int& width, int& height) -> bool;
+
+} } } // namespace mir::test::benchmark
+
+#endif // MIR_TEST_BENCHMARK_SAMPLES_H_
@@ -0,0 +1,555 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// A headless benchmark of the compositor pipeline
+//
+// Runs a server on the virtual display platform, starts a number of synthetic
+// clients (mir_benchmark_client) and, once they have warmed up, records how
+// long each stage of compositing takes, how many heap allocations the server
+// makes and how much CPU time it uses. The results are written as JSON so
+// that CI can compare them against a baseline.
+
+#include "benchmark_samples.h"
+
+#include <miral/minimal_window_manager.h>
+#include <miral/runner.h>
+#include <miral/set_window_management_policy.h>
+
+#include <mir/compositor/compositor_report.h>
+#include <mir/server.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace mc = mir::compositor;
+namespace mtb = mir::test::benchmark;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+std::atomic<uint64_t> allocations{0};
+}
+
+// Count every allocation in the server. Array and non-throwing forms all come through here.
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto const memory = std::malloc(size ? size : 1))
+        return memory;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+struct Options
+{
+    int clients{1};
+    int windows{1};
+    std::string size{"640x480"};
+    std::string output_size{"1280x1024"};
+    std::string buffers{"shm"};
+    std::string damage{"full"};
+    std::string render_node{"/dev/dri/renderD128"};
+    std::chrono::seconds warmup{2s};
+    std::chrono::seconds duration{10s};
+    std::string results;
+    std::vector<std::string> server_args;
+};
+
+auto parse_options(int argc, char* argv[], Options& options) -> bool
+{
+    static option const long_options[] = {
+        {"clients", required_argument, nullptr, 'c'},
+        {"windows", required_argument, nullptr, 'w'},
+        {"size", required_argument, nullptr, 's'},
+        {"output-size", required_argument, nullptr, 'o'},
+        {"buffers", required_argument, nullptr, 'b'},
+        {"damage", required_argument, nullptr, 'd'},
+        {"render-node", required_argument, nullptr, 'n'},
+        {"warmup", required_argument, nullptr, 'u'},
+        {"duration", required_argument, nullptr, 't'},
+        {"results", required_argument, nullptr, 'r'},
+        {nullptr, 0, nullptr, 0}};
+
+    int width, height;
+    for (int opt; (opt = getopt_long(argc, argv, "", long_options, nullptr)) != -1;)
+    {
+        switch (opt)
+        {
+        case 'c': options.clients = atoi(optarg); break;
+        case 'w': options.windows = atoi(optarg); break;
+        case 's': options.size = optarg; break;
+        case 'o': options.output_size = optarg; break;
+        case 'b': options.buffers = optarg; break;
+        case 'd': options.damage = optarg; break;
+        case 'n': options.render_node = optarg; break;
+        case 'u': options.warmup = std::chrono::seconds{atoi(optarg)}; break;
+        case 't': options.duration = std::chrono::seconds{atoi(optarg)}; break;
+        case 'r': options.results = optarg; break;
+        default: return false;
+        }
+    }
+
+    // Anything after "--" is passed to the server
+    for (int i = optind; i != argc; ++i)
+        options.server_args.push_back(argv[i]);
+
+    return options.clients > 0 && options.windows > 0 && options.duration > 0s &&
+        mtb::parse_size(options.size.c_str(), width, height) &&
+        (options.buffers == "shm" || options.buffers == "dmabuf") &&
+        (options.damage == "full" || options.damage == "partial" || options.damage == "still");
+}
+
+auto cpu_time() -> std::chrono::microseconds
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+        std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+}
+
+auto bin_dir() -> std::string
+{
+    char path[256];
+    auto len = readlink("/proc/self/exe", path, sizeof(path)-1);
+    if (len < 0)
+        len = 0;
+    path[len] = '\0';
+    if (auto slash = strrchr(path, '/'))
+        *slash = '\0';
+    return path;
+}
+
+/// Records the time taken by each stage of compositing, while recording is started
+///
+/// The stages are those the metrics compositor report uses: taking the scene snapshot,
+/// filtering occlusions, rendering and posting. "frame" is the whole of it.
+class RecordingReport : public mc::CompositorReport
+{
+public:
+    explicit RecordingReport(size_t capacity) :
+        scene_snapshot{capacity},
+        occlusion{capacity},
+        render{capacity},
+        post{capacity},
+        frame{capacity}
+    {
+    }
+
+    void start()
+    {
+        std::lock_guard lock{mutex};
+        for (auto samples : {&scene_snapshot, &occlusion, &render, &post, &frame})
+            samples->clear();
+        frames = bypassed_frames = missed_vblanks = 0;
+        recording = true;
+    }
+
+    void stop()
+    {
+        std::lock_guard lock{mutex};
+        recording = false;
+    }
+
+    auto frame_count() const -> uint64_t
+    {
+        std::lock_guard lock{mutex};
+        return frames;
+    }
+
+    void write_json(std::ostream& out) const
+    {
+        std::lock_guard lock{mutex};
+        out << "\"frames\":" << frames
+            << ",\"bypassed_frames\":" << bypassed_frames
+            << ",\"missed_vblanks\":" << missed_vblanks
+            << ",\"stages\":{\"scene_snapshot\":";
+        scene_snapshot.write_json(out);
+        out << ",\"occlusion\":";
+        occlusion.write_json(out);
+        out << ",\"render\":";
+        render.write_json(out);
+        out << ",\"post\":";
+        post.write_json(out);
+        out << ",\"frame\":";
+        frame.write_json(out);
+        out << '}';
+    }
+
+    void added_display(int, int, int, int, SubCompositorId id) override
+    {
+        std::lock_guard lock{mutex};
+        outputs[id] = Output{};
+    }
+
+    void began_scene_snapshot(SubCompositorId id) override
+    {
+        std::lock_guard lock{mutex};
+        outputs[id].snapshot_started = Clock::now();
+    }
+
+    void began_frame(SubCompositorId id) override
+    {
+        std::lock_guard lock{mutex};
+        auto& output = outputs[id];
+        output.frame_started = Clock::now();
+        output.bypassed = true;
+        if (recording)
+            scene_snapshot.add(output.frame_started - output.snapshot_started);
+    }
+
+    void filtered_occlusions(SubCompositorId id) override
+    {
+        std::lock_guard lock{mutex};
+        auto& output = outputs[id];
+        output.occlusions_filtered = Clock::now();
+        if (recording)
+            occlusion.add(output.occlusions_filtered - output.frame_started);
+    }
+
+    void renderables_in_frame(SubCompositorId, mir::graphics::RenderableList const&) override
+    {
+    }
+
+    void rendered_frame(SubCompositorId id) override
+    {
+        std::lock_guard lock{mutex};
+        auto& output = outputs[id];
+        output.bypassed = false;
+        if (recording)
+            render.add(Clock::now() - output.occlusions_filtered);
+    }
+
+    void finished_frame(SubCompositorId id) override
+    {
+        std::lock_guard lock{mutex};
+        auto& output = outputs[id];
+        output.frame_finished = Clock::now();
+        if (recording)
+        {
+            ++frames;
+            if (output.bypassed)
+                ++bypassed_frames;
+        }
+    }
+
+    void posted_frame(SubCompositorId id, int missed) override
+    {
+        std::lock_guard lock{mutex};
+        auto& output = outputs[id];
+        if (recording)
+        {
+            auto const now = Clock::now();
+            post.add(now - output.frame_finished);
+            frame.add(now - output.snapshot_started);
+            if (missed > 0)
+                missed_vblanks += missed;
+        }
+    }
+
+    void started() override
+    {
+    }
+
+    void stopped() override
+    {
+    }
+
+    void scheduled() override
+    {
+    }
+
+private:
+    struct Output
+    {
+        Clock::time_point snapshot_started;
+        Clock::time_point frame_started;
+        Clock::time_point occlusions_filtered;
+        Clock::time_point frame_finished;
+        bool bypassed{false};
+    };
+
+    std::mutex mutable mutex;
+    bool recording{false};
+    std::unordered_map<SubCompositorId, Output> outputs;
+    mtb::Samples scene_snapshot;
+    mtb::Samples occlusion;
+    mtb::Samples render;
+    mtb::Samples post;
+    mtb::Samples frame;
+    uint64_t frames{0};
+    uint64_t bypassed_frames{0};
+    uint64_t missed_vblanks{0};
+};
+
+class Benchmark
+{
+public:
+    Benchmark(Options const& options, std::shared_ptr<RecordingReport> const& report) :
+        options{options},
+        report{report}
+    {
+    }
+
+    /// Starts the clients, measures the server while they run, and writes the results
+    ///
+    /// \return whether all the clients ran and reported their results
+    auto run() -> bool
+    {
+        int results_pipe[2];
+        if (pipe(results_pipe) < 0)
+        {
+            perror("Failed to create results pipe");
+            return false;
+        }
+        fcntl(results_pipe[0], F_SETFD, FD_CLOEXEC);
+
+        for (int i = 0; i != options.clients; ++i)
+            spawn_client(i, results_pipe[1]);
+        close(results_pipe[1]);
+
+        std::this_thread::sleep_for(options.warmup);
+
+        auto const cpu_from = cpu_time();
+        auto const allocations_from = allocations.load();
+        report->start();
+
+        std::this_thread::sleep_for(options.duration);
+
+        report->stop();
+        auto const allocations_made = allocations.load() - allocations_from;
+        auto const cpu_used = cpu_time() - cpu_from;
+
+        auto const clients_succeeded = wait_for_clients();
+        auto const client_results = read_results(results_pipe[0]);
+        close(results_pipe[0]);
+
+        auto const frames = report->frame_count();
+
+        std::ostringstream out;
+        out << "{\"configuration\":{"
+            << "\"clients\":" << options.clients
+            << ",\"windows_per_client\":" << options.windows
+            << ",\"size\":\"" << options.size << '"'
+            << ",\"output_size\":\"" << options.output_size << '"'
+            << ",\"buffers\":\"" << options.buffers << '"'
+            << ",\"damage\":\"" << options.damage << '"'
+            << ",\"warmup_s\":" << options.warmup.count()
+            << ",\"duration_s\":" << options.duration.count()
+            << "},\"server\":{";
+        report->write_json(out);
+        out << ",\"frames_per_second\":" << double(frames) / options.duration.count()
+            << ",\"cpu_us\":" << cpu_used.count()
+            << ",\"allocations\":" << allocations_made
+            << ",\"allocations_per_frame\":" << (frames ? double(allocations_made) / frames : 0.0)
+            << "},\"clients\":[";
+        for (auto const& result : client_results)
+            out << (&result == client_results.data() ? "" : ",") << result;
+        out << "]}\n";
+
+        if (options.results.empty())
+        {
+            std::cout << out.str() << std::flush;
+        }
+        else
+        {
+            std::ofstream file{options.results};
+            file << out.str();
+            if (!file)
+            {
+                std::cerr << "Failed to write results to " << options.results << std::endl;
+                return false;
+            }
+        }
+
+        return clients_succeeded && client_results.size() == size_t(options.clients);
+    }
+
+private:
+    void spawn_client(int index, int results_fd)
+    {
+        auto const client = bin_dir() + "/mir_benchmark_client";
+        auto const duration = std::chrono::milliseconds{options.duration};
+
+        std::vector<std::string> args{
+            client,
+            "--index=" + std::to_string(index),
+            "--windows=" + std::to_string(options.windows),
+            "--size=" + options.size,
+            "--buffers=" + options.buffers,
+            "--damage=" + options.damage,
+            "--render-node=" + options.render_node,
+            "--warmup-ms=" + std::to_string(std::chrono::milliseconds{options.warmup}.count()),
+            "--duration-ms=" + std::to_string(duration.count()),
+            "--results-fd=" + std::to_string(results_fd)};
+
+        std::vector<char*> argv;
+        for (auto& arg : args)
+            argv.push_back(arg.data());
+        argv.push_back(nullptr);
+
+        pid_t pid;
+        if (auto const error = posix_spawn(&pid, client.c_str(), nullptr, nullptr, argv.data(), environ))
+        {
+            std::cerr << "Failed to start " << client << ": " << strerror(error) << std::endl;
+            return;
+        }
+        client_pids.push_back(pid);
+    }
+
+    auto wait_for_clients() -> bool
+    {
+        auto const deadline = Clock::now() + 10s;
+        bool succeeded = client_pids.size() == size_t(options.clients);
+
+        for (auto const pid : client_pids)
+        {
+            int status;
+            pid_t result;
+            while ((result = waitpid(pid, &status, WNOHANG)) == 0 && Clock::now() < deadline)
+                std::this_thread::sleep_for(10ms);
+
+            if (result == 0)
+            {
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                succeeded = false;
+            }
+            else if (result < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+            {
+                succeeded = false;
+            }
+        }
+
+        return succeeded;
+    }
+
+    static auto read_results(int fd) -> std::vector<std::string>
+    {
+        std::string all;
+        char buffer[4096];
+        for (ssize_t n; (n = read(fd, buffer, sizeof buffer)) > 0;)
+            all.append(buffer, n);
+
+        std::vector<std::string> results;
+        std::istringstream lines{all};
+        for (std::string line; std::getline(lines, line);)
+        {
+            if (!line.empty())
+                results.push_back(line);
+        }
+        return results;
+    }
+
+    Options const options;
+    std::shared_ptr<RecordingReport> const report;
+    std::vector<pid_t> client_pids;
+};
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr,
+            "Usage: %s [--clients=<n>] [--windows=<n per client>] [--size=<width>x<height>]\n"
+            "    [--output-size=<width>x<height>] [--buffers=shm|dmabuf] [--damage=full|partial|still]\n"
+            "    [--render-node=<path>] [--warmup=<seconds>] [--duration=<seconds>] [--results=<file>]\n"
+            "    [-- <server options>...]\n",
+            argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The clients inherit this, so they connect to the server under test
+    auto const socket = "mir-benchmark-" + std::to_string(getpid());
+    setenv("WAYLAND_DISPLAY", socket.c_str(), true);
+
+    std::vector<std::string> server_args{
+        argv[0],
+        "--platform-display-libs=mir:virtual",
+        "--virtual-output=" + options.output_size};
+    server_args.insert(server_args.end(), options.server_args.begin(), options.server_args.end());
+
+    std::vector<char const*> server_argv;
+    for (auto const& arg : server_args)
+        server_argv.push_back(arg.c_str());
+    server_argv.push_back(nullptr);
+
+    // Room for every stage of a 1000Hz compositor, which is far more than the virtual display manages
+    auto const report = std::make_shared<RecordingReport>((options.duration / 1ms) + 1);
+
+    miral::MirRunner runner{int(server_argv.size() - 1), server_argv.data()};
+
+    std::atomic<bool> succeeded{false};
+    std::thread benchmark;
+    runner.add_start_callback([&]
+        {
+            benchmark = std::thread{[&]
+                {
+                    succeeded = Benchmark{options, report}.run();
+                    runner.stop();
+                }};
+        });
+
+    auto const status = runner.run_with(
+        {
+            miral::set_window_management_policy<miral::MinimalWindowManager>(),
+            [&](mir::Server& server)
+            {
+                server.override_the_compositor_report([&] { return report; });
+            }
+        });
+
+    if (benchmark.joinable())
+        benchmark.join();
+
+    return status == EXIT_SUCCESS && succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/default_display_buffer_compositor.h"
+#include "src/server/compositor/stream.h"
+#include "src/server/report/null_report_factory.h"
+#include "src/server/scene/basic_surface.h"
+#include "src/server/scene/surface_stack.h"
+#include "mir/input/input_reception_mode.h"
+#include "mir/test/doubles/stub_buffer.h"
+#include "mir/test/doubles/stub_display_sink.h"
+#include "mir/test/doubles/stub_gl_rendering_provider.h"
+#include "mir/test/doubles/stub_renderer.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <list>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace mi = mir::input;
+namespace mr = mir::report;
+namespace ms = mir::scene;
+namespace mtd = mir::test::doubles;
+namespace mw = mir::wayland;
+namespace mf = mir::frontend;
+namespace geom = mir::geometry;
+using namespace testing;
+
+namespace
+{
+std::atomic<uint64_t> allocations{0};
+}
+
+// Count every allocation in the server. Array and non-throwing forms all come through here.
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto const memory = std::malloc(size ? size : 1))
+        return memory;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+int const rows = 4;
+int const columns = 4;
+geom::Size const window_size{200, 200};
+
+struct CompositorAllocations : Test
+{
+    CompositorAllocations()
+    {
+        // A grid of windows, none hiding another, so every one is in every frame
+        for (int row = 0; row != rows; ++row)
+        {
+            for (int column = 0; column != columns; ++column)
+            {
+                auto const stream = std::make_shared<mc::Stream>(window_size, mir_pixel_format_abgr_8888);
+                stream->submit_buffer(std::make_shared<mtd::StubBuffer>(window_size));
+
+                auto const surface = std::make_shared<ms::BasicSurface>(
+                    nullptr /* session */,
+                    mw::Weak<mf::WlSurface>{},
+                    std::string("window"),
+                    geom::Rectangle{{column * 250, row * 250}, window_size},
+                    mir_pointer_unconfined,
+                    std::list<ms::StreamInfo>{{stream, {0, 0}, {}}},
+                    std::shared_ptr<mg::CursorImage>(),
+                    scene_report);
+                stack.add_surface(surface, mi::InputReceptionMode::normal);
+                surfaces.push_back(surface);
+            }
+        }
+    }
+
+    /// The heap allocations made building and compositing one frame
+    auto allocations_for_frame() -> uint64_t
+    {
+        auto const from = allocations.load();
+        compositor.composite(stack.scene_elements_for(&compositor));
+        return allocations.load() - from;
+    }
+
+    std::shared_ptr<ms::SceneReport> const scene_report{mr::null_scene_report()};
+    ms::SurfaceStack stack{scene_report};
+    std::vector<std::shared_ptr<ms::BasicSurface>> surfaces;
+
+    mtd::StubDisplaySink display_sink{{{0, 0}, {1280, 1024}}};
+    mtd::StubGlRenderingProvider gl_provider;
+    mc::DefaultDisplayBufferCompositor compositor{
+        display_sink,
+        gl_provider,
+        std::make_shared<mtd::StubRenderer>(),
+        mr::null_compositor_report()};
+};
+}
+
+// Frames after the first reuse the scene element arena and the compositor's
+// scratch vectors, so redrawing an unchanged scene mustn't take more from the heap
+TEST_F(CompositorAllocations, steady_state_frames_allocate_a_constant_amount)
+{
+    auto const first_frame = allocations_for_frame();
+    auto const steady_state = allocations_for_frame();
+
+    EXPECT_THAT(steady_state, Lt(first_frame));
+
+    int const frames = 100;
+    for (int i = 0; i != frames; ++i)
+        ASSERT_THAT(allocations_for_frame(), Eq(steady_state)) << "after " << i << " frames";
+
+    RecordProperty("first_frame_allocations", std::to_string(first_frame));
+    RecordProperty("steady_state_allocations", std::to_string(steady_state));
+}
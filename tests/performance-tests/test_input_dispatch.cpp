@@ -0,0 +1,94 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/input/input_device_info.h"
+#include "mir/input/composite_event_filter.h"
+#include "mir/input/event_filter.h"
+
+#include "mir_test_framework/headless_in_process_server.h"
+#include "mir_test_framework/input_device_faker.h"
+#include "mir_test_framework/fake_input_device.h"
+#include "mir/test/event_factory.h"
+#include "mir/test/signal.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace mi = mir::input;
+namespace mt = mir::test;
+namespace mis = mir::input::synthesis;
+namespace mtf = mir_test_framework;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+/// Counts the events reaching the end of the filter chain, without consuming them
+struct CountingFilter : mi::EventFilter
+{
+    explicit CountingFilter(int expected)
+        : expected{expected}
+    {
+    }
+
+    bool handle(MirEvent const&) override
+    {
+        if (++count == expected)
+            all_seen.raise();
+        return false;
+    }
+
+    int const expected;
+    std::atomic<int> count{0};
+    mt::Signal all_seen;
+};
+
+struct InputDispatchPerformance : mtf::HeadlessInProcessServer, mtf::InputDeviceFaker
+{
+    void SetUp() override
+    {
+        HeadlessInProcessServer::SetUp();
+        fake_pointer = add_fake_input_device(
+            mi::InputDeviceInfo{"mouse", "mouse-uid", mi::DeviceCapability::pointer});
+        wait_for_input_devices_added_to(server);
+    }
+
+    mir::UniqueModulePtr<mtf::FakeInputDevice> fake_pointer;
+};
+}
+
+TEST_F(InputDispatchPerformance, pointer_motion_through_default_chain)
+{
+    int const events = 20000;
+    auto const filter = std::make_shared<CountingFilter>(events);
+    server.the_composite_event_filter()->append(filter);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i != events; ++i)
+        fake_pointer->emit_event(mis::a_pointer_event().with_movement(1, 1));
+
+    bool const delivered = filter->all_seen.wait_for(60s);
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_TRUE(delivered);
+    EXPECT_EQ(events, filter->count);
+
+    RecordProperty("events", std::to_string(filter->count));
+    RecordProperty("events_per_second", std::to_string(filter->count / elapsed.count()));
+}
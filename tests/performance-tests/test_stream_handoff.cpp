@@ -0,0 +1,95 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/stream.h"
+#include "mir/test/doubles/stub_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+struct StreamHandoffPerformance : testing::Test
+{
+    geom::Size const size{64, 64};
+    mc::Stream stream{size, mir_pixel_format_abgr_8888};
+    std::array<std::shared_ptr<mg::Buffer>, 3> const buffers{
+        std::make_shared<mtd::StubBuffer>(size),
+        std::make_shared<mtd::StubBuffer>(size),
+        std::make_shared<mtd::StubBuffer>(size)};
+};
+}
+
+// One client submitting as fast as it can to a framedropping stream while two
+// compositors (say, on two outputs) poll it and take whatever is newest.
+TEST_F(StreamHandoffPerformance, framedropping_submissions_against_two_compositors)
+{
+    stream.allow_framedropping(true);
+
+    std::atomic<bool> done{false};
+    std::atomic<long> polls{0};
+
+    auto const compositor = [&]
+        {
+            long local_polls{0};
+            while (!done)
+            {
+                if (stream.buffers_ready_for_compositor(&local_polls) > 0)
+                    stream.lock_compositor_buffer(&local_polls);
+                ++local_polls;
+            }
+            polls += local_polls;
+        };
+
+    std::vector<std::thread> compositors;
+    compositors.emplace_back(compositor);
+    compositors.emplace_back(compositor);
+
+    long submissions{0};
+    auto const start = std::chrono::steady_clock::now();
+    auto const deadline = start + 2s;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        for (auto const& buffer : buffers)
+            stream.submit_buffer(buffer);
+        submissions += buffers.size();
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+    done = true;
+    for (auto& thread : compositors)
+        thread.join();
+
+    EXPECT_GT(submissions, 0);
+    EXPECT_GT(polls, 0);
+
+    RecordProperty("submissions_per_second", std::to_string(submissions / elapsed.count()));
+    RecordProperty("polls_per_second", std::to_string(polls / elapsed.count()));
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_window_manager_tools.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace miral;
+using namespace testing;
+namespace mt = mir::test;
+
+namespace
+{
+Rectangle const display_area{{0, 0}, {1280, 720}};
+
+int const windows_per_workspace = 4;
+int const workspace_count = 1000;
+int const window_count = windows_per_workspace * workspace_count;
+
+struct WindowManagementPerformance : mt::TestWindowManagerTools
+{
+    void SetUp() override
+    {
+        notify_configuration_applied(create_fake_display_configuration({display_area}));
+        basic_window_manager.add_session(session);
+
+        EXPECT_CALL(*window_manager_policy, advise_new_window(_))
+            .WillRepeatedly([this](WindowInfo const& window_info) { windows.push_back(window_info.window()); });
+        EXPECT_CALL(*window_manager_policy, advise_raise(_)).Times(AnyNumber());
+        EXPECT_CALL(*window_manager_policy, advise_move_to(_, _)).Times(AnyNumber());
+        EXPECT_CALL(*window_manager_policy, advise_resize(_, _)).Times(AnyNumber());
+    }
+
+    template<typename Action>
+    auto time(Action const& action) -> double
+    {
+        auto const start = std::chrono::steady_clock::now();
+        action();
+        return std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+    }
+
+    void record(std::string const& name, int operations, double seconds)
+    {
+        RecordProperty(name + "_per_second", std::to_string(operations / seconds));
+    }
+
+    std::vector<Window> windows;
+    std::vector<std::shared_ptr<Workspace>> workspaces;
+};
+}
+
+// Thousands of windows of one application, spread over a thousand workspaces:
+// the lookups on the MRU list and workspace membership must not grow with either.
+TEST_F(WindowManagementPerformance, thousands_of_windows_on_thousands_of_workspaces)
+{
+    mir::shell::SurfaceSpecification creation_parameters;
+    creation_parameters.type = mir_window_type_normal;
+    creation_parameters.set_size({100, 100});
+
+    record("window_creation", window_count, time([&]
+        {
+            for (int i = 0; i != window_count; ++i)
+            {
+                basic_window_manager.add_surface(session, creation_parameters, &create_surface);
+                basic_window_manager.select_active_window(windows.back());
+            }
+        }));
+    ASSERT_THAT(windows.size(), Eq(static_cast<size_t>(window_count)));
+
+    record("workspace_assignment", window_count, time([&]
+        {
+            for (int i = 0; i != workspace_count; ++i)
+            {
+                workspaces.push_back(window_manager_tools.create_workspace());
+                for (int j = 0; j != windows_per_workspace; ++j)
+                    window_manager_tools.add_tree_to_workspace(windows[i*windows_per_workspace + j], workspaces.back());
+            }
+        }));
+
+    // Each step has to skip the windows that aren't on the active window's workspace
+    int const focus_changes = 1000;
+    record("focus_change", focus_changes, time([&]
+        {
+            for (int i = 0; i != focus_changes; ++i)
+                window_manager_tools.focus_next_within_application();
+        }));
+    EXPECT_TRUE(window_manager_tools.active_window());
+
+    record("window_selection", window_count, time([&]
+        {
+            for (auto const& window : windows)
+                basic_window_manager.select_active_window(window);
+        }));
+
+    record("workspace_move", workspace_count - 1, time([&]
+        {
+            for (int i = 1; i != workspace_count; ++i)
+                window_manager_tools.move_workspace_content_to_workspace(workspaces[0], workspaces[i]);
+        }));
+
+    record("window_removal", window_count, time([&]
+        {
+            for (auto const& window : windows)
+                basic_window_manager.remove_surface(session, window);
+        }));
+    EXPECT_FALSE(window_manager_tools.active_window());
+}
@@ -442,6 +442,11 @@ void basic_software_buffer_drawing(
             return mg::contains_alpha(buffer_->pixel_format());
         }
 
+        auto opaque_region() const -> mir::geometry::Rectangles override
+        {
+            return {};
+        }
+
         auto clip_area() const -> std::optional<mir::geometry::Rectangle> override
         {
             return std::optional<mir::geometry::Rectangle>{};
@@ -288,3 +288,97 @@ TEST_F(BasicScreenShooter, ensures_renderer_is_current_on_only_one_thread)
     mir::ThreadPoolExecutor::quiesce();
     EXPECT_THAT(call_count, Eq(expected_call_count));
 }
+
+namespace
+{
+/// Captures into a CPU-addressable target as a copying output surface does: mapping it, then writing its damage
+struct BasicScreenShooterDamage : BasicScreenShooter
+{
+    BasicScreenShooterDamage()
+    {
+        ON_CALL(*gl_provider, surface_for_sink(_, _))
+            .WillByDefault(
+                [this](mg::DisplaySink& sink, auto const&)
+                    -> std::unique_ptr<mg::gl::OutputSurface>
+                {
+                    auto const cpu_provider = sink.acquire_compatible_allocator<mg::CPUAddressableDisplayAllocator>();
+                    auto surface = std::make_unique<testing::NiceMock<mtd::MockOutputSurface>>();
+                    ON_CALL(*surface, commit())
+                        .WillByDefault(
+                            [this, cpu_provider]() -> std::unique_ptr<mg::Framebuffer>
+                            {
+                                auto fb = cpu_provider->alloc_fb(cpu_provider->supported_formats().front());
+                                auto const mapping = fb->map_writeable();
+                                written.push_back(fb->damage());
+                                return fb;
+                            });
+                    return surface;
+                });
+    }
+
+    void capture(std::shared_ptr<mtd::StubBuffer> const& target, geom::Rectangle const& area)
+    {
+        shooter->capture(target, area, [](auto) {});
+        executor.execute();
+    }
+
+    void capture_with_damage(
+        std::shared_ptr<mtd::StubBuffer> const& target,
+        geom::Rectangle const& area,
+        geom::Rectangle const& damage)
+    {
+        shooter->capture_with_damage(target, area, damage, [](auto) {});
+        executor.execute();
+    }
+
+    /// The damage each capture wrote, where nullopt is the whole buffer
+    std::vector<std::optional<geom::Rectangle>> written;
+    geom::Rectangle const damage{{10, 20}, {30, 40}};
+};
+}
+
+TEST_F(BasicScreenShooterDamage, first_capture_writes_the_whole_buffer)
+{
+    capture_with_damage(buffer, viewport_rect, damage);
+
+    EXPECT_THAT(written, ElementsAre(Eq(std::nullopt)));
+}
+
+TEST_F(BasicScreenShooterDamage, capture_into_the_buffer_holding_the_last_capture_writes_only_the_damage)
+{
+    capture(buffer, viewport_rect);
+    capture_with_damage(buffer, viewport_rect, damage);
+    capture_with_damage(buffer, viewport_rect, damage);
+
+    EXPECT_THAT(written, ElementsAre(Eq(std::nullopt), Eq(damage), Eq(damage)));
+}
+
+TEST_F(BasicScreenShooterDamage, capture_into_another_buffer_writes_the_whole_buffer)
+{
+    auto const other_buffer = std::make_shared<mtd::StubBuffer>(buffer->size());
+
+    capture(buffer, viewport_rect);
+    capture_with_damage(other_buffer, viewport_rect, damage);
+    capture_with_damage(buffer, viewport_rect, damage);
+
+    EXPECT_THAT(written, ElementsAre(Eq(std::nullopt), Eq(std::nullopt), Eq(std::nullopt)));
+}
+
+TEST_F(BasicScreenShooterDamage, capture_of_another_area_writes_the_whole_buffer)
+{
+    capture(buffer, viewport_rect);
+    capture_with_damage(buffer, {{0, 0}, viewport_rect.size}, damage);
+
+    EXPECT_THAT(written, ElementsAre(Eq(std::nullopt), Eq(std::nullopt)));
+}
+
+TEST_F(BasicScreenShooterDamage, resized_capture_writes_the_whole_buffer)
+{
+    auto const resized_buffer = std::make_shared<mtd::StubBuffer>(geom::Size{1024, 768});
+
+    capture(buffer, viewport_rect);
+    next_renderer = std::make_unique<testing::NiceMock<mtd::MockRenderer>>();
+    capture_with_damage(resized_buffer, viewport_rect, damage);
+
+    EXPECT_THAT(written, ElementsAre(Eq(std::nullopt), Eq(std::nullopt)));
+}
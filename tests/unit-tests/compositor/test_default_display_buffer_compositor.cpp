@@ -286,6 +286,31 @@ struct MockSceneElement : mc::SceneElement
 };
 }
 
+
+TEST_F(DefaultDisplayBufferCompositor, partly_covered_surfaces_are_clipped_to_their_visible_part)
+{
+    using namespace testing;
+
+    auto const bottom = std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{0, 0}, {200, 100}});
+    auto const top = std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{100, 0}, {100, 100}});
+
+    mg::RenderableList rendered;
+    EXPECT_CALL(mock_renderer, render(_))
+        .WillOnce(DoAll(SaveArg<0>(&rendered), Return(ByMove(std::unique_ptr<mg::Framebuffer>{}))));
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_sink,
+        gl_provider,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+    compositor.composite(make_scene_elements({bottom, top}));
+
+    ASSERT_THAT(rendered.size(), Eq(2u));
+    EXPECT_THAT(rendered[0]->id(), Eq(bottom->id()));
+    EXPECT_THAT(rendered[0]->screen_position(), Eq(bottom->screen_position()));
+    EXPECT_THAT(rendered[0]->clip_area(), Eq(std::make_optional(geom::Rectangle{{0, 0}, {100, 100}})));
+    EXPECT_THAT(rendered[1], Eq(top));
+}
 TEST_F(DefaultDisplayBufferCompositor, marks_rendered_scene_elements)
 {
     using namespace testing;
@@ -331,3 +356,128 @@ TEST_F(DefaultDisplayBufferCompositor, marks_occluded_scene_elements)
     compositor.composite({element0_occluded, element1_rendered, element2_occluded});
 }
 
+
+namespace
+{
+struct StubFramebuffer : mg::Framebuffer
+{
+    auto size() const -> geom::Size override { return {}; }
+};
+
+/// Can scan out one particular buffer, and nothing else
+struct ScanoutGlRenderingProvider : mtd::StubGlRenderingProvider
+{
+    explicit ScanoutGlRenderingProvider(std::shared_ptr<mg::Buffer> scanout_buffer)
+        : scanout_buffer{std::move(scanout_buffer)}
+    {
+    }
+
+    auto make_framebuffer_provider(mg::DisplaySink& /*sink*/) -> std::unique_ptr<FramebufferProvider> override
+    {
+        class Provider : public FramebufferProvider
+        {
+        public:
+            explicit Provider(std::shared_ptr<mg::Buffer> scanout_buffer)
+                : scanout_buffer{std::move(scanout_buffer)}
+            {
+            }
+
+            auto buffer_to_framebuffer(std::shared_ptr<mg::Buffer> buffer) -> std::unique_ptr<mg::Framebuffer> override
+            {
+                if (buffer == scanout_buffer)
+                {
+                    return std::make_unique<StubFramebuffer>();
+                }
+                return {};
+            }
+
+        private:
+            std::shared_ptr<mg::Buffer> const scanout_buffer;
+        };
+        return std::make_unique<Provider>(scanout_buffer);
+    }
+
+    std::shared_ptr<mg::Buffer> const scanout_buffer;
+};
+}
+
+TEST_F(DefaultDisplayBufferCompositor, top_of_stack_goes_on_overlay_and_the_rest_is_rendered)
+{
+    using namespace testing;
+    ScanoutGlRenderingProvider scanout_provider{small->buffer()};
+
+    EXPECT_CALL(display_sink, accepts_overlays(SizeIs(1)))
+        .WillOnce(Return(true));
+    EXPECT_CALL(mock_renderer, render(ContainerEq(mg::RenderableList{fullscreen})));
+    EXPECT_CALL(display_sink, overlay(SizeIs(2)))
+        .WillOnce(Return(true));
+    EXPECT_CALL(display_sink, set_next_image(_))
+        .Times(0);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_sink,
+        scanout_provider,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+    compositor.composite(make_scene_elements({fullscreen, small}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, overlays_refused_by_the_display_are_not_retried)
+{
+    using namespace testing;
+    ScanoutGlRenderingProvider scanout_provider{small->buffer()};
+
+    EXPECT_CALL(display_sink, accepts_overlays(SizeIs(1)))
+        .WillOnce(Return(false));
+    EXPECT_CALL(display_sink, overlay(SizeIs(2)))
+        .Times(0);
+    EXPECT_CALL(mock_renderer, render(ContainerEq(mg::RenderableList{fullscreen, small})))
+        .Times(2);
+    EXPECT_CALL(display_sink, set_next_image(_))
+        .Times(2);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_sink,
+        scanout_provider,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+    compositor.composite(make_scene_elements({fullscreen, small}));
+    compositor.composite(make_scene_elements({fullscreen, small}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, frame_is_rendered_once_when_overlays_are_refused)
+{
+    using namespace testing;
+    ScanoutGlRenderingProvider scanout_provider{small->buffer()};
+
+    ON_CALL(display_sink, accepts_overlays(_))
+        .WillByDefault(Return(false));
+    EXPECT_CALL(mock_renderer, render(_))
+        .Times(1);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_sink,
+        scanout_provider,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+    compositor.composite(make_scene_elements({fullscreen, small}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, bypassed_buffer_keeps_its_whole_screen_position)
+{
+    using namespace testing;
+    auto const oversized = std::make_shared<mtd::FakeRenderable>(
+        geom::Rectangle{{-10, -10}, {screen.size.width.as_int() + 20, screen.size.height.as_int() + 20}});
+    ScanoutGlRenderingProvider scanout_provider{oversized->buffer()};
+
+    EXPECT_CALL(display_sink, overlay(ElementsAre(
+        Field(&mg::DisplayElement::screen_positon, Eq(oversized->screen_position())))))
+        .WillOnce(Return(true));
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_sink,
+        scanout_provider,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+    compositor.composite(make_scene_elements({oversized}));
+}
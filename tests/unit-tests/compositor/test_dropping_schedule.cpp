@@ -20,6 +20,10 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 using namespace testing;
 namespace mtd = mir::test::doubles;
 namespace mt = mir::test;
@@ -84,3 +88,40 @@ TEST_F(DroppingSchedule, queueing_same_buffer_many_times_doesnt_drop)
     ASSERT_THAT(queue, SizeIs(1));
     EXPECT_THAT(queue[0]->id(), Eq(buffers[2]->id()));
 }
+
+TEST_F(DroppingSchedule, concurrent_scheduling_never_hands_out_a_buffer_twice)
+{
+    std::vector<std::shared_ptr<mg::Buffer>> submissions;
+    for (auto i = 0; i != 1000; ++i)
+        submissions.emplace_back(std::make_shared<mtd::StubBuffer>());
+
+    std::atomic<bool> client_done{false};
+    std::thread client{
+        [&]
+        {
+            for (auto const& buffer : submissions)
+                schedule.schedule(buffer);
+            client_done = true;
+        }};
+
+    std::vector<mg::BufferID> taken;
+    while (!client_done || schedule.num_scheduled())
+    {
+        try
+        {
+            taken.push_back(schedule.next_buffer()->id());
+        }
+        catch (std::logic_error const&)
+        {
+            // Nothing scheduled yet
+        }
+    }
+    client.join();
+
+    ASSERT_THAT(taken, Not(IsEmpty()));
+    EXPECT_THAT(taken.back(), Eq(submissions.back()->id()));
+    std::sort(taken.begin(), taken.end());
+    EXPECT_THAT(std::adjacent_find(taken.begin(), taken.end()), Eq(taken.end()));
+    // Everything dropped or taken has been released
+    EXPECT_THAT(submissions, Each(Property(&std::shared_ptr<mg::Buffer>::unique, Eq(true))));
+}
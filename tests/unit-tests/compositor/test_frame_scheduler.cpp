@@ -0,0 +1,142 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/frame_scheduler.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mc = mir::compositor;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct FrameScheduler : Test
+{
+    using Clock = mc::FrameScheduler::Clock;
+
+    /// Record a frame that took composite_time to composite and was posted at vblank
+    void frame_at(Clock::time_point vblank, Clock::duration composite_time)
+    {
+        scheduler.frame_posted(vblank - composite_time - 1ms, vblank - 1ms, vblank);
+    }
+
+    /// Record frames composited back-to-back, as happens when post() waits for vblank
+    void synchronise()
+    {
+        scheduler.frame_posted(vblank - 2 * interval - 1ms, vblank - 2 * interval, vblank - interval);
+        scheduler.frame_posted(vblank - interval, vblank - interval + 1ms, vblank);
+    }
+
+    Clock::duration const interval{16ms};
+    Clock::time_point const vblank{Clock::now()};
+    mc::FrameScheduler scheduler{interval};
+};
+}
+
+TEST_F(FrameScheduler, without_any_frames_there_is_no_delay)
+{
+    EXPECT_THAT(scheduler.delay_before_next_frame(vblank), Eq(Clock::duration::zero()));
+}
+
+TEST_F(FrameScheduler, post_waiting_for_vblank_is_synchronised_to_display)
+{
+    synchronise();
+
+    EXPECT_TRUE(scheduler.synchronised_to_display());
+}
+
+TEST_F(FrameScheduler, post_not_waiting_for_vblank_is_not_synchronised_to_display)
+{
+    auto const start = vblank - interval;
+    scheduler.frame_posted(start, start + 1ms, start + 2ms);
+    scheduler.frame_posted(start + 2ms, start + 3ms, start + 4ms);
+
+    EXPECT_FALSE(scheduler.synchronised_to_display());
+    EXPECT_THAT(scheduler.delay_before_next_frame(start + 4ms), Eq(Clock::duration::zero()));
+}
+
+TEST_F(FrameScheduler, prediction_covers_slowest_recent_frame)
+{
+    frame_at(vblank, 3ms);
+    frame_at(vblank + interval, 5ms);
+    frame_at(vblank + 2 * interval, 1ms);
+
+    EXPECT_THAT(scheduler.predicted_composite_time(), Gt(5ms));
+    EXPECT_THAT(scheduler.predicted_composite_time(), Lt(interval));
+}
+
+TEST_F(FrameScheduler, slow_frames_are_eventually_forgotten)
+{
+    frame_at(vblank, 10ms);
+    for (int i = 1; i != 20; ++i)
+    {
+        frame_at(vblank + i * interval, 1ms);
+    }
+
+    EXPECT_THAT(scheduler.predicted_composite_time(), Lt(10ms));
+}
+
+TEST_F(FrameScheduler, next_frame_starts_just_in_time_for_next_vblank)
+{
+    synchronise();
+
+    auto const delay = scheduler.delay_before_next_frame(vblank);
+
+    EXPECT_THAT(delay, Eq(interval - scheduler.predicted_composite_time()));
+}
+
+TEST_F(FrameScheduler, frame_that_cannot_make_next_vblank_aims_for_the_one_after)
+{
+    synchronise();
+    auto const too_late = vblank + interval - 1ms;
+
+    auto const delay = scheduler.delay_before_next_frame(too_late);
+
+    EXPECT_THAT(too_late + delay, Eq(vblank + 2 * interval - scheduler.predicted_composite_time()));
+}
+
+TEST_F(FrameScheduler, composite_slower_than_refresh_aims_for_the_first_vblank_it_can_make)
+{
+    synchronise();
+    frame_at(vblank + interval, 20ms);
+    auto const now = vblank + interval + 5ms;
+
+    auto const delay = scheduler.delay_before_next_frame(now);
+
+    EXPECT_THAT(now + delay + scheduler.predicted_composite_time(), Eq(vblank + 3 * interval));
+}
+
+TEST_F(FrameScheduler, frame_posted_on_time_missed_no_vblanks)
+{
+    synchronise();
+
+    EXPECT_THAT(scheduler.frame_posted(vblank, vblank + 1ms, vblank + interval), Eq(0));
+}
+
+TEST_F(FrameScheduler, frame_posted_late_counts_missed_vblanks)
+{
+    synchronise();
+
+    EXPECT_THAT(scheduler.frame_posted(vblank, vblank + 20ms, vblank + 3 * interval), Eq(2));
+}
+
+TEST_F(FrameScheduler, missed_vblanks_are_not_counted_until_synchronised)
+{
+    EXPECT_THAT(scheduler.frame_posted(vblank, vblank + 20ms, vblank + 3 * interval), Eq(0));
+}
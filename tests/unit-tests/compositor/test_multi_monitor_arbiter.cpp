@@ -22,6 +22,8 @@
 #include "src/server/compositor/schedule.h"
 
 #include <gtest/gtest.h>
+
+#include <array>
 using namespace testing;
 namespace mt = mir::test;
 namespace mtd = mir::test::doubles;
@@ -655,3 +657,25 @@ TEST_F(MultiMonitorArbiter, second_compositor_advances_schedule_after_both_aquir
     auto cbuffer4 = arbiter.compositor_acquire(&comp_id2);
     EXPECT_THAT(cbuffer1, Not(IsSameBufferAs(cbuffer4)));
 }
+
+TEST_F(MultiMonitorArbiter, tracks_readiness_of_many_compositors)
+{
+    // More compositors than the arbiter keeps lock-free track of
+    std::array<int, 20> comp_ids{};
+    schedule.set_schedule({buffers[0]});
+
+    for (auto& id : comp_ids)
+    {
+        EXPECT_TRUE(arbiter.buffer_ready_for(&id));
+        EXPECT_THAT(arbiter.compositor_acquire(&id), IsSameBufferAs(buffers[0]));
+        EXPECT_FALSE(arbiter.buffer_ready_for(&id));
+    }
+
+    schedule.set_schedule({buffers[1]});
+    for (auto& id : comp_ids)
+        EXPECT_TRUE(arbiter.buffer_ready_for(&id));
+
+    arbiter.compositor_acquire(&comp_ids.back());
+    for (auto& id : comp_ids)
+        EXPECT_THAT(arbiter.buffer_ready_for(&id), Eq(&id != &comp_ids.back()));
+}
@@ -200,3 +200,77 @@ TEST_F(OcclusionFilterTest,
     EXPECT_THAT(renderables_from(occlusions), ElementsAre(partially_onscreen));
     EXPECT_THAT(renderables_from(elements), ElementsAre(covering));
 }
+
+TEST_F(OcclusionFilterTest, window_covered_by_several_windows_occluded)
+{
+    auto const bottom = std::make_shared<mtd::FakeRenderable>(100, 100, 200, 100);
+    auto const left = std::make_shared<mtd::FakeRenderable>(0, 0, 200, 300);
+    auto const right = std::make_shared<mtd::FakeRenderable>(200, 50, 200, 200);
+    auto elements = scene_elements_from({bottom, left, right});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), ElementsAre(bottom));
+    EXPECT_THAT(renderables_from(elements), ElementsAre(left, right));
+}
+
+TEST_F(OcclusionFilterTest, window_with_uncovered_gap_not_occluded)
+{
+    auto const bottom = std::make_shared<mtd::FakeRenderable>(100, 100, 200, 100);
+    auto const left = std::make_shared<mtd::FakeRenderable>(0, 0, 199, 300);
+    auto const right = std::make_shared<mtd::FakeRenderable>(200, 50, 200, 200);
+    auto elements = scene_elements_from({bottom, left, right});
+
+    std::vector<Rectangles> visible_regions;
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, visible_regions);
+
+    EXPECT_THAT(renderables_from(occlusions), IsEmpty());
+    EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, left, right));
+    ASSERT_THAT(visible_regions.size(), Eq(3u));
+    EXPECT_THAT(visible_regions[0], Eq(Rectangles{{{199, 100}, {1, 100}}}));
+}
+
+TEST_F(OcclusionFilterTest, reports_visible_regions_of_remaining_windows)
+{
+    auto const bottom = std::make_shared<mtd::FakeRenderable>(0, 0, 100, 100);
+    auto const top = std::make_shared<mtd::FakeRenderable>(50, 50, 100, 100);
+    auto const translucent = std::make_shared<mtd::FakeRenderable>(Rectangle{{0, 0}, {60, 10}}, 0.5f);
+    auto elements = scene_elements_from({bottom, top, translucent});
+
+    std::vector<Rectangles> visible_regions;
+    filter_occlusions_from(elements, monitor_rect, visible_regions);
+
+    ASSERT_THAT(visible_regions.size(), Eq(3u));
+    EXPECT_THAT(visible_regions[0], Eq(Rectangles{{{0, 0}, {100, 50}}, {{0, 50}, {50, 50}}}));
+    EXPECT_THAT(visible_regions[1], Eq(Rectangles{{{50, 50}, {100, 100}}}));
+    EXPECT_THAT(visible_regions[2], Eq(Rectangles{{{0, 0}, {60, 10}}}));
+}
+
+TEST_F(OcclusionFilterTest, visible_regions_are_limited_to_area)
+{
+    auto const window = std::make_shared<mtd::FakeRenderable>(1900, 1100, 100, 200);
+    auto elements = scene_elements_from({window});
+
+    std::vector<Rectangles> visible_regions;
+    filter_occlusions_from(elements, monitor_rect, visible_regions);
+
+    ASSERT_THAT(visible_regions.size(), Eq(1u));
+    EXPECT_THAT(visible_regions[0], Eq(Rectangles{{{1900, 1100}, {20, 100}}}));
+}
+
+TEST_F(OcclusionFilterTest, opaque_region_of_shaped_window_occludes)
+{
+    auto const bottom = std::make_shared<mtd::FakeRenderable>(Rectangle{{10, 10}, {50, 50}});
+    auto const shaped = std::make_shared<mtd::FakeRenderable>(Rectangle{{0, 0}, {100, 100}}, 1.0f, false);
+    auto elements = scene_elements_from({bottom, shaped});
+
+    auto occlusions = filter_occlusions_from(elements, monitor_rect);
+    EXPECT_THAT(renderables_from(occlusions), IsEmpty());
+
+    shaped->set_opaque_region({{{5, 5}, {90, 90}}});
+    elements = scene_elements_from({bottom, shaped});
+
+    occlusions = filter_occlusions_from(elements, monitor_rect);
+    EXPECT_THAT(renderables_from(occlusions), ElementsAre(bottom));
+    EXPECT_THAT(renderables_from(elements), ElementsAre(shaped));
+}
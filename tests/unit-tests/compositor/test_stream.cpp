@@ -21,6 +21,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+
 using namespace testing;
 namespace mf = mir::frontend;
 namespace mt = mir::test;
@@ -133,9 +136,9 @@ TEST_F(Stream, tracks_has_buffer)
 TEST_F(Stream, calls_frame_callback_after_scheduling_on_submissions)
 {
     int frame_count{0};
-    stream.set_frame_posted_callback([&frame_count](auto) { ++frame_count;});
+    stream.set_frame_posted_callback([&frame_count](auto, auto) { ++frame_count;});
     stream.submit_buffer(buffers[0]);
-    stream.set_frame_posted_callback([](auto) {});
+    stream.set_frame_posted_callback([](auto, auto) {});
     stream.submit_buffer(buffers[0]);
     EXPECT_THAT(frame_count, Eq(1));
 }
@@ -143,7 +146,7 @@ TEST_F(Stream, calls_frame_callback_after_scheduling_on_submissions)
 TEST_F(Stream, frame_callback_is_called_without_scheduling_lock)
 {
     stream.set_frame_posted_callback(
-        [this](auto)
+        [this](auto, auto)
         {
             EXPECT_THAT(stream.buffers_ready_for_compositor(this), Eq(1));
             EXPECT_TRUE(stream.has_submitted_buffer());
@@ -151,6 +154,41 @@ TEST_F(Stream, frame_callback_is_called_without_scheduling_lock)
     stream.submit_buffer(buffers[0]);
 }
 
+TEST_F(Stream, frame_callback_receives_submitted_damage)
+{
+    geom::Rectangle const damage{{4, 1}, {10, 1}};
+    geom::Rectangle posted_damage;
+    stream.set_frame_posted_callback([&posted_damage](auto, auto const& damage) { posted_damage = damage; });
+    stream.submit_buffer(buffers[0], damage);
+    EXPECT_THAT(posted_damage, Eq(damage));
+}
+
+TEST_F(Stream, frame_callback_receives_full_damage_when_submitted_without_damage)
+{
+    geom::Rectangle posted_damage;
+    stream.set_frame_posted_callback([&posted_damage](auto, auto const& damage) { posted_damage = damage; });
+    stream.submit_buffer(buffers[0]);
+    EXPECT_THAT(posted_damage, Eq(geom::Rectangle{{}, initial_size}));
+}
+
+TEST_F(Stream, damage_is_clipped_to_buffer)
+{
+    geom::Rectangle posted_damage;
+    stream.set_frame_posted_callback([&posted_damage](auto, auto const& damage) { posted_damage = damage; });
+    stream.submit_buffer(buffers[0], {{40, 0}, {100, 100}});
+    EXPECT_THAT(posted_damage, Eq(geom::Rectangle{{40, 0}, {4, 2}}));
+}
+
+TEST_F(Stream, buffer_size_change_damages_whole_buffer)
+{
+    geom::Size const new_size{333,139};
+    auto const new_size_buffer = std::make_shared<mtd::StubBuffer>(new_size);
+    geom::Rectangle posted_damage;
+    stream.set_frame_posted_callback([&posted_damage](auto, auto const& damage) { posted_damage = damage; });
+    stream.submit_buffer(new_size_buffer, {{1, 1}, {1, 1}});
+    EXPECT_THAT(posted_damage, Eq(geom::Rectangle{{}, new_size}));
+}
+
 TEST_F(Stream, flattens_queue_out_when_told_to_drop)
 {
     for(auto& buffer : buffers)
@@ -180,7 +218,7 @@ TEST_F(Stream, forces_a_new_buffer_when_told_to_drop_buffers)
 
 TEST_F(Stream, throws_on_nullptr_submissions)
 {
-    stream.set_frame_posted_callback([](auto) { FAIL() << "frame-posted should not be called on null buffer"; });
+    stream.set_frame_posted_callback([](auto, auto) { FAIL() << "frame-posted should not be called on null buffer"; });
     EXPECT_THROW({
         stream.submit_buffer(nullptr);
     }, std::invalid_argument);
@@ -236,3 +274,48 @@ TEST_F(Stream, stream_remembers_scale_when_buffer_added)
     stream.submit_buffer(buffers[0]);
     ASSERT_THAT(stream.stream_size(), Eq(initial_size / 2));
 }
+
+TEST_F(Stream, toggling_framedropping_repeatedly_keeps_latest_buffer)
+{
+    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[1]);
+
+    for (auto i = 0; i != 3; ++i)
+    {
+        stream.allow_framedropping(true);
+        EXPECT_TRUE(stream.framedropping());
+        stream.allow_framedropping(false);
+        EXPECT_FALSE(stream.framedropping());
+    }
+
+    ASSERT_THAT(stream.buffers_ready_for_compositor(this), Eq(1));
+    EXPECT_THAT(stream.lock_compositor_buffer(this)->id(), Eq(buffers[1]->id()));
+    EXPECT_THAT(stream.buffers_ready_for_compositor(this), Eq(0));
+}
+
+TEST_F(Stream, compositor_sees_last_submission_of_concurrent_client)
+{
+    stream.allow_framedropping(true);
+    auto const last_buffer = std::make_shared<mtd::StubBuffer>(initial_size);
+
+    std::atomic<bool> client_done{false};
+    std::thread client{
+        [&]
+        {
+            for (auto i = 0; i != 1000; ++i)
+                stream.submit_buffer(buffers[i % buffers.size()]);
+            stream.submit_buffer(last_buffer);
+            client_done = true;
+        }};
+
+    std::shared_ptr<mg::Buffer> composited;
+    while (!client_done || stream.buffers_ready_for_compositor(this))
+    {
+        if (stream.buffers_ready_for_compositor(this))
+            composited = stream.lock_compositor_buffer(this);
+    }
+    client.join();
+
+    ASSERT_THAT(composited, NotNull());
+    EXPECT_THAT(composited->id(), Eq(last_buffer->id()));
+}
@@ -283,3 +283,41 @@ TEST_F(TestRectangles, remove_only_removes_one_instance)
         EXPECT_THAT(rectangles.size(), Eq(i));
     }
 }
+
+TEST_F(TestRectangles, difference_with_disjoint_hole_is_unchanged)
+{
+    Rectangles const region{{{0, 0}, {100, 100}}, {{200, 0}, {50, 50}}};
+
+    EXPECT_THAT(difference_of(region, {{100, 0}, {100, 100}}), Eq(region));
+}
+
+TEST_F(TestRectangles, difference_with_covering_hole_is_empty)
+{
+    Rectangles const region{{{10, 10}, {100, 100}}};
+
+    EXPECT_THAT(difference_of(region, {{0, 0}, {200, 200}}).size(), Eq(0u));
+}
+
+TEST_F(TestRectangles, difference_with_central_hole_leaves_surround)
+{
+    Rectangles const region{{{0, 0}, {100, 100}}};
+
+    EXPECT_THAT(
+        difference_of(region, {{25, 25}, {50, 50}}),
+        Eq(Rectangles{
+            {{0, 0}, {100, 25}},
+            {{0, 75}, {100, 25}},
+            {{0, 25}, {25, 50}},
+            {{75, 25}, {25, 50}}}));
+}
+
+TEST_F(TestRectangles, difference_with_overlapping_hole_leaves_uncovered_part)
+{
+    Rectangles const region{{{0, 0}, {100, 100}}};
+
+    EXPECT_THAT(
+        difference_of(region, {{50, 50}, {100, 100}}),
+        Eq(Rectangles{
+            {{0, 0}, {100, 50}},
+            {{0, 50}, {50, 50}}}));
+}
@@ -351,3 +351,99 @@ TEST_F(ShmBufferTest, texture_is_destroyed_on_thread_with_current_context)
         eglMakeCurrent(dummy_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     }
 }
+
+namespace
+{
+auto make_shm_data(geom::Size size, MirPixelFormat format, std::shared_ptr<mgc::EGLContextExecutor> const& egl_delegate)
+    -> std::shared_ptr<PlatformlessShmBuffer>
+{
+    return std::make_shared<PlatformlessShmBuffer>(size, format, egl_delegate);
+}
+}
+
+TEST_F(ShmBufferTest, successor_uploads_only_damage_into_shared_texture)
+{
+    geom::Size const buffer_size{640, 480};
+    auto const format = mir_pixel_format_argb_8888;
+    GLuint const tex_id{0x8086};
+
+    auto const first_data = make_shm_data(buffer_size, format, egl_delegate);
+    auto const second_data = make_shm_data(buffer_size, format, egl_delegate);
+    auto const first = std::make_shared<mgc::MappableBackedShmBuffer>(
+        first_data, nullptr, geom::Rectangle{{}, buffer_size}, egl_delegate);
+
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).WillOnce(SetArgPointee<1>(tex_id));
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, first_data->pixel_buffer()));
+    first->bind();
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    geom::Rectangle const damage{{10, 20}, {30, 40}};
+    mgc::MappableBackedShmBuffer second{second_data, first, damage, egl_delegate};
+
+    auto const stride = MIR_BYTES_PER_PIXEL(format) * buffer_size.width.as_int();
+    auto const damaged_pixels = second_data->pixel_buffer() + 20 * stride + 10 * MIR_BYTES_PER_PIXEL(format);
+
+    EXPECT_CALL(mock_gl, glGenTextures(_, _)).Times(0);
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _)).Times(0);
+    EXPECT_CALL(mock_gl, glBindTexture(GL_TEXTURE_2D, tex_id));
+    EXPECT_CALL(mock_gl, glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, buffer_size.width.as_int()));
+    EXPECT_CALL(mock_gl, glTexSubImage2D(GL_TEXTURE_2D, 0, 10, 20, 30, 40, _, _, damaged_pixels));
+    second.bind();
+}
+
+TEST_F(ShmBufferTest, shared_texture_catches_up_with_damage_of_skipped_buffers)
+{
+    geom::Size const buffer_size{640, 480};
+    auto const format = mir_pixel_format_argb_8888;
+
+    auto const first = std::make_shared<mgc::MappableBackedShmBuffer>(
+        make_shm_data(buffer_size, format, egl_delegate), nullptr, geom::Rectangle{{}, buffer_size}, egl_delegate);
+    first->bind();
+
+    auto const skipped = std::make_shared<mgc::MappableBackedShmBuffer>(
+        make_shm_data(buffer_size, format, egl_delegate), first, geom::Rectangle{{0, 0}, {10, 10}}, egl_delegate);
+    mgc::MappableBackedShmBuffer latest{
+        make_shm_data(buffer_size, format, egl_delegate), skipped, geom::Rectangle{{100, 100}, {10, 10}}, egl_delegate};
+
+    EXPECT_CALL(mock_gl, glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 110, 110, _, _, _));
+    latest.bind();
+}
+
+TEST_F(ShmBufferTest, superseded_buffer_uploads_into_its_own_texture)
+{
+    geom::Size const buffer_size{640, 480};
+    auto const format = mir_pixel_format_argb_8888;
+    GLuint const shared_tex_id{0x8086}, own_tex_id{0x1337};
+
+    auto const first_data = make_shm_data(buffer_size, format, egl_delegate);
+    auto const first = std::make_shared<mgc::MappableBackedShmBuffer>(
+        first_data, nullptr, geom::Rectangle{{}, buffer_size}, egl_delegate);
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).WillOnce(SetArgPointee<1>(shared_tex_id));
+    first->bind();
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    mgc::MappableBackedShmBuffer second{
+        make_shm_data(buffer_size, format, egl_delegate), first, geom::Rectangle{{0, 0}, {10, 10}}, egl_delegate};
+
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).WillOnce(SetArgPointee<1>(own_tex_id));
+    EXPECT_CALL(mock_gl, glBindTexture(GL_TEXTURE_2D, own_tex_id));
+    EXPECT_CALL(mock_gl, glBindTexture(GL_TEXTURE_2D, shared_tex_id)).Times(0);
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, first_data->pixel_buffer()));
+    first->bind();
+}
+
+TEST_F(ShmBufferTest, buffer_of_different_size_does_not_share_texture)
+{
+    auto const format = mir_pixel_format_argb_8888;
+
+    auto const first = std::make_shared<mgc::MappableBackedShmBuffer>(
+        make_shm_data({640, 480}, format, egl_delegate), nullptr, geom::Rectangle{{}, {640, 480}}, egl_delegate);
+    first->bind();
+
+    auto const resized_data = make_shm_data({800, 600}, format, egl_delegate);
+    mgc::MappableBackedShmBuffer resized{resized_data, first, geom::Rectangle{{0, 0}, {10, 10}}, egl_delegate};
+
+    EXPECT_CALL(mock_gl, glTexSubImage2D(_, _, _, _, _, _, _, _, _)).Times(0);
+    EXPECT_CALL(mock_gl, glTexImage2D(GL_TEXTURE_2D, 0, _, 800, 600, 0, _, _, resized_data->pixel_buffer()));
+    resized.bind();
+}
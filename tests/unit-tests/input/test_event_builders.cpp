@@ -225,3 +225,33 @@ TEST_F(InputEventBuilder, when_creating_input_device_state_event_it_has_supplied
     EXPECT_THAT(mir_input_device_state_event_device_pressed_keys_count(ids_event, 1), Eq(0));
     EXPECT_THAT(mir_input_device_state_event_device_pointer_buttons(ids_event, 1), Eq(button_state));
 }
+
+TEST_F(InputEventBuilder, cloned_pointer_event_outlives_recycled_original)
+{
+    float const x_axis_value = 3.5, y_axis_value = 7.25;
+
+    auto ev = mev::make_pointer_event(
+        device_id, timestamp, modifiers,
+        mir_pointer_action_motion, mir_pointer_button_primary, x_axis_value, y_axis_value,
+        0, 0, 1, -2);
+    auto const clone = mev::clone_event(*ev);
+
+    // The storage of the original can now be reused for a new event
+    ev.reset();
+    auto const recycled = mev::make_pointer_event(
+        device_id, timestamp, mir_input_event_modifier_none,
+        mir_pointer_action_button_up, 0, 0, 0,
+        0, 0, 0, 0);
+
+    auto const pev = mir_input_event_get_pointer_event(mir_event_get_input_event(clone.get()));
+    EXPECT_EQ(modifiers, mir_pointer_event_modifiers(pev));
+    EXPECT_EQ(mir_pointer_action_motion, mir_pointer_event_action(pev));
+    EXPECT_TRUE(mir_pointer_event_button_state(pev, mir_pointer_button_primary));
+    EXPECT_EQ(x_axis_value, mir_pointer_event_axis_value(pev, mir_pointer_axis_x));
+    EXPECT_EQ(y_axis_value, mir_pointer_event_axis_value(pev, mir_pointer_axis_y));
+
+    auto const recycled_pev = mir_input_event_get_pointer_event(mir_event_get_input_event(recycled.get()));
+    EXPECT_EQ(mir_input_event_modifier_none, mir_pointer_event_modifiers(recycled_pev));
+    EXPECT_EQ(mir_pointer_action_button_up, mir_pointer_event_action(recycled_pev));
+    EXPECT_FALSE(mir_pointer_event_button_state(recycled_pev, mir_pointer_button_primary));
+}
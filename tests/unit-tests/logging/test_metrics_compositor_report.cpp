@@ -0,0 +1,265 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "src/server/report/metrics/compositor_report.h"
+#include "src/server/report/null/compositor_report.h"
+#include "mir/test/doubles/advanceable_clock.h"
+#include "mir/test/doubles/explicit_executor.h"
+#include "mir/test/doubles/mock_compositor_report.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace mtd = mir::test::doubles;
+namespace mrm = mir::report::metrics;
+namespace mrn = mir::report::null;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct MetricsCompositorReport : Test
+{
+    ~MetricsCompositorReport()
+    {
+        std::filesystem::remove(filename);
+    }
+
+    /// Go through the stages of a frame, taking the given time in each
+    void frame(
+        std::chrono::microseconds snapshot,
+        std::chrono::microseconds occlusion,
+        std::optional<std::chrono::microseconds> render,
+        std::chrono::microseconds post,
+        int missed_vblanks = 0)
+    {
+        report.began_scene_snapshot(display);
+        clock->advance_by(snapshot);
+        report.began_frame(display);
+        clock->advance_by(occlusion);
+        report.filtered_occlusions(display);
+        if (render)
+        {
+            clock->advance_by(*render);
+            report.rendered_frame(display);
+        }
+        report.finished_frame(display);
+        clock->advance_by(post);
+        report.posted_frame(display, missed_vblanks);
+    }
+
+    auto metrics() const -> std::string
+    {
+        std::ostringstream out;
+        report.write_metrics(out);
+        return out.str();
+    }
+
+    void const* const display = "display";
+    std::string const labels{R"(output="0",area="1920x1080+0+0")"};
+    std::string const filename{
+        (std::filesystem::temp_directory_path() / ("mir-metrics-" + std::to_string(getpid()))).string()};
+    std::shared_ptr<mtd::AdvanceableClock> const clock{std::make_shared<mtd::AdvanceableClock>()};
+    mtd::ExplicitExecutor executor;
+    mrm::CompositorReport report{std::make_shared<mrn::CompositorReport>(), filename, clock, executor};
+};
+}
+
+TEST_F(MetricsCompositorReport, passes_events_on)
+{
+    auto const wrapped = std::make_shared<NiceMock<mtd::MockCompositorReport>>();
+    mrm::CompositorReport report{wrapped, filename, clock, executor};
+
+    InSequence seq;
+    EXPECT_CALL(*wrapped, added_display(1920, 1080, 0, 0, display));
+    EXPECT_CALL(*wrapped, began_scene_snapshot(display));
+    EXPECT_CALL(*wrapped, began_frame(display));
+    EXPECT_CALL(*wrapped, filtered_occlusions(display));
+    EXPECT_CALL(*wrapped, rendered_frame(display));
+    EXPECT_CALL(*wrapped, finished_frame(display));
+    EXPECT_CALL(*wrapped, posted_frame(display, 1));
+
+    report.added_display(1920, 1080, 0, 0, display);
+    report.began_scene_snapshot(display);
+    report.began_frame(display);
+    report.filtered_occlusions(display);
+    report.rendered_frame(display);
+    report.finished_frame(display);
+    report.posted_frame(display, 1);
+
+    executor.execute();
+}
+
+TEST_F(MetricsCompositorReport, records_time_of_each_stage)
+{
+    report.added_display(1920, 1080, 0, 0, display);
+
+    frame(50us, 100us, 3000us, 12000us);
+
+    auto const output = metrics();
+    EXPECT_THAT(output, HasSubstr("mir_compositor_scene_snapshot_seconds_bucket{" + labels + R"(,le="0.000064"} 1)"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_occlusion_seconds_bucket{" + labels + R"(,le="0.000064"} 0)"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_occlusion_seconds_bucket{" + labels + R"(,le="0.000128"} 1)"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_render_seconds_bucket{" + labels + R"(,le="0.002048"} 0)"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_render_seconds_bucket{" + labels + R"(,le="0.004096"} 1)"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_render_seconds_sum{" + labels + "} 0.003000"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_post_seconds_bucket{" + labels + R"(,le="0.016384"} 1)"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_post_seconds_count{" + labels + "} 1"));
+
+    executor.execute();
+}
+
+TEST_F(MetricsCompositorReport, slow_stages_are_counted_in_the_last_bucket)
+{
+    report.added_display(1920, 1080, 0, 0, display);
+
+    frame(50us, 100us, 500ms, 12000us);
+
+    auto const output = metrics();
+    EXPECT_THAT(output, HasSubstr("mir_compositor_render_seconds_bucket{" + labels + R"(,le="0.131072"} 0)"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_render_seconds_bucket{" + labels + R"(,le="+Inf"} 1)"));
+
+    executor.execute();
+}
+
+TEST_F(MetricsCompositorReport, counts_frames_bypassed_frames_and_missed_vblanks)
+{
+    report.added_display(1920, 1080, 0, 0, display);
+
+    frame(50us, 100us, 3000us, 12000us);
+    frame(50us, 100us, std::nullopt, 12000us, 2);
+    frame(50us, 100us, std::nullopt, 12000us, 1);
+
+    auto const output = metrics();
+    EXPECT_THAT(output, HasSubstr("mir_compositor_frames_total{" + labels + "} 3"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_bypassed_frames_total{" + labels + "} 2"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_missed_vblanks_total{" + labels + "} 3"));
+    EXPECT_THAT(output, HasSubstr("mir_compositor_render_seconds_count{" + labels + "} 1"));
+
+    executor.execute();
+}
+
+TEST_F(MetricsCompositorReport, latency_is_from_scheduling_to_posting)
+{
+    report.added_display(1920, 1080, 0, 0, display);
+
+    report.scheduled();
+    clock->advance_by(5ms);
+    frame(50us, 100us, 3000us, 12000us);
+
+    EXPECT_THAT(metrics(), HasSubstr("mir_compositor_latency_seconds_sum{" + labels + "} 0.020150"));
+
+    executor.execute();
+}
+
+TEST_F(MetricsCompositorReport, each_output_has_its_own_metrics)
+{
+    void const* const other_display = "other display";
+    report.added_display(1920, 1080, 0, 0, display);
+    report.added_display(1280, 1024, 1920, 0, other_display);
+
+    frame(50us, 100us, 3000us, 12000us);
+
+    auto const output = metrics();
+    EXPECT_THAT(output, HasSubstr("mir_compositor_frames_total{" + labels + "} 1"));
+    EXPECT_THAT(output, HasSubstr(R"(mir_compositor_frames_total{output="1",area="1280x1024+1920+0"} 0)"));
+
+    executor.execute();
+}
+
+TEST_F(MetricsCompositorReport, writes_metrics_to_file_about_once_a_second)
+{
+    report.added_display(1920, 1080, 0, 0, display);
+
+    frame(50us, 100us, 3000us, 12000us);
+    executor.execute();
+
+    std::stringstream written;
+    written << std::ifstream{filename}.rdbuf();
+    EXPECT_THAT(written.str(), HasSubstr("mir_compositor_frames_total{" + labels + "} 1"));
+
+    frame(50us, 100us, 3000us, 12000us);
+    executor.execute();
+
+    written.str({});
+    written << std::ifstream{filename}.rdbuf();
+    EXPECT_THAT(written.str(), HasSubstr("mir_compositor_frames_total{" + labels + "} 1"));
+
+    clock->advance_by(1s);
+    frame(50us, 100us, 3000us, 12000us);
+    executor.execute();
+
+    written.str({});
+    written << std::ifstream{filename}.rdbuf();
+    EXPECT_THAT(written.str(), HasSubstr("mir_compositor_frames_total{" + labels + "} 3"));
+}
+
+TEST_F(MetricsCompositorReport, outputs_are_forgotten_when_stopped)
+{
+    report.added_display(1920, 1080, 0, 0, display);
+    frame(50us, 100us, 3000us, 12000us);
+    executor.execute();
+
+    report.stopped();
+    report.started();
+    report.added_display(1280, 1024, 0, 0, display);
+
+    auto const output = metrics();
+    EXPECT_THAT(output, Not(HasSubstr("1920x1080")));
+    EXPECT_THAT(output, HasSubstr(R"(mir_compositor_frames_total{output="0",area="1280x1024+0+0"} 0)"));
+}
+
+TEST_F(MetricsCompositorReport, metrics_can_be_written_while_displays_are_replaced)
+{
+    report.added_display(1920, 1080, 0, 0, display);
+
+    std::atomic<bool> done{false};
+    std::thread replacer{
+        [&]
+        {
+            for (int i = 0; i != 1000; ++i)
+            {
+                report.stopped();
+                report.started();
+                report.added_display(i % 2 ? 1280 : 1920, i % 2 ? 1024 : 1080, 0, 0, display);
+            }
+            done = true;
+        }};
+
+    while (!done)
+    {
+        std::istringstream lines{metrics()};
+        for (std::string line; std::getline(lines, line);)
+        {
+            if (line.starts_with("mir_compositor_frames_total{"))
+            {
+                EXPECT_THAT(line, AnyOf(
+                    HasSubstr(R"(area="1920x1080+0+0")"),
+                    HasSubstr(R"(area="1280x1024+0+0")")));
+            }
+        }
+    }
+    replacer.join();
+}
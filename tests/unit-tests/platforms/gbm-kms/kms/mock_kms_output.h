@@ -49,6 +49,23 @@ struct MockKMSOutput : public graphics::gbm::KMSOutput
     }
     MOCK_METHOD1(schedule_page_flip_thunk, bool(graphics::FBHandle const*));
     MOCK_METHOD0(wait_for_page_flip, void());
+    MOCK_METHOD0(commit_staged_changes, void());
+
+    MOCK_METHOD0(overlay_planes, std::vector<graphics::gbm::OverlayPlane>());
+    bool set_plane(
+        uint32_t plane_id,
+        graphics::FBHandle const& fb,
+        geometry::Rectangle const& destination,
+        geometry::RectangleF const& source) override
+    {
+        return set_plane_thunk(plane_id, &fb, destination, source);
+    }
+    MOCK_METHOD4(set_plane_thunk, bool(
+        uint32_t,
+        graphics::FBHandle const*,
+        geometry::Rectangle const&,
+        geometry::RectangleF const&));
+    MOCK_METHOD1(clear_plane, bool(uint32_t));
 
     MOCK_CONST_METHOD0(last_frame, graphics::Frame());
 
@@ -59,6 +76,8 @@ struct MockKMSOutput : public graphics::gbm::KMSOutput
 
     MOCK_METHOD1(set_power_mode, void(MirPowerMode));
     MOCK_METHOD1(set_gamma, void(mir::graphics::GammaCurves const&));
+    MOCK_METHOD1(set_variable_refresh, void(bool));
+    MOCK_CONST_METHOD0(has_variable_refresh, bool());
 
     MOCK_METHOD0(refresh_hardware_state, void());
     MOCK_CONST_METHOD1(update_from_hardware_state, void(graphics::DisplayConfigurationOutput&));
@@ -0,0 +1,465 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "kms_framebuffer.h"
+#include "src/platforms/gbm-kms/server/kms/atomic_kms_output.h"
+#include "src/platforms/gbm-kms/server/kms/page_flipper.h"
+
+#include "mir/test/fake_shared.h"
+
+#include "mir/test/doubles/mock_drm.h"
+#include "mir/test/doubles/mock_gbm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <fcntl.h>
+
+namespace mg = mir::graphics;
+namespace mgg = mir::graphics::gbm;
+namespace geom = mir::geometry;
+namespace mt = mir::test;
+namespace mtd = mir::test::doubles;
+
+using namespace ::testing;
+
+namespace
+{
+
+class MockPageFlipper : public mgg::PageFlipper
+{
+public:
+    MOCK_METHOD3(schedule_flip, bool(uint32_t,uint32_t,uint32_t));
+    MOCK_METHOD3(schedule_commit, bool(uint32_t,uint32_t,drmModeAtomicReq*));
+    MOCK_METHOD1(wait_for_flip, mg::Frame(uint32_t));
+    MOCK_METHOD1(flip_pending, bool(uint32_t));
+    MOCK_METHOD1(schedule_wakeup, void(std::chrono::steady_clock::time_point));
+};
+
+class StubKMSFramebuffer : public mg::FBHandle
+{
+public:
+    StubKMSFramebuffer(uint32_t fb_id)
+        : fb_id{fb_id}
+    {
+    }
+
+    operator uint32_t() const override
+    {
+        return fb_id;
+    }
+
+    auto size() const -> geom::Size override
+    {
+        return {};
+    }
+private:
+    uint32_t const fb_id;
+};
+
+/// The properties of a DRM object, as drmModeObjectGetProperties() returns them
+class FakeObjectProperties
+{
+public:
+    FakeObjectProperties(std::vector<uint32_t> ids, std::vector<uint64_t> values)
+        : ids{std::move(ids)},
+          values{std::move(values)},
+          properties{static_cast<uint32_t>(this->ids.size()), this->ids.data(), this->values.data()}
+    {
+    }
+
+    // properties points into the vectors, so must stay with them
+    FakeObjectProperties(FakeObjectProperties const&) = delete;
+    FakeObjectProperties& operator=(FakeObjectProperties const&) = delete;
+
+    auto get() -> drmModeObjectProperties*
+    {
+        return &properties;
+    }
+
+private:
+    std::vector<uint32_t> ids;
+    std::vector<uint64_t> values;
+    drmModeObjectProperties properties;
+};
+
+// As in the kernel, each property has the same id on every object that has it
+std::vector<std::string> const property_names{
+    "type", "FB_ID", "CRTC_ID",
+    "SRC_X", "SRC_Y", "SRC_W", "SRC_H",
+    "CRTC_X", "CRTC_Y", "CRTC_W", "CRTC_H",
+    "MODE_ID", "ACTIVE"};
+
+uint32_t const first_property_id{100};
+
+auto property_id(std::string const& name) -> uint32_t
+{
+    auto const index = std::find(property_names.begin(), property_names.end(), name) - property_names.begin();
+    return first_property_id + index;
+}
+
+auto plane_properties(uint64_t type) -> FakeObjectProperties
+{
+    std::vector<uint32_t> ids;
+    std::vector<uint64_t> values;
+    for (auto const& name : property_names)
+    {
+        if (name == "MODE_ID" || name == "ACTIVE")
+            continue;
+
+        ids.push_back(property_id(name));
+        values.push_back(name == "type" ? type : 0);
+    }
+    return {std::move(ids), std::move(values)};
+}
+
+class AtomicKMSOutputTest : public ::testing::Test
+{
+public:
+    AtomicKMSOutputTest()
+        : drm_fd{open(drm_device, 0, 0)}
+    {
+        mock_drm.reset(drm_device);
+        mock_drm.add_crtc(drm_device, crtc_id, mode);
+        mock_drm.add_encoder(drm_device, encoder_id, crtc_id, 0x1);
+        mock_drm.add_connector(
+            drm_device,
+            connector_id,
+            DRM_MODE_CONNECTOR_HDMIA,
+            DRM_MODE_CONNECTED,
+            encoder_id,
+            modes,
+            encoder_ids,
+            geom::Size());
+        mock_drm.prepare(drm_device);
+
+        for (auto const& name : property_names)
+        {
+            drmModePropertyRes property{};
+            property.prop_id = property_id(name);
+            strncpy(property.name, name.c_str(), sizeof(property.name) - 1);
+            properties.push_back(property);
+        }
+        ON_CALL(mock_drm, drmModeGetProperty(_, _))
+            .WillByDefault(Invoke(
+                [this](int, uint32_t id)
+                {
+                    return &properties.at(id - first_property_id);
+                }));
+
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, crtc_id, DRM_MODE_OBJECT_CRTC))
+            .WillByDefault(Return(crtc_properties.get()));
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, connector_id, DRM_MODE_OBJECT_CONNECTOR))
+            .WillByDefault(Return(connector_properties.get()));
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, primary_plane_id, DRM_MODE_OBJECT_PLANE))
+            .WillByDefault(Return(primary_properties.get()));
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, cursor_plane_id, DRM_MODE_OBJECT_PLANE))
+            .WillByDefault(Return(cursor_properties.get()));
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, overlay_plane_id, DRM_MODE_OBJECT_PLANE))
+            .WillByDefault(Return(overlay_properties.get()));
+
+        plane_resources.count_planes = plane_ids.size();
+        plane_resources.planes = plane_ids.data();
+        ON_CALL(mock_drm, drmModeGetPlaneResources(_))
+            .WillByDefault(Return(&plane_resources));
+
+        for (auto id : plane_ids)
+        {
+            drmModePlane plane{};
+            plane.plane_id = id;
+            plane.possible_crtcs = 0x1;
+            planes.push_back(plane);
+        }
+        ON_CALL(mock_drm, drmModeGetPlane(_, _))
+            .WillByDefault(Invoke(
+                [this](int, uint32_t id)
+                {
+                    return &planes.at(std::find(plane_ids.begin(), plane_ids.end(), id) - plane_ids.begin());
+                }));
+
+        ON_CALL(mock_gbm, gbm_bo_get_width(_))
+            .WillByDefault(Return(cursor_size.width.as_uint32_t()));
+        ON_CALL(mock_gbm, gbm_bo_get_height(_))
+            .WillByDefault(Return(cursor_size.height.as_uint32_t()));
+        ON_CALL(mock_gbm, gbm_bo_get_handle(_))
+            .WillByDefault(Return(gbm_bo_handle{0}));
+        ON_CALL(mock_drm, drmModeAddFB2(_,_,_,_,_,_,_,_,_))
+            .WillByDefault(DoAll(SetArgPointee<7>(cursor_fb_id), Return(0)));
+
+        ON_CALL(mock_page_flipper, schedule_commit(_, _, _))
+            .WillByDefault(Return(true));
+        ON_CALL(mock_page_flipper, schedule_wakeup(_))
+            .WillByDefault(SaveArg<0>(&wakeup));
+    }
+
+    /// Commit staged changes as the main loop does once the wakeup the output asked for comes
+    void commit_on_wakeup(mgg::AtomicKMSOutput& output)
+    {
+        std::this_thread::sleep_until(wakeup);
+        output.commit_staged_changes();
+    }
+
+    /// An output whose CRTC has been set, with an overlay showing a client buffer for the next frame
+    auto output_with_overlay() -> std::unique_ptr<mgg::AtomicKMSOutput>
+    {
+        auto output = std::make_unique<mgg::AtomicKMSOutput>(
+            drm_fd,
+            mg::kms::get_connector(drm_fd, connector_id),
+            mt::fake_shared(mock_page_flipper));
+
+        EXPECT_TRUE(output->set_crtc(primary_fb));
+        EXPECT_TRUE(output->set_plane(overlay_plane_id, overlay_fb, overlay_destination, overlay_source));
+        return output;
+    }
+
+    testing::NiceMock<mtd::MockDRM> mock_drm;
+    testing::NiceMock<mtd::MockGBM> mock_gbm;
+    testing::NiceMock<MockPageFlipper> mock_page_flipper;
+    std::chrono::steady_clock::time_point wakeup;
+
+    char const* const drm_device = "/dev/dri/card0";
+    int const drm_fd;
+
+    uint32_t const crtc_id{10};
+    uint32_t const encoder_id{20};
+    uint32_t const connector_id{30};
+    uint32_t const primary_plane_id{40};
+    uint32_t const cursor_plane_id{41};
+    uint32_t const overlay_plane_id{42};
+    uint32_t const cursor_fb_id{50};
+
+    drmModeModeInfo const mode{
+        mtd::FakeDRMResources::create_mode(1920, 1080, 138500, 2080, 1111, mtd::FakeDRMResources::PreferredMode)};
+    std::vector<drmModeModeInfo> modes{mode};
+    std::vector<uint32_t> encoder_ids{encoder_id};
+
+    std::vector<drmModePropertyRes> properties;
+    FakeObjectProperties crtc_properties{{property_id("MODE_ID"), property_id("ACTIVE")}, {0, 1}};
+    FakeObjectProperties connector_properties{{property_id("CRTC_ID")}, {crtc_id}};
+    FakeObjectProperties primary_properties{plane_properties(DRM_PLANE_TYPE_PRIMARY)};
+    FakeObjectProperties cursor_properties{plane_properties(DRM_PLANE_TYPE_CURSOR)};
+    FakeObjectProperties overlay_properties{plane_properties(DRM_PLANE_TYPE_OVERLAY)};
+
+    std::vector<uint32_t> plane_ids{primary_plane_id, cursor_plane_id, overlay_plane_id};
+    drmModePlaneRes plane_resources{};
+    std::vector<drmModePlane> planes;
+
+    StubKMSFramebuffer const primary_fb{60};
+    StubKMSFramebuffer const overlay_fb{61};
+    geom::Rectangle const overlay_destination{{100, 100}, {640, 480}};
+    geom::RectangleF const overlay_source{{0, 0}, {640, 480}};
+    geom::Size const cursor_size{64, 64};
+    gbm_bo* const cursor_bo{reinterpret_cast<gbm_bo*>(0x1234)};
+};
+}
+
+TEST_F(AtomicKMSOutputTest, set_plane_fails_when_the_plane_cant_show_the_buffer)
+{
+    mgg::AtomicKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_id),
+        mt::fake_shared(mock_page_flipper)};
+    ASSERT_TRUE(output.set_crtc(primary_fb));
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, DRM_MODE_ATOMIC_TEST_ONLY, _))
+        .WillOnce(Return(-EINVAL));
+
+    EXPECT_FALSE(output.set_plane(overlay_plane_id, overlay_fb, overlay_destination, overlay_source));
+}
+
+TEST_F(AtomicKMSOutputTest, frame_is_flipped_to_without_overlays_when_they_cant_be_shown_with_it)
+{
+    auto const output = output_with_overlay();
+
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(AnyNumber());
+    {
+        InSequence seq;
+        EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_id("FB_ID"), uint32_t{overlay_fb}));
+        EXPECT_CALL(mock_page_flipper, schedule_commit(crtc_id, connector_id, _))
+            .WillOnce(Return(false));
+        EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_id("FB_ID"), 0));
+        EXPECT_CALL(mock_page_flipper, schedule_commit(crtc_id, connector_id, _))
+            .WillOnce(Return(true));
+    }
+
+    EXPECT_TRUE(output->schedule_page_flip(primary_fb));
+}
+
+TEST_F(AtomicKMSOutputTest, overlays_are_refused_once_they_couldnt_be_shown_with_a_frame)
+{
+    auto const output = output_with_overlay();
+
+    EXPECT_CALL(mock_page_flipper, schedule_commit(crtc_id, connector_id, _))
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+    ASSERT_TRUE(output->schedule_page_flip(primary_fb));
+
+    EXPECT_FALSE(output->set_plane(overlay_plane_id, overlay_fb, overlay_destination, overlay_source));
+}
+
+TEST_F(AtomicKMSOutputTest, cursor_changes_never_block)
+{
+    mgg::AtomicKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_id),
+        mt::fake_shared(mock_page_flipper)};
+    ASSERT_TRUE(output.set_crtc(primary_fb));
+
+    // Only the page flipper's non-blocking commits may change what's on screen
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, DRM_MODE_ATOMIC_TEST_ONLY, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, Ne(DRM_MODE_ATOMIC_TEST_ONLY), _))
+        .Times(0);
+    EXPECT_CALL(mock_page_flipper, schedule_commit(crtc_id, connector_id, _))
+        .Times(3);
+
+    EXPECT_TRUE(output.set_cursor(cursor_bo));
+    output.move_cursor({10, 20});
+    commit_on_wakeup(output);
+    EXPECT_TRUE(output.clear_cursor());
+    commit_on_wakeup(output);
+}
+
+TEST_F(AtomicKMSOutputTest, cursor_change_with_nothing_in_flight_is_committed_at_once)
+{
+    mgg::AtomicKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_id),
+        mt::fake_shared(mock_page_flipper)};
+    ASSERT_TRUE(output.set_crtc(primary_fb));
+
+    EXPECT_CALL(mock_page_flipper, schedule_wakeup(_))
+        .Times(0);
+    EXPECT_CALL(mock_page_flipper, schedule_commit(crtc_id, connector_id, _))
+        .WillOnce(Return(true));
+
+    EXPECT_TRUE(output.set_cursor(cursor_bo));
+}
+
+TEST_F(AtomicKMSOutputTest, cursor_changes_while_a_flip_is_in_flight_go_with_the_next_frame)
+{
+    mgg::AtomicKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_id),
+        mt::fake_shared(mock_page_flipper)};
+    ASSERT_TRUE(output.set_crtc(primary_fb));
+    ASSERT_TRUE(output.schedule_page_flip(primary_fb));
+
+    ON_CALL(mock_page_flipper, flip_pending(crtc_id))
+        .WillByDefault(Return(true));
+    EXPECT_CALL(mock_page_flipper, schedule_commit(_, _, _))
+        .Times(0);
+
+    EXPECT_TRUE(output.set_cursor(cursor_bo));
+    output.move_cursor({10, 20});
+
+    // The flip completes, and the main loop handles its event before the next frame comes
+    ON_CALL(mock_page_flipper, flip_pending(crtc_id))
+        .WillByDefault(Return(false));
+    EXPECT_CALL(mock_page_flipper, schedule_wakeup(_));
+    output.commit_staged_changes();
+
+    Mock::VerifyAndClearExpectations(&mock_page_flipper);
+
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_id("FB_ID"), uint32_t{primary_fb}));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, cursor_plane_id, property_id("FB_ID"), cursor_fb_id));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, cursor_plane_id, property_id("CRTC_X"), 10));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, cursor_plane_id, property_id("CRTC_Y"), 20));
+    EXPECT_CALL(mock_page_flipper, schedule_commit(crtc_id, connector_id, _))
+        .WillOnce(Return(true));
+
+    EXPECT_TRUE(output.schedule_page_flip(primary_fb));
+}
+
+TEST_F(AtomicKMSOutputTest, cursor_changes_are_committed_after_a_bypass_frame_with_no_frame_following)
+{
+    mgg::AtomicKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_id),
+        mt::fake_shared(mock_page_flipper)};
+    ASSERT_TRUE(output.set_crtc(primary_fb));
+    ASSERT_TRUE(output.schedule_page_flip(primary_fb));
+
+    ON_CALL(mock_page_flipper, flip_pending(crtc_id))
+        .WillByDefault(Return(true));
+    EXPECT_CALL(mock_page_flipper, schedule_commit(_, _, _))
+        .Times(0);
+
+    EXPECT_TRUE(output.set_cursor(cursor_bo));
+    output.move_cursor({10, 20});
+
+    // DisplaySink::post() waits for a bypass frame's flip, and the client posts nothing more
+    output.wait_for_page_flip();
+    ON_CALL(mock_page_flipper, flip_pending(crtc_id))
+        .WillByDefault(Return(false));
+    output.commit_staged_changes();
+
+    Mock::VerifyAndClearExpectations(&mock_page_flipper);
+
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, _, _))
+        .Times(0);
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, cursor_plane_id, property_id("CRTC_X"), 10));
+    EXPECT_CALL(mock_page_flipper, schedule_commit(crtc_id, connector_id, _))
+        .WillOnce(Return(true));
+
+    commit_on_wakeup(output);
+}
+
+TEST_F(AtomicKMSOutputTest, replaced_cursor_image_is_removed_once_its_replacement_is_committed)
+{
+    uint32_t const next_cursor_fb_id{cursor_fb_id + 1};
+
+    mgg::AtomicKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_id),
+        mt::fake_shared(mock_page_flipper)};
+    ASSERT_TRUE(output.set_crtc(primary_fb));
+    ASSERT_TRUE(output.set_cursor(cursor_bo));
+
+    ON_CALL(mock_page_flipper, flip_pending(crtc_id))
+        .WillByDefault(Return(true));
+    EXPECT_CALL(mock_drm, drmModeAddFB2(_,_,_,_,_,_,_,_,_))
+        .WillOnce(DoAll(SetArgPointee<7>(next_cursor_fb_id), Return(0)));
+    EXPECT_CALL(mock_drm, drmModeRmFB(_, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeRmFB(_, cursor_fb_id))
+        .Times(0);
+
+    ASSERT_TRUE(output.set_cursor(cursor_bo));
+    ON_CALL(mock_page_flipper, flip_pending(crtc_id))
+        .WillByDefault(Return(false));
+    output.commit_staged_changes();
+
+    Mock::VerifyAndClearExpectations(&mock_drm);
+
+    EXPECT_CALL(mock_drm, drmModeRmFB(_, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeRmFB(_, cursor_fb_id));
+
+    commit_on_wakeup(output);
+}
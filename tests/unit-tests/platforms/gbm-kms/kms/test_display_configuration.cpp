@@ -134,7 +134,8 @@ public:
             mir::report::null_display_report(),
             *std::make_shared<mtd::StubConsoleServices>(),
             *std::make_shared<mtd::NullEmergencyCleanup>(),
-            mgg::BypassOption::allowed);
+            mgg::BypassOption::allowed,
+            mgg::AtomicKMSOption::prohibited);
     }
 
     std::shared_ptr<mg::Display> create_display(
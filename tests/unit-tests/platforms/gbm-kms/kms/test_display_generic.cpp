@@ -93,7 +93,8 @@ public:
             mir::report::null_display_report(),
             *std::make_shared<mtd::StubConsoleServices>(),
             *std::make_shared<mtd::NullEmergencyCleanup>(),
-            mgg::BypassOption::allowed);
+            mgg::BypassOption::allowed,
+            mgg::AtomicKMSOption::prohibited);
         return platform->create_display(
             std::make_shared<mg::CloneDisplayConfigurationPolicy>(),
             std::make_shared<mtd::StubGLConfig>());
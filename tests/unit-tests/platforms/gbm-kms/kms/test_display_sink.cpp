@@ -18,6 +18,7 @@
 #include "src/server/report/null_report_factory.h"
 #include "src/platforms/gbm-kms/server/kms/platform.h"
 #include "src/platforms/gbm-kms/server/kms/display_sink.h"
+#include "src/platforms/gbm-kms/server/dmabuf_framebuffer.h"
 #include "mir/graphics/dmabuf_buffer.h"
 #include "mir/test/doubles/mock_egl.h"
 #include "mir/test/doubles/mock_gl.h"
@@ -34,6 +35,7 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <gbm.h>
+#include <drm_fourcc.h>
 
 using namespace testing;
 using namespace mir;
@@ -233,6 +235,148 @@ TEST_F(MesaDisplaySinkTest, untransformed_with_bypassable_list_can_bypass)
     EXPECT_TRUE(sink.overlay(bypassable_list));
 }
 
+namespace
+{
+struct MesaDisplaySinkOverlayTest : MesaDisplaySinkTest
+{
+    MesaDisplaySinkOverlayTest()
+    {
+        ON_CALL(mock_dmabuf_buffer, planes())
+            .WillByDefault(ReturnRef(dmabuf_planes));
+        ON_CALL(mock_dmabuf_buffer, size())
+            .WillByDefault(Return(overlay_size));
+        ON_CALL(mock_dmabuf_buffer, format())
+            .WillByDefault(Return(DRMFormat{DRM_FORMAT_ARGB8888}));
+        ON_CALL(*mock_kms_output, overlay_planes())
+            .WillByDefault(Return(std::vector<OverlayPlane>{{overlay_plane_id, {DRM_FORMAT_ARGB8888}}}));
+        ON_CALL(*mock_kms_output, set_plane_thunk(_, _, _, _))
+            .WillByDefault(Return(true));
+    }
+
+    auto overlay_list() -> std::vector<mir::graphics::DisplayElement>
+    {
+        std::shared_ptr<mir::graphics::Framebuffer> client_fb =
+            DMABufFramebuffer::import(drm_fd, mock_bypassable_buffer);
+
+        return {
+            bypassable_list[0],
+            mir::graphics::DisplayElement{
+                {display_area.top_left + overlay_offset, overlay_size},
+                {{0, 0}, {overlay_size.width.as_value(), overlay_size.height.as_value()}},
+                client_fb}};
+    }
+
+    uint32_t const overlay_plane_id{42};
+    geometry::Displacement const overlay_offset{5, 6};
+    geometry::Size const overlay_size{20, 10};
+    std::vector<DMABufBuffer::PlaneDescriptor> const dmabuf_planes{{mir::Fd{IntOwnedFd{7}}, 80, 0}};
+};
+}
+
+TEST_F(MesaDisplaySinkOverlayTest, client_buffers_above_primary_are_shown_on_overlay_planes)
+{
+    graphics::gbm::DisplaySink sink(
+        drm_fd,
+        gbm,
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, set_plane_thunk(
+        overlay_plane_id, _, geometry::Rectangle{as_point(overlay_offset), overlay_size}, _));
+
+    ASSERT_TRUE(sink.overlay(overlay_list()));
+    sink.post();
+}
+
+TEST_F(MesaDisplaySinkOverlayTest, overlay_planes_are_cleared_when_no_longer_used)
+{
+    graphics::gbm::DisplaySink sink(
+        drm_fd,
+        gbm,
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        display_area,
+        identity);
+
+    ASSERT_TRUE(sink.overlay(overlay_list()));
+    sink.post();
+
+    EXPECT_CALL(*mock_kms_output, clear_plane(overlay_plane_id));
+
+    ASSERT_TRUE(sink.overlay(bypassable_list));
+    sink.post();
+}
+
+TEST_F(MesaDisplaySinkOverlayTest, overlays_are_refused_without_a_suitable_plane)
+{
+    ON_CALL(*mock_kms_output, overlay_planes())
+        .WillByDefault(Return(std::vector<OverlayPlane>{{overlay_plane_id, {DRM_FORMAT_NV12}}}));
+
+    graphics::gbm::DisplaySink sink(
+        drm_fd,
+        gbm,
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        display_area,
+        identity);
+
+    EXPECT_FALSE(sink.overlay(overlay_list()));
+}
+
+TEST_F(MesaDisplaySinkOverlayTest, overlays_are_accepted_before_the_primary_is_rendered)
+{
+    graphics::gbm::DisplaySink sink(
+        drm_fd,
+        gbm,
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        display_area,
+        identity);
+
+    auto const list = overlay_list();
+
+    EXPECT_TRUE(sink.accepts_overlays({list.begin() + 1, list.end()}));
+}
+
+TEST_F(MesaDisplaySinkOverlayTest, overlays_are_not_accepted_without_overlay_planes)
+{
+    ON_CALL(*mock_kms_output, overlay_planes())
+        .WillByDefault(Return(std::vector<OverlayPlane>{}));
+
+    graphics::gbm::DisplaySink sink(
+        drm_fd,
+        gbm,
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        display_area,
+        identity);
+
+    auto const list = overlay_list();
+
+    EXPECT_FALSE(sink.accepts_overlays({list.begin() + 1, list.end()}));
+}
+
+TEST_F(MesaDisplaySinkOverlayTest, overlays_are_refused_when_bypass_is_prohibited)
+{
+    graphics::gbm::DisplaySink sink(
+        drm_fd,
+        gbm,
+        graphics::gbm::BypassOption::prohibited,
+        null_display_report(),
+        {mock_kms_output},
+        display_area,
+        identity);
+
+    EXPECT_FALSE(sink.overlay(overlay_list()));
+}
+
 namespace
 {
 template<typename T>
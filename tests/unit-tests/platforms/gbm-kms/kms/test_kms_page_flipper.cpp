@@ -31,6 +31,7 @@
 
 #include <sys/time.h>
 #include <fcntl.h>
+#include <poll.h>
 
 namespace mg  = mir::graphics;
 namespace mgg = mir::graphics::gbm;
@@ -126,6 +127,114 @@ TEST_F(KMSPageFlipperTest, wait_for_flip_handles_drm_event)
     page_flipper.wait_for_flip(crtc_id);
 }
 
+TEST_F(KMSPageFlipperTest, handle_events_completes_flip_for_wait_for_flip)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const fb_id{101};
+    uint32_t const connector_id{345};
+    void* user_data{nullptr};
+
+    EXPECT_CALL(mock_drm, drmModePageFlip(drm_fd, crtc_id, fb_id, _, _))
+        .Times(1)
+        .WillOnce(DoAll(SaveArg<4>(&user_data), Return(0)));
+
+    EXPECT_CALL(mock_drm, drmHandleEvent(drm_fd, _))
+        .Times(1)
+        .WillOnce(DoAll(InvokePageFlipHandler(&user_data), Return(0)));
+
+    page_flipper.schedule_flip(crtc_id, fb_id, connector_id);
+
+    /* Fake a DRM event, and handle it as the main loop would */
+    mock_drm.generate_event_on(drm_device);
+    page_flipper.handle_events();
+
+    page_flipper.wait_for_flip(crtc_id);
+}
+
+TEST_F(KMSPageFlipperTest, handle_events_without_pending_event_does_not_read_drm_events)
+{
+    using namespace testing;
+
+    EXPECT_CALL(mock_drm, drmHandleEvent(_, _))
+        .Times(0);
+
+    page_flipper.handle_events();
+}
+
+TEST_F(KMSPageFlipperTest, flip_is_pending_until_its_event_is_handled)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const fb_id{101};
+    uint32_t const connector_id{345};
+    void* user_data{nullptr};
+
+    EXPECT_CALL(mock_drm, drmModePageFlip(drm_fd, crtc_id, fb_id, _, _))
+        .WillOnce(DoAll(SaveArg<4>(&user_data), Return(0)));
+    EXPECT_CALL(mock_drm, drmHandleEvent(drm_fd, _))
+        .WillOnce(DoAll(InvokePageFlipHandler(&user_data), Return(0)));
+
+    EXPECT_FALSE(page_flipper.flip_pending(crtc_id));
+
+    page_flipper.schedule_flip(crtc_id, fb_id, connector_id);
+    EXPECT_TRUE(page_flipper.flip_pending(crtc_id));
+
+    mock_drm.generate_event_on(drm_device);
+    page_flipper.handle_events();
+    EXPECT_FALSE(page_flipper.flip_pending(crtc_id));
+}
+
+TEST_F(KMSPageFlipperTest, handle_events_wakes_thread_waiting_for_flip)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const fb_id{101};
+    uint32_t const connector_id{345};
+    void* user_data{nullptr};
+
+    EXPECT_CALL(mock_drm, drmModePageFlip(drm_fd, crtc_id, fb_id, _, _))
+        .WillOnce(DoAll(SaveArg<4>(&user_data), Return(0)));
+    EXPECT_CALL(mock_drm, drmHandleEvent(drm_fd, _))
+        .WillOnce(DoAll(InvokePageFlipHandler(&user_data), Return(0)));
+
+    page_flipper.schedule_flip(crtc_id, fb_id, connector_id);
+
+    std::thread waiter{[&] { page_flipper.wait_for_flip(crtc_id); }};
+
+    /* Wait until the thread is waiting on the DRM fd */
+    while (page_flipper.debug_get_worker_tid() != waiter.get_id())
+        std::this_thread::yield();
+
+    /* The main loop, or the waiting thread itself, handles the event */
+    mock_drm.generate_event_on(drm_device);
+    page_flipper.handle_events();
+
+    waiter.join();
+    EXPECT_FALSE(page_flipper.flip_pending(crtc_id));
+}
+
+TEST_F(KMSPageFlipperTest, wakeup_fd_is_readable_once_wakeup_time_comes)
+{
+    using namespace testing;
+    using namespace std::chrono_literals;
+
+    auto const wakeup_at = std::chrono::steady_clock::now() + 10ms;
+    page_flipper.schedule_wakeup(wakeup_at);
+    page_flipper.schedule_wakeup(wakeup_at + 1s);
+
+    pollfd fd{page_flipper.wakeup_fd(), POLLIN, 0};
+    ASSERT_THAT(poll(&fd, 1, 5000), Eq(1));
+    EXPECT_THAT(std::chrono::steady_clock::now(), Ge(wakeup_at));
+    EXPECT_THAT(std::chrono::steady_clock::now(), Lt(wakeup_at + 1s));
+
+    page_flipper.handle_events();
+    EXPECT_THAT(poll(&fd, 1, 0), Eq(0));
+}
+
 TEST_F(KMSPageFlipperTest, wait_for_flip_reports_vsync)
 {
     using namespace testing;
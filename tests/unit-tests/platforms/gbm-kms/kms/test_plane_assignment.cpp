@@ -0,0 +1,67 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/platforms/gbm-kms/server/kms/plane_assignment.h"
+
+#include <drm_fourcc.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mgg = mir::graphics::gbm;
+
+using namespace testing;
+
+namespace
+{
+auto const argb = uint32_t{DRM_FORMAT_ARGB8888};
+auto const xrgb = uint32_t{DRM_FORMAT_XRGB8888};
+auto const nv12 = uint32_t{DRM_FORMAT_NV12};
+}
+
+TEST(PlaneAssignment, nothing_to_assign_needs_no_planes)
+{
+    EXPECT_THAT(mgg::assign_overlay_planes({}, {}), Optional(IsEmpty()));
+}
+
+TEST(PlaneAssignment, buffers_get_planes_in_stacking_order)
+{
+    std::vector<mgg::OverlayPlane> const planes{{31, {argb, xrgb}}, {32, {argb, xrgb}}, {33, {argb, xrgb}}};
+
+    EXPECT_THAT(mgg::assign_overlay_planes(planes, {xrgb, argb}), Optional(ElementsAre(31u, 32u)));
+}
+
+TEST(PlaneAssignment, planes_without_the_format_are_skipped)
+{
+    std::vector<mgg::OverlayPlane> const planes{{31, {nv12}}, {32, {argb, xrgb}}, {33, {nv12, xrgb}}};
+
+    EXPECT_THAT(mgg::assign_overlay_planes(planes, {argb, xrgb}), Optional(ElementsAre(32u, 33u)));
+}
+
+TEST(PlaneAssignment, fails_when_there_are_too_few_planes)
+{
+    std::vector<mgg::OverlayPlane> const planes{{31, {argb, xrgb}}};
+
+    EXPECT_THAT(mgg::assign_overlay_planes(planes, {argb, argb}), Eq(std::nullopt));
+}
+
+TEST(PlaneAssignment, fails_when_stacking_order_cannot_be_kept)
+{
+    // The only NV12 plane is below the only ARGB one, but the NV12 buffer is on top
+    std::vector<mgg::OverlayPlane> const planes{{31, {nv12}}, {32, {argb}}};
+
+    EXPECT_THAT(mgg::assign_overlay_planes(planes, {argb, nv12}), Eq(std::nullopt));
+}
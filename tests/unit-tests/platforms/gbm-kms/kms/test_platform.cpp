@@ -129,7 +129,8 @@ TEST_F(MesaGraphicsPlatform, a_failure_while_creating_a_platform_results_in_an_e
                 mir::report::null_display_report(),
                 *std::make_shared<mtd::StubConsoleServices>(),
                 *std::make_shared<mtd::NullEmergencyCleanup>(),
-                mgg::BypassOption::allowed
+                mgg::BypassOption::allowed,
+                mgg::AtomicKMSOption::prohibited
             };
         }
     } catch(std::exception const&)
@@ -24,6 +24,7 @@
 #include "mir/test/doubles/mock_drm.h"
 #include "mir/test/doubles/mock_gbm.h"
 
+#include <cstring>
 #include <stdexcept>
 
 #include <gtest/gtest.h>
@@ -45,14 +46,20 @@ class NullPageFlipper : public mgg::PageFlipper
 {
 public:
     bool schedule_flip(uint32_t,uint32_t,uint32_t) override { return true; }
+    bool schedule_commit(uint32_t,uint32_t,drmModeAtomicReq*) override { return true; }
     mg::Frame wait_for_flip(uint32_t) override { return {}; }
+    bool flip_pending(uint32_t) override { return false; }
+    void schedule_wakeup(std::chrono::steady_clock::time_point) override {}
 };
 
 class MockPageFlipper : public mgg::PageFlipper
 {
 public:
     MOCK_METHOD3(schedule_flip, bool(uint32_t,uint32_t,uint32_t));
+    MOCK_METHOD3(schedule_commit, bool(uint32_t,uint32_t,drmModeAtomicReq*));
     MOCK_METHOD1(wait_for_flip, mg::Frame(uint32_t));
+    MOCK_METHOD1(flip_pending, bool(uint32_t));
+    MOCK_METHOD1(schedule_wakeup, void(std::chrono::steady_clock::time_point));
 };
 
 class MockKMSFramebuffer : public mg::FBHandle
@@ -555,3 +562,75 @@ TEST_F(RealKMSOutputTest, drm_set_gamma_failure_does_not_throw)
 
     EXPECT_NO_THROW(output.set_gamma(gamma););
 }
+
+TEST_F(RealKMSOutputTest, variable_refresh_is_not_enabled_without_driver_support)
+{
+    using namespace testing;
+
+    uint32_t const fb_id{67};
+
+    setup_outputs_connected_crtc();
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    EXPECT_CALL(mock_drm, drmModeObjectSetProperty(_, _, _, _, _)).Times(0);
+
+    auto const fb = std::make_shared<MockKMSFramebuffer>(fb_id);
+
+    EXPECT_TRUE(output.set_crtc(*fb));
+
+    EXPECT_NO_THROW(output.set_variable_refresh(true));
+    EXPECT_FALSE(output.has_variable_refresh());
+}
+
+TEST_F(RealKMSOutputTest, variable_refresh_is_enabled_on_capable_connector)
+{
+    using namespace testing;
+
+    uint32_t const fb_id{67};
+    uint32_t const vrr_capable_id{100};
+    uint32_t const vrr_enabled_id{101};
+
+    setup_outputs_connected_crtc();
+
+    drmModePropertyRes vrr_capable{};
+    vrr_capable.prop_id = vrr_capable_id;
+    strncpy(vrr_capable.name, "vrr_capable", sizeof(vrr_capable.name));
+    drmModePropertyRes vrr_enabled{};
+    vrr_enabled.prop_id = vrr_enabled_id;
+    strncpy(vrr_enabled.name, "VRR_ENABLED", sizeof(vrr_enabled.name));
+
+    uint32_t connector_prop_ids[]{vrr_capable_id};
+    uint64_t connector_prop_values[]{1};
+    drmModeObjectProperties connector_props{1, connector_prop_ids, connector_prop_values};
+    uint32_t crtc_prop_ids[]{vrr_enabled_id};
+    uint64_t crtc_prop_values[]{0};
+    drmModeObjectProperties crtc_props{1, crtc_prop_ids, crtc_prop_values};
+
+    ON_CALL(mock_drm, drmModeObjectGetProperties(_, connector_ids[0], DRM_MODE_OBJECT_CONNECTOR))
+        .WillByDefault(Return(&connector_props));
+    ON_CALL(mock_drm, drmModeObjectGetProperties(_, crtc_ids[0], DRM_MODE_OBJECT_CRTC))
+        .WillByDefault(Return(&crtc_props));
+    ON_CALL(mock_drm, drmModeGetProperty(_, vrr_capable_id))
+        .WillByDefault(Return(&vrr_capable));
+    ON_CALL(mock_drm, drmModeGetProperty(_, vrr_enabled_id))
+        .WillByDefault(Return(&vrr_enabled));
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    EXPECT_CALL(mock_drm, drmModeObjectSetProperty(_, crtc_ids[0], DRM_MODE_OBJECT_CRTC, vrr_enabled_id, 1))
+        .WillOnce(Return(0));
+
+    auto const fb = std::make_shared<MockKMSFramebuffer>(fb_id);
+
+    EXPECT_TRUE(output.set_crtc(*fb));
+
+    output.set_variable_refresh(true);
+    EXPECT_TRUE(output.has_variable_refresh());
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <src/renderers/gl/damage_tracker.h>
+#include <mir/test/doubles/fake_renderable.h>
+#include <mir/test/doubles/stub_buffer.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mtd = mir::test::doubles;
+namespace mg = mir::graphics;
+namespace mrg = mir::renderer::gl;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace
+{
+struct DamageTracker : Test
+{
+    geom::Rectangle const viewport{{0, 0}, {1920, 1080}};
+    std::shared_ptr<mtd::FakeRenderable> const lower{std::make_shared<mtd::FakeRenderable>(10, 10, 100, 100)};
+    std::shared_ptr<mtd::FakeRenderable> const upper{std::make_shared<mtd::FakeRenderable>(500, 500, 50, 50)};
+
+    mrg::DamageTracker tracker;
+};
+}
+
+TEST_F(DamageTracker, first_frame_damages_whole_viewport)
+{
+    EXPECT_THAT(tracker.add_frame({lower, upper}, viewport), Eq(viewport));
+}
+
+TEST_F(DamageTracker, unchanged_frame_has_no_damage)
+{
+    tracker.add_frame({lower, upper}, viewport);
+
+    EXPECT_THAT(tracker.add_frame({lower, upper}, viewport), Eq(geom::Rectangle{}));
+}
+
+TEST_F(DamageTracker, new_buffer_damages_renderable)
+{
+    tracker.add_frame({lower, upper}, viewport);
+
+    upper->set_buffer(std::make_shared<mtd::StubBuffer>());
+
+    EXPECT_THAT(tracker.add_frame({lower, upper}, viewport), Eq(upper->screen_position()));
+}
+
+TEST_F(DamageTracker, added_and_removed_renderables_are_damaged)
+{
+    tracker.add_frame({lower}, viewport);
+
+    EXPECT_THAT(tracker.add_frame({lower, upper}, viewport), Eq(upper->screen_position()));
+    EXPECT_THAT(tracker.add_frame({upper}, viewport), Eq(lower->screen_position()));
+}
+
+TEST_F(DamageTracker, damage_covers_old_and_new_renderables)
+{
+    auto const moved = std::make_shared<mtd::FakeRenderable>(200, 10, 100, 100);
+    tracker.add_frame({lower}, viewport);
+
+    EXPECT_THAT(tracker.add_frame({moved}, viewport), Eq(geom::Rectangle{{10, 10}, {290, 100}}));
+}
+
+TEST_F(DamageTracker, damage_is_limited_to_viewport)
+{
+    auto const offscreen = std::make_shared<mtd::FakeRenderable>(1900, 1000, 100, 100);
+    tracker.add_frame({lower}, viewport);
+
+    EXPECT_THAT(tracker.add_frame({lower, offscreen}, viewport), Eq(geom::Rectangle{{1900, 1000}, {20, 80}}));
+}
+
+TEST_F(DamageTracker, restacking_damages_whole_viewport)
+{
+    tracker.add_frame({lower, upper}, viewport);
+
+    EXPECT_THAT(tracker.add_frame({upper, lower}, viewport), Eq(viewport));
+}
+
+TEST_F(DamageTracker, viewport_change_damages_whole_viewport)
+{
+    geom::Rectangle const new_viewport{{0, 0}, {1280, 720}};
+    tracker.add_frame({lower, upper}, viewport);
+
+    EXPECT_THAT(tracker.add_frame({lower, upper}, new_viewport), Eq(new_viewport));
+}
+
+TEST_F(DamageTracker, buffer_age_accumulates_damage_of_intervening_frames)
+{
+    tracker.add_frame({lower, upper}, viewport);
+    lower->set_buffer(std::make_shared<mtd::StubBuffer>());
+    tracker.add_frame({lower, upper}, viewport);
+    upper->set_buffer(std::make_shared<mtd::StubBuffer>());
+    tracker.add_frame({lower, upper}, viewport);
+
+    EXPECT_THAT(tracker.damage_for_buffer_age(1), Optional(upper->screen_position()));
+    EXPECT_THAT(tracker.damage_for_buffer_age(2), Optional(geom::Rectangle{{10, 10}, {540, 540}}));
+    EXPECT_THAT(tracker.damage_for_buffer_age(3), Optional(viewport));
+}
+
+TEST_F(DamageTracker, unknown_buffer_age_needs_full_repaint)
+{
+    tracker.add_frame({lower, upper}, viewport);
+    tracker.add_frame({lower, upper}, viewport);
+
+    EXPECT_THAT(tracker.damage_for_buffer_age(0), Eq(std::nullopt));
+    EXPECT_THAT(tracker.damage_for_buffer_age(3), Eq(std::nullopt));
+    EXPECT_THAT(tracker.damage_for_buffer_age(mrg::DamageTracker::max_buffer_age + 1), Eq(std::nullopt));
+}
+
+TEST_F(DamageTracker, reset_forgets_history)
+{
+    tracker.add_frame({lower, upper}, viewport);
+    tracker.add_frame({lower, upper}, viewport);
+
+    tracker.reset();
+
+    EXPECT_THAT(tracker.damage_for_buffer_age(1), Eq(std::nullopt));
+    EXPECT_THAT(tracker.add_frame({lower, upper}, viewport), Eq(viewport));
+}
@@ -36,6 +36,7 @@ using testing::Pointee;
 using testing::AnyNumber;
 using testing::AtLeast;
 using testing::DoAll;
+using testing::Mock;
 using testing::_;
 
 namespace mt=mir::test;
@@ -436,3 +437,215 @@ TEST_F(GLRenderer, sets_viewport_downscaled_wide)
     mrg::Renderer renderer(gl_platform, std::move(output_surface));
     renderer.set_viewport(view_area);
 }
+
+TEST_F(GLRenderer, repaints_only_damage_when_buffer_age_is_known)
+{
+    EXPECT_CALL(*renderable, transformation()).WillRepeatedly(Return(glm::mat4{1}));
+    auto output_surface = make_output_surface();
+    ON_CALL(*output_surface, size())
+        .WillByDefault(Return(mir::geometry::Size{1920, 1080}));
+    ON_CALL(*output_surface, buffer_age())
+        .WillByDefault(Return(1));
+
+    mrg::Renderer renderer(gl_platform, std::move(output_surface), true);
+    renderer.set_viewport({{0, 0}, {1920, 1080}});
+
+    // The first frame has no history, so is repainted in full
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST)).Times(0);
+    renderer.render(renderable_list);
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    // An unchanged frame has nothing to repaint
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST));
+    EXPECT_CALL(mock_gl, glScissor(0, 0, 0, 0));
+    EXPECT_CALL(mock_gl, glDrawArrays(_, _, _)).Times(0);
+    renderer.render(renderable_list);
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    // A new buffer damages just the renderable (flipped into GL's bottom-up window coordinates)
+    auto const new_buffer = std::make_shared<testing::NiceMock<mtd::MockTextureBuffer>>();
+    ON_CALL(*new_buffer, id()).WillByDefault(Return(mg::BufferID{790}));
+    ON_CALL(*new_buffer, shader(_)).WillByDefault(testing::Invoke(
+        [](auto& factory) -> mg::gl::Program&
+        {
+            static int unused = 1;
+            return factory.compile_fragment_shader(&unused, "extension code", "fragment code");
+        }));
+    EXPECT_CALL(*renderable, buffer()).WillRepeatedly(Return(new_buffer));
+
+    EXPECT_CALL(mock_gl, glEnable(_)).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST));
+    EXPECT_CALL(mock_gl, glScissor(1, 1074, 3, 4));
+    EXPECT_CALL(mock_gl, glDrawArrays(_, _, _)).Times(AtLeast(1));
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, repaints_everything_when_buffer_age_is_unknown)
+{
+    auto output_surface = make_output_surface();
+    ON_CALL(*output_surface, size())
+        .WillByDefault(Return(mir::geometry::Size{1920, 1080}));
+    ON_CALL(*output_surface, buffer_age())
+        .WillByDefault(Return(0));
+
+    mrg::Renderer renderer(gl_platform, std::move(output_surface), true);
+    renderer.set_viewport({{0, 0}, {1920, 1080}});
+
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST)).Times(0);
+    EXPECT_CALL(mock_gl, glDrawArrays(_, _, _)).Times(AtLeast(2));
+    renderer.render(renderable_list);
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, draws_opaque_region_of_rgba_surface_without_blending)
+{
+    EXPECT_CALL(*renderable, transformation()).WillRepeatedly(Return(glm::mat4{1}));
+    EXPECT_CALL(*renderable, shaped()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*renderable, screen_position())
+        .WillRepeatedly(Return(mir::geometry::Rectangle{{0, 0}, {100, 100}}));
+    EXPECT_CALL(*renderable, opaque_region())
+        .WillRepeatedly(Return(mir::geometry::Rectangles{{{0, 0}, {100, 80}}}));
+    auto output_surface = make_output_surface();
+    ON_CALL(*output_surface, size())
+        .WillByDefault(Return(mir::geometry::Size{1920, 1080}));
+
+    mrg::Renderer renderer(gl_platform, std::move(output_surface));
+    renderer.set_viewport({{0, 0}, {1920, 1080}});
+
+    EXPECT_CALL(mock_gl, glEnable(_)).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glScissor(_, _, _, _)).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glDrawArrays(_, _, _)).Times(2);
+    {
+        InSequence seq;
+        EXPECT_CALL(mock_gl, glScissor(0, 1000, 100, 80));
+        EXPECT_CALL(mock_gl, glDisable(GL_BLEND));
+        EXPECT_CALL(mock_gl, glScissor(0, 980, 100, 20));
+        EXPECT_CALL(mock_gl, glEnable(GL_BLEND));
+    }
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, uploads_vertices_of_whole_frame_at_once)
+{
+    auto const other = std::make_shared<testing::NiceMock<mtd::MockRenderable>>();
+    ON_CALL(*other, buffer()).WillByDefault(Return(mock_buffer));
+    ON_CALL(*other, alpha()).WillByDefault(Return(1.0f));
+    ON_CALL(*other, screen_position()).WillByDefault(Return(mir::geometry::Rectangle{{10, 20}, {30, 40}}));
+    renderable_list.push_back(other);
+
+    mrg::Renderer renderer(gl_platform, make_output_surface());
+
+    InSequence seq;
+    EXPECT_CALL(mock_gl, glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(mgl::Vertex), _, _));
+    EXPECT_CALL(mock_gl, glDrawArrays(_, 0, 4));
+    EXPECT_CALL(mock_gl, glDrawArrays(_, 4, 4));
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, unchanged_geometry_is_not_uploaded_again)
+{
+    mrg::Renderer renderer(gl_platform, make_output_surface());
+
+    // Each of the buffers used in turn needs filling once...
+    EXPECT_CALL(mock_gl, glBufferData(_, _, _, _)).Times(3);
+    for (int frame = 0; frame != 3; ++frame)
+    {
+        renderer.render(renderable_list);
+    }
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    // ...but after that they hold the same geometry
+    EXPECT_CALL(mock_gl, glBufferData(_, _, _, _)).Times(0);
+    renderer.render(renderable_list);
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    EXPECT_CALL(*renderable, screen_position())
+        .WillRepeatedly(Return(mir::geometry::Rectangle{{5, 6}, {3, 4}}));
+    EXPECT_CALL(mock_gl, glBufferData(_, _, _, _));
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, does_not_repeat_gl_state_changes_between_renderables)
+{
+    for (int i = 0; i != 3; ++i)
+    {
+        auto const other = std::make_shared<testing::NiceMock<mtd::MockRenderable>>();
+        ON_CALL(*other, buffer()).WillByDefault(Return(mock_buffer));
+        ON_CALL(*other, alpha()).WillByDefault(Return(1.0f));
+        renderable_list.push_back(other);
+    }
+
+    mrg::Renderer renderer(gl_platform, make_output_surface());
+
+    EXPECT_CALL(mock_gl, glUseProgram(_)).Times(1);
+    EXPECT_CALL(mock_gl, glVertexAttribPointer(_, _, _, _, _, _)).Times(2);
+    EXPECT_CALL(mock_gl, glDisable(GL_BLEND)).Times(1);
+    EXPECT_CALL(mock_gl, glDrawArrays(_, _, _)).Times(4);
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, copies_a_buffer_drawn_much_smaller_only_once_it_is_drawn_unchanged_again)
+{
+    auto output_surface = make_output_surface();
+    ON_CALL(*output_surface, size())
+        .WillByDefault(Return(mir::geometry::Size{1920, 1080}));
+    ON_CALL(mock_gl, glCheckFramebufferStatus(GL_FRAMEBUFFER))
+        .WillByDefault(Return(GL_FRAMEBUFFER_COMPLETE));
+    EXPECT_CALL(*renderable, transformation()).WillRepeatedly(Return(glm::mat4{1}));
+
+    mrg::Renderer renderer(gl_platform, std::move(output_surface));
+    renderer.set_viewport({{0, 0}, {1920, 1080}});
+
+    int copies{0};
+    ON_CALL(mock_gl, glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _, 0))
+        .WillByDefault(testing::InvokeWithoutArgs([&copies] { ++copies; }));
+
+    renderer.render(renderable_list);
+    EXPECT_THAT(copies, testing::Eq(0));
+
+    renderer.render(renderable_list);
+    renderer.render(renderable_list);
+    EXPECT_THAT(copies, testing::Eq(1));
+}
+
+TEST_F(GLRenderer, scene_is_drawn_to_the_output_framebuffer_after_making_a_scaled_copy)
+{
+    GLuint const output_framebuffer{0};
+    GLuint const copy_framebuffer{42};
+
+    auto output_surface = make_output_surface();
+    ON_CALL(*output_surface, size())
+        .WillByDefault(Return(mir::geometry::Size{1920, 1080}));
+    ON_CALL(mock_gl, glCheckFramebufferStatus(GL_FRAMEBUFFER))
+        .WillByDefault(Return(GL_FRAMEBUFFER_COMPLETE));
+    ON_CALL(mock_gl, glGenFramebuffers(1, _))
+        .WillByDefault(SetArgPointee<1>(copy_framebuffer));
+    EXPECT_CALL(*renderable, transformation()).WillRepeatedly(Return(glm::mat4{1}));
+
+    // Track the framebuffer binding, as the output surface relies on it when binding does nothing
+    GLuint bound_framebuffer{output_framebuffer};
+    ON_CALL(mock_gl, glBindFramebuffer(GL_FRAMEBUFFER, _))
+        .WillByDefault(testing::SaveArg<1>(&bound_framebuffer));
+    ON_CALL(mock_gl, glGetIntegerv(GL_FRAMEBUFFER_BINDING, _))
+        .WillByDefault(testing::WithArg<1>(testing::Invoke(
+            [&bound_framebuffer](GLint* binding) { *binding = static_cast<GLint>(bound_framebuffer); })));
+
+    std::vector<GLuint> framebuffers_drawn_to;
+    ON_CALL(mock_gl, glDrawArrays(_, _, _))
+        .WillByDefault(testing::InvokeWithoutArgs(
+            [&] { framebuffers_drawn_to.push_back(bound_framebuffer); }));
+
+    mrg::Renderer renderer(gl_platform, std::move(output_surface));
+    renderer.set_viewport({{0, 0}, {1920, 1080}});
+
+    renderer.render(renderable_list);
+    framebuffers_drawn_to.clear();
+
+    // This frame makes the copy, then draws the scene with it
+    renderer.render(renderable_list);
+
+    EXPECT_THAT(framebuffers_drawn_to, testing::Contains(copy_framebuffer));
+    ASSERT_THAT(framebuffers_drawn_to, testing::Not(testing::IsEmpty()));
+    EXPECT_THAT(framebuffers_drawn_to.back(), testing::Eq(output_framebuffer));
+    EXPECT_THAT(bound_framebuffer, testing::Eq(output_framebuffer));
+}
@@ -1018,7 +1018,7 @@ TEST_F(BasicSurfaceTest, when_frame_is_posted_an_observer_is_notified_of_frame_w
         .WillByDefault(Return(rect.size));
 
     EXPECT_CALL(*mock_surface_observer, frame_posted(_, _, mt::RectSizeEq(rect.size)));
-    buffer_stream->frame_posted_callback(rect.size);
+    buffer_stream->frame_posted_callback(rect.size, {{}, rect.size});
 }
 
 TEST_F(BasicSurfaceTest, when_stream_size_differs_from_buffer_size_an_observer_is_notified_of_frame_with_stream_size)
@@ -1027,7 +1027,6 @@ TEST_F(BasicSurfaceTest, when_stream_size_differs_from_buffer_size_an_observer_i
     geom::Size const stream_size{rect.size * 1.5};
 
     auto buffer_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
-    std::function<void(geom::Size const&)> frame_posted_callback;
     ON_CALL(*buffer_stream, stream_size())
         .WillByDefault(Return(stream_size));
 
@@ -1035,7 +1034,7 @@ TEST_F(BasicSurfaceTest, when_stream_size_differs_from_buffer_size_an_observer_i
     surface.set_streams({ms::StreamInfo{buffer_stream, {}, {}}});
 
     EXPECT_CALL(*mock_surface_observer, frame_posted(_, _, mt::RectSizeEq(stream_size)));
-    buffer_stream->frame_posted_callback(stream_size * 2);
+    buffer_stream->frame_posted_callback(stream_size * 2, {{}, stream_size * 2});
 }
 
 TEST_F(BasicSurfaceTest, when_stream_info_has_explicit_size_an_observer_is_notified_of_frame_with_stream_info_size)
@@ -1045,7 +1044,6 @@ TEST_F(BasicSurfaceTest, when_stream_info_has_explicit_size_an_observer_is_notif
     geom::Size const stream_size{stream_info_size * 2};
 
     auto buffer_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
-    std::function<void(geom::Size const&)> frame_posted_callback;
     ON_CALL(*buffer_stream, stream_size())
         .WillByDefault(Return(stream_size));
 
@@ -1053,7 +1051,7 @@ TEST_F(BasicSurfaceTest, when_stream_info_has_explicit_size_an_observer_is_notif
     surface.set_streams({ms::StreamInfo{buffer_stream, {}, stream_info_size}});
 
     EXPECT_CALL(*mock_surface_observer, frame_posted(_, _, mt::RectSizeEq(stream_info_size)));
-    buffer_stream->frame_posted_callback(stream_size);
+    buffer_stream->frame_posted_callback(stream_size, {{}, stream_size});
 }
 
 TEST_F(BasicSurfaceTest, when_frame_is_posted_an_observer_is_notified_of_frame_at_origin)
@@ -1065,7 +1063,7 @@ TEST_F(BasicSurfaceTest, when_frame_is_posted_an_observer_is_notified_of_frame_a
     surface.set_streams({ms::StreamInfo{buffer_stream, {}, {}}});
 
     EXPECT_CALL(*mock_surface_observer, frame_posted(_, _, mt::RectTopLeftEq(geom::Point{})));
-    buffer_stream->frame_posted_callback(rect.size);
+    buffer_stream->frame_posted_callback(rect.size, {{}, rect.size});
 }
 
 TEST_F(BasicSurfaceTest, when_stream_info_has_offset_an_observer_is_notified_of_frame_with_correct_offset)
@@ -1074,13 +1072,28 @@ TEST_F(BasicSurfaceTest, when_stream_info_has_offset_an_observer_is_notified_of_
     geom::Displacement const stream_info_offset{7, 10};
 
     auto buffer_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
-    std::function<void(geom::Size const&)> frame_posted_callback;
 
     surface.register_interest(mock_surface_observer, executor);
     surface.set_streams({ms::StreamInfo{buffer_stream, stream_info_offset, {}}});
 
     EXPECT_CALL(*mock_surface_observer, frame_posted(_, _, mt::RectTopLeftEq(geom::Point{} + stream_info_offset)));
-    buffer_stream->frame_posted_callback(rect.size);
+    buffer_stream->frame_posted_callback(rect.size, {{}, rect.size});
+}
+
+TEST_F(BasicSurfaceTest, renderable_opaque_region_is_placed_on_screen_and_clipped_to_stream)
+{
+    using namespace testing;
+    geom::Displacement const stream_info_offset{2, 3};
+    geom::Size const stream_info_size{10, 10};
+
+    surface.set_streams({ms::StreamInfo{
+        mock_buffer_stream, stream_info_offset, stream_info_size, geom::Rectangles{{{0, 0}, {5, 20}}}}});
+
+    auto const renderables = surface.generate_renderables(compositor_id);
+    ASSERT_THAT(renderables.size(), Eq(1u));
+    EXPECT_THAT(
+        renderables[0]->opaque_region(),
+        Eq(geom::Rectangles{{rect.top_left + stream_info_offset, {5, 10}}}));
 }
 
 TEST_F(BasicSurfaceTest, when_surface_has_margins_an_observer_is_notified_of_frame_with_correct_offset)
@@ -1090,14 +1103,46 @@ TEST_F(BasicSurfaceTest, when_surface_has_margins_an_observer_is_notified_of_fra
     geom::DeltaX const margin_left{3}, margin_right{5};
 
     auto buffer_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
-    std::function<void(geom::Size const&)> frame_posted_callback;
 
     surface.register_interest(mock_surface_observer, executor);
     surface.set_streams({ms::StreamInfo{buffer_stream, {}, {}}});
 
     EXPECT_CALL(*mock_surface_observer, frame_posted(_, _, mt::RectTopLeftEq(geom::Point{} + margin_top + margin_left)));
     surface.set_window_margins(margin_top, margin_left, margin_bottom, margin_right);
-    buffer_stream->frame_posted_callback({20, 30});
+    buffer_stream->frame_posted_callback({20, 30}, {{}, geom::Size{20, 30}});
+}
+
+TEST_F(BasicSurfaceTest, when_frame_is_posted_an_observer_is_notified_of_damaged_area)
+{
+    using namespace testing;
+    geom::Size const size{100, 80};
+
+    auto buffer_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
+    ON_CALL(*buffer_stream, stream_size())
+        .WillByDefault(Return(size));
+
+    surface.register_interest(mock_surface_observer, executor);
+    surface.set_streams({ms::StreamInfo{buffer_stream, {}, {}}});
+
+    EXPECT_CALL(*mock_surface_observer, frame_posted(_, _, Eq(geom::Rectangle{{10, 20}, {5, 6}})));
+    buffer_stream->frame_posted_callback(size, {{10, 20}, {5, 6}});
+}
+
+TEST_F(BasicSurfaceTest, damage_of_scaled_buffer_is_notified_in_logical_coordinates)
+{
+    using namespace testing;
+    geom::Size const logical_size{100, 80};
+
+    auto buffer_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
+    ON_CALL(*buffer_stream, stream_size())
+        .WillByDefault(Return(logical_size));
+
+    surface.register_interest(mock_surface_observer, executor);
+    surface.set_streams({ms::StreamInfo{buffer_stream, {}, {}}});
+
+    // Damage that doesn't fall on logical pixel boundaries is rounded outwards
+    EXPECT_CALL(*mock_surface_observer, frame_posted(_, _, Eq(geom::Rectangle{{5, 10}, {3, 4}})));
+    buffer_stream->frame_posted_callback(logical_size * 2, {{10, 21}, {5, 6}});
 }
 
 TEST_F(BasicSurfaceTest, default_application_id)
@@ -1573,7 +1618,7 @@ TEST_F(BasicSurfaceTest, buffer_can_be_submitted_to_original_stream_after_surfac
 
     auto local_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
     std::list<ms::StreamInfo> local_stream_list = { { local_stream, {}, {} } };
-    std::function<void(geom::Size const&)> callback = [](auto){};
+    std::function<void(geom::Size const&, geom::Rectangle const&)> callback = [](auto, auto){};
 
     EXPECT_CALL(*local_stream, set_frame_posted_callback(_))
         .Times(AtLeast(1))
@@ -1590,7 +1635,7 @@ TEST_F(BasicSurfaceTest, buffer_can_be_submitted_to_original_stream_after_surfac
         report);
 
     surface.reset();
-    callback({10, 10});
+    callback({10, 10}, {{0, 0}, {10, 10}});
 }
 
 TEST_F(BasicSurfaceTest, buffer_can_be_submitted_to_set_stream_after_surface_destroyed)
@@ -1599,7 +1644,7 @@ TEST_F(BasicSurfaceTest, buffer_can_be_submitted_to_set_stream_after_surface_des
 
     auto local_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
     std::list<ms::StreamInfo> local_stream_list = { { local_stream, {}, {} } };
-    std::function<void(geom::Size const&)> callback = [](auto){};
+    std::function<void(geom::Size const&, geom::Rectangle const&)> callback = [](auto, auto){};
 
     EXPECT_CALL(*local_stream, set_frame_posted_callback(_))
         .Times(AtLeast(1))
@@ -1618,5 +1663,5 @@ TEST_F(BasicSurfaceTest, buffer_can_be_submitted_to_set_stream_after_surface_des
     surface->set_streams(local_stream_list);
 
     surface.reset();
-    callback({10, 10});
+    callback({10, 10}, {{0, 0}, {10, 10}});
 }
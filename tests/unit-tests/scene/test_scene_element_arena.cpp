@@ -0,0 +1,80 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/scene/scene_element_arena.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+
+namespace ms = mir::scene;
+
+using namespace testing;
+
+namespace
+{
+struct SceneElementArena : Test
+{
+    ms::SceneElementArena arena;
+
+    /// Allocate and release \a count blocks, as a compositor does with a frame's elements
+    void run_frame(int count)
+    {
+        std::vector<void*> blocks;
+        for (auto i = 0; i != count; ++i)
+            blocks.push_back(arena.allocate(64));
+        for (auto const block : blocks)
+            arena.deallocate(block, 64);
+    }
+};
+}
+
+TEST_F(SceneElementArena, steady_state_frames_allocate_no_more_blocks)
+{
+    run_frame(300);
+    auto const after_first_frame = arena.blocks_allocated();
+
+    for (auto i = 0; i != 10; ++i)
+        run_frame(300);
+
+    EXPECT_THAT(after_first_frame, Eq(300u));
+    EXPECT_THAT(arena.blocks_allocated(), Eq(after_first_frame));
+}
+
+TEST_F(SceneElementArena, grows_to_fit_a_bigger_frame)
+{
+    run_frame(10);
+    run_frame(20);
+
+    EXPECT_THAT(arena.blocks_allocated(), Eq(20u));
+}
+
+TEST_F(SceneElementArena, released_block_is_handed_out_again)
+{
+    auto const block = arena.allocate(64);
+    arena.deallocate(block, 64);
+
+    EXPECT_THAT(arena.allocate(32), Eq(block));
+}
+
+TEST_F(SceneElementArena, oversized_requests_bypass_the_arena)
+{
+    auto const block = arena.allocate(ms::SceneElementArena::block_size + 1);
+    arena.deallocate(block, ms::SceneElementArena::block_size + 1);
+
+    EXPECT_THAT(arena.blocks_allocated(), Eq(0u));
+}
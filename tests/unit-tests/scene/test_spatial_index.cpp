@@ -0,0 +1,107 @@
+/*
+ * Copyright © Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/scene/spatial_index.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace ms = mir::scene;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace
+{
+struct SpatialIndex : Test
+{
+    // Only ever used as keys
+    ms::Surface const* const surface1{reinterpret_cast<ms::Surface const*>(0x10)};
+    ms::Surface const* const surface2{reinterpret_cast<ms::Surface const*>(0x20)};
+    ms::Surface const* const surface3{reinterpret_cast<ms::Surface const*>(0x30)};
+
+    ms::SpatialIndex index{100};
+};
+}
+
+TEST_F(SpatialIndex, finds_surfaces_at_a_point)
+{
+    index.update(surface1, geom::Rectangle{{0, 0}, {300, 300}});
+    index.update(surface2, geom::Rectangle{{250, 250}, {100, 100}});
+
+    EXPECT_THAT(index.surfaces_at({10, 10}), ElementsAre(surface1));
+    EXPECT_THAT(index.surfaces_at({260, 260}), UnorderedElementsAre(surface1, surface2));
+    EXPECT_THAT(index.surfaces_at({340, 340}), ElementsAre(surface2));
+    EXPECT_THAT(index.surfaces_at({350, 350}), IsEmpty());
+}
+
+TEST_F(SpatialIndex, finds_each_surface_intersecting_an_area_once)
+{
+    index.update(surface1, geom::Rectangle{{0, 0}, {1920, 1080}});
+    index.update(surface2, geom::Rectangle{{1900, 0}, {100, 100}});
+    index.update(surface3, geom::Rectangle{{2500, 0}, {100, 100}});
+
+    EXPECT_THAT(index.surfaces_intersecting({{0, 0}, {1920, 1080}}), UnorderedElementsAre(surface1, surface2));
+    EXPECT_THAT(index.surfaces_intersecting({{1920, 0}, {1920, 1080}}), UnorderedElementsAre(surface2, surface3));
+}
+
+TEST_F(SpatialIndex, handles_negative_coordinates)
+{
+    index.update(surface1, geom::Rectangle{{-150, -150}, {100, 100}});
+
+    EXPECT_THAT(index.surfaces_at({-100, -100}), ElementsAre(surface1));
+    EXPECT_THAT(index.surfaces_at({-50, -50}), IsEmpty());
+    EXPECT_THAT(index.surfaces_intersecting({{-1920, 0}, {1920, 1080}}), IsEmpty());
+    EXPECT_THAT(index.surfaces_intersecting({{-1920, -1080}, {1920, 1080}}), ElementsAre(surface1));
+}
+
+TEST_F(SpatialIndex, updated_surface_is_only_found_at_new_bounds)
+{
+    index.update(surface1, geom::Rectangle{{0, 0}, {100, 100}});
+    index.update(surface1, geom::Rectangle{{500, 500}, {100, 100}});
+
+    EXPECT_THAT(index.surfaces_at({50, 50}), IsEmpty());
+    EXPECT_THAT(index.surfaces_at({550, 550}), ElementsAre(surface1));
+}
+
+TEST_F(SpatialIndex, removed_surface_is_not_found)
+{
+    index.update(surface1, geom::Rectangle{{0, 0}, {100, 100}});
+    index.update(surface2, std::nullopt);
+
+    index.remove(surface1);
+    index.remove(surface2);
+
+    EXPECT_THAT(index.surfaces_at({50, 50}), IsEmpty());
+    EXPECT_THAT(index.surfaces_intersecting({{0, 0}, {100, 100}}), IsEmpty());
+}
+
+TEST_F(SpatialIndex, unbounded_and_huge_surfaces_are_found_everywhere)
+{
+    index.update(surface1, std::nullopt);
+    index.update(surface2, geom::Rectangle{{-100000, -100000}, {200000, 200000}});
+
+    EXPECT_THAT(index.surfaces_at({123456, -654321}), UnorderedElementsAre(surface1, surface2));
+    EXPECT_THAT(index.surfaces_intersecting({{0, 0}, {1, 1}}), UnorderedElementsAre(surface1, surface2));
+}
+
+TEST_F(SpatialIndex, empty_surface_is_found_nowhere)
+{
+    index.update(surface1, geom::Rectangle{{0, 0}, {0, 0}});
+
+    EXPECT_THAT(index.surfaces_at({0, 0}), IsEmpty());
+    EXPECT_THAT(index.surfaces_intersecting({{-10, -10}, {20, 20}}), IsEmpty());
+}
@@ -34,7 +34,10 @@
 #include <memory>
 #include <stdexcept>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <future>
+#include <set>
 
 namespace mc = mir::compositor;
 namespace mg = mir::graphics;
@@ -1458,4 +1461,168 @@ TEST_F(SurfaceStack, multiple_surfaces_can_be_swapped)
             SceneElementForStream(stub_buffer_stream2)));
 
     Mock::VerifyAndClearExpectations(&observer);
-}
\ No newline at end of file
+}
+
+TEST_F(SurfaceStack, scene_elements_for_compositor_area_leave_out_surfaces_elsewhere)
+{
+    stack.register_compositor(compositor_id);
+    stack.set_compositor_area(compositor_id, {{0, 0}, {1920, 1080}});
+    stack.add_surface(stub_surface1, mi::InputReceptionMode::normal);
+    stack.add_surface(stub_surface2, mi::InputReceptionMode::normal);
+    stub_surface2->move_to({2000, 0});
+
+    EXPECT_THAT(
+        stack.scene_elements_for(compositor_id),
+        ElementsAre(SceneElementForStream(stub_buffer_stream1)));
+}
+
+TEST_F(SurfaceStack, scene_elements_follow_surface_between_compositor_areas)
+{
+    mc::CompositorID const compositor_id2{&compositor_id};
+    stack.register_compositor(compositor_id);
+    stack.register_compositor(compositor_id2);
+    stack.set_compositor_area(compositor_id, {{0, 0}, {1920, 1080}});
+    stack.set_compositor_area(compositor_id2, {{1920, 0}, {1920, 1080}});
+    stack.add_surface(stub_surface1, mi::InputReceptionMode::normal);
+    stub_surface1->move_to({100, 100});
+
+    EXPECT_THAT(stack.scene_elements_for(compositor_id), SizeIs(1));
+    EXPECT_THAT(stack.scene_elements_for(compositor_id2), IsEmpty());
+
+    stub_surface1->move_to({2000, 100});
+    executor.execute();
+
+    EXPECT_THAT(stack.scene_elements_for(compositor_id), IsEmpty());
+    EXPECT_THAT(stack.scene_elements_for(compositor_id2), SizeIs(1));
+}
+
+TEST_F(SurfaceStack, surface_outside_compositor_area_is_occluded_in_it)
+{
+    using namespace testing;
+
+    stack.register_compositor(compositor_id);
+    stack.set_compositor_area(compositor_id, {{0, 0}, {100, 100}});
+
+    auto const mock_surface = std::make_shared<NiceMock<MockConfigureSurface>>(executor);
+    mock_surface->move_to({500, 500});
+
+    EXPECT_CALL(*mock_surface, configure(mir_window_attrib_visibility, mir_window_visibility_occluded));
+
+    stack.add_surface(mock_surface, mi::InputReceptionMode::normal);
+    EXPECT_THAT(stack.scene_elements_for(compositor_id), IsEmpty());
+}
+
+TEST_F(SurfaceStack, frames_pending_ignores_surfaces_outside_compositor_area)
+{
+    mc::CompositorID const compositor_id2{&compositor_id};
+    stack.register_compositor(compositor_id);
+    stack.register_compositor(compositor_id2);
+    stack.set_compositor_area(compositor_id, {{0, 0}, {100, 100}});
+    stack.set_compositor_area(compositor_id2, {{100, 0}, {1000, 1000}});
+
+    auto stream = std::make_shared<mc::Stream>(geom::Size{ 1, 1 }, mir_pixel_format_abgr_8888);
+    auto surface = std::make_shared<ms::BasicSurface>(
+        nullptr /* session */,
+        mw::Weak<mf::WlSurface>{},
+        std::string("stub"),
+        geom::Rectangle{{500, 500}, {10, 10}},
+        mir_pointer_unconfined,
+        std::list<ms::StreamInfo> { { stream, {}, {} } },
+        std::shared_ptr<mg::CursorImage>(),
+        report);
+    stack.add_surface(surface, mi::InputReceptionMode::normal);
+    post_a_frame(*stream);
+
+    EXPECT_THAT(stack.frames_pending(compositor_id), Eq(0));
+    EXPECT_THAT(stack.frames_pending(compositor_id2), Eq(1));
+}
+
+TEST_F(SurfaceStack, surface_at_follows_moved_surface)
+{
+    stack.add_surface(stub_surface1, mi::InputReceptionMode::normal);
+    stub_surface1->resize({100, 100});
+    EXPECT_THAT(stack.surface_at({50, 50}), Eq(stub_surface1));
+
+    stub_surface1->move_to({1000, 1000});
+    executor.execute();
+
+    EXPECT_THAT(stack.surface_at({50, 50}).get(), IsNull());
+    EXPECT_THAT(stack.surface_at({1050, 1050}), Eq(stub_surface1));
+}
+
+TEST_F(SurfaceStack, surface_at_finds_input_region_outside_window)
+{
+    stack.add_surface(stub_surface1, mi::InputReceptionMode::normal);
+    EXPECT_THAT(stack.surface_at({50, 50}).get(), IsNull());
+
+    stub_surface1->set_input_region({{{40, 40}, {20, 20}}});
+    executor.execute();
+
+    EXPECT_THAT(stack.surface_at({50, 50}), Eq(stub_surface1));
+}
+
+TEST_F(SurfaceStack, released_scene_elements_are_recycled_for_the_next_frame)
+{
+    stack.add_surface(stub_surface1, mi::InputReceptionMode::normal);
+    stack.add_surface(stub_surface2, mi::InputReceptionMode::normal);
+
+    std::set<mc::SceneElement const*> first_frame;
+    for (auto const& element : stack.scene_elements_for(compositor_id))
+        first_frame.insert(element.get());
+
+    std::set<mc::SceneElement const*> second_frame;
+    for (auto const& element : stack.scene_elements_for(compositor_id))
+        second_frame.insert(element.get());
+
+    EXPECT_THAT(second_frame, SizeIs(2));
+    EXPECT_THAT(second_frame, Eq(first_frame));
+}
+
+TEST_F(SurfaceStack, scene_elements_still_held_are_not_recycled)
+{
+    stack.add_surface(stub_surface1, mi::InputReceptionMode::normal);
+
+    auto const held = stack.scene_elements_for(compositor_id);
+    auto const next = stack.scene_elements_for(compositor_id);
+
+    ASSERT_THAT(held, SizeIs(1));
+    ASSERT_THAT(next, SizeIs(1));
+    EXPECT_THAT(next.front().get(), Ne(held.front().get()));
+    EXPECT_THAT(held.front()->renderable(), NotNull());
+}
+
+namespace
+{
+struct SurfaceWithDepthLayerCallback : StubSurface
+{
+    using StubSurface::StubSurface;
+
+    auto depth_layer() const -> MirDepthLayer override
+    {
+        if (auto const callback = std::exchange(on_depth_layer, {}))
+            callback();
+        return StubSurface::depth_layer();
+    }
+
+    std::function<void()> mutable on_depth_layer;
+};
+}
+
+TEST_F(SurfaceStack, readers_do_not_wait_for_a_change_in_progress)
+{
+    stack.add_surface(stub_surface1, mi::InputReceptionMode::normal);
+
+    auto const surface = std::make_shared<SurfaceWithDepthLayerCallback>(stub_buffer_stream2, executor);
+    std::future<size_t> reader;
+    std::future_status reader_status{std::future_status::deferred};
+    surface->on_depth_layer = [&]
+        {
+            // Called while add_surface() has the stack locked against other changes
+            reader = std::async(std::launch::async, [&]{ return stack.scene_elements_for(compositor_id).size(); });
+            reader_status = reader.wait_for(std::chrono::seconds{5});
+        };
+    stack.add_surface(surface, mi::InputReceptionMode::normal);
+
+    EXPECT_THAT(reader_status, Eq(std::future_status::ready));
+    EXPECT_THAT(reader.get(), Eq(1u));
+}